@@ -0,0 +1,133 @@
+#include "CellLocator.h"
+#include <cstdio>
+
+static uint64_t record_key(const CellRecord& record)
+{
+    return (uint64_t)record.key_hi << 32 | record.key_lo;
+}
+
+CellLocator::CellLocator()
+    : header(nullptr),
+      cells(nullptr)
+{
+}
+
+uint64_t CellLocator::key(uint16_t mcc, uint16_t mnc, uint32_t area, uint32_t cell_id)
+{
+    return (uint64_t)(mcc & 0x3FF) << 54 | (uint64_t)(mnc & 0x3FF) << 44 |
+           (uint64_t)(area & 0xFFFF) << 28 | (cell_id & 0xFFFFFFF);
+}
+
+uint32_t CellLocator::checksum(const uint8_t* data, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+bool CellLocator::open(const uint8_t* image, size_t max_len)
+{
+    header = nullptr;
+
+    const CellTableHeader* candidate = (const CellTableHeader*)image;
+    if (!image || max_len < sizeof(CellTableHeader) ||
+        candidate->magic != CELL_MAGIC || candidate->version != CELL_VERSION ||
+        candidate->header_size != sizeof(CellTableHeader))
+    {
+        return false;
+    }
+
+    uint64_t cells_end = (uint64_t)candidate->cells_offset + (uint64_t)candidate->count * sizeof(CellRecord);
+    if (candidate->count == 0 || candidate->cells_offset % 4 != 0 || cells_end > max_len)
+    {
+        printf("[CellLocator] Bad table layout\n");
+        return false;
+    }
+
+    if (checksum(image + candidate->cells_offset, cells_end - candidate->cells_offset) != candidate->checksum)
+    {
+        printf("[CellLocator] Table checksum mismatch\n");
+        return false;
+    }
+
+    header = candidate;
+    cells = (const CellRecord*)(image + header->cells_offset);
+    return true;
+}
+
+size_t CellLocator::imageSize() const
+{
+    return header ? header->cells_offset + header->count * sizeof(CellRecord) : 0;
+}
+
+const CellRecord* CellLocator::find(const sim7670g_cell_t& cell) const
+{
+    if (!header)
+    {
+        return nullptr;
+    }
+
+    uint64_t wanted = key(cell.mcc, cell.mnc, cell.area, cell.cell_id);
+    uint32_t lo = 0, hi = header->count;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        uint64_t k = record_key(cells[mid]);
+        if (k == wanted)
+        {
+            return &cells[mid];
+        }
+        if (k < wanted)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return nullptr;
+}
+
+bool CellLocator::locate(const sim7670g_cell_t* observed, int count, CellFix* fix) const
+{
+    // Stronger cells weigh more: dB above -140, at least 1
+    int64_t lat_sum = 0, lon_sum = 0;
+    uint64_t range_sum = 0;
+    int64_t weight_sum = 0;
+    int found = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        const CellRecord* record = find(observed[i]);
+        if (!record)
+        {
+            continue;
+        }
+
+        int64_t weight = observed[i].signal_dbm ? observed[i].signal_dbm + 140 : 1;
+        if (weight < 1)
+        {
+            weight = 1;
+        }
+        lat_sum += weight * record->lat_e6;
+        lon_sum += weight * record->lon_e6;
+        range_sum += weight * (record->range_m ? record->range_m : CELL_DEFAULT_RANGE_M);
+        weight_sum += weight;
+        found++;
+    }
+
+    if (found == 0)
+    {
+        return false;
+    }
+
+    fix->lat_e6 = (int32_t)(lat_sum / weight_sum);
+    fix->lon_e6 = (int32_t)(lon_sum / weight_sum);
+    fix->accuracy_m = (uint32_t)(range_sum / weight_sum);
+    fix->cells = found;
+    return true;
+}
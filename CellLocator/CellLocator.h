@@ -0,0 +1,87 @@
+#ifndef CELL_LOCATOR_H
+#define CELL_LOCATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sim7670g_parse.h"
+
+// Table image built on the host by tools/cell_build and flashed apart from
+// the firmware: picotool load -o 0x10200000 cells.bin
+#ifndef CELL_FLASH_OFFSET
+#define CELL_FLASH_OFFSET 0x200000
+#endif
+
+// Room up to the geocoding index (GEOCODER_FLASH_OFFSET)
+#define CELL_FLASH_SIZE 0x100000
+
+#define CELL_MAGIC 0x314C4543          // "CEL1"
+#define CELL_VERSION 1
+
+// Accuracy given to a cell whose range is unknown (m)
+#define CELL_DEFAULT_RANGE_M 2000
+
+// On-flash layout, little endian, every field 4-byte aligned
+struct CellTableHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t count;            // cells
+    uint32_t cells_offset;     // from the start of the image
+    uint32_t checksum;         // FNV-1a over the cells
+    uint32_t reserved;
+};
+
+// Sorted by key = mcc:10 | mnc:10 | area:16 | cell id:28 (see key())
+struct CellRecord
+{
+    uint32_t key_hi;
+    uint32_t key_lo;
+    int32_t lat_e6;
+    int32_t lon_e6;
+    uint32_t range_m;          // coverage radius estimated from the samples
+};
+
+struct CellFix
+{
+    int32_t lat_e6;
+    int32_t lon_e6;
+    uint32_t accuracy_m;
+    int cells;                 // cells found in the table
+};
+
+/**
+ * Coarse position from cell identities, looked up in a table read in place
+ * from flash (XIP). Answers at once with no GNSS fix and no network call;
+ * the accuracy is the cell range, typically 0.5-5 km.
+ *
+ * Pure logic with no SDK dependency: the image is just a pointer, so the
+ * same code runs on the host (tools/cell_build --bench).
+ */
+class CellLocator
+{
+public:
+    CellLocator();
+
+    // Validate a table image; false (and isOpen() false) if there is none
+    bool open(const uint8_t* image, size_t max_len);
+
+    bool isOpen() const { return header != nullptr; }
+    uint32_t size() const { return header ? header->count : 0; }
+    size_t imageSize() const;
+
+    // Binary search on the key; nullptr if the cell is not in the table
+    const CellRecord* find(const sim7670g_cell_t& cell) const;
+
+    // Position of the cells found, weighted by signal; false if none is known
+    bool locate(const sim7670g_cell_t* cells, int count, CellFix* fix) const;
+
+    static uint64_t key(uint16_t mcc, uint16_t mnc, uint32_t area, uint32_t cell_id);
+    static uint32_t checksum(const uint8_t* data, size_t len);
+
+private:
+    const CellTableHeader* header;
+    const CellRecord* cells;
+};
+
+#endif // CELL_LOCATOR_H
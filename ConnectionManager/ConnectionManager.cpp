@@ -0,0 +1,127 @@
+#include "ConnectionManager.h"
+#include <cstdio>
+#include "pico/stdlib.h"
+
+static uint32_t now_ms()
+{
+    return to_ms_since_boot(get_absolute_time());
+}
+
+ConnectionManager::ConnectionManager(ModemArbiter & arbiter)
+    : arbiter(arbiter),
+      sim7670g(arbiter.modem()),
+      down(false),
+      down_since(0),
+      next_attempt_time(0),
+      retry_delay(CONNECTION_RETRY_MIN_MS),
+      attempts(0),
+      transaction(0),
+      connection_stats()
+{
+}
+
+ConnectionManager::~ConnectionManager()
+{
+}
+
+bool ConnectionManager::isUp() const
+{
+    return sim7670g.sim7670g_link_up();
+}
+
+void ConnectionManager::onGiveUp(std::function<void()> callback)
+{
+    give_up_callback = callback;
+}
+
+void ConnectionManager::link_restored(uint32_t now)
+{
+    uint32_t elapsed = now - down_since;
+
+    down = false;
+    attempts = 0;
+    retry_delay = CONNECTION_RETRY_MIN_MS;
+
+    connection_stats.reconnects++;
+    connection_stats.last_ms = elapsed;
+    connection_stats.total_ms += elapsed;
+    if (elapsed > connection_stats.max_ms)
+    {
+        connection_stats.max_ms = elapsed;
+    }
+
+    printf("[ConnectionManager] ✓ Link up again after %u ms\n", elapsed);
+}
+
+void ConnectionManager::attempt_done(bool ok)
+{
+    transaction = 0;
+    uint32_t now = now_ms();
+
+    if (ok)
+    {
+        link_restored(now);
+        return;
+    }
+
+    connection_stats.failed_attempts++;
+    next_attempt_time = now + retry_delay;
+    printf("[ConnectionManager] Reconnect failed, retry in %u ms\n", retry_delay);
+    retry_delay = retry_delay * 2 > CONNECTION_RETRY_MAX_MS ? CONNECTION_RETRY_MAX_MS : retry_delay * 2;
+
+    if (++attempts == CONNECTION_MAX_ATTEMPTS && give_up_callback)
+    {
+        give_up_callback();
+    }
+}
+
+void ConnectionManager::loop()
+{
+    // Las URC de red actualizan el estado dentro de Sim7670G
+    arbiter.execute("urc", MODEM_PRIORITY_NORMAL, 
+        [](Sim7670G & sim) { sim.sim7670g_poll_urc(sim7670g_deadline(0)); return true; });
+
+    uint32_t now = now_ms();
+
+    if (isUp())
+    {
+        // Came back on its own (network-initiated PDN activation)
+        if (down && transaction == 0)
+        {
+            link_restored(now);
+        }
+        return;
+    }
+
+    if (!down)
+    {
+        down = true;
+        down_since = sim7670g.sim7670g_link_down_since();
+        next_attempt_time = now;
+        connection_stats.drops++;
+        printf("[ConnectionManager] Link down, holding network traffic\n");
+    }
+
+    if (transaction != 0 || (int32_t)(now - next_attempt_time) < 0)
+    {
+        return;
+    }
+
+    ModemTransaction reconnect = {};
+    reconnect.name = "reconnect";
+    reconnect.priority = MODEM_PRIORITY_URGENT;
+    reconnect.run = [](Sim7670G & sim)
+    {
+        return sim.sim7670g_connect(sim7670g_deadline(CONNECTION_REGISTER_TIMEOUT_MS));
+    };
+    reconnect.done = [this](bool ok) { attempt_done(ok); };
+    transaction = arbiter.submit(reconnect);
+}
+
+int ConnectionManager::format(char* buffer, size_t len) const
+{
+    const ConnectionStats& s = connection_stats;
+    return snprintf(buffer, len, "Enlace: %s, %u caídas, %u reconexiones (%u ms medio, %u ms máx)\n",
+                    isUp() ? "activo" : "caído", s.drops, s.reconnects,
+                    s.reconnects ? (unsigned)(s.total_ms / s.reconnects) : 0u, s.max_ms);
+}
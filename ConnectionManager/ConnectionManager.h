@@ -0,0 +1,76 @@
+#ifndef CONNECTION_MANAGER_H
+#define CONNECTION_MANAGER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include "ModemArbiter.h"
+
+// Plazo de cada intento de reconexión: registro, GPRS, PDP y HTTP (ms)
+#define CONNECTION_REGISTER_TIMEOUT_MS 20000
+
+// Reintentos: espera inicial y máxima (ms)
+#define CONNECTION_RETRY_MIN_MS 2000
+#define CONNECTION_RETRY_MAX_MS 60000
+
+// Intentos fallidos antes de avisar a onGiveUp()
+#define CONNECTION_MAX_ATTEMPTS 3
+
+struct ConnectionStats
+{
+    uint32_t drops;             // link lost (URC or failed init)
+    uint32_t reconnects;
+    uint32_t failed_attempts;
+    uint32_t last_ms;           // link down -> link up
+    uint32_t max_ms;
+    uint64_t total_ms;
+};
+
+/**
+ * Keeps the data link up, driven by +CREG/+CEREG/+CGEV URCs.
+ *
+ * Sim7670G tracks registration, attach, PDP and HTTP state from the URCs;
+ * when any of them drops this runs sim7670g_connect(), which only repeats
+ * the missing steps instead of the full init. Network transactions wait in
+ * the arbiter queue meanwhile (see ModemArbiter::setNetworkGate).
+ */
+class ConnectionManager
+{
+public:
+    explicit ConnectionManager(ModemArbiter & arbiter);
+    ~ConnectionManager();
+
+    // Leer URC pendientes y reconectar si hace falta (llamar en bucle principal)
+    void loop();
+
+    bool isUp() const;
+
+    // Próximo reintento mientras el enlace está caído
+    uint32_t nextRetryTime() const { return next_attempt_time; }
+    bool isDown() const { return down; }
+
+    // Aviso tras CONNECTION_MAX_ATTEMPTS intentos fallidos seguidos
+    void onGiveUp(std::function<void()> callback);
+
+    const ConnectionStats& stats() const { return connection_stats; }
+
+    // Human-readable summary
+    int format(char* buffer, size_t len) const;
+
+private:
+    ModemArbiter & arbiter;
+    Sim7670G & sim7670g;
+    std::function<void()> give_up_callback;
+    bool down;
+    uint32_t down_since;
+    uint32_t next_attempt_time;
+    uint32_t retry_delay;
+    int attempts;
+    uint32_t transaction;       // queued reconnect, 0 if none
+    ConnectionStats connection_stats;
+
+    void link_restored(uint32_t now);
+    void attempt_done(bool ok);
+};
+
+#endif // CONNECTION_MANAGER_H
@@ -0,0 +1,210 @@
+#include "DataBudget.h"
+#include <cstdio>
+
+static const char* class_names[DATA_CLASS_COUNT] =
+{
+    "poll", "message", "telemetry", "mqtt", "other"
+};
+
+// Start and end (Unix s) of the UTC calendar month holding unix_s
+static void month_bounds(uint32_t unix_s, uint32_t* start, uint32_t* end)
+{
+    // Days to civil date (H. Hinnant), valid for any uint32_t time
+    uint32_t days = unix_s / 86400;
+    uint32_t z = days + 719468;
+    uint32_t era = z / 146097;
+    uint32_t doe = z - era * 146097;
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    uint32_t day = doy - (153 * mp + 2) / 5 + 1;
+    uint32_t month = mp < 10 ? mp + 3 : mp - 9;
+    uint32_t year = yoe + era * 400 + (month <= 2);
+
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    uint32_t month_days = month == 2 ? (leap ? 29 : 28) : 30 + ((month ^ (month >> 3)) & 1);
+
+    *start = (days - (day - 1)) * 86400;
+    *end = *start + month_days * 86400;
+}
+
+DataBudget::DataBudget(uint64_t budget_bytes, uint32_t period_s)
+    : budget_bytes(budget_bytes),
+      period_s(period_s),
+      elapsed_ms(0),
+      uptime_ms(0),
+      last_tick_ms(0),
+      ticked(false),
+      calendar(false),
+      month_start_s(0),
+      month_end_s(0),
+      carried_bytes(0),
+      classes()
+{
+}
+
+uint32_t DataBudget::estimate(uint32_t request_bytes, uint32_t response_bytes, bool new_tls)
+{
+    uint32_t bytes = request_bytes + response_bytes
+                   + DATA_BUDGET_HTTP_HEADERS_BYTES
+                   + 2 * DATA_BUDGET_TLS_RECORD_BYTES
+                   + DATA_BUDGET_TCP_IP_BYTES;
+
+    if (new_tls)
+    {
+        bytes += DATA_BUDGET_TLS_HANDSHAKE_BYTES;
+    }
+    return bytes;
+}
+
+void DataBudget::record(DataClass data_class, uint32_t request_bytes, uint32_t response_bytes, bool new_tls)
+{
+    DataUsage& usage = classes[data_class];
+    usage.requests++;
+    usage.bytes += estimate(request_bytes, response_bytes, new_tls);
+}
+
+void DataBudget::tick(uint32_t now_ms, uint32_t utc_s)
+{
+    // Unsigned difference: still right across the 32-bit wrap of the ms clock
+    uint32_t delta = ticked ? now_ms - last_tick_ms : 0;
+    last_tick_ms = now_ms;
+    ticked = true;
+    uptime_ms += delta;
+
+    if (utc_s != 0)
+    {
+        if (!calendar || utc_s < month_start_s || utc_s >= month_end_s)
+        {
+            start_month(utc_s, !calendar);
+        }
+        elapsed_ms = (uint64_t)(utc_s - month_start_s) * 1000;
+        return;
+    }
+
+    elapsed_ms += delta;
+    if (!calendar && elapsed_ms >= (uint64_t)period_s * 1000)
+    {
+        new_period();
+        elapsed_ms %= (uint64_t)period_s * 1000;
+    }
+}
+
+void DataBudget::start_month(uint32_t utc_s, bool first)
+{
+    uint32_t start, end;
+    month_bounds(utc_s, &start, &end);
+
+    if (first)
+    {
+        // Traffic counted since boot stays; the month before boot is assumed on pace
+        uint32_t boot_s = utc_s - (uint32_t)(uptime_ms / 1000);
+        carried_bytes = boot_s > start ? budget_bytes * (boot_s - start) / (end - start) : 0;
+        printf("[DataBudget] Network time: month started %u s ago, %llu bytes assumed spent before boot\n",
+               utc_s - start, (unsigned long long)carried_bytes);
+    }
+    else if (utc_s >= month_end_s)
+    {
+        new_period();
+    }
+
+    calendar = true;
+    month_start_s = start;
+    month_end_s = end;
+    period_s = end - start;
+}
+
+void DataBudget::new_period()
+{
+    printf("[DataBudget] New period, %llu bytes used in the last one\n",
+           (unsigned long long)used());
+
+    carried_bytes = 0;
+    for (int i = 0; i < DATA_CLASS_COUNT; i++)
+    {
+        classes[i] = {0, 0};
+    }
+}
+
+uint64_t DataBudget::used() const
+{
+    uint64_t total = carried_bytes;
+    for (int i = 0; i < DATA_CLASS_COUNT; i++)
+    {
+        total += classes[i].bytes;
+    }
+    return total;
+}
+
+uint64_t DataBudget::remaining() const
+{
+    uint64_t spent = used();
+    return spent < budget_bytes ? budget_bytes - spent : 0;
+}
+
+bool DataBudget::overPace() const
+{
+    // Some slack, or the first request of a period would already be ahead of pace
+    uint64_t paced_s = (uint64_t)elapsed_s() + DATA_BUDGET_PACE_SLACK_S;
+    uint64_t allowed = paced_s < period_s ? budget_bytes * paced_s / period_s : budget_bytes;
+    return used() > allowed;
+}
+
+uint32_t DataBudget::pollInterval(uint32_t base_interval_ms) const
+{
+    // The polls' own share of what this boot may spend, less what they used
+    const DataUsage& polls = classes[DATA_CLASS_POLL];
+    uint64_t poll_share = (uint64_t)((budget_bytes - carried_bytes) * DATA_BUDGET_POLL_SHARE);
+    uint64_t poll_left = poll_share > polls.bytes ? poll_share - polls.bytes : 0;
+    if (poll_left > remaining())
+    {
+        poll_left = remaining();
+    }
+    if (poll_left == 0)
+    {
+        return DATA_BUDGET_MAX_POLL_INTERVAL_MS;
+    }
+
+    uint32_t elapsed = elapsed_s();
+    uint32_t left_s = elapsed < period_s ? period_s - elapsed : 1;
+
+    uint64_t poll_cost = polls.requests ? polls.bytes / polls.requests : DATA_BUDGET_DEFAULT_POLL_BYTES;
+
+    // Polls the remaining share can pay for, spread over the rest of the period
+    uint64_t interval_ms = poll_cost * left_s * 1000ULL / poll_left;
+
+    if (interval_ms < base_interval_ms)
+    {
+        return base_interval_ms;
+    }
+    if (interval_ms > DATA_BUDGET_MAX_POLL_INTERVAL_MS)
+    {
+        return DATA_BUDGET_MAX_POLL_INTERVAL_MS;
+    }
+    return (uint32_t)interval_ms;
+}
+
+int DataBudget::format(char* buffer, size_t len) const
+{
+    int pos = snprintf(buffer, len, "Datos: %llu/%llu KB (día %u de %u%s)\n",
+                       (unsigned long long)(used() / 1024), (unsigned long long)(budget_bytes / 1024),
+                       elapsed_s() / 86400 + 1, period_s / 86400, calendar ? "" : " desde el arranque");
+
+    if (carried_bytes > 0 && pos > 0 && (size_t)pos < len)
+    {
+        pos += snprintf(buffer + pos, len - pos, "antes del arranque (estimado): %llu KB\n",
+                        (unsigned long long)(carried_bytes / 1024));
+    }
+
+    for (int i = 0; i < DATA_CLASS_COUNT && pos > 0 && (size_t)pos < len; i++)
+    {
+        if (classes[i].requests == 0)
+        {
+            continue;
+        }
+        pos += snprintf(buffer + pos, len - pos, "%s: %u peticiones, %llu KB\n",
+                        class_names[i], classes[i].requests,
+                        (unsigned long long)(classes[i].bytes / 1024));
+    }
+    return pos;
+}
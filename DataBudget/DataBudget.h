@@ -0,0 +1,101 @@
+#ifndef DATA_BUDGET_H
+#define DATA_BUDGET_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Estimaciones de overhead por petición (bytes)
+#define DATA_BUDGET_TLS_HANDSHAKE_BYTES 5500   // full handshake incl. certificate chain
+#define DATA_BUDGET_TLS_RECORD_BYTES 29        // record header + AEAD tag, per direction
+#define DATA_BUDGET_TCP_IP_BYTES 120           // SYN/ACK/FIN and per segment headers
+#define DATA_BUDGET_HTTP_HEADERS_BYTES 350     // request + response headers
+#define DATA_BUDGET_DEFAULT_POLL_BYTES 1500    // assumed poll cost until measured
+
+// Límites del intervalo de polling ajustado al presupuesto
+#define DATA_BUDGET_MAX_POLL_INTERVAL_MS (15 * 60 * 1000)
+
+// Fracción del presupuesto reservada para polling (resto: mensajes y telemetría)
+#define DATA_BUDGET_POLL_SHARE 0.6
+
+// Margen de ritmo: se puede ir adelantado hasta este tiempo de presupuesto (s)
+#define DATA_BUDGET_PACE_SLACK_S (24u * 3600u)
+
+enum DataClass
+{
+    DATA_CLASS_POLL = 0,
+    DATA_CLASS_MESSAGE,
+    DATA_CLASS_TELEMETRY,
+    DATA_CLASS_MQTT,
+    DATA_CLASS_OTHER,
+    DATA_CLASS_COUNT
+};
+
+struct DataUsage
+{
+    uint32_t requests;
+    uint64_t bytes;
+};
+
+/**
+ * Cellular data accounting against a monthly budget.
+ *
+ * Every request is charged with its payload plus estimated HTTP, TLS and
+ * TCP/IP overhead. pollInterval() stretches the polling period so that the
+ * polling share of the remaining budget lasts until the end of the period.
+ *
+ * Once network time is known the period is the calendar month (UTC), as
+ * carriers bill. Counters are not persisted: after a reboot in mid-month
+ * the part of the month before boot is assumed spent at the budget pace.
+ * Until then the period runs from boot with the fallback length.
+ *
+ * Pure logic with no SDK dependency: time only enters through tick()
+ * (tools/budget_replay).
+ */
+class DataBudget
+{
+public:
+    // period_s: period length while there is no network time
+    DataBudget(uint64_t budget_bytes, uint32_t period_s);
+
+    // Estimar bytes en el aire de una petición
+    static uint32_t estimate(uint32_t request_bytes, uint32_t response_bytes, bool new_tls);
+
+    // Registrar una petición
+    void record(DataClass data_class, uint32_t request_bytes, uint32_t response_bytes, bool new_tls);
+
+    // Avanzar el reloj: ms desde el arranque y hora Unix UTC (0 = sin hora de red).
+    // Reinicia contadores al empezar un nuevo periodo
+    void tick(uint32_t now_ms, uint32_t utc_s);
+
+    // Intervalo de polling permitido (>= base_interval_ms)
+    uint32_t pollInterval(uint32_t base_interval_ms) const;
+
+    // ¿Se gasta más rápido de lo que permite el presupuesto?
+    bool overPace() const;
+
+    uint64_t used() const;
+    uint64_t remaining() const;
+    const DataUsage& usage(DataClass data_class) const { return classes[data_class]; }
+
+    // Resumen legible para /datos
+    int format(char* buffer, size_t len) const;
+
+private:
+    uint64_t budget_bytes;
+    uint32_t period_s;         // current period length
+    uint64_t elapsed_ms;       // into the current period
+    uint64_t uptime_ms;
+    uint32_t last_tick_ms;
+    bool ticked;
+    bool calendar;             // period is a UTC calendar month
+    uint32_t month_start_s;
+    uint32_t month_end_s;
+    uint64_t carried_bytes;    // assumed spent this month before boot
+    DataUsage classes[DATA_CLASS_COUNT];
+
+    void new_period();
+    void start_month(uint32_t utc_s, bool first);
+    uint32_t elapsed_s() const { return (uint32_t)(elapsed_ms / 1000); }
+};
+
+#endif // DATA_BUDGET_H
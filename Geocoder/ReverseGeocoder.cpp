@@ -0,0 +1,174 @@
+#include "ReverseGeocoder.h"
+#include <cmath>
+#include <cstdio>
+
+// Metres per micro-degree of latitude (mean Earth radius)
+#define GEO_METERS_PER_E6 0.1111951
+
+// Radians per micro-degree
+#define GEO_RADIANS_PER_E6 1.7453293e-8f
+
+// Longitude delta shrunk by cos(lat): same units as a latitude delta
+static int64_t scaled_lon(int64_t dlon, int32_t cos_q16)
+{
+    return (dlon * cos_q16) >> 16;
+}
+
+ReverseGeocoder::ReverseGeocoder()
+    : header(nullptr),
+      nodes(nullptr),
+      names(nullptr)
+{
+}
+
+uint32_t ReverseGeocoder::checksum(const uint8_t* data, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+bool ReverseGeocoder::open(const uint8_t* image, size_t max_len)
+{
+    header = nullptr;
+
+    const GeoIndexHeader* candidate = (const GeoIndexHeader*)image;
+    if (!image || max_len < sizeof(GeoIndexHeader) ||
+        candidate->magic != GEOCODER_MAGIC || candidate->version != GEOCODER_VERSION ||
+        candidate->header_size != sizeof(GeoIndexHeader))
+    {
+        return false;
+    }
+
+    // Names follow the nodes; both must fit in the flash region
+    uint64_t nodes_end = (uint64_t)candidate->nodes_offset + (uint64_t)candidate->count * sizeof(GeoNode);
+    uint64_t names_end = (uint64_t)candidate->names_offset + candidate->names_size;
+    if (candidate->count == 0 || candidate->nodes_offset % 4 != 0 ||
+        candidate->names_offset != nodes_end || names_end > max_len ||
+        candidate->names_size == 0 || image[names_end - 1] != '\0')
+    {
+        printf("[Geocoder] Bad index layout\n");
+        return false;
+    }
+
+    if (checksum(image + candidate->nodes_offset, names_end - candidate->nodes_offset) != candidate->checksum)
+    {
+        printf("[Geocoder] Index checksum mismatch\n");
+        return false;
+    }
+
+    header = candidate;
+    nodes = (const GeoNode*)(image + header->nodes_offset);
+    names = (const char*)(image + header->names_offset);
+    return true;
+}
+
+size_t ReverseGeocoder::imageSize() const
+{
+    return header ? header->names_offset + header->names_size : 0;
+}
+
+void ReverseGeocoder::search(uint32_t lo, uint32_t hi, int depth, Query& query) const
+{
+    // Recurse into the near side, loop on the far one while it can still win
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        const GeoNode& node = nodes[mid];
+
+        int64_t dlat = (int64_t)query.lat_e6 - node.lat_e6;
+        int64_t dlon = scaled_lon((int64_t)query.lon_e6 - node.lon_e6, query.cos_q16);
+
+        if (query.kinds & (1u << (node.name >> 24)))
+        {
+            uint64_t d2 = (uint64_t)(dlat * dlat) + (uint64_t)(dlon * dlon);
+            if (d2 < query.best_d2)
+            {
+                query.best_d2 = d2;
+                query.best = &node;
+            }
+        }
+
+        int64_t delta = (depth & 1) ? dlon : dlat;
+        uint32_t near_lo = delta < 0 ? lo : mid + 1;
+        uint32_t near_hi = delta < 0 ? mid : hi;
+
+        search(near_lo, near_hi, depth + 1, query);
+
+        if ((uint64_t)(delta * delta) >= query.best_d2)
+        {
+            return;
+        }
+
+        lo = delta < 0 ? mid + 1 : lo;
+        hi = delta < 0 ? hi : mid;
+        depth++;
+    }
+}
+
+bool ReverseGeocoder::nearest(int32_t lat_e6, int32_t lon_e6, uint32_t kinds, GeoPlace* place,
+                              uint32_t max_distance_m) const
+{
+    if (!header || !place)
+    {
+        return false;
+    }
+
+    Query query;
+    query.lat_e6 = lat_e6;
+    query.lon_e6 = lon_e6;
+    query.cos_q16 = (int32_t)(cosf(lat_e6 * GEO_RADIANS_PER_E6) * 65536.0f);
+    query.kinds = kinds;
+    query.best = nullptr;
+
+    // Half the Earth's circumference covers everything
+    double limit = max_distance_m / GEO_METERS_PER_E6;
+    query.best_d2 = max_distance_m >= 20000000u ? UINT64_MAX : (uint64_t)(limit * limit) + 1;
+
+    search(0, header->count, 0, query);
+
+    if (!query.best || (query.best->name & 0xFFFFFF) >= header->names_size)
+    {
+        return false;
+    }
+
+    place->name = names + (query.best->name & 0xFFFFFF);
+    place->kind = (GeoKind)(query.best->name >> 24);
+    place->lat_e6 = query.best->lat_e6;
+    place->lon_e6 = query.best->lon_e6;
+    place->distance_m = (uint32_t)(sqrt((double)query.best_d2) * GEO_METERS_PER_E6);
+    return true;
+}
+
+int ReverseGeocoder::describe(int32_t lat_e6, int32_t lon_e6, char* buffer, size_t len) const
+{
+    GeoPlace town = {};
+    GeoPlace road = {};
+    bool has_town = nearest(lat_e6, lon_e6, GEO_KINDS(GEO_KIND_TOWN), &town);
+    bool has_road = nearest(lat_e6, lon_e6, GEO_KINDS(GEO_KIND_ROAD), &road, GEOCODER_ROAD_RADIUS_M);
+
+    int pos = 0;
+    if (len > 0)
+    {
+        buffer[0] = '\0';
+    }
+    if (has_town)
+    {
+        if (town.distance_m < 1000)
+        {
+            pos = snprintf(buffer, len, "Cerca de %s (%u m)", town.name, town.distance_m);
+        }
+        else
+        {
+            pos = snprintf(buffer, len, "Cerca de %s (%.1f km)", town.name, town.distance_m / 1000.0);
+        }
+    }
+    if (has_road && pos >= 0 && (size_t)pos < len)
+    {
+        pos += snprintf(buffer + pos, len - pos, has_town ? ", %s" : "%s", road.name);
+    }
+    return pos;
+}
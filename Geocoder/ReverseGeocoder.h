@@ -0,0 +1,111 @@
+#ifndef REVERSE_GEOCODER_H
+#define REVERSE_GEOCODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Index image built on the host by tools/geocode_build and flashed apart from
+// the firmware: picotool load -o 0x10300000 places.bin
+#ifndef GEOCODER_FLASH_OFFSET
+#define GEOCODER_FLASH_OFFSET 0x300000
+#endif
+
+#define GEOCODER_MAGIC 0x314F4547      // "GEO1"
+#define GEOCODER_VERSION 1
+
+// Roads are only named when this close (m)
+#define GEOCODER_ROAD_RADIUS_M 300
+
+enum GeoKind
+{
+    GEO_KIND_TOWN = 0,
+    GEO_KIND_ROAD = 1,
+    GEO_KIND_POI = 2
+};
+
+// Kind filter for nearest()
+#define GEO_KINDS(kind) (1u << (kind))
+#define GEO_KINDS_ANY 0xFFu
+
+// On-flash layout, little endian, every field 4-byte aligned
+struct GeoIndexHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t count;            // places (k-d tree nodes)
+    uint32_t nodes_offset;     // from the start of the image
+    uint32_t names_offset;
+    uint32_t names_size;
+    uint32_t checksum;         // FNV-1a over nodes and names
+    uint32_t reserved;
+};
+
+// Implicit k-d tree: the node of range [lo, hi) sits at lo + (hi - lo) / 2,
+// split on latitude at even depths and longitude at odd ones
+struct GeoNode
+{
+    int32_t lat_e6;
+    int32_t lon_e6;
+    uint32_t name;             // kind << 24 | offset into the name table
+};
+
+struct GeoPlace
+{
+    const char* name;
+    GeoKind kind;
+    int32_t lat_e6;
+    int32_t lon_e6;
+    uint32_t distance_m;
+};
+
+/**
+ * Nearest-place lookup over a k-d tree read in place from flash (XIP).
+ *
+ * Coordinates are fixed point (degrees * 1e6). Distances use an
+ * equirectangular approximation scaled by cos(latitude) of the query, which
+ * is well under 1% off at town distances; the antimeridian is not handled.
+ *
+ * Pure logic with no SDK dependency: the image is just a pointer, so the
+ * same code runs on the host (tools/geocode_build --bench).
+ */
+class ReverseGeocoder
+{
+public:
+    ReverseGeocoder();
+
+    // Validate an index image; false (and isOpen() false) if there is none
+    bool open(const uint8_t* image, size_t max_len);
+
+    bool isOpen() const { return header != nullptr; }
+    uint32_t size() const { return header ? header->count : 0; }
+    size_t imageSize() const;
+
+    // Nearest place of one of 'kinds' within max_distance_m
+    bool nearest(int32_t lat_e6, int32_t lon_e6, uint32_t kinds, GeoPlace* place,
+                 uint32_t max_distance_m = UINT32_MAX) const;
+
+    // "Cerca de <town> (1.2 km), <road>"; 0 if nothing was found
+    int describe(int32_t lat_e6, int32_t lon_e6, char* buffer, size_t len) const;
+
+    static uint32_t checksum(const uint8_t* data, size_t len);
+
+private:
+    struct Query
+    {
+        int32_t lat_e6;
+        int32_t lon_e6;
+        int32_t cos_q16;           // cos(lat) in Q16, shrinks longitude deltas
+        uint32_t kinds;
+        uint64_t best_d2;
+        const GeoNode* best;
+    };
+
+    const GeoIndexHeader* header;
+    const GeoNode* nodes;
+    const char* names;
+
+    void search(uint32_t lo, uint32_t hi, int depth, Query& query) const;
+};
+
+#endif // REVERSE_GEOCODER_H
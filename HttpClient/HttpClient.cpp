@@ -0,0 +1,310 @@
+#include "HttpClient.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "pico/stdlib.h"
+
+static uint32_t now_ms()
+{
+    return to_ms_since_boot(get_absolute_time());
+}
+
+static uint32_t remaining_ms(uint32_t deadline_ms)
+{
+    int32_t left = (int32_t)(deadline_ms - now_ms());
+    return left > 0 ? (uint32_t)left : 0;
+}
+
+HttpClient::HttpClient(const char* host, int port)
+    : host(host),
+      port(port),
+      last_status(0),
+      http_stats(),
+      rx_pos(0),
+      rx_len(0),
+      truncated(false)
+{
+}
+
+HttpClient::~HttpClient()
+{
+}
+
+bool HttpClient::get(Sim7670G & sim7670g, const char* path,
+                     char* body, int body_len, uint32_t deadline_ms)
+{
+    int body_pos = 0;
+    bool ok = request(sim7670g, "GET", path, nullptr, 0, nullptr, 
+                      buffer_consumer(body, body_len, &body_pos), deadline_ms);
+    body[body_pos] = '\0';
+    return ok && !truncated;
+}
+
+bool HttpClient::getStream(Sim7670G & sim7670g, const char* path,
+                           const Sim7670G::ChunkConsumer& consumer, uint32_t deadline_ms)
+{
+    return request(sim7670g, "GET", path, nullptr, 0, nullptr, consumer, deadline_ms);
+}
+
+bool HttpClient::post(Sim7670G & sim7670g, const char* path, const char* content_type,
+                      const char* data, int data_len,
+                      char* body, int body_len, uint32_t deadline_ms)
+{
+    Sim7670G::BodyWriter writer = [data, data_len](const Sim7670G::ChunkConsumer& out)
+    {
+        return data_len <= 0 || out(data, data_len);
+    };
+    return postStream(sim7670g, path, content_type, data_len, writer, body, body_len, deadline_ms);
+}
+
+bool HttpClient::postStream(Sim7670G & sim7670g, const char* path, const char* content_type,
+                            int data_len, const Sim7670G::BodyWriter& writer,
+                            char* body, int body_len, uint32_t deadline_ms)
+{
+    int body_pos = 0;
+    bool ok = request(sim7670g, "POST", path, content_type, data_len, &writer, 
+                      buffer_consumer(body, body_len, &body_pos), deadline_ms);
+    body[body_pos] = '\0';
+    return ok && !truncated;
+}
+
+Sim7670G::ChunkConsumer HttpClient::buffer_consumer(char* body, int body_len, int* body_pos)
+{
+    truncated = false;
+
+    // Bytes beyond body_len are dropped, the rest of the body is still read
+    return [this, body, body_len, body_pos](const char* data, int len)
+    {
+        int room = body_len - 1 - *body_pos;
+        int copy = len < room ? len : room;
+        if (copy > 0)
+        {
+            memcpy(body + *body_pos, data, copy);
+            *body_pos += copy;
+        }
+        if (copy < len)
+        {
+            truncated = true;
+            printf("[HttpClient] ⚠️  Body truncated to %d bytes\n", *body_pos);
+            return false;
+        }
+        return true;
+    };
+}
+
+void HttpClient::close(Sim7670G & sim7670g)
+{
+    sim7670g.sim7670g_ssl_close();
+    rx_pos = 0;
+    rx_len = 0;
+}
+
+bool HttpClient::request(Sim7670G & sim7670g, const char* method, const char* path,
+                         const char* content_type, int data_len, const Sim7670G::BodyWriter* writer,
+                         const Sim7670G::ChunkConsumer& consumer, uint32_t deadline)
+{
+    uint32_t start = now_ms();
+    uint32_t rx_before = http_stats.rx_bytes;
+    uint32_t tx_before = http_stats.tx_bytes;
+
+    last_status = 0;
+    http_stats.requests++;
+
+    // Un reintento: el servidor puede haber cerrado una conexión keep-alive
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        bool reused = sim7670g.sim7670g_ssl_is_open();
+        if (!reused)
+        {
+            rx_pos = 0;
+            rx_len = 0;
+            if (!sim7670g.sim7670g_ssl_open(host, port, deadline))
+            {
+                printf("[HttpClient] ❌ Connect to %s failed\n", host);
+                return timed_out(sim7670g);
+            }
+            http_stats.connects++;
+        }
+
+        if (!send_request(sim7670g, method, path, content_type, data_len, writer, deadline))
+        {
+            if (remaining_ms(deadline) == 0)
+            {
+                timed_out(sim7670g);
+                close(sim7670g);
+                return false;
+            }
+            close(sim7670g);
+            continue;
+        }
+
+        bool keep_alive = true;
+        uint32_t rx_mark = http_stats.rx_bytes;
+        bool ok = read_response(sim7670g, consumer, deadline, &keep_alive);
+
+        if (!ok && sim7670g.sim7670g_recv_aborted())
+        {
+            // The answer would still arrive on this socket: drop it, do not retry
+            printf("[HttpClient] %s %s abandoned for more urgent work\n", method, host);
+            close(sim7670g);
+            return false;
+        }
+
+        if (!ok && last_status == 0 && reused && http_stats.rx_bytes == rx_mark && remaining_ms(deadline) > 0)
+        {
+            // Nothing came back on a reused connection: stale, reconnect
+            printf("[HttpClient] Stale connection, reconnecting\n");
+            close(sim7670g);
+            continue;
+        }
+
+        if (!ok)
+        {
+            timed_out(sim7670g);
+        }
+        if (!ok || !keep_alive)
+        {
+            close(sim7670g);
+        }
+
+        if (reused)
+        {
+            http_stats.reused++;
+        }
+
+        http_stats.last_latency_ms = now_ms() - start;
+        http_stats.last_tx_bytes = http_stats.tx_bytes - tx_before;
+        http_stats.last_rx_bytes = http_stats.rx_bytes - rx_before;
+        http_stats.last_new_tls = !reused;
+        printf("[HttpClient] %s %s -> %d in %u ms (%s, %u B out, %u B in)\n",
+               method, host, last_status, http_stats.last_latency_ms,
+               reused ? "reused" : "new TLS",
+               http_stats.last_tx_bytes, http_stats.last_rx_bytes);
+
+        return ok && last_status == 200;
+    }
+
+    return false;
+}
+
+bool HttpClient::send_request(Sim7670G & sim7670g, const char* method, const char* path,
+                              const char* content_type, int data_len, const Sim7670G::BodyWriter* writer,
+                              uint32_t deadline_ms)
+{
+    char header[640];
+    int len;
+
+    if (writer)
+    {
+        len = snprintf(header, sizeof(header),
+                       "%s %s HTTP/1.1\r\n"
+                       "Host: %s\r\n"
+                       "Connection: keep-alive\r\n"
+                       "Accept-Encoding: identity\r\n"
+                       "Content-Type: %s\r\n"
+                       "Content-Length: %d\r\n"
+                       "\r\n",
+                       method, path, host, content_type, data_len);
+    }
+    else
+    {
+        len = snprintf(header, sizeof(header),
+                       "%s %s HTTP/1.1\r\n"
+                       "Host: %s\r\n"
+                       "Connection: keep-alive\r\n"
+                       "Accept-Encoding: identity\r\n"
+                       "\r\n",
+                       method, path, host);
+    }
+
+    if (len <= 0 || len >= (int)sizeof(header))
+    {
+        printf("[HttpClient] Request header too long\n");
+        return false;
+    }
+
+    if (!sim7670g.sim7670g_ssl_send(header, len, deadline_ms))
+    {
+        return false;
+    }
+    http_stats.tx_bytes += len;
+
+    if (!writer || data_len <= 0)
+    {
+        return true;
+    }
+
+    // Cada trozo del productor es un AT+CCHSEND
+    int sent = 0;
+    bool ok = (*writer)([this, &sim7670g, &sent, data_len, deadline_ms](const char* data, int n)
+    {
+        if (sent + n > data_len || !sim7670g.sim7670g_ssl_send(data, n, deadline_ms))
+        {
+            return false;
+        }
+        sent += n;
+        http_stats.tx_bytes += n;
+        return true;
+    });
+
+    if (!ok || sent != data_len)
+    {
+        printf("[HttpClient] ❌ Body: %d of %d bytes sent\n", sent, data_len);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Log where the deadline ran out, if it did; returns false
+ */
+bool HttpClient::timed_out(Sim7670G & sim7670g)
+{
+    sim7670g_stage_t stage = sim7670g.sim7670g_timeout_stage();
+    if (stage != SIM7670G_STAGE_NONE)
+    {
+        printf("[HttpClient] ⏱ Out of time in %s\n", sim7670g_stage_name(stage));
+    }
+    return false;
+}
+
+bool HttpClient::fill(Sim7670G & sim7670g, uint32_t deadline_ms)
+{
+    // Past the deadline ssl_recv returns at once and records the stage
+    int n = sim7670g.sim7670g_ssl_recv(rx, sizeof(rx), deadline_ms);
+    if (n <= 0)
+    {
+        return false;
+    }
+
+    rx_pos = 0;
+    rx_len = n;
+    http_stats.rx_bytes += n;
+    return true;
+}
+
+bool HttpClient::read_response(Sim7670G & sim7670g, const Sim7670G::ChunkConsumer& consumer,
+                               uint32_t deadline_ms, bool* keep_alive)
+{
+    response.begin(consumer);
+
+    while (!response.done() && !response.failed())
+    {
+        if (rx_pos >= rx_len && !fill(sim7670g, deadline_ms))
+        {
+            // Closed or out of time: only a body that runs until the close is complete
+            response.closed();
+            break;
+        }
+        rx_pos += response.feed(rx + rx_pos, rx_len - rx_pos);
+    }
+
+    last_status = response.status();
+    *keep_alive = response.keepAlive();
+    if (response.failed())
+    {
+        printf("[HttpClient] ❌ %s\n", last_status ? "Response cut short" : "No response");
+        return false;
+    }
+    return true;
+}
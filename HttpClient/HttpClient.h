@@ -0,0 +1,93 @@
+#ifndef HTTP_CLIENT_H
+#define HTTP_CLIENT_H
+
+#include <stdint.h>
+#include "sim7670g.h"
+#include "HttpResponse.h"
+
+// Tamaño del buffer de recepción del socket
+#define HTTP_CLIENT_RX_CHUNK 512
+
+struct HttpStats
+{
+    uint32_t requests;
+    uint32_t connects;         // TLS handshakes
+    uint32_t reused;           // requests served on an already open connection
+    uint32_t tx_bytes;         // HTTP bytes written (without TLS overhead)
+    uint32_t rx_bytes;         // HTTP bytes read (without TLS overhead)
+    uint32_t last_latency_ms;
+    uint32_t last_tx_bytes;    // last request only
+    uint32_t last_rx_bytes;
+    bool last_new_tls;
+};
+
+/**
+ * HTTP/1.1 client over one keep-alive TLS socket (Sim7670G AT+CCH*).
+ *
+ * The modem HTTP service (AT+HTTPACTION) negotiates TLS again on most
+ * requests; this client keeps the connection open and writes the requests
+ * itself, so getUpdates and sendMessage share a single handshake. A dropped
+ * connection is reopened once per request.
+ */
+class HttpClient
+{
+public:
+    HttpClient(const char* host, int port = 443);
+    ~HttpClient();
+
+    // Todas las peticiones acaban antes de 'deadline_ms' (sim7670g_deadline()),
+    // reintento de una conexión keep-alive caducada incluido
+
+    // GET, cuerpo copiado en 'body' (terminado en '\0')
+    bool get(Sim7670G & sim7670g, const char* path, 
+             char* body, int body_len, uint32_t deadline_ms);
+
+    // GET entregando el cuerpo por trozos, memoria constante
+    bool getStream(Sim7670G & sim7670g, const char* path,
+                   const Sim7670G::ChunkConsumer& consumer, uint32_t deadline_ms);
+
+    // POST con cuerpo 'data'
+    bool post(Sim7670G & sim7670g, const char* path, const char* content_type,
+              const char* data, int data_len,
+              char* body, int body_len, uint32_t deadline_ms);
+
+    // POST con cuerpo generado al enviar; 'data_len' es su tamaño exacto
+    bool postStream(Sim7670G & sim7670g, const char* path, const char* content_type,
+                    int data_len, const Sim7670G::BodyWriter& writer,
+                    char* body, int body_len, uint32_t deadline_ms);
+
+    // Cerrar la conexión
+    void close(Sim7670G & sim7670g);
+
+    // Status of the last response, 0 if no response was received
+    int lastStatus() const { return last_status; }
+
+    const HttpStats& stats() const { return http_stats; }
+
+private:
+    const char* host;
+    int port;
+    int last_status;
+    HttpStats http_stats;
+
+    // Buffer de recepción
+    char rx[HTTP_CLIENT_RX_CHUNK];
+    int rx_pos;
+    int rx_len;
+    bool truncated;
+    HttpResponse response;
+
+    Sim7670G::ChunkConsumer buffer_consumer(char* body, int body_len, int* body_pos);
+    bool request(Sim7670G & sim7670g, const char* method, const char* path,
+                 const char* content_type, int data_len, const Sim7670G::BodyWriter* writer,
+                 const Sim7670G::ChunkConsumer& consumer, uint32_t deadline_ms);
+    bool send_request(Sim7670G & sim7670g, const char* method, const char* path,
+                      const char* content_type, int data_len, const Sim7670G::BodyWriter* writer,
+                      uint32_t deadline_ms);
+    bool timed_out(Sim7670G & sim7670g);
+    bool read_response(Sim7670G & sim7670g, const Sim7670G::ChunkConsumer& consumer,
+                       uint32_t deadline_ms, bool* keep_alive);
+    bool fill(Sim7670G & sim7670g, uint32_t deadline_ms);
+};
+
+#endif // HTTP_CLIENT_H
@@ -0,0 +1,200 @@
+#include "HttpResponse.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#include "TextScan.h"
+
+HttpResponse::HttpResponse()
+    : state(FAILED),
+      accepting(false),
+      status_code(0),
+      keep_alive(false),
+      chunked(false),
+      content_length(-1),
+      remaining(0),
+      body_bytes(0),
+      line_len(0)
+{
+}
+
+void HttpResponse::begin(const Consumer& body_consumer)
+{
+    state = STATUS_LINE;
+    consumer = body_consumer;
+    accepting = true;
+    status_code = 0;
+    keep_alive = false;
+    chunked = false;
+    content_length = -1;
+    remaining = 0;
+    body_bytes = 0;
+    line_len = 0;
+}
+
+int HttpResponse::feed(const char* data, int len)
+{
+    int pos = 0;
+
+    while (pos < len && state != DONE && state != FAILED)
+    {
+        if (state == BODY || state == CHUNK_DATA || state == UNTIL_CLOSE)
+        {
+            int n = len - pos;
+            if (state != UNTIL_CLOSE && n > remaining)
+            {
+                n = (int)remaining;
+            }
+            deliver(data + pos, n);
+            pos += n;
+
+            if (state != UNTIL_CLOSE)
+            {
+                remaining -= n;
+                if (remaining == 0)
+                {
+                    state = state == BODY ? DONE : CHUNK_END;
+                }
+            }
+            continue;
+        }
+
+        // Up to the newline (or the end of the data) in one copy
+        int run = (int)text_find_newline(data + pos, len - pos);
+        int room = HTTP_RESPONSE_MAX_LINE - 1 - line_len;
+        int copy = run < room ? run : room;
+        memcpy(line + line_len, data + pos, copy);
+        line_len += copy;
+        pos += run;
+
+        if (pos < len)
+        {
+            // CRLF: the CR ends the copied run
+            pos++;
+            if (line_len > 0 && line[line_len - 1] == '\r')
+            {
+                line_len--;
+            }
+            line[line_len] = '\0';
+            handle_line();
+            line_len = 0;
+        }
+    }
+    return pos;
+}
+
+void HttpResponse::closed()
+{
+    if (state == UNTIL_CLOSE)
+    {
+        state = DONE;
+    }
+    else if (state != DONE)
+    {
+        state = FAILED;
+        keep_alive = false;
+    }
+}
+
+void HttpResponse::handle_line()
+{
+    switch (state)
+    {
+        case STATUS_LINE:
+        {
+            // HTTP/1.1 200 OK
+            int major = 0, minor = 0;
+            if (sscanf(line, "HTTP/%d.%d %d", &major, &minor, &status_code) != 3)
+            {
+                printf("[HttpResponse] ❌ Bad status line: %s\n", line);
+                status_code = 0;
+                state = FAILED;
+                return;
+            }
+            keep_alive = (major == 1 && minor >= 1);
+            state = HEADERS;
+            break;
+        }
+
+        case HEADERS:
+            if (line_len == 0)
+            {
+                end_headers();
+            }
+            else if (strncasecmp(line, "Content-Length:", 15) == 0)
+            {
+                content_length = strtoll(line + 15, nullptr, 10);
+            }
+            else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0 && strstr(line, "chunked"))
+            {
+                chunked = true;
+            }
+            else if (strncasecmp(line, "Connection:", 11) == 0 && strstr(line, "close"))
+            {
+                keep_alive = false;
+            }
+            break;
+
+        case CHUNK_SIZE:
+        {
+            // <hex size>[;extensions]
+            char* end;
+            long size = strtol(line, &end, 16);
+            if (end == line || size < 0)
+            {
+                printf("[HttpResponse] ❌ Bad chunk size: %s\n", line);
+                keep_alive = false;
+                state = FAILED;
+                return;
+            }
+            remaining = size;
+            state = size > 0 ? CHUNK_DATA : TRAILERS;
+            break;
+        }
+
+        case CHUNK_END:
+            // CRLF after the chunk data
+            state = CHUNK_SIZE;
+            break;
+
+        case TRAILERS:
+            if (line_len == 0)
+            {
+                state = DONE;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void HttpResponse::end_headers()
+{
+    if (chunked)
+    {
+        state = CHUNK_SIZE;
+    }
+    else if (content_length >= 0)
+    {
+        remaining = content_length;
+        state = remaining > 0 ? BODY : DONE;
+    }
+    else
+    {
+        // No length: the body ends when the server closes the connection
+        keep_alive = false;
+        state = UNTIL_CLOSE;
+    }
+}
+
+void HttpResponse::deliver(const char* data, int len)
+{
+    body_bytes += len;
+
+    // Once the consumer refuses data the rest is drained to keep the stream in sync
+    if (accepting && consumer)
+    {
+        accepting = consumer(data, len);
+    }
+}
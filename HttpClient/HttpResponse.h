@@ -0,0 +1,82 @@
+#ifndef HTTP_RESPONSE_H
+#define HTTP_RESPONSE_H
+
+#include <stdint.h>
+#include <functional>
+
+// Longest status or header line kept; the rest of a longer line is skipped
+#define HTTP_RESPONSE_MAX_LINE 256
+
+/**
+ * Incremental HTTP/1.1 response parser: status line, headers, then the body
+ * by Content-Length, chunked, or until the server closes the connection.
+ *
+ * Bytes arrive in whatever pieces the socket returns; feed() stops at the
+ * end of the response so the rest of the buffer stays for the next one.
+ *
+ * Pure logic with no SDK dependency: tools/http_replay feeds it recorded
+ * responses split at every byte.
+ */
+class HttpResponse
+{
+public:
+    // Body bytes in order; false stops delivery, the rest is still read
+    using Consumer = std::function<bool(const char* data, int len)>;
+
+    HttpResponse();
+
+    // Before each response
+    void begin(const Consumer& consumer);
+
+    // Bytes of 'data' used; less than 'len' only once the response is complete
+    int feed(const char* data, int len);
+
+    // The connection closed: completes a body that runs until the close
+    void closed();
+
+    bool done() const { return state == DONE; }
+    bool failed() const { return state == FAILED; }
+
+    // 0 until a valid status line arrived
+    int status() const { return status_code; }
+
+    // HTTP/1.1 without "Connection: close" and with a delimited body
+    bool keepAlive() const { return keep_alive; }
+
+    // Body bytes received (chunk framing not included)
+    uint32_t bodyBytes() const { return body_bytes; }
+
+private:
+    enum State
+    {
+        STATUS_LINE,
+        HEADERS,
+        BODY,
+        CHUNK_SIZE,
+        CHUNK_DATA,
+        CHUNK_END,
+        TRAILERS,
+        UNTIL_CLOSE,
+        DONE,
+        FAILED
+    };
+
+    State state;
+    Consumer consumer;
+    bool accepting;
+    int status_code;
+    bool keep_alive;
+    bool chunked;
+    int64_t content_length;
+    int64_t remaining;
+    uint32_t body_bytes;
+
+    char line[HTTP_RESPONSE_MAX_LINE];
+    int line_len;
+
+    void handle_line();
+    void end_headers();
+    void deliver(const char* data, int len);
+};
+
+#endif // HTTP_RESPONSE_H
@@ -0,0 +1,215 @@
+#include "JsonWriter.h"
+#include "TextScan.h"
+#include <cstdio>
+#include <cstring>
+
+static const char hex_digits[] = "0123456789abcdef";
+
+// 0 = copied as is, otherwise the character after the backslash ('u' = \u00XX)
+static char escape_for(unsigned char c)
+{
+    switch (c)
+    {
+        case '"':  return '"';
+        case '\\': return '\\';
+        case '\n': return 'n';
+        case '\r': return 'r';
+        case '\t': return 't';
+        case '\b': return 'b';
+        case '\f': return 'f';
+        default:   return c < 0x20 ? 'u' : 0;
+    }
+}
+
+JsonWriter::JsonWriter()
+    : buffer(nullptr),
+      buffer_len(0),
+      used(0),
+      total(0),
+      sink(nullptr),
+      pending_comma(false),
+      failed(false)
+{
+}
+
+JsonWriter::JsonWriter(char* buffer, size_t buffer_len, const Sink& sink)
+    : buffer(buffer),
+      buffer_len(buffer_len),
+      used(0),
+      total(0),
+      sink(&sink),
+      pending_comma(false),
+      failed(false)
+{
+}
+
+void JsonWriter::put(const char* data, size_t len)
+{
+    total += len;
+
+    if (!sink || failed)
+    {
+        return;
+    }
+
+    while (len > 0)
+    {
+        size_t room = buffer_len - used;
+        size_t n = len < room ? len : room;
+        memcpy(buffer + used, data, n);
+        used += n;
+        data += n;
+        len -= n;
+
+        if (used == buffer_len && !finish())
+        {
+            return;
+        }
+    }
+}
+
+bool JsonWriter::finish()
+{
+    if (sink && !failed && used > 0)
+    {
+        failed = !(*sink)(buffer, (int)used);
+        used = 0;
+    }
+    return !failed;
+}
+
+void JsonWriter::separate()
+{
+    if (pending_comma)
+    {
+        put(',');
+    }
+    pending_comma = false;
+}
+
+JsonWriter& JsonWriter::beginObject()
+{
+    separate();
+    put('{');
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject()
+{
+    put('}');
+    pending_comma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray()
+{
+    separate();
+    put('[');
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray()
+{
+    put(']');
+    pending_comma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(const char* name)
+{
+    separate();
+    put_string(name, strlen(name));
+    put(':');
+    return *this;
+}
+
+void JsonWriter::put_string(const char* text, size_t len)
+{
+    put('"');
+
+    size_t start = 0;
+    while (true)
+    {
+        // Copy the plain run in one go, then the escape sequence
+        size_t i = start + text_find_json_escape(text + start, len - start);
+        put(text + start, i - start);
+        if (i == len)
+        {
+            break;
+        }
+        start = i + 1;
+
+        char escape = escape_for((unsigned char)text[i]);
+        if (escape == 'u')
+        {
+            unsigned char c = text[i];
+            char seq[6] = {'\\', 'u', '0', '0', hex_digits[c >> 4], hex_digits[c & 0xF]};
+            put(seq, sizeof(seq));
+        }
+        else
+        {
+            char seq[2] = {'\\', escape};
+            put(seq, sizeof(seq));
+        }
+    }
+
+    put('"');
+}
+
+JsonWriter& JsonWriter::value(const char* text)
+{
+    return text ? value(text, strlen(text)) : raw("null", 4);
+}
+
+JsonWriter& JsonWriter::value(const char* text, size_t len)
+{
+    separate();
+    put_string(text, len);
+    pending_comma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(int64_t number)
+{
+    char digits[24];
+    int len = snprintf(digits, sizeof(digits), "%lld", (long long)number);
+    return raw(digits, len);
+}
+
+JsonWriter& JsonWriter::value(double number, int decimals)
+{
+    char digits[40];
+    int len = snprintf(digits, sizeof(digits), "%.*f", decimals, number);
+    return raw(digits, len);
+}
+
+JsonWriter& JsonWriter::boolean(bool flag)
+{
+    return flag ? raw("true", 4) : raw("false", 5);
+}
+
+JsonWriter& JsonWriter::raw(const char* json, size_t len)
+{
+    separate();
+    put(json, len);
+    pending_comma = true;
+    return *this;
+}
+
+size_t JsonWriter::measure(const Render& render)
+{
+    JsonWriter counter;
+    render(counter);
+    return counter.length();
+}
+
+size_t JsonWriter::escapedLength(const char* text, size_t len)
+{
+    size_t n = len + 2;
+    for (size_t i = text_find_json_escape(text, len); i < len; 
+         i += 1 + text_find_json_escape(text + i + 1, len - i - 1))
+    {
+        n += (escape_for((unsigned char)text[i]) == 'u') ? 5 : 1;
+    }
+    return n;
+}
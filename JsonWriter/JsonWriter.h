@@ -0,0 +1,84 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+
+// Stack buffer used between the writer and its sink
+#define JSON_WRITER_CHUNK 256
+
+/**
+ * Streaming JSON writer with string escaping.
+ *
+ * A counting writer (default constructor) only adds up the output size, so
+ * the same render function can be run twice: once to get the exact
+ * Content-Length / AT+HTTPDATA size, once to stream the bytes through a
+ * small fixed buffer. Nothing is allocated in either pass.
+ *
+ * Pure logic with no SDK dependency.
+ */
+class JsonWriter
+{
+public:
+    // Receives the output in pieces; false aborts the write
+    using Sink = std::function<bool(const char* data, int len)>;
+    using Render = std::function<void(JsonWriter& json)>;
+
+    // Count only
+    JsonWriter();
+
+    // Write through 'buffer', handed to 'sink' whenever it fills up
+    JsonWriter(char* buffer, size_t buffer_len, const Sink& sink);
+
+    JsonWriter& beginObject();
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& endArray();
+
+    JsonWriter& key(const char* name);
+
+    JsonWriter& value(const char* text);
+    JsonWriter& value(const char* text, size_t len);
+    JsonWriter& value(int64_t number);
+    JsonWriter& value(double number, int decimals);
+    JsonWriter& boolean(bool flag);
+
+    // Already encoded JSON (numbers, nested documents)
+    JsonWriter& raw(const char* json, size_t len);
+
+    // key + value shorthands
+    JsonWriter& field(const char* name, const char* text) { return key(name).value(text); }
+    JsonWriter& field(const char* name, int64_t number) { return key(name).value(number); }
+
+    // Flush what is left in the buffer
+    bool finish();
+
+    // Bytes produced so far (all of them, flushed or not)
+    size_t length() const { return total; }
+
+    // false once the sink refused data
+    bool ok() const { return !failed; }
+
+    // Exact size of what 'render' writes
+    static size_t measure(const Render& render);
+
+    // Escaped size of a string, quotes included
+    static size_t escapedLength(const char* text, size_t len);
+
+private:
+    char* buffer;
+    size_t buffer_len;
+    size_t used;
+    size_t total;
+    const Sink* sink;
+    bool pending_comma;
+    bool failed;
+
+    void put(const char* data, size_t len);
+    void put(char c) { put(&c, 1); }
+    void separate();
+    void put_string(const char* text, size_t len);
+};
+
+#endif // JSON_WRITER_H
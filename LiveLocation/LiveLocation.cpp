@@ -0,0 +1,105 @@
+#include "LiveLocation.h"
+#include <cstring>
+#include "TripStats.h"
+
+LiveLocation::LiveLocation()
+    : running(false),
+      chat_id(),
+      message_id(0),
+      start_ms(0),
+      period_s(0),
+      next_sample_ms(0),
+      shown_lat_e6(0),
+      shown_lon_e6(0),
+      fix_lat_e6(0),
+      fix_lon_e6(0),
+      live_stats()
+{
+}
+
+void LiveLocation::start(const char* chat, uint32_t now_ms, uint32_t period)
+{
+    if (period < LIVE_MIN_PERIOD_S)
+    {
+        period = LIVE_MIN_PERIOD_S;
+    }
+    if (period > LIVE_MAX_PERIOD_S)
+    {
+        period = LIVE_MAX_PERIOD_S;
+    }
+
+    // A new /live replaces the running session with a new message
+    running = true;
+    strncpy(chat_id, chat, sizeof(chat_id) - 1);
+    chat_id[sizeof(chat_id) - 1] = '\0';
+    message_id = 0;
+    start_ms = now_ms;
+    period_s = period;
+    next_sample_ms = now_ms;
+    live_stats.sessions++;
+}
+
+void LiveLocation::stop()
+{
+    running = false;
+    message_id = 0;
+}
+
+LiveAction LiveLocation::onFix(uint32_t now_ms, int32_t lat_e6, int32_t lon_e6,
+                               uint32_t accuracy_m, uint32_t speed_mm_s)
+{
+    if (!running)
+    {
+        return LIVE_IDLE;
+    }
+    if (now_ms - start_ms >= period_s * 1000u)
+    {
+        stop();
+        return LIVE_END;
+    }
+
+    // Next sample when the device has covered about LIVE_STEP_M
+    uint32_t interval = LIVE_MAX_INTERVAL_MS;
+    if (speed_mm_s > 0)
+    {
+        uint64_t step = (uint64_t)LIVE_STEP_M * 1000u * 1000u / speed_mm_s;
+        interval = step < LIVE_MIN_INTERVAL_MS ? LIVE_MIN_INTERVAL_MS :
+                   step > LIVE_MAX_INTERVAL_MS ? LIVE_MAX_INTERVAL_MS : (uint32_t)step;
+    }
+    next_sample_ms = now_ms + interval;
+
+    fix_lat_e6 = lat_e6;
+    fix_lon_e6 = lon_e6;
+    if (message_id == 0)
+    {
+        return LIVE_SEND;
+    }
+
+    uint32_t threshold_m = accuracy_m > LIVE_MIN_MOVE_M ? accuracy_m : LIVE_MIN_MOVE_M;
+    if (TripStats::distanceMm(shown_lat_e6, shown_lon_e6, lat_e6, lon_e6) < threshold_m * 1000u)
+    {
+        live_stats.skipped++;
+        return LIVE_SKIP;
+    }
+    return LIVE_EDIT;
+}
+
+void LiveLocation::sent(int32_t id)
+{
+    message_id = id;
+    shown_lat_e6 = fix_lat_e6;
+    shown_lon_e6 = fix_lon_e6;
+}
+
+void LiveLocation::edited()
+{
+    shown_lat_e6 = fix_lat_e6;
+    shown_lon_e6 = fix_lon_e6;
+    live_stats.edits++;
+}
+
+void LiveLocation::retry(uint32_t now_ms)
+{
+    next_sample_ms = now_ms + LIVE_MIN_INTERVAL_MS;
+    live_stats.retries++;
+}
@@ -0,0 +1,88 @@
+#ifndef LIVE_LOCATION_H
+#define LIVE_LOCATION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// /live without minutes; Telegram accepts 60 s to 24 h
+#define LIVE_DEFAULT_PERIOD_S 3600
+#define LIVE_MIN_PERIOD_S 60
+#define LIVE_MAX_PERIOD_S 86400
+
+// Moves shorter than this (or than the fix accuracy) are not sent (m)
+#define LIVE_MIN_MOVE_M 30
+
+// Sample often enough for one update every LIVE_STEP_M at the current speed
+#define LIVE_STEP_M 100
+#define LIVE_MIN_INTERVAL_MS 10000
+#define LIVE_MAX_INTERVAL_MS 120000
+
+#define LIVE_CHAT_ID_MAX 24
+
+enum LiveAction
+{
+    LIVE_IDLE,          // no session
+    LIVE_SEND,          // first fix: sendLocation with live_period
+    LIVE_EDIT,          // moved: editMessageLiveLocation
+    LIVE_SKIP,          // moved less than the threshold
+    LIVE_END            // live period over, Telegram stopped the message
+};
+
+struct LiveStats
+{
+    uint32_t sessions;
+    uint32_t edits;
+    uint32_t skipped;
+    uint32_t retries;   // no fix or the request failed
+};
+
+/**
+ * Live location session: one Telegram location message updated in place.
+ *
+ * Decides when to sample (faster while moving, from the filter's speed)
+ * and whether a fix is worth an edit (it moved more than LIVE_MIN_MOVE_M
+ * and than its own accuracy since the last one shown).
+ *
+ * Pure logic with no SDK dependency: time only enters through now_ms.
+ */
+class LiveLocation
+{
+public:
+    LiveLocation();
+
+    void start(const char* chat_id, uint32_t now_ms, uint32_t period_s);
+    void stop();
+
+    bool active() const { return running; }
+    const char* chatId() const { return chat_id; }
+    int32_t messageId() const { return message_id; }
+    uint32_t period() const { return period_s; }
+
+    // Time of the next sample while active
+    uint32_t nextSampleTime() const { return next_sample_ms; }
+
+    // What to do with a fix; accuracy in m, speed in mm/s
+    LiveAction onFix(uint32_t now_ms, int32_t lat_e6, int32_t lon_e6, uint32_t accuracy_m, uint32_t speed_mm_s);
+
+    // Result of the request onFix() asked for
+    void sent(int32_t message_id);
+    void edited();
+    void retry(uint32_t now_ms);
+
+    const LiveStats& stats() const { return live_stats; }
+
+private:
+    bool running;
+    char chat_id[LIVE_CHAT_ID_MAX];
+    int32_t message_id;             // 0 until sendLocation succeeded
+    uint32_t start_ms;
+    uint32_t period_s;
+    uint32_t next_sample_ms;
+    int32_t shown_lat_e6;           // position on the message
+    int32_t shown_lon_e6;
+    int32_t fix_lat_e6;             // fix waiting for sent()/edited()
+    int32_t fix_lon_e6;
+    LiveStats live_stats;
+};
+
+#endif // LIVE_LOCATION_H
@@ -0,0 +1,288 @@
+#include "ModemArbiter.h"
+#include <cstdio>
+#include "pico/stdlib.h"
+
+// Maximum queued transactions, protects RAM if a service floods the queue
+#define MODEM_ARBITER_MAX_QUEUE 16
+
+// Synchronous calls that take at least this long are logged (ms)
+#define MODEM_ARBITER_SLOW_MS 1000
+
+static bool deadline_passed(uint32_t deadline_ms, uint32_t now)
+{
+    return deadline_ms != 0 && (int32_t)(now - deadline_ms) > 0;
+}
+
+ModemArbiter::ModemArbiter(Sim7670G & sim7670g)
+    : sim7670g(sim7670g),
+      next_id(1),
+      next_sequence(0),
+      busy(false),
+      running(nullptr),
+      yield_requested(false)
+{
+}
+
+ModemArbiter::~ModemArbiter()
+{
+}
+
+uint32_t ModemArbiter::submit(const ModemTransaction& transaction)
+{
+    if (!transaction.run)
+    {
+        printf("[ModemArbiter] Invalid transaction\n");
+        return 0;
+    }
+
+    if (queue.size() >= MODEM_ARBITER_MAX_QUEUE)
+    {
+        printf("[ModemArbiter] Queue full, rejecting %s\n", transaction.name);
+        return 0;
+    }
+
+    uint32_t id = next_id++;
+    if (next_id == 0)
+    {
+        next_id = 1;
+    }
+
+    queue.push_back({id, next_sequence++, transaction});
+    return id;
+}
+
+bool ModemArbiter::cancel(uint32_t id)
+{
+    for (size_t i = 0; i < queue.size(); i++)
+    {
+        if (queue[i].id == id)
+        {
+            queue.erase(queue.begin() + i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ModemArbiter::execute(const char* name, ModemPriority priority,
+                           const std::function<bool(Sim7670G&)>& run)
+{
+    // Single core, cooperative: a synchronous call issued from inside a
+    // running transaction (e.g. a reply sent from the getUpdates callback)
+    // happens between two AT exchanges of the outer one, so it runs inline.
+    // It is not preemptible itself: while it runs, shouldYield() says no.
+    bool was_busy = busy;
+    const ModemTransaction* outer = running;
+    busy = true;
+    running = nullptr;
+    uint32_t start = to_ms_since_boot(get_absolute_time());
+    sim7670g.sim7670g_wake();
+    bool ok = run(sim7670g);
+    running = outer;
+    busy = was_busy;
+
+    // Nested or slow calls only: per-pass calls such as mqttLoop would flood the log
+    uint32_t elapsed = to_ms_since_boot(get_absolute_time()) - start;
+    if (was_busy || elapsed >= MODEM_ARBITER_SLOW_MS)
+    {
+        printf("[ModemArbiter] Executed %s (priority %d)%s in %u ms\n",
+               name, priority, was_busy ? " nested" : "", (unsigned)elapsed);
+    }
+    return ok;
+}
+
+bool ModemArbiter::hasPending(ModemPriority priority) const
+{
+    for (const Entry& entry : queue)
+    {
+        if (entry.transaction.priority <= priority)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ModemArbiter::requestYield()
+{
+    yield_requested = true;
+}
+
+bool ModemArbiter::shouldYield() const
+{
+    if (!running || !running->preemptible)
+    {
+        return false;
+    }
+    if (yield_requested)
+    {
+        return true;
+    }
+
+    for (const Entry& entry : queue)
+    {
+        if (entry.transaction.priority <= running->priority)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ModemArbiter::drop_expired(uint32_t now)
+{
+    for (size_t i = 0; i < queue.size(); )
+    {
+        if (deadline_passed(queue[i].transaction.deadline_ms, now))
+        {
+            ModemTransaction transaction = queue[i].transaction;
+            queue.erase(queue.begin() + i);
+
+            printf("[ModemArbiter] Deadline missed, dropping %s\n", transaction.name);
+            if (transaction.done)
+            {
+                transaction.done(false);
+            }
+            continue;
+        }
+        i++;
+    }
+}
+
+bool ModemArbiter::can_run(const ModemTransaction& transaction) const
+{
+    return !transaction.network || !network_gate || network_gate();
+}
+
+size_t ModemArbiter::runnable() const
+{
+    size_t count = 0;
+    for (const Entry& entry : queue)
+    {
+        if (can_run(entry.transaction))
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+void ModemArbiter::setNetworkGate(std::function<bool()> gate)
+{
+    network_gate = gate;
+}
+
+int ModemArbiter::pick_next() const
+{
+    int best = -1;
+
+    for (size_t i = 0; i < queue.size(); i++)
+    {
+        if (!can_run(queue[i].transaction))
+        {
+            continue;
+        }
+
+        if (best < 0)
+        {
+            best = i;
+            continue;
+        }
+
+        const Entry& a = queue[i];
+        const Entry& b = queue[best];
+
+        if (a.transaction.priority != b.transaction.priority)
+        {
+            if (a.transaction.priority < b.transaction.priority)
+            {
+                best = i;
+            }
+            continue;
+        }
+
+        // Same priority: earliest deadline first, no deadline goes last
+        uint32_t da = a.transaction.deadline_ms;
+        uint32_t db = b.transaction.deadline_ms;
+        if (da != db)
+        {
+            if (db == 0 || (da != 0 && (int32_t)(da - db) < 0))
+            {
+                best = i;
+            }
+            continue;
+        }
+
+        // Same deadline: FIFO
+        if ((int32_t)(a.sequence - b.sequence) < 0)
+        {
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+bool ModemArbiter::run_entry(Entry& entry)
+{
+    busy = true;
+    running = &entry.transaction;
+    yield_requested = false;
+
+    // A preemptible transaction stops waiting for data once it should yield
+    if (entry.transaction.preemptible)
+    {
+        sim7670g.sim7670g_set_recv_abort([this]() { return shouldYield(); });
+    }
+    sim7670g.sim7670g_wake();
+    bool ok = entry.transaction.run(sim7670g);
+    if (entry.transaction.preemptible)
+    {
+        sim7670g.sim7670g_set_recv_abort(nullptr);
+    }
+
+    running = nullptr;
+    yield_requested = false;
+    busy = false;
+
+    if (entry.transaction.done)
+    {
+        entry.transaction.done(ok);
+    }
+    if (entry.transaction.network && result_callback)
+    {
+        result_callback(entry.transaction, ok);
+    }
+    return ok;
+}
+
+void ModemArbiter::onResult(ResultCallback callback)
+{
+    result_callback = callback;
+}
+
+void ModemArbiter::loop()
+{
+    if (busy)
+    {
+        return;
+    }
+
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    drop_expired(now);
+
+    int index = pick_next();
+    if (index < 0)
+    {
+        return;
+    }
+
+    // Take it out first: the transaction may submit new work while running
+    Entry entry = queue[index];
+    queue.erase(queue.begin() + index);
+
+    printf("[ModemArbiter] Running %s (priority %d, %u queued)\n",
+           entry.transaction.name, entry.transaction.priority, (unsigned)queue.size());
+
+    run_entry(entry);
+}
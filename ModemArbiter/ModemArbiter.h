@@ -0,0 +1,115 @@
+#ifndef MODEM_ARBITER_H
+#define MODEM_ARBITER_H
+
+#include <stdint.h>
+#include <functional>
+#include <vector>
+#include "sim7670g.h"
+
+// Lower value = more urgent
+enum ModemPriority
+{
+    MODEM_PRIORITY_URGENT = 0,  // user facing replies (e.g. /location)
+    MODEM_PRIORITY_HIGH,        // outgoing messages, retries
+    MODEM_PRIORITY_NORMAL,      // GNSS sampling, health checks
+    MODEM_PRIORITY_LOW          // long polls, telemetry upload
+};
+
+struct ModemTransaction
+{
+    const char* name;
+    ModemPriority priority;
+    uint32_t deadline_ms;   // absolute ms since boot, 0 = no deadline
+    bool preemptible;       // may be postponed while more urgent work is pending
+    bool network;           // uses the data path, result reported to onResult()
+    std::function<bool(Sim7670G&)> run;
+    std::function<void(bool ok)> done;  // optional
+};
+
+/**
+ * Single owner of the Sim7670G modem.
+ *
+ * Every service (Telegram polling, GNSS sampling, telemetry upload...) goes
+ * through the arbiter instead of holding its own modem instance, so only one
+ * AT transaction is on the wire at any time. Queued transactions run by
+ * priority and, within the same priority, earliest deadline first.
+ *
+ * A preemptible transaction (the getUpdates long poll) is cut short when
+ * equally or more urgent work is queued or requestYield() is called: while
+ * it waits for data on the TLS socket, Sim7670G::sim7670g_ssl_recv() gives
+ * up and the socket is closed. The modem HTTP fallback (AT+HTTPACTION) is
+ * not interrupted. execute() called from inside a running transaction runs
+ * inline, ahead of anything queued whatever its priority.
+ */
+class ModemArbiter
+{
+public:
+    using ResultCallback = std::function<void(const ModemTransaction& transaction, bool ok)>;
+
+    explicit ModemArbiter(Sim7670G & sim7670g);
+    ~ModemArbiter();
+
+    // Encolar transacción, devuelve su id (0 si no se pudo encolar)
+    uint32_t submit(const ModemTransaction& transaction);
+
+    // Cancelar transacción pendiente
+    bool cancel(uint32_t id);
+
+    // Ejecutar transacción de forma síncrona (bloqueante)
+    bool execute(const char* name, ModemPriority priority,
+                 const std::function<bool(Sim7670G&)>& run);
+
+    // ¿Hay trabajo pendiente con prioridad igual o mayor que 'priority'?
+    bool hasPending(ModemPriority priority) const;
+
+    // La transacción en curso es interrumpible y hay trabajo igual o más
+    // urgente esperando: una long poll debería acortar su timeout
+    bool shouldYield() const;
+
+    // Hay trabajo urgente fuera de la cola (p. ej. un SMS avisado por +CMTI):
+    // la transacción interrumpible en curso debe acabar cuanto antes
+    void requestYield();
+
+    // Number of queued transactions
+    size_t pending() const { return queue.size(); }
+
+    // Queued transactions that may run now (network ones wait for the gate)
+    size_t runnable() const;
+
+    // Mientras devuelva false, las transacciones de red esperan en la cola
+    void setNetworkGate(std::function<bool()> gate);
+
+    // Procesar cola (llamar en bucle principal)
+    void loop();
+
+    // Observador del resultado de las transacciones de red (salud del módem)
+    void onResult(ResultCallback callback);
+
+    // Acceso directo al módem (solo para inicialización)
+    Sim7670G& modem() { return sim7670g; }
+
+private:
+    struct Entry
+    {
+        uint32_t id;
+        uint32_t sequence;
+        ModemTransaction transaction;
+    };
+
+    Sim7670G & sim7670g;
+    std::vector<Entry> queue;
+    uint32_t next_id;
+    uint32_t next_sequence;
+    bool busy;
+    const ModemTransaction* running;
+    bool yield_requested;
+    ResultCallback result_callback;
+    std::function<bool()> network_gate;
+
+    int pick_next() const;
+    bool can_run(const ModemTransaction& transaction) const;
+    bool run_entry(Entry& entry);
+    void drop_expired(uint32_t now);
+};
+
+#endif // MODEM_ARBITER_H
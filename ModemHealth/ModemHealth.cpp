@@ -0,0 +1,222 @@
+#include "ModemHealth.h"
+#include <cstdio>
+#include "pico/stdlib.h"
+#include "hardware/watchdog.h"
+
+static uint32_t now_ms()
+{
+    return to_ms_since_boot(get_absolute_time());
+}
+
+ModemHealth::ModemHealth(ModemArbiter & arbiter)
+    : arbiter(arbiter),
+      policy((uint32_t)to_us_since_boot(get_absolute_time())),
+      next_check_time(now_ms() + MODEM_HEALTH_CHECK_INTERVAL_MS),
+      transaction(0)
+{
+    arbiter.onResult([this](const ModemTransaction& t, bool ok)
+    {
+        if (ok)
+        {
+            policy.onSuccess(now_ms());
+        }
+        else
+        {
+            printf("[ModemHealth] %s failed\n", t.name);
+            policy.onFailure(now_ms());
+        }
+    });
+}
+
+ModemHealth::~ModemHealth()
+{
+}
+
+uint32_t ModemHealth::nextWakeTime() const
+{
+    if (policy.state() == BREAKER_OPEN &&
+        (int32_t)(policy.nextAttemptTime() - next_check_time) < 0)
+    {
+        return policy.nextAttemptTime();
+    }
+    return next_check_time;
+}
+
+void ModemHealth::loop()
+{
+    uint32_t now = now_ms();
+
+    if (transaction != 0)
+    {
+        return;
+    }
+
+    ModemTransaction t = {};
+    t.priority = MODEM_PRIORITY_URGENT;
+    t.done = [this](bool) { transaction = 0; };
+
+    if (policy.recoveryDue(now))
+    {
+        t.name = "recover";
+        t.run = [this](Sim7670G & sim7670g) { return recover(sim7670g); };
+        transaction = arbiter.submit(t);
+        return;
+    }
+
+    if ((int32_t)(now - next_check_time) >= 0)
+    {
+        next_check_time = now + MODEM_HEALTH_CHECK_INTERVAL_MS;
+
+        t.name = "healthCheck";
+        t.priority = MODEM_PRIORITY_NORMAL;
+        t.run = [this](Sim7670G & sim7670g) { return check(sim7670g); };
+        transaction = arbiter.submit(t);
+    }
+}
+
+/**
+ * Lowest layer that is down, RECOVERY_NONE if registration and PDP look fine
+ */
+RecoveryStep ModemHealth::diagnose(Sim7670G & sim7670g)
+{
+    char line[64] = "";
+    int cid = 0, state = 0;
+
+    if (!sim7670g.sim7670g_send_command("AT", "OK", sim7670g_deadline(1000)))
+    {
+        printf("[ModemHealth] No answer to AT\n");
+        return RECOVERY_RESET;
+    }
+
+    // Registered on either domain, as the driver judges it: on LTE-only
+    // networks +CREG can stay unregistered while +CEREG is home or roaming
+    uint32_t deadline = sim7670g_deadline(SIM7670G_CMD_TIMEOUT);
+    sim7670g_link_t link = {};
+    if (sim7670g.sim7670g_send_query("AT+CEREG?", "+CEREG:", line, sizeof(line), deadline))
+    {
+        sim7670g_parse_link_urc(line, &link);
+    }
+    if (!link.network_registered &&
+        sim7670g.sim7670g_send_query("AT+CREG?", "+CREG:", line, sizeof(line), deadline))
+    {
+        sim7670g_parse_link_urc(line, &link);
+    }
+    if (!link.network_registered)
+    {
+        printf("[ModemHealth] Not registered (%s)\n", line);
+        return RECOVERY_ATTACH;
+    }
+
+    // +CGACT: <cid>,<state>, context 1
+    if (!sim7670g.sim7670g_send_query("AT+CGACT?", "+CGACT: 1,", line, sizeof(line), deadline) ||
+        sscanf(line, "+CGACT: %d,%d", &cid, &state) != 2 || state != 1)
+    {
+        printf("[ModemHealth] PDP context down\n");
+        return RECOVERY_PDP;
+    }
+
+    return RECOVERY_NONE;
+}
+
+bool ModemHealth::check(Sim7670G & sim7670g)
+{
+    RecoveryStep step = diagnose(sim7670g);
+    if (step != RECOVERY_NONE)
+    {
+        policy.onFault(now_ms(), step);
+        return false;
+    }
+    return true;
+}
+
+bool ModemHealth::run_step(Sim7670G & sim7670g, RecoveryStep step)
+{
+    uint32_t deadline = sim7670g_deadline(MODEM_HEALTH_STEP_TIMEOUT_MS);
+
+    switch (step)
+    {
+        case RECOVERY_HTTP:
+            return sim7670g.sim7670g_http_reinit(deadline);
+
+        case RECOVERY_PDP:
+            sim7670g.sim7670g_ssl_stop();
+            sim7670g.sim7670g_send_command("AT+CGACT=0,1", "OK", deadline);
+            return sim7670g.sim7670g_activate_pdp(deadline) && sim7670g.sim7670g_http_reinit(deadline);
+
+        case RECOVERY_ATTACH:
+            sim7670g.sim7670g_ssl_stop();
+            sim7670g.sim7670g_send_command("AT+CGATT=0", "OK", deadline);
+            return sim7670g.sim7670g_attach_gprs(deadline) && sim7670g.sim7670g_activate_pdp(deadline) &&
+                   sim7670g.sim7670g_http_reinit(deadline);
+
+        case RECOVERY_RESET:
+            sim7670g.sim7670g_reset();
+            if (!sim7670g.sim7670g_init())
+            {
+                return false;
+            }
+            // AT+CSCLK does not survive the reset
+            sim7670g.sim7670g_sleep_enable(sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
+            return true;
+
+        case RECOVERY_REBOOT:
+            printf("[ModemHealth] ❌ Recovery exhausted, rebooting\n");
+            watchdog_reboot(0, 0, 100);
+            while (true)
+            {
+                tight_loop_contents();
+            }
+
+        default:
+            return true;
+    }
+}
+
+bool ModemHealth::recover(Sim7670G & sim7670g)
+{
+    // A deeper fault than the policy assumed skips the cheaper steps
+    RecoveryStep found = diagnose(sim7670g);
+    if (found > policy.nextStep())
+    {
+        policy.onFault(now_ms(), found);
+    }
+
+    RecoveryStep step = policy.nextStep();
+    uint32_t start = now_ms();
+    printf("[ModemHealth] Recovery step: %s\n", RecoveryPolicy::stepName(step));
+
+    bool ok = run_step(sim7670g, step) && diagnose(sim7670g) == RECOVERY_NONE;
+    policy.onStepResult(now_ms(), ok);
+
+    printf("[ModemHealth] Step %s %s in %u ms\n", RecoveryPolicy::stepName(step),
+           ok ? "done" : "failed", now_ms() - start);
+    return ok;
+}
+
+void ModemHealth::reportFault(RecoveryStep step)
+{
+    policy.onFault(now_ms(), step);
+}
+
+bool ModemHealth::injectFault(RecoveryStep layer)
+{
+    printf("[ModemHealth] Injecting fault: %s\n", RecoveryPolicy::stepName(layer));
+
+    return arbiter.execute("injectFault", MODEM_PRIORITY_URGENT, [layer](Sim7670G & sim7670g)
+    {
+        switch (layer)
+        {
+            case RECOVERY_HTTP:
+                sim7670g.sim7670g_ssl_stop();
+                return sim7670g.sim7670g_send_command("AT+HTTPTERM", "OK", sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
+            case RECOVERY_PDP:
+                sim7670g.sim7670g_ssl_stop();
+                return sim7670g.sim7670g_send_command("AT+CGACT=0,1", "OK", sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
+            case RECOVERY_ATTACH:
+                sim7670g.sim7670g_ssl_stop();
+                return sim7670g.sim7670g_send_command("AT+CGATT=0", "OK", sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
+            default:
+                return false;
+        }
+    });
+}
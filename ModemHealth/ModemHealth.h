@@ -0,0 +1,59 @@
+#ifndef MODEM_HEALTH_H
+#define MODEM_HEALTH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ModemArbiter.h"
+#include "RecoveryPolicy.h"
+
+// Interval between proactive AT+CEREG? / AT+CREG? / AT+CGACT? checks (ms)
+#define MODEM_HEALTH_CHECK_INTERVAL_MS (5u * 60u * 1000u)
+
+// Budget of one recovery step below AT+CRESET (detach, attach, PDP, HTTP) (ms)
+#define MODEM_HEALTH_STEP_TIMEOUT_MS 15000
+
+/**
+ * Modem health watchdog.
+ *
+ * Watches the result of every network transaction through the arbiter and
+ * runs a light registration / PDP check every few minutes. When the data
+ * path is down it diagnoses the broken layer and recovers step by step
+ * (HTTP, PDP, attach, AT+CRESET), ending with a watchdog reboot of the
+ * Pico. The policy (breaker, backoff, MTTR) lives in RecoveryPolicy.
+ */
+class ModemHealth
+{
+public:
+    explicit ModemHealth(ModemArbiter & arbiter);
+    ~ModemHealth();
+
+    // Encolar comprobación o recuperación si toca (llamar desde el planificador)
+    void loop();
+
+    // Instante (ms desde el arranque) en que loop() tiene trabajo
+    uint32_t nextWakeTime() const;
+
+    // false mientras el módem se recupera: no enviar tráfico
+    bool allowTraffic() const { return policy.allowTraffic(); }
+
+    // Fallo detectado fuera del monitor (p. ej. reconexión agotada)
+    void reportFault(RecoveryStep step);
+
+    // Romper una capa a propósito para medir el tiempo de recuperación
+    bool injectFault(RecoveryStep layer);
+
+    const RecoveryPolicy& recovery() const { return policy; }
+
+private:
+    ModemArbiter & arbiter;
+    RecoveryPolicy policy;
+    uint32_t next_check_time;
+    uint32_t transaction;        // queued check / recovery, 0 if none
+
+    RecoveryStep diagnose(Sim7670G & sim7670g);
+    bool run_step(Sim7670G & sim7670g, RecoveryStep step);
+    bool recover(Sim7670G & sim7670g);
+    bool check(Sim7670G & sim7670g);
+};
+
+#endif // MODEM_HEALTH_H
@@ -0,0 +1,163 @@
+#include "RecoveryPolicy.h"
+#include <cstdio>
+
+static const char* step_names[RECOVERY_STEP_COUNT] =
+{
+    "none", "http", "pdp", "attach", "reset", "reboot"
+};
+
+RecoveryPolicy::RecoveryPolicy(uint32_t seed)
+    : breaker(BREAKER_CLOSED),
+      step(RECOVERY_NONE),
+      attempts(0),
+      consecutive_failures(0),
+      outage_start_ms(0),
+      next_attempt_ms(0),
+      backoff_ms(RECOVERY_BACKOFF_MIN_MS),
+      rng(seed ? seed : 0x9E3779B9u),
+      recovery_stats()
+{
+}
+
+const char* RecoveryPolicy::stepName(RecoveryStep step)
+{
+    return step < RECOVERY_STEP_COUNT ? step_names[step] : "?";
+}
+
+uint32_t RecoveryPolicy::jitter(uint32_t delay_ms)
+{
+    // xorshift32; "equal jitter": half fixed, half random
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    uint32_t half = delay_ms / 2;
+    return half + (half ? rng % half : 0);
+}
+
+void RecoveryPolicy::onSuccess(uint32_t now_ms)
+{
+    consecutive_failures = 0;
+
+    if (breaker == BREAKER_CLOSED)
+    {
+        return;
+    }
+
+    uint32_t mttr = now_ms - outage_start_ms;
+    recovery_stats.recoveries++;
+    recovery_stats.last_mttr_ms = mttr;
+    recovery_stats.total_mttr_ms += mttr;
+    if (mttr > recovery_stats.max_mttr_ms)
+    {
+        recovery_stats.max_mttr_ms = mttr;
+    }
+
+    printf("[RecoveryPolicy] Recovered after %u ms (step %s)\n", mttr, stepName(step));
+
+    breaker = BREAKER_CLOSED;
+    step = RECOVERY_NONE;
+    attempts = 0;
+    backoff_ms = RECOVERY_BACKOFF_MIN_MS;
+}
+
+void RecoveryPolicy::onFailure(uint32_t now_ms)
+{
+    if (consecutive_failures++ == 0 && breaker == BREAKER_CLOSED)
+    {
+        outage_start_ms = now_ms;
+    }
+
+    if (breaker == BREAKER_HALF_OPEN)
+    {
+        // The step looked fine but traffic still fails: go deeper
+        breaker = BREAKER_OPEN;
+        attempts = RECOVERY_ATTEMPTS_PER_STEP;
+        escalate(now_ms);
+        return;
+    }
+
+    if (breaker == BREAKER_CLOSED && consecutive_failures >= RECOVERY_FAILURE_THRESHOLD)
+    {
+        open(now_ms, RECOVERY_HTTP);
+    }
+}
+
+void RecoveryPolicy::onFault(uint32_t now_ms, RecoveryStep first_step)
+{
+    if (breaker == BREAKER_CLOSED)
+    {
+        outage_start_ms = now_ms;
+        open(now_ms, first_step);
+        return;
+    }
+
+    // Already recovering: never go back to a cheaper step
+    breaker = BREAKER_OPEN;
+    if (first_step > step)
+    {
+        step = first_step;
+        attempts = 0;
+    }
+}
+
+void RecoveryPolicy::open(uint32_t now_ms, RecoveryStep first_step)
+{
+    breaker = BREAKER_OPEN;
+    step = first_step;
+    attempts = 0;
+    backoff_ms = RECOVERY_BACKOFF_MIN_MS;
+    next_attempt_ms = now_ms;
+    recovery_stats.outages++;
+
+    printf("[RecoveryPolicy] Breaker open, starting at step %s\n", stepName(step));
+}
+
+bool RecoveryPolicy::recoveryDue(uint32_t now_ms) const
+{
+    return breaker == BREAKER_OPEN && (int32_t)(now_ms - next_attempt_ms) >= 0;
+}
+
+void RecoveryPolicy::onStepResult(uint32_t now_ms, bool ok)
+{
+    recovery_stats.steps[step]++;
+
+    if (ok)
+    {
+        // Let one transaction through to confirm
+        breaker = BREAKER_HALF_OPEN;
+        consecutive_failures = 0;
+        return;
+    }
+
+    attempts++;
+    escalate(now_ms);
+}
+
+void RecoveryPolicy::escalate(uint32_t now_ms)
+{
+    if (attempts >= RECOVERY_ATTEMPTS_PER_STEP && step < RECOVERY_REBOOT)
+    {
+        step = (RecoveryStep)(step + 1);
+        attempts = 0;
+    }
+
+    next_attempt_ms = now_ms + jitter(backoff_ms);
+    backoff_ms = backoff_ms * 2 > RECOVERY_BACKOFF_MAX_MS ? RECOVERY_BACKOFF_MAX_MS : backoff_ms * 2;
+
+    printf("[RecoveryPolicy] Next attempt (%s) in %u ms\n", stepName(step), next_attempt_ms - now_ms);
+}
+
+int RecoveryPolicy::format(char* buffer, size_t len) const
+{
+    static const char* states[] = {"ok", "en recuperación", "comprobando"};
+
+    const RecoveryStats& s = recovery_stats;
+    return snprintf(buffer, len,
+                    "Módem: %s\nCaídas: %u, recuperadas: %u\nMTTR: %u ms medio, %u ms máx, %u ms última\n"
+                    "Pasos: http %u, pdp %u, attach %u, reset %u\n",
+                    states[breaker], s.outages, s.recoveries,
+                    s.recoveries ? (unsigned)(s.total_mttr_ms / s.recoveries) : 0u,
+                    s.max_mttr_ms, s.last_mttr_ms,
+                    s.steps[RECOVERY_HTTP], s.steps[RECOVERY_PDP],
+                    s.steps[RECOVERY_ATTACH], s.steps[RECOVERY_RESET]);
+}
@@ -0,0 +1,100 @@
+#ifndef RECOVERY_POLICY_H
+#define RECOVERY_POLICY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Consecutive failed transactions that open the circuit breaker
+#define RECOVERY_FAILURE_THRESHOLD 3
+
+// Failed attempts at one step before escalating to the next
+#define RECOVERY_ATTEMPTS_PER_STEP 2
+
+// Backoff between recovery attempts (ms), jittered
+#define RECOVERY_BACKOFF_MIN_MS 5000
+#define RECOVERY_BACKOFF_MAX_MS 300000
+
+// Escalation ladder, cheapest first
+enum RecoveryStep
+{
+    RECOVERY_NONE = 0,
+    RECOVERY_HTTP,          // AT+HTTPTERM / AT+HTTPINIT, restart CCH
+    RECOVERY_PDP,           // deactivate and reactivate the PDP context
+    RECOVERY_ATTACH,        // detach and re-attach to the packet domain
+    RECOVERY_RESET,         // AT+CRESET and full init
+    RECOVERY_REBOOT,        // hardware watchdog reboot of the Pico
+    RECOVERY_STEP_COUNT
+};
+
+enum BreakerState
+{
+    BREAKER_CLOSED,         // healthy, traffic flows
+    BREAKER_OPEN,           // outage: traffic held back, recovery running
+    BREAKER_HALF_OPEN       // a step succeeded, next transaction is the probe
+};
+
+struct RecoveryStats
+{
+    uint32_t outages;
+    uint32_t recoveries;
+    uint32_t steps[RECOVERY_STEP_COUNT];  // attempts per step
+    uint32_t last_mttr_ms;
+    uint32_t max_mttr_ms;
+    uint64_t total_mttr_ms;               // for the mean time to recovery
+};
+
+/**
+ * Circuit breaker and escalation policy for modem recovery.
+ *
+ * Pure logic with no SDK dependency: every call takes the current time, so
+ * fault sequences can be replayed on the host.
+ */
+class RecoveryPolicy
+{
+public:
+    explicit RecoveryPolicy(uint32_t seed);
+
+    // Result of a transaction that used the data path
+    void onSuccess(uint32_t now_ms);
+    void onFailure(uint32_t now_ms);
+
+    // A health check found a layer down: open at once, starting at 'step'
+    void onFault(uint32_t now_ms, RecoveryStep step);
+
+    // Is a recovery attempt due?
+    bool recoveryDue(uint32_t now_ms) const;
+
+    // Step to run on the next attempt
+    RecoveryStep nextStep() const { return step; }
+
+    // Outcome of the attempted step
+    void onStepResult(uint32_t now_ms, bool ok);
+
+    bool allowTraffic() const { return breaker != BREAKER_OPEN; }
+    BreakerState state() const { return breaker; }
+    uint32_t nextAttemptTime() const { return next_attempt_ms; }
+
+    const RecoveryStats& stats() const { return recovery_stats; }
+
+    // Human-readable summary
+    int format(char* buffer, size_t len) const;
+
+    static const char* stepName(RecoveryStep step);
+
+private:
+    BreakerState breaker;
+    RecoveryStep step;
+    int attempts;                // at the current step
+    int consecutive_failures;
+    uint32_t outage_start_ms;    // first failure of the streak
+    uint32_t next_attempt_ms;
+    uint32_t backoff_ms;
+    uint32_t rng;
+    RecoveryStats recovery_stats;
+
+    void open(uint32_t now_ms, RecoveryStep first_step);
+    void escalate(uint32_t now_ms);
+    uint32_t jitter(uint32_t delay_ms);
+};
+
+#endif // RECOVERY_POLICY_H
@@ -0,0 +1,259 @@
+#include "MqttClient.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "pico/stdlib.h"
+
+MqttClient::MqttClient(Sim7670G & sim7670g, const MqttConfig& config)
+    : sim7670g(sim7670g),
+      config(config),
+      enabled(false),
+      started(false),
+      connected(false),
+      subscription_qos(0),
+      next_reconnect_time(0),
+      reconnect_delay(MQTT_RECONNECT_MIN_MS),
+      mqtt_stats()
+{
+    sim7670g.sim7670g_add_urc_handler([this](const char* line) { on_urc(line); });
+}
+
+MqttClient::~MqttClient()
+{
+}
+
+bool MqttClient::start_service()
+{
+    char cmd[160];
+
+    if (started)
+    {
+        return true;
+    }
+
+    uint32_t deadline = sim7670g_deadline(SIM7670G_CMD_TIMEOUT);
+    if (!sim7670g.sim7670g_send_command("AT+CMQTTSTART", "+CMQTTSTART: 0", deadline))
+    {
+        // Half-started service (e.g. after a modem reset): stop it so the
+        // next attempt from loop() starts clean
+        printf("[MqttClient] ❌ CMQTTSTART failed\n");
+        sim7670g.sim7670g_send_command("AT+CMQTTSTOP", "OK", sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
+        return false;
+    }
+
+    // Cliente 0, tipo de servidor: 0 = TCP, 1 = TLS
+    snprintf(cmd, sizeof(cmd), "AT+CMQTTACCQ=0,\"%s\",%d", config.client_id, config.use_tls ? 1 : 0);
+    if (!sim7670g.sim7670g_send_command(cmd, "OK", deadline))
+    {
+        printf("[MqttClient] ❌ CMQTTACCQ failed\n");
+        sim7670g.sim7670g_send_command("AT+CMQTTSTOP", "OK", sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
+        return false;
+    }
+
+    if (config.use_tls)
+    {
+        sim7670g.sim7670g_send_command("AT+CMQTTSSLCFG=0,0", "OK", deadline);
+    }
+
+    started = true;
+    return true;
+}
+
+bool MqttClient::connect()
+{
+    char cmd[256];
+
+    enabled = true;
+    if (!start_service())
+    {
+        return false;
+    }
+
+    printf("[MqttClient] Connecting to %s as %s...\n", config.broker_uri, config.client_id);
+
+    // clean_session = 0: the broker keeps subscriptions and QoS 1 backlog
+    if (config.username)
+    {
+        snprintf(cmd, sizeof(cmd), "AT+CMQTTCONNECT=0,\"%s\",%u,0,\"%s\",\"%s\"",
+                 config.broker_uri, config.keepalive_s, config.username,
+                 config.password ? config.password : "");
+    }
+    else
+    {
+        snprintf(cmd, sizeof(cmd), "AT+CMQTTCONNECT=0,\"%s\",%u,0",
+                 config.broker_uri, config.keepalive_s);
+    }
+
+    if (!sim7670g.sim7670g_send_command(cmd, "+CMQTTCONNECT: 0,0", sim7670g_deadline(MQTT_CONNECT_TIMEOUT)))
+    {
+        printf("[MqttClient] ❌ Connect failed\n");
+        return false;
+    }
+
+    connected = true;
+    reconnect_delay = MQTT_RECONNECT_MIN_MS;
+    mqtt_stats.connects++;
+    printf("[MqttClient] ✓ Connected\n");
+
+    if (!subscription.empty())
+    {
+        send_subscribe();
+    }
+    return true;
+}
+
+void MqttClient::disconnect()
+{
+    enabled = false;
+    if (connected)
+    {
+        sim7670g.sim7670g_send_command("AT+CMQTTDISC=0,60", "+CMQTTDISC: 0,0", sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
+        connected = false;
+    }
+
+    if (started)
+    {
+        // Teardown: each step gets its own budget so a failed REL cannot starve STOP
+        sim7670g.sim7670g_send_command("AT+CMQTTREL=0", "OK", sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
+        sim7670g.sim7670g_send_command("AT+CMQTTSTOP", "+CMQTTSTOP: 0", sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
+        started = false;
+    }
+}
+
+bool MqttClient::subscribe(const char* topic, int qos)
+{
+    if (!topic)
+    {
+        return false;
+    }
+
+    subscription = topic;
+    subscription_qos = qos;
+
+    return connected ? send_subscribe() : true;
+}
+
+bool MqttClient::send_subscribe()
+{
+    char cmd[64];
+
+    snprintf(cmd, sizeof(cmd), "AT+CMQTTSUB=0,%d,%d", (int)subscription.size(), subscription_qos);
+    if (!sim7670g.sim7670g_send_with_prompt(cmd, subscription.c_str(), subscription.size(),
+                                            "+CMQTTSUB: 0,0", sim7670g_deadline(MQTT_PUBLISH_TIMEOUT)))
+    {
+        printf("[MqttClient] ❌ Subscribe to %s failed\n", subscription.c_str());
+        return false;
+    }
+
+    printf("[MqttClient] ✓ Subscribed to %s (qos %d)\n", subscription.c_str(), subscription_qos);
+    return true;
+}
+
+bool MqttClient::publish(const char* topic, const char* payload, int len, int qos, bool retain)
+{
+    char cmd[64];
+
+    if (!connected || !topic || !payload)
+    {
+        return false;
+    }
+
+    // Topic, payload y publicación comparten un plazo
+    uint32_t deadline = sim7670g_deadline(MQTT_PUBLISH_TIMEOUT);
+
+    snprintf(cmd, sizeof(cmd), "AT+CMQTTTOPIC=0,%d", (int)strlen(topic));
+    if (!sim7670g.sim7670g_send_with_prompt(cmd, topic, strlen(topic), "OK", deadline))
+    {
+        return false;
+    }
+
+    snprintf(cmd, sizeof(cmd), "AT+CMQTTPAYLOAD=0,%d", len);
+    if (!sim7670g.sim7670g_send_with_prompt(cmd, payload, len, "OK", deadline))
+    {
+        return false;
+    }
+
+    // AT+CMQTTPUB=<client>,<qos>,<pub_timeout s>,<retained>
+    snprintf(cmd, sizeof(cmd), "AT+CMQTTPUB=0,%d,%d,%d", qos, MQTT_PUBLISH_TIMEOUT / 1000, retain ? 1 : 0);
+    if (!sim7670g.sim7670g_send_command(cmd, "+CMQTTPUB: 0,0", deadline))
+    {
+        printf("[MqttClient] ❌ Publish to %s failed\n", topic);
+        return false;
+    }
+
+    mqtt_stats.published++;
+    mqtt_stats.payload_bytes += len;
+    return true;
+}
+
+void MqttClient::onMessage(MessageCallback callback)
+{
+    message_callback = callback;
+}
+
+void MqttClient::on_urc(const char* line)
+{
+    int client = 0;
+    int len = 0;
+
+    if (strncmp(line, "+CMQTTRXSTART:", 14) == 0)
+    {
+        rx_topic.clear();
+        rx_payload.clear();
+    }
+    else if (sscanf(line, "+CMQTTRXTOPIC: %d,%d", &client, &len) == 2 ||
+             sscanf(line, "+CMQTTRXPAYLOAD: %d,%d", &client, &len) == 2)
+    {
+        // Los datos siguen a la cabecera, en crudo
+        std::string& dst = (strncmp(line, "+CMQTTRXTOPIC:", 14) == 0) ? rx_topic : rx_payload;
+        size_t offset = dst.size();
+        dst.resize(offset + len);
+        int n = sim7670g.sim7670g_read_raw(&dst[offset], len, sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
+        dst.resize(offset + n);
+    }
+    else if (strncmp(line, "+CMQTTRXEND:", 12) == 0)
+    {
+        mqtt_stats.received++;
+        printf("[MqttClient] Message on %s: %s\n", rx_topic.c_str(), rx_payload.c_str());
+
+        if (message_callback)
+        {
+            message_callback(rx_topic, rx_payload);
+        }
+    }
+    else if (strncmp(line, "+CMQTTCONNLOST:", 15) == 0)
+    {
+        printf("[MqttClient] ⚠️  Connection lost: %s\n", line);
+        connected = false;
+        next_reconnect_time = to_ms_since_boot(get_absolute_time()) + reconnect_delay;
+    }
+}
+
+void MqttClient::loop()
+{
+    if (!enabled)
+    {
+        return;
+    }
+
+    if (connected)
+    {
+        sim7670g.sim7670g_poll_urc(sim7670g_deadline(0));
+        return;
+    }
+
+    // Not connected, or the service never started: retry with backoff
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    if ((int32_t)(now - next_reconnect_time) < 0)
+    {
+        return;
+    }
+
+    if (!connect())
+    {
+        // Espera exponencial hasta MQTT_RECONNECT_MAX_MS
+        reconnect_delay = reconnect_delay * 2 > MQTT_RECONNECT_MAX_MS ? MQTT_RECONNECT_MAX_MS : reconnect_delay * 2;
+        next_reconnect_time = now + reconnect_delay;
+        printf("[MqttClient] Reconnect in %u ms\n", reconnect_delay);
+    }
+}
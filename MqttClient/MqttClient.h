@@ -0,0 +1,99 @@
+#ifndef MQTT_CLIENT_H
+#define MQTT_CLIENT_H
+
+#include <stdint.h>
+#include <string>
+#include <functional>
+#include "sim7670g.h"
+
+// Timeouts (ms)
+#define MQTT_CONNECT_TIMEOUT 30000
+#define MQTT_PUBLISH_TIMEOUT 10000
+
+// Reconexión: espera inicial y máxima
+#define MQTT_RECONNECT_MIN_MS 2000
+#define MQTT_RECONNECT_MAX_MS 120000
+
+struct MqttConfig
+{
+    const char* broker_uri;    // "tcp://host:1883"
+    const char* client_id;     // stable id, the broker keys the session on it
+    const char* username;      // nullptr = no auth
+    const char* password;
+    uint16_t keepalive_s;
+    bool use_tls;
+};
+
+struct MqttStats
+{
+    uint32_t published;
+    uint32_t received;
+    uint32_t payload_bytes;    // payload bytes published
+    uint32_t connects;
+};
+
+/**
+ * MQTT 3.1.1 client on top of the SIM7670G MQTT service (AT+CMQTT*).
+ *
+ * Connects with clean_session=0, so the broker keeps the subscriptions and
+ * queued QoS 1 messages across reconnects. Incoming publishes arrive as
+ * +CMQTTRX* URCs and are delivered through onMessage().
+ */
+class MqttClient
+{
+public:
+    using MessageCallback = std::function<void(const std::string& topic,
+                                               const std::string& payload)>;
+
+    MqttClient(Sim7670G & sim7670g, const MqttConfig& config);
+    ~MqttClient();
+
+    // Conectar al broker
+    bool connect();
+
+    // Desconectar y liberar el cliente
+    void disconnect();
+
+    // Suscribirse a un topic (se repite en cada reconexión)
+    bool subscribe(const char* topic, int qos);
+
+    // Publicar mensaje (qos 0 o 1)
+    bool publish(const char* topic, const char* payload, int len, int qos, bool retain = false);
+
+    // Registrar callback para mensajes recibidos
+    void onMessage(MessageCallback callback);
+
+    // Procesar URC y reconectar si hace falta, también si el servicio MQTT
+    // no llegó a arrancar (llamar en bucle principal)
+    void loop();
+
+    bool isConnected() const { return connected; }
+
+    // Próximo intento de reconexión (ms); sin conexión, loop() no hace nada antes
+    uint32_t nextReconnectTime() const { return next_reconnect_time; }
+
+    const MqttStats& stats() const { return mqtt_stats; }
+
+private:
+    Sim7670G & sim7670g;
+    MqttConfig config;
+    MessageCallback message_callback;
+    bool enabled;              // connect() called and no disconnect() since
+    bool started;
+    bool connected;
+    std::string subscription;
+    int subscription_qos;
+    uint32_t next_reconnect_time;
+    uint32_t reconnect_delay;
+    MqttStats mqtt_stats;
+
+    // Mensaje entrante en curso (+CMQTTRXSTART ... +CMQTTRXEND)
+    std::string rx_topic;
+    std::string rx_payload;
+
+    bool start_service();
+    bool send_subscribe();
+    void on_urc(const char* line);
+};
+
+#endif // MQTT_CLIENT_H
@@ -0,0 +1,239 @@
+#include "OtaImage.h"
+#include <cstdio>
+#include <cstring>
+
+// Header bytes covered by the HMAC
+#define OTA_SIGNED_BYTES offsetof(OtaHeader, hmac)
+
+static bool digest_equal(const uint8_t* a, const uint8_t* b)
+{
+    // Every byte compared: no early exit to time
+    uint8_t diff = 0;
+    for (int i = 0; i < SHA256_DIGEST_SIZE; i++)
+    {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+OtaImage::OtaImage(const uint8_t* key, size_t key_len, uint32_t slot_size, const OtaFlash& flash)
+    : key(key),
+      key_len(key_len),
+      slot_size(slot_size),
+      flash(flash),
+      running_version(0),
+      ota_status(OTA_IDLE),
+      image_header(),
+      header_received(0),
+      image_received(0),
+      written(0),
+      page_len(0)
+{
+}
+
+void OtaImage::begin(uint32_t version)
+{
+    running_version = version;
+    ota_status = OTA_HEADER;
+    image_header = OtaHeader();
+    header_received = 0;
+    image_received = 0;
+    written = 0;
+    page_len = 0;
+    stream_hash.reset();
+}
+
+bool OtaImage::fail(OtaStatus status)
+{
+    printf("[Ota] ❌ %s after %u bytes\n", statusName(status), (unsigned)image_received);
+    ota_status = status;
+    return false;
+}
+
+bool OtaImage::feed(const uint8_t* data, size_t len)
+{
+    if (ota_status == OTA_HEADER)
+    {
+        size_t take = sizeof(OtaHeader) - header_received;
+        take = len < take ? len : take;
+        memcpy((uint8_t*)&image_header + header_received, data, take);
+        header_received += take;
+        data += take;
+        len -= take;
+
+        if (header_received < sizeof(OtaHeader))
+        {
+            return true;
+        }
+        if (!accept_header())
+        {
+            return false;
+        }
+    }
+
+    if (ota_status != OTA_WRITING)
+    {
+        return false;
+    }
+
+    if (image_received + len > image_header.image_len)
+    {
+        return fail(OTA_TOO_LARGE);
+    }
+    stream_hash.update(data, len);
+    image_received += len;
+
+    while (len > 0)
+    {
+        size_t take = OTA_FLASH_PAGE - page_len < len ? OTA_FLASH_PAGE - page_len : len;
+        memcpy(page + page_len, data, take);
+        page_len += take;
+        data += take;
+        len -= take;
+
+        if (page_len == OTA_FLASH_PAGE && !program_page())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool OtaImage::accept_header()
+{
+    if (image_header.magic != OTA_MAGIC || image_header.image_len == 0)
+    {
+        return fail(OTA_BAD_HEADER);
+    }
+
+    uint8_t mac[SHA256_DIGEST_SIZE];
+    Sha256::hmac(key, key_len, (const uint8_t*)&image_header, OTA_SIGNED_BYTES, mac);
+    if (!digest_equal(mac, image_header.hmac))
+    {
+        return fail(OTA_BAD_SIGNATURE);
+    }
+
+    // A signed image can be replayed: only a newer one is taken
+    if (image_header.firmware_version <= running_version)
+    {
+        return fail(OTA_OLD_VERSION);
+    }
+    if (image_header.image_len > slot_size)
+    {
+        return fail(OTA_TOO_LARGE);
+    }
+
+    // Only the sectors the image needs
+    uint32_t erase_len = (image_header.image_len + OTA_FLASH_SECTOR - 1) / OTA_FLASH_SECTOR * OTA_FLASH_SECTOR;
+    printf("[Ota] Version %u, %u bytes: erasing %u KB\n",
+           (unsigned)image_header.firmware_version, (unsigned)image_header.image_len, (unsigned)(erase_len / 1024));
+    if (!flash.erase(0, erase_len))
+    {
+        return fail(OTA_FLASH_ERROR);
+    }
+
+    ota_status = OTA_WRITING;
+    return true;
+}
+
+bool OtaImage::program_page()
+{
+    // The last page is padded with the erased value
+    memset(page + page_len, 0xFF, OTA_FLASH_PAGE - page_len);
+    if (!flash.program(written, page, OTA_FLASH_PAGE))
+    {
+        return fail(OTA_FLASH_ERROR);
+    }
+    written += OTA_FLASH_PAGE;
+    page_len = 0;
+    return true;
+}
+
+bool OtaImage::hash_flash(uint8_t digest[SHA256_DIGEST_SIZE])
+{
+    Sha256 sha;
+    uint8_t buffer[OTA_FLASH_PAGE];
+    for (uint32_t offset = 0; offset < image_header.image_len; offset += sizeof(buffer))
+    {
+        uint32_t n = image_header.image_len - offset < sizeof(buffer) ? image_header.image_len - offset : sizeof(buffer);
+        if (!flash.read(offset, buffer, n))
+        {
+            return false;
+        }
+        sha.update(buffer, n);
+    }
+    sha.finish(digest);
+    return true;
+}
+
+bool OtaImage::finish()
+{
+    if (ota_status != OTA_WRITING)
+    {
+        return false;
+    }
+    if (image_received < image_header.image_len)
+    {
+        return fail(OTA_TRUNCATED);
+    }
+    if (page_len > 0 && !program_page())
+    {
+        return false;
+    }
+
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    stream_hash.finish(digest);
+    if (!digest_equal(digest, image_header.sha256))
+    {
+        return fail(OTA_BAD_HASH);
+    }
+
+    // What was received is right; now what was written
+    if (!hash_flash(digest))
+    {
+        return fail(OTA_FLASH_ERROR);
+    }
+    if (!digest_equal(digest, image_header.sha256))
+    {
+        return fail(OTA_BAD_HASH);
+    }
+
+    ota_status = OTA_VERIFIED;
+    printf("[Ota] ✓ Version %u verified in flash\n", (unsigned)image_header.firmware_version);
+    return true;
+}
+
+const char* OtaImage::statusName(OtaStatus status)
+{
+    switch (status)
+    {
+        case OTA_IDLE:          return "idle";
+        case OTA_HEADER:        return "waiting for header";
+        case OTA_WRITING:       return "writing";
+        case OTA_VERIFIED:      return "verified";
+        case OTA_BAD_HEADER:    return "bad header";
+        case OTA_BAD_SIGNATURE: return "bad signature";
+        case OTA_OLD_VERSION:   return "not newer than the running version";
+        case OTA_TOO_LARGE:     return "image too large";
+        case OTA_FLASH_ERROR:   return "flash error";
+        case OTA_TRUNCATED:     return "download truncated";
+        case OTA_BAD_HASH:      return "SHA-256 mismatch";
+    }
+    return "?";
+}
+
+OtaHeader OtaImage::sign(const uint8_t* key, size_t key_len, uint32_t firmware_version,
+                         const uint8_t* image, uint32_t image_len)
+{
+    OtaHeader header = {};
+    header.magic = OTA_MAGIC;
+    header.firmware_version = firmware_version;
+    header.image_len = image_len;
+
+    Sha256 sha;
+    sha.update(image, image_len);
+    sha.finish(header.sha256);
+
+    Sha256::hmac(key, key_len, (const uint8_t*)&header, OTA_SIGNED_BYTES, header.hmac);
+    return header;
+}
@@ -0,0 +1,106 @@
+#ifndef OTA_IMAGE_H
+#define OTA_IMAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include "Sha256.h"
+
+#define OTA_MAGIC 0x3141544F           // "OTA1"
+
+// Flash geometry: erase by sector, program by page
+#define OTA_FLASH_SECTOR 4096
+#define OTA_FLASH_PAGE 256
+
+// Header in front of the firmware .bin, little endian (tools/ota_pack)
+struct OtaHeader
+{
+    uint32_t magic;
+    uint32_t firmware_version;     // must be newer than the running one
+    uint32_t image_len;            // bytes after the header
+    uint32_t reserved;
+    uint8_t sha256[SHA256_DIGEST_SIZE];   // of the image
+    uint8_t hmac[SHA256_DIGEST_SIZE];     // HMAC-SHA256 of everything above, keyed with OTA_HMAC_KEY
+};
+
+// Slot access, offsets from the start of the inactive slot
+struct OtaFlash
+{
+    std::function<bool(uint32_t offset, uint32_t len)> erase;
+    std::function<bool(uint32_t offset, const uint8_t* data, uint32_t len)> program;
+    std::function<bool(uint32_t offset, uint8_t* data, uint32_t len)> read;
+};
+
+enum OtaStatus
+{
+    OTA_IDLE,
+    OTA_HEADER,          // waiting for the header
+    OTA_WRITING,         // header accepted, slot erased, image streaming in
+    OTA_VERIFIED,        // hash checked on the stream and read back from flash
+    OTA_BAD_HEADER,
+    OTA_BAD_SIGNATURE,
+    OTA_OLD_VERSION,
+    OTA_TOO_LARGE,
+    OTA_FLASH_ERROR,
+    OTA_TRUNCATED,
+    OTA_BAD_HASH,
+};
+
+/**
+ * Writes a signed firmware image into the inactive flash slot while it
+ * downloads, one page at a time, so the image is never held in RAM.
+ *
+ * The header is checked first: its HMAC before anything is erased, so an
+ * unsigned or stale image never touches flash. The image is then hashed as
+ * it streams in and hashed again from flash once written; the slot is only
+ * worth booting when both hashes match the signed one. Any failure leaves
+ * the running slot untouched. Pure logic with no SDK dependency: flash
+ * access goes through OtaFlash, so a download can be replayed on the host
+ * against a flash simulator (tools/ota_sim).
+ */
+class OtaImage
+{
+public:
+    OtaImage(const uint8_t* key, size_t key_len, uint32_t slot_size, const OtaFlash& flash);
+
+    // Before each download
+    void begin(uint32_t running_version);
+
+    // Bytes as they arrive; false once the download must stop
+    bool feed(const uint8_t* data, size_t len);
+
+    // After the last byte: flush, then check both hashes
+    bool finish();
+
+    OtaStatus status() const { return ota_status; }
+    const OtaHeader& header() const { return image_header; }
+    uint32_t received() const { return image_received; }
+
+    static const char* statusName(OtaStatus status);
+
+    // Signed header for an image (host side, tools/ota_pack)
+    static OtaHeader sign(const uint8_t* key, size_t key_len, uint32_t firmware_version,
+                          const uint8_t* image, uint32_t image_len);
+
+private:
+    const uint8_t* key;
+    size_t key_len;
+    uint32_t slot_size;
+    OtaFlash flash;
+    uint32_t running_version;
+    OtaStatus ota_status;
+    OtaHeader image_header;
+    uint32_t header_received;
+    uint32_t image_received;
+    uint32_t written;              // bytes programmed so far
+    uint8_t page[OTA_FLASH_PAGE];
+    uint32_t page_len;
+    Sha256 stream_hash;
+
+    bool fail(OtaStatus status);
+    bool accept_header();
+    bool program_page();
+    bool hash_flash(uint8_t digest[SHA256_DIGEST_SIZE]);
+};
+
+#endif // OTA_IMAGE_H
@@ -0,0 +1,196 @@
+#include "OtaUpdater.h"
+#include <cstdio>
+#include <cstring>
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "pico/bootrom.h"
+#include "hardware/flash.h"
+#include "hardware/watchdog.h"
+
+struct FlashOp
+{
+    uint32_t offset;
+    const uint8_t* data;
+    uint32_t len;
+};
+
+// Run from flash_safe_execute: interrupts off, other core parked
+static void flash_erase_op(void* param)
+{
+    const FlashOp* op = (const FlashOp*)param;
+    flash_range_erase(op->offset, op->len);
+}
+
+static void flash_program_op(void* param)
+{
+    const FlashOp* op = (const FlashOp*)param;
+    flash_range_program(op->offset, op->data, op->len);
+}
+
+static uint32_t now_ms()
+{
+    return to_ms_since_boot(get_absolute_time());
+}
+
+OtaUpdater::OtaUpdater(const char* url, const char* hmac_key, uint32_t running_version)
+    : url(url),
+      hmac_key(hmac_key),
+      running_version(running_version),
+      running_slot(-1),
+      trial(false),
+      target_offset(0),
+      image((const uint8_t*)hmac_key, strlen(hmac_key), OTA_SLOT_SIZE,
+            OtaFlash{
+                [this](uint32_t offset, uint32_t len) { return erase(offset, len); },
+                [this](uint32_t offset, const uint8_t* data, uint32_t len) { return program(offset, data, len); },
+                [this](uint32_t offset, uint8_t* data, uint32_t len) { return read(offset, data, len); }
+            }),
+      ota_stats()
+{
+#if PICO_RP2350
+    boot_info_t info;
+    if (rom_get_boot_info(&info))
+    {
+        if (info.partition >= 0)
+        {
+            running_slot = info.partition;
+        }
+        trial = (info.tbyb_and_update_info & BOOT_TBYB_AND_UPDATE_FLAG_BUY_PENDING) != 0;
+    }
+#endif
+    target_offset = running_slot == 1 ? OTA_SLOT_A_OFFSET : OTA_SLOT_B_OFFSET;
+}
+
+bool OtaUpdater::supported() const
+{
+    // Without a key anyone could sign an image; without a version any old one replays
+    return running_slot >= 0 && running_version > 0 && url && url[0] != '\0' && 
+           hmac_key && hmac_key[0] != '\0';
+}
+
+void OtaUpdater::confirm()
+{
+    if (!trial)
+    {
+        return;
+    }
+    trial = false;
+
+#if PICO_RP2350
+    // The bootrom rewrites the image's first sector: it needs a sector of work area
+    uint8_t* work = new uint8_t[FLASH_SECTOR_SIZE];
+    int ret = rom_explicit_buy(work, FLASH_SECTOR_SIZE);
+    delete[] work;
+    printf("[Ota] Version %u on slot %c %s\n", (unsigned)running_version, running_slot == 1 ? 'B' : 'A',
+           ret == 0 ? "kept" : "could not be kept, the next reboot goes back");
+#endif
+}
+
+void OtaUpdater::rollback()
+{
+    if (!trial)
+    {
+        return;
+    }
+
+    // Not bought: a normal boot does not pick the trial image again
+    printf("[Ota] Version %u not confirmed in %u s, going back\n", (unsigned)running_version,
+           OTA_TRIAL_TIMEOUT_MS / 1000);
+    watchdog_reboot(0, 0, 100);
+}
+
+bool OtaUpdater::download(Sim7670G & sim7670g)
+{
+    if (!supported())
+    {
+        printf("[Ota] ❌ Not available: no A/B partitions, OTA_FIRMWARE_URL or OTA_HMAC_KEY\n");
+        ota_stats.last_status = OTA_IDLE;
+        return false;
+    }
+
+    printf("[Ota] Downloading %s into slot %c\n", url, target_offset == OTA_SLOT_A_OFFSET ? 'A' : 'B');
+
+    uint32_t start = now_ms();
+    ota_stats.attempts++;
+    ota_stats.erase_ms = 0;
+    image.begin(running_version);
+
+    // Each AT+HTTPREAD chunk goes to flash before the next one is asked for.
+    // The whole download outlasts the watchdog period: every chunk feeds it
+    bool ok = sim7670g.sim7670g_https_get_stream(url, [this](const char* data, int len)
+    {
+        watchdog_update();
+        return image.feed((const uint8_t*)data, len);
+    }, sim7670g_deadline(OTA_DOWNLOAD_TIMEOUT_MS));
+    ok = ok && image.finish();
+
+    ota_stats.last_bytes = image.received();
+    ota_stats.last_ms = now_ms() - start;
+    ota_stats.last_status = image.status();
+
+    // A failed attempt leaves a partial image: the running slot is untouched
+    // and the bootrom never picks a slot without a valid image
+    printf("[Ota] %s: %u bytes in %u ms (%u B/s, erase %u ms)\n",
+           OtaImage::statusName(image.status()), (unsigned)ota_stats.last_bytes, (unsigned)ota_stats.last_ms,
+           ota_stats.last_ms ? (unsigned)(ota_stats.last_bytes * 1000ULL / ota_stats.last_ms) : 0u,
+           (unsigned)ota_stats.erase_ms);
+    return ok;
+}
+
+void OtaUpdater::reboot()
+{
+    if (image.status() != OTA_VERIFIED)
+    {
+        return;
+    }
+
+    printf("[Ota] Rebooting into version %u\n", (unsigned)image.header().firmware_version);
+#if PICO_RP2350
+    // Flash update boot: the new slot runs on trial until confirm()
+    rom_reboot(REBOOT2_FLAG_REBOOT_TYPE_FLASH_UPDATE, 1000, XIP_BASE + target_offset, 0);
+#endif
+}
+
+bool OtaUpdater::erase(uint32_t offset, uint32_t len)
+{
+    uint32_t start = now_ms();
+    for (uint32_t done = 0; done < len; done += OTA_ERASE_STEP)
+    {
+        FlashOp op = {target_offset + offset + done, nullptr, len - done < OTA_ERASE_STEP ? len - done : OTA_ERASE_STEP};
+        if (flash_safe_execute(flash_erase_op, &op, OTA_FLASH_LOCKOUT_MS) != PICO_OK)
+        {
+            return false;
+        }
+        // A whole slot takes longer to erase than the watchdog period
+        watchdog_update();
+    }
+    ota_stats.erase_ms += now_ms() - start;
+    return true;
+}
+
+bool OtaUpdater::program(uint32_t offset, const uint8_t* data, uint32_t len)
+{
+    FlashOp op = {target_offset + offset, data, len};
+    return flash_safe_execute(flash_program_op, &op, OTA_FLASH_LOCKOUT_MS) == PICO_OK;
+}
+
+bool OtaUpdater::read(uint32_t offset, uint8_t* data, uint32_t len)
+{
+    // Uncached, so the check sees the flash and not stale cache lines
+    memcpy(data, (const uint8_t*)(uintptr_t)(OTA_FLASH_DATA_BASE + target_offset + offset), len);
+    return true;
+}
+
+int OtaUpdater::format(char* buffer, size_t len) const
+{
+    int pos = snprintf(buffer, len, "Firmware %u, slot %c\n", (unsigned)running_version,
+                       running_slot < 0 ? '-' : running_slot == 1 ? 'B' : 'A');
+    if (ota_stats.attempts > 0 && pos > 0 && (size_t)pos < len)
+    {
+        pos += snprintf(buffer + pos, len - pos, "Última actualización: %s, %u KB en %u s (%u B/s)\n",
+                        OtaImage::statusName(ota_stats.last_status), (unsigned)(ota_stats.last_bytes / 1024),
+                        (unsigned)(ota_stats.last_ms / 1000),
+                        ota_stats.last_ms ? (unsigned)(ota_stats.last_bytes * 1000ULL / ota_stats.last_ms) : 0u);
+    }
+    return pos;
+}
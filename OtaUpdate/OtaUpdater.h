@@ -0,0 +1,101 @@
+#ifndef OTA_UPDATER_H
+#define OTA_UPDATER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hardware/regs/addressmap.h"
+#include "sim7670g.h"
+#include "OtaImage.h"
+
+// Firmware slots, as laid out in partition_table.json (RP2350 A/B partitions).
+// The flash after them (cell table, geocoder) is left unpartitioned.
+#define OTA_SLOT_A_OFFSET 0x002000
+#define OTA_SLOT_B_OFFSET 0x100000
+#define OTA_SLOT_SIZE 0x0FE000
+
+// Flash outside the slots, read past the address translation the bootrom
+// sets up for the running slot (it maps only that slot at XIP_BASE)
+#if PICO_RP2350
+#define OTA_FLASH_DATA_BASE XIP_NOCACHE_NOALLOC_NOTRANSLATE_BASE
+#else
+#define OTA_FLASH_DATA_BASE XIP_BASE
+#endif
+
+// Whole download: +HTTPACTION (the modem buffers the body), then every
+// AT+HTTPREAD chunk and its flash write (~90 s for 900 KB at 115200 baud)
+#define OTA_DOWNLOAD_TIMEOUT_MS 300000
+
+// A firmware on trial that has not confirmed by then goes back to the old slot
+#define OTA_TRIAL_TIMEOUT_MS (10u * 60u * 1000u)
+
+// Erase in blocks so interrupts are never off for long
+#define OTA_ERASE_STEP 0x10000
+
+// Wait for the other core to leave flash before erasing or programming
+#define OTA_FLASH_LOCKOUT_MS 100
+
+struct OtaStats
+{
+    uint32_t attempts;
+    uint32_t last_bytes;           // image bytes received in the last attempt
+    uint32_t last_ms;              // download + flash + verify
+    uint32_t erase_ms;             // of which erasing
+    OtaStatus last_status;
+};
+
+/**
+ * Firmware update over the air on the RP2350 A/B partitions.
+ *
+ * download() streams a signed image (tools/ota_pack) from OTA_FIRMWARE_URL
+ * through chunked AT+HTTPREAD into the slot that is not running, through
+ * OtaImage. reboot() then boots that slot on trial. main re-arms the
+ * bootrom's try-before-you-buy watchdog and only calls confirm() once the
+ * new firmware has reached Telegram; any reboot before that (a hang, or
+ * rollback()) boots the old slot again. On the RP2040 there is no A/B boot
+ * and download() refuses.
+ */
+class OtaUpdater
+{
+public:
+    OtaUpdater(const char* url, const char* hmac_key, uint32_t running_version);
+
+    bool supported() const;
+
+    // Booted on trial after an update and not confirmed yet
+    bool onTrial() const { return trial; }
+
+    // Keep the running firmware (once it has proved it works)
+    void confirm();
+
+    // Give up the trial: reboot into the previous slot
+    void rollback();
+
+    // Run inside a modem transaction; true once the image is verified in flash
+    bool download(Sim7670G & sim7670g);
+
+    // Boot the verified slot on trial
+    void reboot();
+
+    uint32_t runningVersion() const { return running_version; }
+    int runningSlot() const { return running_slot; }
+
+    const OtaStats& stats() const { return ota_stats; }
+
+    int format(char* buffer, size_t len) const;
+
+private:
+    const char* url;
+    const char* hmac_key;
+    uint32_t running_version;
+    int running_slot;              // 0 = A, 1 = B, -1 = no partition table
+    bool trial;
+    uint32_t target_offset;        // flash offset of the slot being written
+    OtaImage image;
+    OtaStats ota_stats;
+
+    bool erase(uint32_t offset, uint32_t len);
+    bool program(uint32_t offset, const uint8_t* data, uint32_t len);
+    bool read(uint32_t offset, uint8_t* data, uint32_t len);
+};
+
+#endif // OTA_UPDATER_H
@@ -0,0 +1,37 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SHA256_DIGEST_SIZE 32
+#define SHA256_BLOCK_SIZE 64
+
+/**
+ * Incremental SHA-256 (FIPS 180-4), fed as the image streams in.
+ * Pure logic with no SDK dependency: the host tools sign and check images
+ * with the same code (tools/ota_pack, tools/ota_sim).
+ */
+class Sha256
+{
+public:
+    Sha256();
+
+    void reset();
+    void update(const uint8_t* data, size_t len);
+    void finish(uint8_t digest[SHA256_DIGEST_SIZE]);
+
+    // HMAC-SHA256 (RFC 2104) of a short message
+    static void hmac(const uint8_t* key, size_t key_len, const uint8_t* data, size_t len,
+                     uint8_t mac[SHA256_DIGEST_SIZE]);
+
+private:
+    uint32_t state[8];
+    uint64_t total_len;
+    uint8_t block[SHA256_BLOCK_SIZE];
+    size_t block_len;
+
+    void compress(const uint8_t* data);
+};
+
+#endif // SHA256_H
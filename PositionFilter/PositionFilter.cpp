@@ -0,0 +1,236 @@
+#include "PositionFilter.h"
+#include <cmath>
+
+// Velocity uncertainty of a fresh estimate (1 sigma, mm/s)
+#define POSITION_FILTER_INITIAL_SPEED_SIGMA 20000
+
+// Smallest fix variance accepted (10 cm, 1 sigma)
+#define POSITION_FILTER_MIN_VARIANCE 10000
+
+static uint64_t isqrt64(uint64_t v)
+{
+    uint64_t result = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > v)
+    {
+        bit >>= 2;
+    }
+    while (bit)
+    {
+        if (v >= result + bit)
+        {
+            v -= result + bit;
+            result = (result >> 1) + bit;
+        }
+        else
+        {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return result;
+}
+
+// num / den in Q16, den > 0, without overflowing for large covariances
+static int64_t ratio_q16(int64_t num, int64_t den)
+{
+    int shift = 0;
+    int64_t magnitude = num < 0 ? -num : num;
+    while ((magnitude >> shift) >= (1LL << 46))
+    {
+        shift++;
+    }
+    int64_t scaled_den = den >> shift;
+    if (scaled_den == 0)
+    {
+        return num < 0 ? -65536 : 65536;
+    }
+    return ((num >> shift) << 16) / scaled_den;
+}
+
+// x * k for a Q16 factor |k| <= 1, split to stay inside 64 bits
+static int64_t mul_q16(int64_t x, int64_t k)
+{
+    bool negative = x < 0;
+    uint64_t magnitude = negative ? -(uint64_t)x : (uint64_t)x;
+    int64_t product = (int64_t)(magnitude >> 16) * k + (((int64_t)(magnitude & 0xFFFF) * k) >> 16);
+    return negative ? -product : product;
+}
+
+PositionFilter::PositionFilter(const PositionFilterConfig& config)
+    : config(config),
+      valid(false),
+      rejects(0),
+      last_ms(0),
+      origin_lat_e6(0),
+      origin_lon_e6(0),
+      cos_q16(65536),
+      north(),
+      east(),
+      filter_stats()
+{
+}
+
+int64_t PositionFilter::north_mm(int32_t lat_e6) const
+{
+    return (int64_t)((int64_t)lat_e6 - origin_lat_e6) * 111195 / 1000;
+}
+
+int64_t PositionFilter::east_mm(int32_t lon_e6) const
+{
+    int64_t mm = (int64_t)((int64_t)lon_e6 - origin_lon_e6) * 111195 / 1000;
+    return (mm * cos_q16) >> 16;
+}
+
+void PositionFilter::anchor(uint32_t now_ms, int32_t lat_e6, int32_t lon_e6, int64_t var)
+{
+    // New local frame around the fix: keeps the flat-earth error small
+    origin_lat_e6 = lat_e6;
+    origin_lon_e6 = lon_e6;
+    int32_t c = (int32_t)(cosf(lat_e6 * 1.7453293e-8f) * 65536.0f);
+    cos_q16 = c > 1 ? c : 1;
+
+    int64_t speed_var = (int64_t)POSITION_FILTER_INITIAL_SPEED_SIGMA * POSITION_FILTER_INITIAL_SPEED_SIGMA;
+    north = {0, 0, var, 0, speed_var};
+    east = north;
+
+    last_ms = now_ms;
+    rejects = 0;
+    valid = true;
+    filter_stats.resets++;
+}
+
+void PositionFilter::predict(Axis& axis, uint32_t dt_ms) const
+{
+    if (dt_ms == 0)
+    {
+        return;
+    }
+
+    int64_t t = dt_ms;
+    axis.pos += axis.vel * t / 1000;
+
+    // F P F': dt in ms, divided step by step to stay in range
+    int64_t p11_t = axis.p11 * t / 1000;
+    axis.p00 += 2 * axis.p01 * t / 1000 + p11_t * t / 1000;
+    axis.p01 += p11_t;
+
+    // Q for a random acceleration a: a^2 [t^4/4, t^3/2; t^3/2, t^2]
+    int64_t a2 = (int64_t)config.accel_noise_mm_s2 * config.accel_noise_mm_s2;
+    int64_t q1 = a2 * t / 1000;
+    int64_t q2 = q1 * t / 1000;
+    int64_t q3 = q2 * t / 1000;
+    axis.p11 += q2;
+    axis.p01 += q3 / 2;
+    axis.p00 += q3 * t / 4000;
+}
+
+void PositionFilter::correct(Axis& axis, int64_t z, int64_t var) const
+{
+    int64_t s = axis.p00 + var;
+    int64_t k0 = ratio_q16(axis.p00, s);
+    int64_t k1 = ratio_q16(axis.p01, s);
+    int64_t y = z - axis.pos;
+
+    axis.pos += mul_q16(y, k0);
+    axis.vel += mul_q16(y, k1);
+
+    int64_t p01 = axis.p01;
+    axis.p00 -= mul_q16(axis.p00, k0);
+    axis.p01 -= mul_q16(p01, k0);
+    axis.p11 -= mul_q16(p01, k1);
+}
+
+FilterResult PositionFilter::update(uint32_t now_ms, int32_t lat_e6, int32_t lon_e6, uint32_t accuracy_mm)
+{
+    int64_t sigma = accuracy_mm ? accuracy_mm : config.fix_sigma_mm;
+    int64_t var = sigma * sigma;
+    if (var < POSITION_FILTER_MIN_VARIANCE)
+    {
+        var = POSITION_FILTER_MIN_VARIANCE;
+    }
+
+    uint32_t dt = now_ms - last_ms;
+    if (!valid || dt > config.max_predict_ms)
+    {
+        anchor(now_ms, lat_e6, lon_e6, var);
+        return FILTER_RESET;
+    }
+
+    Axis n = north;
+    Axis e = east;
+    predict(n, dt);
+    predict(e, dt);
+
+    // Innovation gate: (y_n^2 / S_n + y_e^2 / S_e) against chi2 with 2 dof.
+    // Only for recent predictions: after a longer gap the constant-velocity
+    // guess is worse than the fix and would reject good fixes
+    int64_t yn = north_mm(lat_e6) - n.pos;
+    int64_t ye = east_mm(lon_e6) - e.pos;
+    int64_t limit = 3000000000LL;     // 3000 km: an obvious outlier, avoids overflow
+    bool outlier = yn > limit || yn < -limit || ye > limit || ye < -limit;
+    if (!outlier && dt <= config.max_extrapolate_ms)
+    {
+        int64_t d2_q8 = yn * yn / ((n.p00 + var) >> 8) + ye * ye / ((e.p00 + var) >> 8);
+        outlier = d2_q8 > config.gate_d2_q8;
+    }
+
+    if (outlier)
+    {
+        filter_stats.rejected++;
+        if (++rejects >= config.max_rejects)
+        {
+            // Consistent "outliers": the estimate is what is wrong
+            anchor(now_ms, lat_e6, lon_e6, var);
+            return FILTER_RESET;
+        }
+        return FILTER_REJECTED;
+    }
+
+    correct(n, north_mm(lat_e6), var);
+    correct(e, east_mm(lon_e6), var);
+    north = n;
+    east = e;
+    last_ms = now_ms;
+    rejects = 0;
+    filter_stats.accepted++;
+    return FILTER_ACCEPTED;
+}
+
+bool PositionFilter::estimate(uint32_t now_ms, int32_t* lat_e6, int32_t* lon_e6, uint32_t* sigma_m) const
+{
+    uint32_t dt = now_ms - last_ms;
+    if (!valid || dt > config.max_predict_ms)
+    {
+        return false;
+    }
+
+    // A velocity projected over long gaps drifts kilometres away: past a few
+    // seconds the position is held, while the uncertainty keeps growing
+    uint32_t coast = dt < config.max_extrapolate_ms ? dt : config.max_extrapolate_ms;
+    Axis n = north;
+    Axis e = east;
+    predict(n, dt);
+    predict(e, dt);
+    int64_t n_pos = north.pos + north.vel * (int64_t)coast / 1000;
+    int64_t e_pos = east.pos + east.vel * (int64_t)coast / 1000;
+
+    *lat_e6 = origin_lat_e6 + (int32_t)(n_pos * 1000 / 111195);
+    *lon_e6 = origin_lon_e6 + (int32_t)(((e_pos << 16) / cos_q16) * 1000 / 111195);
+
+    if (sigma_m)
+    {
+        *sigma_m = (uint32_t)(isqrt64((uint64_t)(n.p00 + e.p00) / 2) / 1000);
+    }
+    return true;
+}
+
+uint32_t PositionFilter::speed() const
+{
+    if (!valid)
+    {
+        return 0;
+    }
+    return (uint32_t)isqrt64((uint64_t)(north.vel * north.vel + east.vel * east.vel));
+}
@@ -0,0 +1,98 @@
+#ifndef POSITION_FILTER_H
+#define POSITION_FILTER_H
+
+#include <stdint.h>
+
+// Millimetres per micro-degree of latitude (mean Earth radius)
+#define POSITION_FILTER_MM_PER_E6 111.195
+
+struct PositionFilterConfig
+{
+    uint32_t accel_noise_mm_s2;    // random acceleration allowed by the model
+    uint32_t fix_sigma_mm;         // GNSS error (1 sigma) when the fix has no estimate
+    uint32_t gate_d2_q8;           // Mahalanobis gate, squared, Q8 (chi2, 2 dof)
+    uint8_t max_rejects;           // consecutive rejects before re-anchoring on the fix
+    uint32_t max_predict_ms;       // estimate older than this is stale
+    uint32_t max_extrapolate_ms;   // velocity is trusted (projection, gate) this far past a fix
+};
+
+// 0.5 m/s2 walking/driving manoeuvres, 5 m fixes, 99.9% gate, 3 rejects,
+// stale after 5 min, dead reckoning for 5 s and then the position is held
+#define POSITION_FILTER_DEFAULTS {500, 5000, 3533, 3, 300000, 5000}
+
+enum FilterResult
+{
+    FILTER_ACCEPTED,
+    FILTER_REJECTED,           // outlier, the estimate is unchanged
+    FILTER_RESET               // first fix, stale estimate or repeated rejects
+};
+
+struct FilterStats
+{
+    uint32_t accepted;
+    uint32_t rejected;
+    uint32_t resets;
+};
+
+/**
+ * Constant-velocity Kalman filter for GNSS fixes, in fixed point.
+ *
+ * North and east are filtered independently in millimetres around the first
+ * fix (int64 covariances, Q16 gains); only the origin's cos(lat) uses floats.
+ * Fixes whose innovation falls outside the gate are rejected instead of
+ * dragging the estimate; a run of rejects means the position really moved
+ * (or the estimate went stale) and the filter re-anchors on the fix.
+ *
+ * Pure logic with no SDK dependency: time only enters through now_ms.
+ */
+class PositionFilter
+{
+public:
+    explicit PositionFilter(const PositionFilterConfig& config = POSITION_FILTER_DEFAULTS);
+
+    // Feed a fix; accuracy_mm = 0 uses config.fix_sigma_mm
+    FilterResult update(uint32_t now_ms, int32_t lat_e6, int32_t lon_e6, uint32_t accuracy_mm = 0);
+
+    // Estimate at now_ms: dead reckoning up to max_extrapolate_ms past the last
+    // fix, held after that; false if there is none or it is older than
+    // max_predict_ms. sigma_m: 1-sigma uncertainty for the whole age
+    bool estimate(uint32_t now_ms, int32_t* lat_e6, int32_t* lon_e6, uint32_t* sigma_m = nullptr) const;
+
+    // Speed of the last estimate (mm/s)
+    uint32_t speed() const;
+
+    bool isValid() const { return valid; }
+    void reset() { valid = false; }
+
+    const FilterStats& stats() const { return filter_stats; }
+
+private:
+    // One axis: position (mm), velocity (mm/s) and their covariance
+    struct Axis
+    {
+        int64_t pos;
+        int64_t vel;
+        int64_t p00;           // mm^2
+        int64_t p01;           // mm^2/s
+        int64_t p11;           // mm^2/s^2
+    };
+
+    PositionFilterConfig config;
+    bool valid;
+    uint8_t rejects;
+    uint32_t last_ms;
+    int32_t origin_lat_e6;
+    int32_t origin_lon_e6;
+    int32_t cos_q16;           // cos(origin latitude)
+    Axis north;
+    Axis east;
+    FilterStats filter_stats;
+
+    void anchor(uint32_t now_ms, int32_t lat_e6, int32_t lon_e6, int64_t var);
+    void predict(Axis& axis, uint32_t dt_ms) const;
+    void correct(Axis& axis, int64_t z, int64_t var) const;
+    int64_t north_mm(int32_t lat_e6) const;
+    int64_t east_mm(int32_t lon_e6) const;
+};
+
+#endif // POSITION_FILTER_H
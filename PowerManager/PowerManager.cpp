@@ -0,0 +1,112 @@
+#include "PowerManager.h"
+#include <cstdio>
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+#include "hardware/watchdog.h"
+
+// Set from interrupt context, polled by sleepUntil()
+static volatile bool modem_activity = false;
+
+static void on_ri(unsigned gpio, uint32_t events)
+{
+    modem_activity = true;
+}
+
+static void on_uart_rx()
+{
+    // The bytes stay in the FIFO for the normal reader; mask the
+    // interrupt so it does not fire again until the next sleep
+    uart_set_irq_enables(SIM7670G_UART, false, false);
+    modem_activity = true;
+}
+
+PowerManager::PowerManager(Sim7670G & sim7670g)
+    : sim7670g(sim7670g),
+      power_schedule(),
+      modem_sleep_enabled(false)
+{
+}
+
+PowerManager::~PowerManager()
+{
+    arm_wake_sources(false);
+    sim7670g.sim7670g_wake();
+}
+
+bool PowerManager::begin()
+{
+    gpio_set_irq_enabled_with_callback(SIM7670G_RI_PIN, GPIO_IRQ_EDGE_FALL, false, on_ri);
+
+    int uart_irq = SIM7670G_UART == uart0 ? UART0_IRQ : UART1_IRQ;
+    irq_set_exclusive_handler(uart_irq, on_uart_rx);
+    irq_set_enabled(uart_irq, true);
+
+    modem_sleep_enabled = sim7670g.sim7670g_sleep_enable(sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
+    if (!modem_sleep_enabled)
+    {
+        printf("[PowerManager] ⚠️  AT+CSCLK not accepted, modem stays awake\n");
+    }
+
+    power_schedule.record(to_ms_since_boot(get_absolute_time()), 0, false, false);
+    return modem_sleep_enabled;
+}
+
+void PowerManager::arm_wake_sources(bool enable)
+{
+    gpio_set_irq_enabled(SIM7670G_RI_PIN, GPIO_IRQ_EDGE_FALL, enable);
+    uart_set_irq_enables(SIM7670G_UART, enable, false);
+}
+
+bool PowerManager::sleepUntil(uint32_t deadline_ms)
+{
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    PowerPlan plan = power_schedule.plan(now, deadline_ms);
+
+    // Bytes already waiting: handle them instead of sleeping
+    if (plan.sleep_ms == 0 || uart_is_readable(SIM7670G_UART))
+    {
+        return false;
+    }
+
+    bool modem_slept = plan.modem_sleep && modem_sleep_enabled;
+    if (modem_slept)
+    {
+        sim7670g.sim7670g_allow_sleep();
+    }
+
+    modem_activity = false;
+    arm_wake_sources(true);
+
+    absolute_time_t wake_time = make_timeout_time_ms(plan.sleep_ms);
+    while (!modem_activity)
+    {
+        absolute_time_t slice = make_timeout_time_ms(POWER_WATCHDOG_FEED_MS);
+        bool last = absolute_time_diff_us(slice, wake_time) <= 0;
+
+        // true once the alarm has fired
+        if (best_effort_wfe_or_timeout(last ? wake_time : slice))
+        {
+            watchdog_update();
+            if (last)
+            {
+                break;
+            }
+        }
+    }
+
+    arm_wake_sources(false);
+    bool woke = modem_activity;
+
+    uint32_t end = to_ms_since_boot(get_absolute_time());
+    if (woke && modem_slept)
+    {
+        // Data pending on the modem side: take DTR low before reading it
+        sim7670g.sim7670g_wake();
+    }
+
+    power_schedule.record(end, end - now, modem_slept, woke);
+
+    return woke;
+}
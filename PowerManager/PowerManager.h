@@ -0,0 +1,43 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <stdint.h>
+#include "sim7670g.h"
+#include "PowerSchedule.h"
+
+// Longest WFE without feeding the hardware watchdog (below its 8 s period)
+#define POWER_WATCHDOG_FEED_MS 4000
+
+/**
+ * Sleeps the MCU between timer deadlines and lets the SIM7670G drop to its
+ * slow-clock mode (AT+CSCLK=1, DTR high) during long gaps.
+ *
+ * The MCU waits in WFE with a timer alarm; the modem's RI line and the UART
+ * RX interrupt cut the sleep short when data arrives. Dormant mode is not
+ * used: it stops the USB clock and with it the stdio console. Long sleeps
+ * wake every POWER_WATCHDOG_FEED_MS to feed the hardware watchdog.
+ */
+class PowerManager
+{
+public:
+    PowerManager(Sim7670G & sim7670g);
+    ~PowerManager();
+
+    // Configurar RI/UART como fuentes de despertar y habilitar AT+CSCLK
+    bool begin();
+
+    // Dormir hasta deadline_ms o hasta actividad del módem.
+    // Devuelve true si lo despertó el módem
+    bool sleepUntil(uint32_t deadline_ms);
+
+    const PowerSchedule& schedule() const { return power_schedule; }
+
+private:
+    Sim7670G & sim7670g;
+    PowerSchedule power_schedule;
+    bool modem_sleep_enabled;
+
+    void arm_wake_sources(bool enable);
+};
+
+#endif // POWER_MANAGER_H
@@ -0,0 +1,75 @@
+#include "PowerSchedule.h"
+#include <cstdio>
+
+PowerSchedule::PowerSchedule()
+    : power_stats(),
+      last_record_ms(0),
+      started(false)
+{
+}
+
+PowerPlan PowerSchedule::plan(uint32_t now_ms, uint32_t deadline_ms) const
+{
+    PowerPlan result = {0, false};
+
+    int32_t gap = (int32_t)(deadline_ms - now_ms);
+    if (gap < POWER_MIN_SLEEP_MS)
+    {
+        return result;
+    }
+
+    result.sleep_ms = gap > POWER_MAX_SLEEP_MS ? POWER_MAX_SLEEP_MS : (uint32_t)gap;
+    result.modem_sleep = result.sleep_ms >= POWER_MODEM_SLEEP_MIN_MS;
+    return result;
+}
+
+void PowerSchedule::record(uint32_t now_ms, uint32_t slept_ms, bool modem_slept, bool modem_woke)
+{
+    if (!started)
+    {
+        // First call only sets the reference point
+        started = true;
+        last_record_ms = now_ms;
+        return;
+    }
+
+    uint32_t elapsed = now_ms - last_record_ms;
+    last_record_ms = now_ms;
+
+    if (slept_ms > elapsed)
+    {
+        slept_ms = elapsed;
+    }
+
+    power_stats.asleep_ms += slept_ms;
+    power_stats.awake_ms += elapsed - slept_ms;
+    power_stats.sleeps++;
+
+    if (modem_slept)
+    {
+        power_stats.modem_sleep_ms += slept_ms;
+    }
+    if (modem_woke)
+    {
+        power_stats.modem_wakes++;
+    }
+}
+
+float PowerSchedule::dutyCycle() const
+{
+    uint64_t total = power_stats.awake_ms + power_stats.asleep_ms;
+    return total ? (float)power_stats.awake_ms / total : 1.0f;
+}
+
+float PowerSchedule::modemDutyCycle() const
+{
+    uint64_t total = power_stats.awake_ms + power_stats.asleep_ms;
+    return total ? 1.0f - (float)power_stats.modem_sleep_ms / total : 1.0f;
+}
+
+int PowerSchedule::format(char* buffer, size_t len) const
+{
+    return snprintf(buffer, len, "Energía: MCU activo %.1f%%, módem activo %.1f%% (%u esperas, %u despertares)\n",
+                    dutyCycle() * 100.0f, modemDutyCycle() * 100.0f,
+                    power_stats.sleeps, power_stats.modem_wakes);
+}
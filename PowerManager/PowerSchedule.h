@@ -0,0 +1,66 @@
+#ifndef POWER_SCHEDULE_H
+#define POWER_SCHEDULE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Gaps shorter than this are not worth sleeping (ms)
+#define POWER_MIN_SLEEP_MS 5
+
+// The modem only goes to slow clock for gaps at least this long (ms):
+// waking it costs SIM7670G_WAKE_DELAY_MS plus the first AT round-trip
+#define POWER_MODEM_SLEEP_MIN_MS 2000
+
+// Upper bound for one sleep, so the loop still runs now and then (ms)
+#define POWER_MAX_SLEEP_MS 60000
+
+struct PowerPlan
+{
+    uint32_t sleep_ms;         // 0 = stay awake
+    bool modem_sleep;          // release DTR for the slow-clock mode
+};
+
+struct PowerStats
+{
+    uint64_t awake_ms;         // MCU running
+    uint64_t asleep_ms;        // MCU in WFE
+    uint64_t modem_sleep_ms;   // modem allowed to sleep
+    uint32_t sleeps;
+    uint32_t modem_wakes;      // sleeps cut short by RI / UART
+};
+
+/**
+ * Sleep planning and duty-cycle accounting.
+ *
+ * Pure logic with no SDK dependency: every call takes the current time, so
+ * it can be driven from a simulated clock on the host.
+ */
+class PowerSchedule
+{
+public:
+    PowerSchedule();
+
+    // How long to sleep from now_ms until deadline_ms
+    PowerPlan plan(uint32_t now_ms, uint32_t deadline_ms) const;
+
+    // Account the interval since the previous call; slept_ms of it in WFE
+    void record(uint32_t now_ms, uint32_t slept_ms, bool modem_slept, bool modem_woke);
+
+    // Fraction of the time the MCU was awake, 0.0 - 1.0
+    float dutyCycle() const;
+
+    // Fraction of the time the modem was kept awake, 0.0 - 1.0
+    float modemDutyCycle() const;
+
+    const PowerStats& stats() const { return power_stats; }
+
+    // Human-readable summary
+    int format(char* buffer, size_t len) const;
+
+private:
+    PowerStats power_stats;
+    uint32_t last_record_ms;
+    bool started;
+};
+
+#endif // POWER_SCHEDULE_H
@@ -1,6 +1,8 @@
 #include "sim7670g.h"
+#include "sim7670g_parse.h"
 #include <cstdio>
 #include <string.h>
+#include "hardware/watchdog.h"
 
 // Buffer circular para RX
 static char rx_buffer[RX_BUFFER_SIZE];
@@ -11,13 +13,75 @@ static uint16_t rx_tail = 0;
 static uint64_t last_response_time = 0;
 
 Sim7670G::Sim7670G(const std::string & sim_pin)
-    : pin_(sim_pin)
+    : device_info(),
+      pin_(sim_pin),
+      ssl_started(false),
+      ssl_open(false),
+      ssl_rx_bytes(0),
+      last_content_length(0),
+      modem_asleep(false),
+      link_down_ms(0),
+      utc_valid(false),
+      utc_base_s(0),
+      utc_base_ms(0),
+      http_target_id(0),
+      batch_stats(),
+      timeout_stage(SIM7670G_STAGE_NONE),
+      recv_aborted(false)
 {
 }
 
 Sim7670G::~Sim7670G()
 {
-    sim7670g_send_command("AT+HTTPTERM", "OK", SIM7670G_CMD_TIMEOUT);
+    sim7670g_ssl_close();
+    sim7670g_send_command("AT+HTTPTERM", "OK", sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
+}
+
+/**
+ * Nombre de una etapa para los mensajes de error
+ */
+const char* sim7670g_stage_name(sim7670g_stage_t stage)
+{
+    switch (stage) 
+    {
+        case SIM7670G_STAGE_COMMAND:     return "comando AT";
+        case SIM7670G_STAGE_TLS:         return "TLS";
+        case SIM7670G_STAGE_HTTP_ACTION: return "HTTP action";
+        case SIM7670G_STAGE_BODY_READ:   return "lectura del cuerpo";
+        default:                         return "ninguna";
+    }
+}
+
+/**
+ * ¿Ha vencido el plazo? (resta con signo: sigue valiendo al dar la vuelta el contador)
+ */
+static bool sim7670g_deadline_passed(uint32_t deadline_ms)
+{
+    return (int32_t)(deadline_ms - to_ms_since_boot(get_absolute_time())) <= 0;
+}
+
+/**
+ * Plazo en ms desde el arranque -> instante en us para los bucles de la UART
+ */
+static uint64_t sim7670g_deadline_us(uint32_t deadline_ms)
+{
+    int32_t left = (int32_t)(deadline_ms - to_ms_since_boot(get_absolute_time()));
+    return time_us_64() + (left > 0 ? (uint64_t)left * 1000ULL : 0);
+}
+
+/**
+ * Anotar la etapa si el fallo se debe a que venció el plazo; devuelve false.
+ * La etapa más externa gana: ssl_open sobrescribe el "comando AT" de su AT+CCHOPEN
+ */
+bool Sim7670G::sim7670g_fail(sim7670g_stage_t stage, uint32_t deadline_ms)
+{
+    if (sim7670g_deadline_passed(deadline_ms)) 
+    {
+        if (timeout_stage != stage) 
+            printf("⏱ Plazo agotado en: %s\n", sim7670g_stage_name(stage));
+        timeout_stage = stage;
+    }
+    return false;
 }
 
 /**
@@ -38,10 +102,50 @@ void Sim7670G::sim7670g_uart_init()
     uart_set_hw_flow(SIM7670G_UART, false, false);
     uart_set_format(SIM7670G_UART, 8, 1, UART_PARITY_NONE);
     uart_set_fifo_enabled(SIM7670G_UART, true);
+
+    // DTR bajo = módem despierto; RI lo baja el módem al llegar datos/URC
+    gpio_init(SIM7670G_DTR_PIN);
+    gpio_set_dir(SIM7670G_DTR_PIN, GPIO_OUT);
+    gpio_put(SIM7670G_DTR_PIN, 0);
+    gpio_init(SIM7670G_RI_PIN);
+    gpio_set_dir(SIM7670G_RI_PIN, GPIO_IN);
+    gpio_pull_up(SIM7670G_RI_PIN);
     
     printf("UART1 inicializado a %u baudios\n", SIM7670G_BAUD);
 }
 
+/**
+ * Habilitar el modo de reloj lento (controlado por DTR)
+ */
+bool Sim7670G::sim7670g_sleep_enable(uint32_t deadline_ms) 
+{
+    printf("Habilitando modo de reloj lento...\n");
+    return sim7670g_send_command("AT+CSCLK=1", "OK", deadline_ms);
+}
+
+/**
+ * Permitir que el módem duerma (DTR alto)
+ * Sigue avisando de datos entrantes por RI y la UART
+ */
+void Sim7670G::sim7670g_allow_sleep() 
+{
+    gpio_put(SIM7670G_DTR_PIN, 1);
+    modem_asleep = true;
+}
+
+/**
+ * Despertar el módem antes de enviar comandos AT (DTR bajo)
+ */
+void Sim7670G::sim7670g_wake() 
+{
+    if (!modem_asleep) 
+        return;
+
+    gpio_put(SIM7670G_DTR_PIN, 0);
+    sleep_ms(SIM7670G_WAKE_DELAY_MS);
+    modem_asleep = false;
+}
+
 /**
  * Transmitir string por UART1
  */
@@ -61,27 +165,146 @@ void Sim7670G::sim7670g_tx_string(const char *str)
  */
 void Sim7670G::sim7670g_rx_flush() 
 {
-    // Primero leer lo que hay en UART
+    char line[128];
+    int pos = 0;
+
+    // Primero leer lo que hay en UART; las URC completas no se pierden
     while (uart_is_readable(SIM7670G_UART)) 
     {
-        uart_getc(SIM7670G_UART);
+        char c = uart_getc(SIM7670G_UART);
+
+        if (c == '\r') 
+            continue;
+        if (c == '\n') 
+        {
+            line[pos] = '\0';
+            if (pos > 0) 
+                sim7670g_dispatch_urc(line);
+            pos = 0;
+            continue;
+        }
+        if (pos < (int)sizeof(line) - 1) 
+        {
+            line[pos++] = c;
+        }
     }
     rx_head = 0;
     rx_tail = 0;
 }
 
+/**
+ * Entregar una línea no solicitada (+XXX: ...) a los manejadores de URC
+ */
+void Sim7670G::sim7670g_dispatch_urc(const char *line) 
+{
+    if (line[0] != '+') 
+        return;
+
+    sim7670g_handle_network_urc(line);
+
+    for (size_t i = 0; i < urc_handlers.size(); i++) 
+    {
+        urc_handlers[i](line);
+    }
+}
+
+/**
+ * Registrar manejador de URC
+ */
+void Sim7670G::sim7670g_add_urc_handler(UrcHandler handler) 
+{
+    urc_handlers.push_back(handler);
+}
+
+/**
+ * Marcar el enlace de datos como caído (la capa HTTP/SSL depende de él)
+ */
+void Sim7670G::sim7670g_link_lost(const char *reason, bool was_up) 
+{
+    if (was_up) 
+    {
+        link_down_ms = to_ms_since_boot(get_absolute_time());
+        printf("⚠️  Enlace de datos perdido: %s\n", reason);
+    }
+
+    // CCHSTART sigue activo en el módem; http_reinit lo para y rearranca
+    device_info.link.http_ready = false;
+    ssl_open = false;
+}
+
+/**
+ * Seguir el estado de red con +CREG/+CEREG/+CGEV (ver enable_network_urcs)
+ */
+void Sim7670G::sim7670g_handle_network_urc(const char *line) 
+{
+    bool was_up = sim7670g_link_up();
+    if (sim7670g_parse_link_urc(line, &device_info.link)) 
+    {
+        sim7670g_link_lost(line, was_up);
+    }
+}
+
+/**
+ * Activar avisos de registro y de eventos del dominio de paquetes
+ */
+bool Sim7670G::sim7670g_enable_network_urcs(uint32_t deadline_ms) 
+{
+    sim7670g_batch_cmd_t cmds[] = 
+    {
+        {"AT+CREG=1", NULL},
+        {"AT+CEREG=1", NULL},
+        {"AT+CGEREP=2,1", NULL}
+    };
+    return sim7670g_send_batch(cmds, 3, deadline_ms) == 3;
+}
+
+/**
+ * ¿Está el enlace de datos completo (registro, GPRS, PDP y HTTP)?
+ */
+bool Sim7670G::sim7670g_link_up() const 
+{
+    return device_info.link.network_registered && device_info.link.gprs_attached &&
+           device_info.link.pdp_active && device_info.link.http_ready;
+}
+
+/**
+ * Esperas largas con plazo conocido (arranque, reinicio, registro,
+ * +HTTPACTION, long poll y resultados que llegan después del OK): solo
+ * mientras dura una, la lectura de líneas alimenta el watchdog. El resto
+ * de esperas no lo alimenta, así un bucle que no vuelve al principal
+ * reinicia el Pico aunque cada espera tenga su plazo
+ */
+static int long_waits = 0;
+
+struct Sim7670gLongWait 
+{
+    explicit Sim7670gLongWait(bool active = true) : active(active) 
+    {
+        if (active) 
+            long_waits++;
+    }
+    ~Sim7670gLongWait() 
+    {
+        if (active) 
+            long_waits--;
+    }
+    bool active;
+};
+
 /**
  * Leer una línea del buffer (terminada en \n)
  * Ignora líneas vacías y continúa buscando
  */
-static bool sim7670g_read_line_skip_empty(char *line, int max_len, uint32_t timeout_ms) 
+static bool sim7670g_read_line_skip_empty(char *line, int max_len, uint64_t deadline_us) 
 {
-    uint64_t start_time = time_us_64();
     int pos = 0;
     bool line_received = false;
     
-    while ((time_us_64() - start_time) < (timeout_ms * 1000)) 
+    while (time_us_64() < deadline_us) 
     {
+        if (long_waits > 0) 
+            watchdog_update();
+
         // Leer caracteres del UART
         while (uart_is_readable(SIM7670G_UART)) 
         {
@@ -111,7 +334,10 @@ static bool sim7670g_read_line_skip_empty(char *line, int max_len, uint32_t time
             }
         }
         
-        sleep_ms(10);
+        // Dormir hasta 10 ms, nunca más allá del plazo
+        uint64_t now = time_us_64();
+        if (now < deadline_us) 
+            sleep_us(deadline_us - now < 10000 ? deadline_us - now : 10000);
     }
     
     line[pos] = '\0';
@@ -119,219 +345,649 @@ static bool sim7670g_read_line_skip_empty(char *line, int max_len, uint32_t time
 }
 
 /**
- * Enviar comando AT y esperar respuesta
+ * Leer un byte con límite de tiempo absoluto (sondeo sin dormir, la FIFO
+ * de la UART solo tiene 32 bytes y a 115200 baudios se llena en ~3 ms)
  */
-bool Sim7670G::sim7670g_send_command(const char *cmd, const char *expected_response, uint32_t timeout) 
+static bool sim7670g_getc_until(char *c, uint64_t deadline_us) 
 {
-    char response[256];
-    
-    printf("→ Enviando: %s\n", cmd);
-    
-    // Limpiar buffer
-    sim7670g_rx_flush();
-    
-    // Enviar comando
-    sim7670g_tx_string(cmd);
-    sim7670g_tx_string("\r\n");
-    
-    // Esperar respuesta
-    uint64_t start_time = time_us_64();
-    bool found = false;
-    int line_count = 0;
-    
-    while ((time_us_64() - start_time) < (timeout * 1000) && line_count < 10) 
+    while (time_us_64() < deadline_us) 
     {
-        if (sim7670g_read_line_skip_empty(response, sizeof(response), 100)) 
+        if (uart_is_readable(SIM7670G_UART)) 
         {
-            line_count++;
-            
-            if (strlen(response) > 0) 
-            {
-                printf("← Recibido: %s\n", response);
-            }
-            
-            // ✅ Si esperamos respuesta específica
-            if (expected_response && strstr(response, expected_response)) 
-            {
-                printf("✓ Respuesta encontrada: %s\n", expected_response);
-                return true;  // ✅ RETORNA INMEDIATAMENTE
-            }
-            
-            // ✅ Si NO especificamos respuesta esperada, buscar OK/ERROR
-            if (!expected_response) 
-            {
-                if (strstr(response, "OK")) 
-                {
-                    printf("✓ OK recibido\n");
-                    return true;  // ✅ RETORNA INMEDIATAMENTE
-                }
-                if (strstr(response, "ERROR")) 
-                {
-                    printf("✗ ERROR recibido\n");
-                    return false;  // ✅ RETORNA INMEDIATAMENTE
-                }
-            }
+            *c = uart_getc(SIM7670G_UART);
+            return true;
         }
+        tight_loop_contents();
     }
-    
-    // Timeout alcanzado sin encontrar respuesta
-    if (expected_response) {
-        printf("✗ Timeout esperando: %s\n", expected_response);
-        return found;
-    }
-    
-    printf("✗ Timeout, ni OK ni ERROR recibido\n");
     return false;
 }
 
 /**
- * Verificar estado de la tarjeta SIM
+ * Leer exactamente 'len' bytes crudos (datos tras una cabecera de trama)
  */
-bool Sim7670G::sim7670g_check_sim() 
+static int sim7670g_read_bytes(char *dst, int len, uint64_t deadline_us) 
 {
-    printf("Verificando tarjeta SIM...\n");
-    
-    if (sim7670g_send_command("AT+CPIN?", "SIM PIN", SIM7670G_CMD_TIMEOUT))
-    {
-        std::string pinCommand = "AT+CPIN=\"" + pin_ + "\"";
-        if(sim7670g_send_command(pinCommand.c_str(), "OK", SIM7670G_CMD_TIMEOUT))
-        {
-            printf("✓ SIM desbloqueada\n");
-        }
-        else
-        {
-            printf("❌ Error al desbloquear SIM con PIN\n");
-            return false;
-        }
-    }
-    else if(!sim7670g_send_command("AT+CPIN?", "READY", SIM7670G_CMD_TIMEOUT))
+    int pos = 0;
+
+    while (pos < len && sim7670g_getc_until(&dst[pos], deadline_us)) 
     {
-        printf("❌ SIM no lista\n");
-        return false;
+        pos++;
     }
-    
-    printf("✓ SIM lista\n");
-    device_info.sim_ready = true;
-    return true;
+    return pos;
 }
 
 /**
- * Verificar calidad de señal
+ * Leer una línea no vacía sondeando sin dormir (cabeceras de trama seguidas
+ * de datos crudos: no se puede perder ningún byte)
  */
-bool Sim7670G::sim7670g_check_signal() 
+static bool sim7670g_read_frame_line(char *line, int max_len, uint64_t deadline_us) 
 {
-    char response[128];
-    int rssi = 99;
-    int retries = 3;
-    
-    printf("Verificando señal...\n");
-    
-    // Reintentar hasta 3 veces
-    while (retries > 0) 
+    int pos = 0;
+    char c;
+
+    while (sim7670g_getc_until(&c, deadline_us)) 
     {
-        sim7670g_rx_flush();
-        sim7670g_tx_string("AT+CSQ\r\n");
-        
-        if (sim7670g_read_line_skip_empty(response, sizeof(response), 2000)) 
+        if (c == '\r') 
+            continue;
+        if (c == '\n') 
         {
-            // Respuesta: +CSQ: rssi,ber
-            if (strstr(response, "+CSQ:")) 
+            if (pos > 0) 
             {
-                int ber;
-                sscanf(response, "+CSQ: %d,%d", &rssi, &ber);
-                device_info.signal_quality = rssi;
-            
-                printf("Señal: RSSI=%d (0-31)\n", rssi);
-            
-                if (rssi == 99) 
-                {
-                    printf("⚠️  Señal no detectada\n");
-                    retries--;
-                    sleep_ms(1000);
-                    continue;
-                }
+                line[pos] = '\0';
                 return true;
             }
+            continue;
         }
-        else
+        if (pos < max_len - 1) 
         {
-            printf("❌ Respuesta inesperada: %s\n", response);
+            line[pos++] = c;
         }
     }
-    
-    printf("❌ Error al leer señal\n");
+
+    line[pos] = '\0';
     return false;
 }
 
 /**
- * Adjuntar a GPRS
+ * Esperar el prompt '>' de los comandos de envío de datos
  */
-bool Sim7670G::sim7670g_attach_gprs() 
+static bool sim7670g_wait_prompt(uint64_t deadline_us) 
 {
-    printf("Adjuntando a GPRS...\n");
-    
-    if (!sim7670g_send_command("AT+CGATT=1", "OK", SIM7670G_CMD_TIMEOUT)) 
+    char c;
+
+    while (sim7670g_getc_until(&c, deadline_us)) 
     {
-        printf("❌ Error al adjuntar GPRS\n");
-        return false;
+        if (c == '>') 
+            return true;
     }
-    
-    printf("✓ GPRS adjuntado\n");
-    device_info.gprs_attached = true;
-    return true;
+    return false;
 }
 
 /**
- * Activar contexto PDP (Internet)
+ * Procesar URC pendientes hasta 'deadline_ms' como máximo
  */
-bool Sim7670G::sim7670g_activate_pdp() 
+void Sim7670G::sim7670g_poll_urc(uint32_t deadline_ms) 
 {
-    printf("Activando contexto PDP...\n");
-    
-    // Definir contexto PDP 1
-    if (!sim7670g_send_command("AT+CGDCONT=1,\"IP\",\"internet\"", "OK", SIM7670G_CMD_TIMEOUT)) 
-    {
-        printf("⚠️  Error al definir contexto (continuar)\n");
-    }
-    
-    // Activar contexto
-    sleep_ms(1000);
-    if (!sim7670g_send_command("AT+CGACT=1,1", "OK", SIM7670G_CMD_TIMEOUT)) 
+    char line[256];
+    uint64_t deadline = sim7670g_deadline_us(deadline_ms);
+
+    // Seguir mientras haya datos aunque el plazo haya vencido: una URC a medias
+    // se perdería en el próximo rx_flush
+    while (uart_is_readable(SIM7670G_UART) || time_us_64() < deadline) 
     {
-        printf("❌ Error al activar PDP\n");
-        return false;
+        if (!uart_is_readable(SIM7670G_UART)) 
+        {
+            sleep_ms(1);
+            continue;
+        }
+
+        // La línea ya ha empezado a llegar: margen para su final
+        if (sim7670g_read_line_skip_empty(line, sizeof(line), time_us_64() + SIM7670G_URC_LINE_TIMEOUT * 1000ULL)) 
+        {
+            printf("← URC: %s\n", line);
+            sim7670g_dispatch_urc(line);
+        }
     }
-    
-    printf("✓ Contexto PDP activado\n");
-    device_info.pdp_active = true;
-    return true;
 }
 
-bool Sim7670G::sim7670g_gnss_power_on()
+/**
+ * Leer bytes crudos (para manejadores de URC seguidas de datos)
+ */
+int Sim7670G::sim7670g_read_raw(char *dst, int len, uint32_t deadline_ms) 
 {
-    printf("Encendiendo GNSS...\n");
-    if (!sim7670g_send_command("AT+CGNSSPWR=1", "OK", SIM7670G_CMD_TIMEOUT)) // o AT+CGNSSPWR=1 según módulo
-    {
-        printf("❌ No se pudo encender GNSS\n");
-        return false;
-    }
-    printf("✓ GNSS encendido\n");
-    return true;
+    return sim7670g_read_bytes(dst, len, sim7670g_deadline_us(deadline_ms));
 }
 
-bool Sim7670G::sim7670g_gnss_power_off()
+/**
+ * Enviar comando con datos tras el prompt '>' y esperar respuesta
+ */
+bool Sim7670G::sim7670g_send_with_prompt(const char *cmd, const char *data, int len, 
+                                         const char *expected_response, uint32_t deadline_ms) 
 {
-    printf("Apagando GNSS...\n");
-    if (!sim7670g_send_command("AT+CGNSSPWR=0", "OK", SIM7670G_CMD_TIMEOUT))
+    if (sim7670g_deadline_passed(deadline_ms)) 
+        return sim7670g_fail(SIM7670G_STAGE_COMMAND, deadline_ms);
+
+    printf("→ Enviando: %s (%d bytes)\n", cmd, len);
+
+    sim7670g_rx_flush();
+    sim7670g_tx_string(cmd);
+    sim7670g_tx_string("\r\n");
+
+    if (!sim7670g_wait_prompt(sim7670g_deadline_us(deadline_ms))) 
     {
-        printf("❌ No se pudo apagar GNSS\n");
-        return false;
+        printf("✗ Sin prompt para: %s\n", cmd);
+        return sim7670g_fail(SIM7670G_STAGE_COMMAND, deadline_ms);
     }
-    printf("✓ GNSS apagado\n");
-    return true;
+
+    uart_write_blocking(SIM7670G_UART, (const uint8_t *)data, len);
+
+    return sim7670g_send_command(NULL, expected_response, deadline_ms);
 }
 
-bool Sim7670G::sim7670g_gnss_get_location(double *lat, double *lon)
+/**
+ * Enviar comando AT y esperar respuesta
+ */
+bool Sim7670G::sim7670g_send_command(const char *cmd, const char *expected_response, uint32_t deadline_ms) 
+{
+    char response[256];
+    
+    // cmd == NULL: solo esperar la respuesta (datos ya enviados tras un prompt)
+    if (cmd) 
+    {
+        // Sin plazo no se envía: la respuesta quedaría sin leer en la UART
+        if (sim7670g_deadline_passed(deadline_ms)) 
+            return sim7670g_fail(SIM7670G_STAGE_COMMAND, deadline_ms);
+
+        printf("→ Enviando: %s\n", cmd);
+    
+        // Limpiar buffer
+        sim7670g_rx_flush();
+    
+        // Enviar comando
+        sim7670g_tx_string(cmd);
+        sim7670g_tx_string("\r\n");
+    }
+    
+    // Esperar respuesta hasta el plazo, sin límite de líneas: las URC
+    // intercaladas no deben cortar la espera de la respuesta
+    // Un resultado '+...' llega tras el OK cuando responde la red (+CCHOPEN,
+    // +CMQTTCONNECT, +CMGS...): espera larga
+    Sim7670gLongWait long_wait(expected_response && expected_response[0] == '+');
+    uint64_t start_time = time_us_64();
+    uint64_t deadline = sim7670g_deadline_us(deadline_ms);
+    
+    while (time_us_64() < deadline) 
+    {
+        if (sim7670g_read_line_skip_empty(response, sizeof(response), deadline)) 
+        {
+            if (strlen(response) > 0) 
+            {
+                printf("← Recibido: %s\n", response);
+            }
+            
+            // ✅ Si esperamos respuesta específica
+            if (expected_response && strstr(response, expected_response)) 
+            {
+                printf("✓ Respuesta encontrada: %s\n", expected_response);
+                if (cmd && strcmp(expected_response, "OK") == 0) 
+                    sim7670g_record_rtt(start_time);
+                return true;  // ✅ RETORNA INMEDIATAMENTE
+            }
+            
+            // ✅ ERROR / +CME ERROR / +CMS ERROR es final aunque se espere
+            // otra respuesta: no consumir el plazo compartido esperando
+            if (strstr(response, "ERROR")) 
+            {
+                printf("✗ ERROR recibido\n");
+                return false;  // ✅ RETORNA INMEDIATAMENTE
+            }
+            
+            // ✅ Si NO especificamos respuesta esperada, buscar OK
+            if (!expected_response && strstr(response, "OK")) 
+            {
+                printf("✓ OK recibido\n");
+                if (cmd) 
+                    sim7670g_record_rtt(start_time);
+                return true;  // ✅ RETORNA INMEDIATAMENTE
+            }
+
+            sim7670g_dispatch_urc(response);
+        }
+    }
+    
+    // Timeout alcanzado sin encontrar respuesta
+    if (expected_response) {
+        printf("✗ Timeout esperando: %s\n", expected_response);
+        return sim7670g_fail(SIM7670G_STAGE_COMMAND, deadline_ms);
+    }
+    
+    printf("✗ Timeout, ni OK ni ERROR recibido\n");
+    return sim7670g_fail(SIM7670G_STAGE_COMMAND, deadline_ms);
+}
+
+/**
+ * Enviar consulta AT y copiar la línea que empieza por 'prefix'
+ */
+bool Sim7670G::sim7670g_send_query(const char *cmd, const char *prefix, char *out, int out_len, uint32_t deadline_ms) 
+{
+    char response[256];
+    bool found = false;
+
+    if (sim7670g_deadline_passed(deadline_ms)) 
+        return sim7670g_fail(SIM7670G_STAGE_COMMAND, deadline_ms);
+
+    printf("→ Consultando: %s\n", cmd);
+
+    sim7670g_rx_flush();
+    sim7670g_tx_string(cmd);
+    sim7670g_tx_string("\r\n");
+
+    uint64_t deadline = sim7670g_deadline_us(deadline_ms);
+
+    while (time_us_64() < deadline) 
+    {
+        if (!sim7670g_read_line_skip_empty(response, sizeof(response), deadline)) 
+            continue;
+
+        printf("← Recibido: %s\n", response);
+
+        if (!found && strncmp(response, prefix, strlen(prefix)) == 0) 
+        {
+            strncpy(out, response, out_len - 1);
+            out[out_len - 1] = '\0';
+            found = true;
+        }
+        else if (strcmp(response, "OK") == 0) 
+        {
+            return found;
+        }
+        else if (strstr(response, "ERROR")) 
+        {
+            return false;
+        }
+        else 
+        {
+            sim7670g_dispatch_urc(response);
+        }
+    }
+
+    printf("✗ Timeout consultando: %s\n", cmd);
+    return sim7670g_fail(SIM7670G_STAGE_COMMAND, deadline_ms);
+}
+
+/**
+ * Media móvil de la ida y vuelta de un comando suelto que respondió OK
+ * (referencia para estimar lo que ahorran los lotes)
+ */
+void Sim7670G::sim7670g_record_rtt(uint64_t start_us) 
+{
+    uint32_t rtt = (uint32_t)((time_us_64() - start_us) / 1000);
+    batch_stats.cmd_rtt_ms = batch_stats.cmd_rtt_ms ? (batch_stats.cmd_rtt_ms * 7 + rtt) / 8 : rtt;
+}
+
+/**
+ * Enviar una línea de comandos concatenados y repartir las respuestas.
+ * Un único OK final confirma todos; un ERROR corta la línea y no dice cuál falló
+ */
+bool Sim7670G::sim7670g_send_batch_line(const char *line, sim7670g_batch_cmd_t *cmds, int count, 
+                                        uint32_t deadline_ms) 
+{
+    char response[256];
+
+    if (sim7670g_deadline_passed(deadline_ms)) 
+        return sim7670g_fail(SIM7670G_STAGE_COMMAND, deadline_ms);
+
+    printf("→ Lote (%d): %s\n", count, line);
+
+    sim7670g_rx_flush();
+    sim7670g_tx_string(line);
+    sim7670g_tx_string("\r\n");
+
+    uint64_t deadline = sim7670g_deadline_us(deadline_ms);
+
+    while (time_us_64() < deadline) 
+    {
+        if (!sim7670g_read_line_skip_empty(response, sizeof(response), deadline)) 
+            continue;
+
+        printf("← Recibido: %s\n", response);
+
+        if (strcmp(response, "OK") == 0) 
+        {
+            for (int i = 0; i < count; i++) 
+                cmds[i].result = SIM7670G_BATCH_OK;
+            return true;
+        }
+        if (strstr(response, "ERROR")) 
+        {
+            if (count == 1) 
+                cmds[0].result = SIM7670G_BATCH_ERROR;
+            return false;
+        }
+
+        // Respuestas de información en orden: la primera sin rellenar con ese prefijo
+        bool matched = false;
+        for (int i = 0; i < count && !matched; i++) 
+        {
+            if (cmds[i].prefix && !cmds[i].response[0] && 
+                strncmp(response, cmds[i].prefix, strlen(cmds[i].prefix)) == 0) 
+            {
+                strncpy(cmds[i].response, response, sizeof(cmds[i].response) - 1);
+                cmds[i].response[sizeof(cmds[i].response) - 1] = '\0';
+                matched = true;
+            }
+        }
+        if (!matched) 
+            sim7670g_dispatch_urc(response);
+    }
+
+    printf("✗ Timeout en lote: %s\n", line);
+    return sim7670g_fail(SIM7670G_STAGE_COMMAND, deadline_ms);
+}
+
+/**
+ * Enviar un subcomando de lote en su propia línea
+ */
+bool Sim7670G::sim7670g_send_single(sim7670g_batch_cmd_t &cmd, uint32_t deadline_ms) 
+{
+    bool done = cmd.prefix 
+        ? sim7670g_send_query(cmd.cmd, cmd.prefix, cmd.response, sizeof(cmd.response), deadline_ms)
+        : sim7670g_send_command(cmd.cmd, NULL, deadline_ms);
+    cmd.result = done ? SIM7670G_BATCH_OK : SIM7670G_BATCH_ERROR;
+    return done;
+}
+
+/**
+ * Enviar comandos concatenados (AT+A;+B;+C), tantas líneas como haga falta
+ */
+int Sim7670G::sim7670g_send_batch(sim7670g_batch_cmd_t *cmds, int count, uint32_t deadline_ms) 
+{
+    char line[SIM7670G_BATCH_MAX_LINE];
+    int ok_count = 0;
+    int first = 0;
+
+    for (int i = 0; i < count; i++) 
+    {
+        cmds[i].result = SIM7670G_BATCH_PENDING;
+        cmds[i].response[0] = '\0';
+    }
+
+    while (first < count) 
+    {
+        // Un comando que no cabe solo (URL larga) va en su propia línea, tal cual
+        int len = 0;
+        if (!sim7670g_batch_append(line, &len, sizeof(line), cmds[first].cmd)) 
+        {
+            ok_count += sim7670g_send_single(cmds[first], deadline_ms) ? 1 : 0;
+            first++;
+            continue;
+        }
+
+        // Llenar la línea: "AT" + "+A" + ";+B" ... dejando sitio para CRLF
+        int last = first + 1;
+        while (last < count && sim7670g_batch_append(line, &len, sizeof(line), cmds[last].cmd)) 
+            last++;
+
+        int n = last - first;
+        uint64_t start = time_us_64();
+        bool ok = sim7670g_send_batch_line(line, &cmds[first], n, deadline_ms);
+        uint32_t elapsed = (uint32_t)((time_us_64() - start) / 1000);
+
+        batch_stats.commands += n;
+        batch_stats.lines++;
+
+        if (!ok && n > 1) 
+        {
+            // No se sabe cuál falló ni cuáles se ejecutaron: uno a uno
+            printf("⚠️  Lote rechazado, repitiendo %d comandos por separado\n", n);
+            batch_stats.fallbacks++;
+            batch_stats.lines += n;
+
+            for (int i = first; i < last; i++) 
+            {
+                sim7670g_send_single(cmds[i], deadline_ms);
+            }
+        }
+        else if (ok && n > 1) 
+        {
+            uint32_t singles = n * batch_stats.cmd_rtt_ms;
+            uint32_t saved = singles > elapsed ? singles - elapsed : 0;
+            batch_stats.saved_ms += saved;
+            printf("✓ Lote: %d comandos en 1 línea, %u ms (%d idas y vueltas, ~%u ms ahorrados estimados)\n", 
+                   n, elapsed, n - 1, saved);
+        }
+
+        for (int i = first; i < last; i++) 
+        {
+            if (cmds[i].result == SIM7670G_BATCH_OK) 
+                ok_count++;
+        }
+        first = last;
+    }
+
+    return ok_count;
+}
+
+/**
+ * Verificar estado de la tarjeta SIM
+ */
+bool Sim7670G::sim7670g_check_sim(uint32_t deadline_ms) 
+{
+    printf("Verificando tarjeta SIM...\n");
+    
+    // Una sola consulta: termina con su OK, sin esperar a una respuesta concreta
+    char status[64];
+    if (!sim7670g_send_query("AT+CPIN?", "+CPIN:", status, sizeof(status), deadline_ms))
+    {
+        printf("❌ SIM no responde\n");
+        return false;
+    }
+
+    if (strstr(status, "SIM PIN"))
+    {
+        std::string pinCommand = "AT+CPIN=\"" + pin_ + "\"";
+        if(sim7670g_send_command(pinCommand.c_str(), "OK", deadline_ms))
+        {
+            printf("✓ SIM desbloqueada\n");
+        }
+        else
+        {
+            printf("❌ Error al desbloquear SIM con PIN\n");
+            return false;
+        }
+    }
+    else if (!strstr(status, "READY"))
+    {
+        printf("❌ SIM no lista: %s\n", status);
+        return false;
+    }
+    
+    printf("✓ SIM lista\n");
+    device_info.sim_ready = true;
+    return true;
+}
+
+/**
+ * Verificar calidad de señal
+ */
+bool Sim7670G::sim7670g_check_signal(uint32_t deadline_ms) 
+{
+    char response[128];
+    int rssi = 99;
+    int retries = 3;
+    
+    printf("Verificando señal...\n");
+    
+    // Reintentar hasta 3 veces dentro del plazo
+    while (retries > 0 && !sim7670g_deadline_passed(deadline_ms)) 
+    {
+        sim7670g_rx_flush();
+        sim7670g_tx_string("AT+CSQ\r\n");
+        
+        if (sim7670g_read_line_skip_empty(response, sizeof(response), sim7670g_deadline_us(deadline_ms))) 
+        {
+            // Respuesta: +CSQ: rssi,ber
+            if (strstr(response, "+CSQ:")) 
+            {
+                int ber;
+                sscanf(response, "+CSQ: %d,%d", &rssi, &ber);
+                device_info.signal_quality = rssi;
+            
+                printf("Señal: RSSI=%d (0-31)\n", rssi);
+            
+                if (rssi == 99) 
+                {
+                    printf("⚠️  Señal no detectada\n");
+                    retries--;
+                    sleep_ms(1000);
+                    continue;
+                }
+                return true;
+            }
+            sim7670g_dispatch_urc(response);
+        }
+        else
+        {
+            printf("❌ Respuesta inesperada: %s\n", response);
+        }
+    }
+    
+    printf("❌ Error al leer señal\n");
+    return false;
+}
+
+/**
+ * Adjuntar a GPRS
+ */
+bool Sim7670G::sim7670g_attach_gprs(uint32_t deadline_ms) 
+{
+    printf("Adjuntando a GPRS...\n");
+    
+    if (!sim7670g_send_command("AT+CGATT=1", "OK", deadline_ms)) 
+    {
+        printf("❌ Error al adjuntar GPRS\n");
+        return false;
+    }
+    
+    printf("✓ GPRS adjuntado\n");
+    device_info.link.gprs_attached = true;
+    return true;
+}
+
+/**
+ * Activar contexto PDP (Internet)
+ */
+bool Sim7670G::sim7670g_activate_pdp(uint32_t deadline_ms) 
+{
+    printf("Activando contexto PDP...\n");
+    
+    // Definir y activar el contexto PDP 1 en una línea
+    sim7670g_batch_cmd_t cmds[] = 
+    {
+        {"AT+CGDCONT=1,\"IP\",\"internet\"", NULL},
+        {"AT+CGACT=1,1", NULL}
+    };
+    sim7670g_send_batch(cmds, 2, deadline_ms);
+
+    if (cmds[0].result != SIM7670G_BATCH_OK) 
+    {
+        printf("⚠️  Error al definir contexto (continuar)\n");
+    }
+    
+    if (cmds[1].result != SIM7670G_BATCH_OK) 
+    {
+        printf("❌ Error al activar PDP\n");
+        return false;
+    }
+    
+    printf("✓ Contexto PDP activado\n");
+    device_info.link.pdp_active = true;
+    return true;
+}
+
+/**
+ * Esperar el registro en la red (LTE o 2G/3G)
+ */
+bool Sim7670G::sim7670g_wait_registration(uint32_t deadline_ms) 
+{
+    char line[64];
+
+    printf("Esperando registro en la red...\n");
+
+    while (true) 
+    {
+        // La respuesta pasa también por handle_network_urc y actualiza el estado
+        if (sim7670g_send_query("AT+CEREG?", "+CEREG:", line, sizeof(line), deadline_ms)) 
+            sim7670g_handle_network_urc(line);
+        if (!device_info.link.network_registered && 
+            sim7670g_send_query("AT+CREG?", "+CREG:", line, sizeof(line), deadline_ms)) 
+            sim7670g_handle_network_urc(line);
+
+        if (device_info.link.network_registered) 
+        {
+            printf("✓ Registrado en la red\n");
+            return true;
+        }
+
+        // Consultar cada segundo, sin dormir más allá del plazo
+        int32_t left = (int32_t)(deadline_ms - to_ms_since_boot(get_absolute_time()));
+        if (left <= 0) 
+            break;
+        sleep_ms(left < 1000 ? left : 1000);
+    }
+
+    printf("❌ Sin registro en la red\n");
+    return false;
+}
+
+/**
+ * Conectar el enlace de datos ejecutando solo los pasos que faltan
+ * Un solo plazo para todos: lo que no gaste el registro queda para los demás
+ */
+bool Sim7670G::sim7670g_connect(uint32_t deadline_ms) 
+{
+    Sim7670gLongWait long_wait;
+
+    if (!device_info.link.network_registered && !sim7670g_wait_registration(deadline_ms)) 
+        return false;
+
+    if (!device_info.link.gprs_attached && !sim7670g_attach_gprs(deadline_ms)) 
+        return false;
+
+    if (!device_info.link.pdp_active && !sim7670g_activate_pdp(deadline_ms)) 
+        return false;
+
+    if (!device_info.link.http_ready && !sim7670g_http_reinit(deadline_ms)) 
+        return false;
+
+    return true;
+}
+
+bool Sim7670G::sim7670g_gnss_power_on(uint32_t deadline_ms)
+{
+    printf("Encendiendo GNSS...\n");
+    if (!sim7670g_send_command("AT+CGNSSPWR=1", "OK", deadline_ms)) // o AT+CGNSSPWR=1 según módulo
+    {
+        printf("❌ No se pudo encender GNSS\n");
+        return false;
+    }
+    printf("✓ GNSS encendido\n");
+    return true;
+}
+
+bool Sim7670G::sim7670g_gnss_power_off(uint32_t deadline_ms)
+{
+    printf("Apagando GNSS...\n");
+    if (!sim7670g_send_command("AT+CGNSSPWR=0", "OK", deadline_ms))
+    {
+        printf("❌ No se pudo apagar GNSS\n");
+        return false;
+    }
+    printf("✓ GNSS apagado\n");
+    return true;
+}
+
+bool Sim7670G::sim7670g_gnss_get_location(double *lat, double *lon, uint32_t deadline_ms)
 {
     if (!lat || !lon) return false;
     
@@ -343,51 +999,27 @@ bool Sim7670G::sim7670g_gnss_get_location(double *lat, double *lon)
     sim7670g_rx_flush();
     sim7670g_tx_string("AT+CGPSINFO\r\n");
     
-    uint64_t start = time_us_64();
+    uint64_t deadline = sim7670g_deadline_us(deadline_ms);
     
-    while ((time_us_64() - start) < 3000000ULL) 
+    while (time_us_64() < deadline) 
     {
-        if (sim7670g_read_line_skip_empty(response, sizeof(response), 500)) 
+        if (sim7670g_read_line_skip_empty(response, sizeof(response), deadline)) 
         {
             printf("GPS response: %s\n", response);
             
             if (strstr(response, "+CGPSINFO:")) 
             {
-                double lat_raw = 0.0;
-                double lon_raw = 0.0;
-                char lat_dir = 'N';
-                char lon_dir = 'W';
-                
-                // ✅ Parser simplificado (tu módulo solo devuelve 4 campos)
-                int parsed = sscanf(response,
-                    "+CGPSINFO: %lf,%c,%lf,%c",
-                    &lat_raw, &lat_dir, &lon_raw, &lon_dir);
-                
-                if (parsed >= 3 && lat_raw > 0 && lon_raw > 0) 
+                if (sim7670g_parse_cgpsinfo(response, lat, lon)) 
                 {
-                    // Convertir NMEA a decimales
-                    double lat_degrees = (int)(lat_raw / 100);
-                    double lat_minutes = lat_raw - (lat_degrees * 100);
-                    double flat = lat_degrees + (lat_minutes / 60.0);
-                    
-                    double lon_degrees = (int)(lon_raw / 100);
-                    double lon_minutes = lon_raw - (lon_degrees * 100);
-                    double flon = -(lon_degrees + (lon_minutes / 60.0));
-                    
-                    if (lat_dir == 'S') flat = -flat;
-                    if (lon_dir == 'W') flon = -flon;
-                    
-                    if (flat >= -90 && flat <= 90 && flon >= -180 && flon <= 180) 
-                    {
-                        *lat = flat;
-                        *lon = flon;
-                        
-                        printf("✓ GPS Posición: lat=%.6f, lon=%.6f\n", flat, flon);
-                        return true;
-                    }
+                    uint32_t unix_s;
+                    if (sim7670g_parse_cgpsinfo_utc(response, &unix_s))
+                        sim7670g_set_utc(unix_s);
+                    printf("✓ GPS Posición: lat=%.6f, lon=%.6f\n", *lat, *lon);
+                    return true;
                 }
                 break;
             }
+            sim7670g_dispatch_urc(response);
         }
     }
     
@@ -395,7 +1027,41 @@ bool Sim7670G::sim7670g_gnss_get_location(double *lat, double *lon)
     return false;
 }
 
-void Sim7670G::sim7670g_gnss_check_power()
+/**
+ * Hora UTC desde el reloj del módem (AT+CCLK?), puesto en hora por la red con AT+CTZU=1
+ */
+bool Sim7670G::sim7670g_sync_clock(uint32_t deadline_ms)
+{
+    char response[64];
+    uint32_t unix_s;
+
+    if (!sim7670g_send_query("AT+CCLK?", "+CCLK:", response, sizeof(response), deadline_ms) ||
+        !sim7670g_parse_cclk(response, &unix_s))
+    {
+        printf("⚠️  Reloj del módem sin hora de red\n");
+        return false;
+    }
+    sim7670g_set_utc(unix_s);
+    printf("✓ Hora UTC: %lu\n", (unsigned long)unix_s);
+    return true;
+}
+
+bool Sim7670G::sim7670g_get_utc(uint32_t *unix_s) const
+{
+    if (!utc_valid || !unix_s)
+        return false;
+    *unix_s = utc_base_s + (to_ms_since_boot(get_absolute_time()) - utc_base_ms) / 1000;
+    return true;
+}
+
+void Sim7670G::sim7670g_set_utc(uint32_t unix_s)
+{
+    utc_base_s = unix_s;
+    utc_base_ms = to_ms_since_boot(get_absolute_time());
+    utc_valid = true;
+}
+
+void Sim7670G::sim7670g_gnss_check_power(uint32_t deadline_ms)
 {
     char response[128];
     
@@ -404,7 +1070,7 @@ void Sim7670G::sim7670g_gnss_check_power()
     sim7670g_rx_flush();
     sim7670g_tx_string("AT+CGNSSPWR?\r\n");
     
-    if (sim7670g_read_line_skip_empty(response, sizeof(response), 2000))
+    if (sim7670g_read_line_skip_empty(response, sizeof(response), sim7670g_deadline_us(deadline_ms)))
     {
         printf("Respuesta: %s\n", response);
         
@@ -423,284 +1089,835 @@ void Sim7670G::sim7670g_gnss_check_power()
 }
 
 /**
- * Obtener información del dispositivo
+ * Celda servidora: +CPSI: LTE,Online,<mcc>-<mnc>,0x<tac>,<cell id>,...
+ * Responde al momento, con o sin posición GNSS
+ */
+bool Sim7670G::sim7670g_get_cell(sim7670g_cell_t *cell, uint32_t deadline_ms)
+{
+    char response[160];
+
+    if (!cell) 
+        return false;
+
+    if (!sim7670g_send_query("AT+CPSI?", "+CPSI:", response, sizeof(response), deadline_ms)) 
+        return false;
+
+    if (!sim7670g_parse_cpsi(response, cell)) 
+    {
+        printf("❌ Sin celda servidora: %s\n", response);
+        return false;
+    }
+    printf("✓ Celda %s %u-%u área 0x%X id %u (%d dBm)\n", cell->lte ? "LTE" : "GSM", 
+           cell->mcc, cell->mnc, (unsigned)cell->area, (unsigned)cell->cell_id, cell->signal_dbm);
+    return true;
+}
+
+/**
+ * SMS en modo texto, juego de caracteres ASCII (IRA) y aviso +CMTI por cada
+ * mensaje nuevo guardado en la SIM (sin esperar a ningún sondeo)
+ */
+bool Sim7670G::sim7670g_sms_init(uint32_t deadline_ms)
+{
+    sim7670g_batch_cmd_t cmds[] = 
+    {
+        {"AT+CMGF=1", NULL},
+        {"AT+CSCS=\"IRA\"", NULL},
+        {"AT+CPMS=\"SM\",\"SM\",\"SM\"", NULL},
+        {"AT+CNMI=2,1,0,0,0", NULL}
+    };
+    if (sim7670g_send_batch(cmds, 4, deadline_ms) != 4)
+    {
+        printf("❌ No se pudo configurar SMS\n");
+        return false;
+    }
+    printf("✓ SMS en modo texto, avisos +CMTI activos\n");
+    return true;
+}
+
+/**
+ * Leer un SMS: +CMGR: "<stat>","<número>",... y el texto hasta el OK
+ */
+bool Sim7670G::sim7670g_sms_read(int index, char *number, int number_len, char *text, int text_len, 
+                                 uint32_t deadline_ms)
+{
+    char response[256];
+    char cmd[32];
+    bool header = false;
+    int pos = 0;
+
+    if (!number || !text || text_len <= 0) 
+        return false;
+
+    text[0] = '\0';
+    snprintf(cmd, sizeof(cmd), "AT+CMGR=%d", index);
+    printf("→ Enviando: %s\n", cmd);
+    sim7670g_rx_flush();
+    sim7670g_tx_string(cmd);
+    sim7670g_tx_string("\r\n");
+
+    uint64_t deadline = sim7670g_deadline_us(deadline_ms);
+    while (time_us_64() < deadline) 
+    {
+        if (!sim7670g_read_line_skip_empty(response, sizeof(response), deadline)) 
+            continue;
+
+        if (!header && sim7670g_parse_cmgr(response, number, number_len)) 
+        {
+            header = true;
+        }
+        else if (strcmp(response, "OK") == 0) 
+        {
+            return header;
+        }
+        else if (strstr(response, "ERROR")) 
+        {
+            printf("❌ No se pudo leer el SMS %d\n", index);
+            return false;
+        }
+        else if (header) 
+        {
+            // Texto, varias líneas unidas con \n
+            pos += snprintf(text + pos, text_len - pos, "%s%s", pos > 0 ? "\n" : "", response);
+            if (pos >= text_len) 
+                pos = text_len - 1;
+        }
+        else 
+        {
+            sim7670g_dispatch_urc(response);
+        }
+    }
+
+    printf("❌ Timeout leyendo el SMS %d\n", index);
+    return sim7670g_fail(SIM7670G_STAGE_COMMAND, deadline_ms);
+}
+
+/**
+ * Enviar un SMS: AT+CMGS="<número>", texto tras el prompt y Ctrl-Z
+ */
+bool Sim7670G::sim7670g_sms_send(const char *number, const char *text, uint32_t deadline_ms)
+{
+    char cmd[48];
+    char data[200];
+
+    if (!number || !text) 
+        return false;
+
+    int len = snprintf(data, sizeof(data) - 1, "%s", text);
+    if (len > (int)sizeof(data) - 2) 
+        len = sizeof(data) - 2;
+    data[len++] = 0x1A;
+
+    snprintf(cmd, sizeof(cmd), "AT+CMGS=\"%s\"", number);
+    if (!sim7670g_send_with_prompt(cmd, data, len, "+CMGS:", deadline_ms)) 
+    {
+        printf("❌ No se pudo enviar el SMS a %s\n", number);
+        return false;
+    }
+    return true;
+}
+
+bool Sim7670G::sim7670g_sms_delete(int index, uint32_t deadline_ms)
+{
+    char cmd[32];
+    snprintf(cmd, sizeof(cmd), "AT+CMGD=%d", index);
+    return sim7670g_send_command(cmd, "OK", deadline_ms);
+}
+
+/**
+ * Índices de los SMS guardados (llegados mientras el Pico no escuchaba)
+ */
+int Sim7670G::sim7670g_sms_list(int *indexes, int max, uint32_t deadline_ms)
+{
+    char response[256];
+    int count = 0;
+
+    printf("→ Enviando: AT+CMGL=\"ALL\"\n");
+    sim7670g_rx_flush();
+    sim7670g_tx_string("AT+CMGL=\"ALL\"\r\n");
+
+    uint64_t deadline = sim7670g_deadline_us(deadline_ms);
+    while (time_us_64() < deadline) 
+    {
+        if (!sim7670g_read_line_skip_empty(response, sizeof(response), deadline)) 
+            continue;
+
+        int index = sim7670g_parse_cmgl(response);
+        if (index >= 0) 
+        {
+            if (count < max) 
+                indexes[count++] = index;
+        }
+        else if (strcmp(response, "OK") == 0) 
+        {
+            return count;
+        }
+        else if (strstr(response, "ERROR")) 
+        {
+            return -1;
+        }
+        else 
+        {
+            sim7670g_dispatch_urc(response);
+        }
+    }
+    sim7670g_fail(SIM7670G_STAGE_COMMAND, deadline_ms);
+    return -1;
+}
+
+/**
+ * Obtener información del dispositivo
+ */
+bool Sim7670G::sim7670g_get_info(sim7670g_info_t *info, uint32_t deadline_ms) 
+{
+    char response[128];
+    
+    // Obtener IMEI
+    sim7670g_rx_flush();
+    sim7670g_tx_string("AT+GSN\r\n");
+    if (sim7670g_read_line_skip_empty(response, sizeof(response), sim7670g_deadline_us(deadline_ms))) 
+    {
+        strncpy(device_info.imei, response, 15);
+        printf("IMEI: %s\n", device_info.imei);
+    }
+    
+    *info = device_info;
+    return true;
+}
+
+bool Sim7670G::sim7670g_https_get(const char* url, char* response_buffer, int buffer_len, uint32_t deadline_ms)
+{
+    char cmd[512];
+    
+    if (!url || !response_buffer || buffer_len <= 0) 
+        return false;
+    
+    response_buffer[0] = '\0';
+    timeout_stage = SIM7670G_STAGE_NONE;
+    printf("HTTPS GET: %s\n", url);
+    
+    // URL y cabecera sin compresión en una línea
+    snprintf(cmd, sizeof(cmd), "AT+HTTPPARA=\"URL\",\"%s\"", url);
+    http_target_id++;
+    sim7670g_batch_cmd_t params[] = 
+    {
+        {cmd, NULL},
+        {"AT+HTTPPARA=\"USERDATA\",\"Accept-Encoding: identity\"", NULL}
+    };
+    sim7670g_send_batch(params, 2, deadline_ms);
+    if (params[0].result != SIM7670G_BATCH_OK)
+    {
+        printf("❌ Error al configurar URL\n");
+        return false;
+    }
+    
+    // Ejecutar GET
+    int status = 0;
+    int length = 0;
+    if (!sim7670g_http_action(0, &status, &length, deadline_ms) || status != 200 || length <= 0) 
+    {
+        printf("❌ HTTP request failed\n");
+        return false;
+    }
+
+    int want = length;
+    if (want > buffer_len - 1) 
+    {
+        printf("⚠️  Cuerpo de %d bytes, el buffer admite %d\n", length, buffer_len - 1);
+        want = buffer_len - 1;
+    }
+
+    // La trama +HTTPREAD dice cuántos bytes vienen: se copian exactamente esos
+    // y la lectura acaba con +HTTPREAD: 0, sin esperas fijas ni silencios
+    uint64_t read_start = time_us_64();
+    int n = sim7670g_http_read_chunk(0, want, response_buffer, deadline_ms);
+    if (n < 0) 
+    {
+        return false;
+    }
+    response_buffer[n] = '\0';
+
+    printf("✓ Total leído: %d de %d bytes en %llu ms\n", 
+           n, length, (unsigned long long)((time_us_64() - read_start) / 1000));
+    return n == length;
+}
+
+/**
+ * Ejecutar AT+HTTPACTION y esperar +HTTPACTION: <method>,<status>,<length>
+ */
+bool Sim7670G::sim7670g_http_action(int method, int *status, int *length, uint32_t deadline_ms)
+{
+    char response[256];
+    char cmd[32];
+
+    // El módem descarga el cuerpo entero antes de +HTTPACTION
+    Sim7670gLongWait long_wait;
+
+    snprintf(cmd, sizeof(cmd), "AT+HTTPACTION=%d\r\n", method);
+    sim7670g_rx_flush();
+    sim7670g_tx_string(cmd);
+
+    uint64_t deadline = sim7670g_deadline_us(deadline_ms);
+    while (time_us_64() < deadline) 
+    {
+        if (!sim7670g_read_line_skip_empty(response, sizeof(response), deadline))
+            continue;
+
+        int action = 0;
+        if (sscanf(response, "+HTTPACTION: %d,%d,%d", &action, status, length) == 3) 
+        {
+            last_content_length = *length;
+            printf("HTTP Status: %d, Content-Length: %d bytes\n", *status, *length);
+            return true;
+        }
+        sim7670g_dispatch_urc(response);
+    }
+
+    printf("❌ Timeout esperando +HTTPACTION\n");
+    return sim7670g_fail(SIM7670G_STAGE_HTTP_ACTION, deadline_ms);
+}
+
+/**
+ * Leer un trozo del cuerpo con AT+HTTPREAD=<offset>,<len>
+ * Trama: OK, +HTTPREAD: <n>, n bytes crudos, ..., +HTTPREAD: 0
+ * Devuelve los bytes copiados en dst o -1 si hay error
+ */
+int Sim7670G::sim7670g_http_read_chunk(int offset, int len, char *dst, uint32_t deadline_ms)
+{
+    char response[64];
+    char cmd[48];
+
+    snprintf(cmd, sizeof(cmd), "AT+HTTPREAD=%d,%d\r\n", offset, len);
+    sim7670g_rx_flush();
+    sim7670g_tx_string(cmd);
+
+    uint64_t deadline = sim7670g_deadline_us(deadline_ms);
+    int total = 0;
+
+    while (sim7670g_read_frame_line(response, sizeof(response), deadline)) 
+    {
+        int n = sim7670g_parse_httpread(response);
+        if (n < 0) 
+        {
+            if (strstr(response, "ERROR")) 
+            {
+                printf("❌ HTTPREAD error en offset %d\n", offset);
+                return -1;
+            }
+            sim7670g_dispatch_urc(response);
+            continue;
+        }
+
+        // +HTTPREAD: 0 cierra la lectura
+        if (n == 0) 
+            return total;
+
+        if (total + n > len) 
+        {
+            printf("❌ HTTPREAD devolvió más datos de los pedidos\n");
+            return -1;
+        }
+
+        int got = 0;
+        while (got < n && sim7670g_getc_until(&dst[total + got], deadline)) 
+        {
+            got++;
+        }
+        total += got;
+
+        if (got < n) 
+            break;
+    }
+
+    printf("❌ Timeout en HTTPREAD (%d de %d bytes)\n", total, len);
+    sim7670g_fail(SIM7670G_STAGE_BODY_READ, deadline_ms);
+    return -1;
+}
+
+/**
+ * GET entregando el cuerpo a 'consumer' en trozos de SIM7670G_HTTP_CHUNK
+ * bytes: la memoria usada no depende del tamaño de la respuesta
+ */
+bool Sim7670G::sim7670g_https_get_stream(const char* url, const ChunkConsumer& consumer, uint32_t deadline_ms)
+{
+    char cmd[512];
+    char chunk[SIM7670G_HTTP_CHUNK];
+
+    if (!url || !consumer) 
+        return false;
+
+    timeout_stage = SIM7670G_STAGE_NONE;
+
+    printf("HTTPS GET (stream): %s\n", url);
+
+    // URL y cabecera sin compresión en una línea
+    snprintf(cmd, sizeof(cmd), "AT+HTTPPARA=\"URL\",\"%s\"", url);
+    http_target_id++;
+    sim7670g_batch_cmd_t params[] = 
+    {
+        {cmd, NULL},
+        {"AT+HTTPPARA=\"USERDATA\",\"Accept-Encoding: identity\"", NULL}
+    };
+    sim7670g_send_batch(params, 2, deadline_ms);
+    if (params[0].result != SIM7670G_BATCH_OK)
+    {
+        printf("❌ Error al configurar URL\n");
+        return false;
+    }
+
+    int status = 0;
+    int length = 0;
+    if (!sim7670g_http_action(0, &status, &length, deadline_ms) || status != 200) 
+    {
+        printf("❌ HTTP request failed\n");
+        return false;
+    }
+
+    int offset = 0;
+    while (offset < length) 
+    {
+        int want = length - offset;
+        if (want > SIM7670G_HTTP_CHUNK) 
+            want = SIM7670G_HTTP_CHUNK;
+
+        int n = sim7670g_http_read_chunk(offset, want, chunk, deadline_ms);
+        if (n <= 0) 
+            return false;
+
+        if (!consumer(chunk, n)) 
+        {
+            printf("⚠️  Lectura interrumpida por el consumidor en %d/%d bytes\n", offset + n, length);
+            return false;
+        }
+
+        offset += n;
+    }
+
+    printf("✓ Total leído: %d bytes en trozos de %d\n", offset, SIM7670G_HTTP_CHUNK);
+    return true;
+}
+
+bool Sim7670G::sim7670g_https_post(const char* url, const char* json_data, char* response_buffer, int buffer_len, 
+                                   uint32_t deadline_ms)
+{
+    if (!json_data) return false;
+
+    printf("Data: %s\n", json_data);
+
+    return sim7670g_https_post_data(url, "application/json", (const uint8_t*)json_data, strlen(json_data), 
+                                    response_buffer, buffer_len, deadline_ms);
+}
+
+/**
+ * POST con cuerpo arbitrario (binario o texto) y Content-Type dado
+ */
+bool Sim7670G::sim7670g_https_post_data(const char* url, const char* content_type, const uint8_t* data, int len, 
+                                        char* response_buffer, int buffer_len, uint32_t deadline_ms)
+{
+    if (!data) return false;
+
+    return sim7670g_https_post_stream(url, content_type, len, 
+        [data, len](const ChunkConsumer& out) { return out((const char*)data, len); },
+        response_buffer, buffer_len, deadline_ms);
+}
+
+/**
+ * POST HTTPS con el cuerpo escrito directamente en AT+HTTPDATA
+ * 'len' debe ser el tamaño exacto que producirá 'writer'
+ */
+bool Sim7670G::sim7670g_https_post_stream(const char* url, const char* content_type, int len, 
+                                          const BodyWriter& writer, char* response_buffer, int buffer_len, 
+                                          uint32_t deadline_ms)
+{
+    if (!url || !content_type) return false;
+    
+    printf("HTTPS POST: %s (%d bytes, %s)\n", url, len, content_type);
+    
+    return sim7670g_http_set_target(url, content_type, deadline_ms) &&
+           sim7670g_http_post_body(len, writer, response_buffer, buffer_len, deadline_ms);
+}
+
+/**
+ * Fijar URL y Content-Type de la sesión HTTP
+ * Se mantienen entre peticiones: varios POST al mismo destino solo repiten HTTPDATA
  */
-bool Sim7670G::sim7670g_get_info(sim7670g_info_t *info) 
+bool Sim7670G::sim7670g_http_set_target(const char* url, const char* content_type, uint32_t deadline_ms)
 {
-    char response[128];
+    char url_cmd[768];
+    char content_cmd[128];
     
-    // Obtener IMEI
-    sim7670g_rx_flush();
-    sim7670g_tx_string("AT+GSN\r\n");
-    if (sim7670g_read_line_skip_empty(response, sizeof(response), SIM7670G_CMD_TIMEOUT)) 
-    {
-        strncpy(device_info.imei, response, 15);
-        printf("IMEI: %s\n", device_info.imei);
-    }
+    if (!url || !content_type) return false;
+
+    timeout_stage = SIM7670G_STAGE_NONE;
     
-    *info = device_info;
-    return true;
+    // URL y Content-Type en una línea (dos si la URL es muy larga)
+    snprintf(url_cmd, sizeof(url_cmd), "AT+HTTPPARA=\"URL\",\"%s\"", url);
+    snprintf(content_cmd, sizeof(content_cmd), "AT+HTTPPARA=\"CONTENT\",\"%s\"", content_type);
+    http_target_id++;
+    sim7670g_batch_cmd_t params[] = 
+    {
+        {url_cmd, NULL},
+        {content_cmd, NULL}
+    };
+    return sim7670g_send_batch(params, 2, deadline_ms) == 2;
 }
 
-bool Sim7670G::sim7670g_https_get(const char* url, char* response_buffer, int buffer_len)
+/**
+ * POST al destino fijado con sim7670g_http_set_target()
+ */
+bool Sim7670G::sim7670g_http_post_body(int len, const BodyWriter& writer, char* response_buffer, int buffer_len, 
+                                       uint32_t deadline_ms)
 {
     char response[256];
-    char cmd[512];
+    char cmd[64];
     
-    if (!url || !response_buffer) 
-        return false;
+    if (!writer || !response_buffer || buffer_len <= 0) return false;
+
+    timeout_stage = SIM7670G_STAGE_NONE;
+    uint64_t deadline = sim7670g_deadline_us(deadline_ms);
+    response_buffer[0] = '\0';
     
-    printf("HTTPS GET: %s\n", url);
+    // Datos
+    snprintf(cmd, sizeof(cmd), "AT+HTTPDATA=%d,10000", len);
+    sim7670g_rx_flush();
+    sim7670g_tx_string(cmd);
+    sim7670g_tx_string("\r\n");
     
-    snprintf(cmd, sizeof(cmd), "AT+HTTPPARA=\"URL\",\"%s\"", url);
-    if (!sim7670g_send_command(cmd, "OK", SIM7670G_CMD_TIMEOUT))
+    // Esperar DOWNLOAD
+    if (!sim7670g_read_line_skip_empty(response, sizeof(response), deadline) || 
+        !strstr(response, "DOWNLOAD")) 
     {
-        printf("❌ Error al configurar URL\n");
-        return false;
+        printf("❌ HTTPDATA failed\n");
+        return sim7670g_fail(SIM7670G_STAGE_HTTP_ACTION, deadline_ms);
     }
     
-    // Desactivar compresión
-    sim7670g_send_command("AT+HTTPPARA=\"USERDATA\",\"Accept-Encoding: identity\"", "OK", SIM7670G_CMD_TIMEOUT);
+    // Enviar datos (pueden contener bytes nulos) según se generan
+    int written = 0;
+    bool body_ok = writer([&written, len](const char* data, int n) 
+    {
+        int copy = (n < len - written) ? n : len - written;
+        uart_write_blocking(SIM7670G_UART, (const uint8_t*)data, copy);
+        written += copy;
+        return copy == n;
+    });
+
+    if (!body_ok || written != len) 
+    {
+        // El módem espera 'len' bytes: completar para cerrar HTTPDATA y no enviar el POST
+        printf("❌ Cuerpo de %d bytes (%s), se anunciaron %d\n", written, body_ok ? "completo" : "con error", len);
+        while (written++ < len) 
+            uart_putc_raw(SIM7670G_UART, ' ');
+        sim7670g_read_line_skip_empty(response, sizeof(response), deadline);
+        return false;
+    }
     
-    // Ejecutar GET
+    // Ejecutar POST
+    Sim7670gLongWait long_wait;
     sim7670g_rx_flush();
-    sim7670g_tx_string("AT+HTTPACTION=0\r\n");
-    
-    bool ok = false;
-    uint64_t start = time_us_64();
-    int content_length = 0;
+    sim7670g_tx_string("AT+HTTPACTION=1\r\n");  // 1=POST 
     
-    // Esperar +HTTPACTION
-    while ((time_us_64() - start) < 5000000ULL) 
+    while (time_us_64() < deadline) 
     {
-        // ✅ CAMBIO: timeout por línea REDUCIDO a 100ms
-        if (!sim7670g_read_line_skip_empty(response, sizeof(response), 100))
+        if (!sim7670g_read_line_skip_empty(response, sizeof(response), deadline))
             continue;
         
         if (strstr(response, "+HTTPACTION:")) 
         {
             int method, status, length;
             sscanf(response, "+HTTPACTION: %d,%d,%d", &method, &status, &length);
-            content_length = length;
-            
-            printf("HTTP Status: %d, Content-Length: %d bytes\n", status, length);
-            
-            if (status == 200) {
-                ok = true;
-            }
-            break;
+            last_content_length = length;
+
+            printf("HTTP POST Status: %d, Length: %d, response: %s\n", status, length, response);
+            if (status != 200) 
+                return false;
+
+            // Cuerpo de la respuesta (p. ej. message_id): se corta al buffer
+            int want = (length < buffer_len - 1) ? length : buffer_len - 1;
+            if (want <= 0) 
+                return true;
+
+            int n = sim7670g_http_read_chunk(0, want, response_buffer, deadline_ms);
+            if (n < 0) 
+                return false;
+            response_buffer[n] = '\0';
+            return true;
         }
+        sim7670g_dispatch_urc(response);
     }
+    
+    printf("❌ Timeout esperando +HTTPACTION\n");
+    return sim7670g_fail(SIM7670G_STAGE_HTTP_ACTION, deadline_ms);
+}
 
-    if (!ok || content_length <= 0) {
-        printf("❌ HTTP request failed\n");
+/**
+ * Arrancar el servicio de sockets SSL (AT+CCH*)
+ * Recepción manual: los datos esperan en el módem hasta AT+CCHRECV,
+ * así la memoria usada en el Pico no depende del tamaño de la respuesta
+ */
+bool Sim7670G::sim7670g_ssl_start(uint32_t deadline_ms) 
+{
+    if (ssl_started) 
+        return true;
+
+    printf("Arrancando servicio SSL...\n");
+
+    sim7670g_send_command("AT+CSSLCFG=\"sslversion\",0,4", "OK", deadline_ms);
+    sim7670g_send_command("AT+CSSLCFG=\"authmode\",0,0", "OK", deadline_ms);
+    sim7670g_send_command("AT+CSSLCFG=\"enableSNI\",0,1", "OK", deadline_ms);
+
+    // Sin informe de envío, recepción manual
+    if (!sim7670g_send_command("AT+CCHSET=0,1", "OK", deadline_ms)) 
+    {
+        printf("❌ Error configurando CCHSET\n");
         return false;
     }
 
-    sleep_ms(500);
-    sim7670g_rx_flush();
-    
-    snprintf(cmd, sizeof(cmd), "AT+HTTPREAD=0,%d\r\n", content_length);
-    printf("Enviando: %s\n", cmd);
-    sim7670g_tx_string(cmd);
-    
-    int pos = 0;
-    int no_data_loops = 0;
-    int total_expected = content_length + 100;  // +100 para header y overhead
-    
-    // ✅ NUEVO: Lee sin depender de uart_is_readable()
-    // Lee byte a byte CON TIMEOUT individual para cada byte
-    uint64_t read_start = time_us_64();
-    
-    while (pos < buffer_len - 1 && (time_us_64() - read_start) < 30000000ULL) 
+    if (!sim7670g_send_command("AT+CCHSTART", "+CCHSTART: 0", deadline_ms)) 
     {
-        // ✅ CLAVE: Intentar leer 1 byte CON TIMEOUT
-        uint64_t byte_start = time_us_64();
-        bool byte_received = false;
-        
-        while ((time_us_64() - byte_start) < 100000ULL) {  // 100ms timeout por byte
-            if (uart_is_readable(SIM7670G_UART)) {
-                char c = uart_getc(SIM7670G_UART);
-                response_buffer[pos++] = c;
-                byte_received = true;
-                no_data_loops = 0;
-                break;
-            }
-            sleep_ms(1);  // Sleep pequeño para no quemar CPU
-        }
-        
-        // Si no llegó byte, incrementar contador
-        if (!byte_received) {
-            no_data_loops++;
-            
-            // ✅ CLAVE: Después de 500ms sin datos, verificar si tenemos JSON completo
-            if (no_data_loops > 50) {  // 50 * 10ms = 500ms
-                printf("⚠️  500ms sin datos, verificando si JSON está completo\n");
-                
-                // Buscar JSON válido en buffer
-                char* json_start = strchr(response_buffer, '{');
-                char* json_end = NULL;
-                
-                if (json_start) {
-                    int brace_count = 0;
-                    bool in_string = false;
-                    bool escape_next = false;
-                    
-                    for (char* p = json_start; p < response_buffer + pos; p++) {
-                        char c = *p;
-                        
-                        if (c == '"' && !escape_next) in_string = !in_string;
-                        escape_next = (c == '\\' && !escape_next);
-                        
-                        if (!in_string) {
-                            if (c == '{') brace_count++;
-                            else if (c == '}') {
-                                brace_count--;
-                                if (brace_count == 0) {
-                                    json_end = p;
-                                    break;
-                                }
-                            }
-                        }
-                    }
-                }
-                
-                // Si encontramos JSON completo, salir
-                if (json_start && json_end) {
-                    printf("✓ JSON completo encontrado después de %d bytes\n", pos);
-                    break;
-                }
-                
-                // Si llevamos 2 segundos sin datos, forzar salida
-                if (no_data_loops > 200) {  // 200 * 10ms = 2 segundos
-                    printf("❌ Timeout 2 segundos sin datos, saliendo\n");
-                    break;
-                }
-            }
-        }
-    }
-    
-    printf("✓ Total leído: %d bytes\n", pos);
-    
-    // ✅ EXTRACCIÓN FINAL DE JSON POR BALANCE DE LLAVES
-    char* json_start = strchr(response_buffer, '{');
-    char* json_end = NULL;
-    
-    if (json_start) {
-        int brace_count = 0;
-        bool in_string = false;
-        bool escape_next = false;
-        
-        for (char* p = json_start; p < response_buffer + pos; p++) {
-            char c = *p;
-            
-            if (c == '"' && !escape_next) {
-                in_string = !in_string;
-            }
-            
-            escape_next = (c == '\\' && !escape_next);
-            
-            if (!in_string) {
-                if (c == '{') brace_count++;
-                else if (c == '}') {
-                    brace_count--;
-                    if (brace_count == 0) {
-                        json_end = p;
-                        break;
-                    }
-                }
-            }
-        }
+        printf("❌ Error arrancando CCH\n");
+        return false;
     }
-    
-    if (json_start && json_end && json_end > json_start) {
-        int json_len = json_end - json_start + 1;
-        memmove(response_buffer, json_start, json_len);
-        response_buffer[json_len] = '\0';
-        
-        printf("✓ JSON extraído: %d bytes\n", json_len);
-        printf("Preview: %.*s\n", 300, response_buffer);
-        
-        ok= true;
-    } 
-    else 
+
+    if (!sim7670g_send_command("AT+CCHSSLCFG=0,0", "OK", deadline_ms)) 
     {
-        printf("❌ JSON válido no encontrado en respuesta (%d bytes leídos)\n", pos);
-        printf("Respuesta completa: %s\n", response_buffer);
-        ok = false;
+        printf("❌ Error asignando contexto SSL\n");
+        return false;
     }
 
-    return ok;
+    ssl_started = true;
+    printf("✓ Servicio SSL arrancado\n");
+    return true;
 }
 
-bool Sim7670G::sim7670g_https_post(const char* url, const char* json_data, char* response_buffer, int buffer_len)
+/**
+ * Abrir conexión TLS (sesión 0)
+ */
+bool Sim7670G::sim7670g_ssl_open(const char *host, int port, uint32_t deadline_ms) 
 {
-    char response[256];
-    char cmd[768];
-    
-    if (!url || !json_data || !response_buffer) return false;
-    
-    printf("HTTPS POST: %s\n", url);
-    printf("Data: %s\n", json_data);
-    
-    // URL
-    snprintf(cmd, sizeof(cmd), "AT+HTTPPARA=\"URL\",\"%s\"", url);
-    if (!sim7670g_send_command(cmd, "OK", 5000))
-    {
+    char cmd[160];
+
+    if (!host) 
         return false;
-    }
 
-    // Content-Type JSON
-    if (!sim7670g_send_command("AT+HTTPPARA=\"CONTENT\",\"application/json\"", "OK", 5000))
+    timeout_stage = SIM7670G_STAGE_NONE;
+    if (!sim7670g_ssl_start(deadline_ms)) 
+        return sim7670g_fail(SIM7670G_STAGE_TLS, deadline_ms);
+
+    if (ssl_open) 
+        sim7670g_ssl_close();
+
+    printf("Abriendo TLS con %s:%d...\n", host, port);
+
+    // 2 = cliente TLS
+    snprintf(cmd, sizeof(cmd), "AT+CCHOPEN=0,\"%s\",%d,2", host, port);
+    if (!sim7670g_send_command(cmd, "+CCHOPEN: 0,0", deadline_ms)) 
     {
-        return false;
+        printf("❌ Error abriendo TLS\n");
+        return sim7670g_fail(SIM7670G_STAGE_TLS, deadline_ms);
     }
-    
-    // Datos
-    snprintf(cmd, sizeof(cmd), "AT+HTTPDATA=%d,10000", (int)strlen(json_data));
-    sim7670g_rx_flush();
-    sim7670g_tx_string(cmd);
-    sim7670g_tx_string("\r\n");
-    
-    // Esperar DOWNLOAD
-    if (!sim7670g_read_line_skip_empty(response, sizeof(response), 5000) || 
-        !strstr(response, "DOWNLOAD")) 
-    {
-        printf("❌ HTTPDATA failed\n");
+
+    ssl_open = true;
+    printf("✓ TLS abierto\n");
+    return true;
+}
+
+/**
+ * Enviar datos por la sesión TLS
+ */
+bool Sim7670G::sim7670g_ssl_send(const char *data, int len, uint32_t deadline_ms) 
+{
+    char cmd[32];
+    char response[64];
+
+    if (!ssl_open || !data) 
         return false;
+
+    timeout_stage = SIM7670G_STAGE_NONE;
+    uint64_t deadline = sim7670g_deadline_us(deadline_ms);
+
+    int sent = 0;
+    while (sent < len) 
+    {
+        int chunk = len - sent;
+        if (chunk > SIM7670G_SSL_MAX_SEND) 
+            chunk = SIM7670G_SSL_MAX_SEND;
+
+        snprintf(cmd, sizeof(cmd), "AT+CCHSEND=0,%d\r\n", chunk);
+        sim7670g_rx_flush();
+        sim7670g_tx_string(cmd);
+
+        if (!sim7670g_wait_prompt(deadline)) 
+        {
+            printf("❌ CCHSEND sin prompt, conexión cerrada\n");
+            ssl_open = false;
+            return sim7670g_fail(SIM7670G_STAGE_TLS, deadline_ms);
+        }
+
+        uart_write_blocking(SIM7670G_UART, (const uint8_t *)data + sent, chunk);
+
+        bool ok = false;
+        while (time_us_64() < deadline) 
+        {
+            if (!sim7670g_read_line_skip_empty(response, sizeof(response), deadline)) 
+                continue;
+
+            if (strcmp(response, "OK") == 0) 
+            {
+                ok = true;
+                break;
+            }
+            if (strstr(response, "ERROR") || strstr(response, "+CCH_PEER_CLOSED")) 
+                break;
+            sim7670g_dispatch_urc(response);
+        }
+
+        if (!ok) 
+        {
+            printf("❌ Error enviando datos TLS\n");
+            ssl_open = false;
+            return sim7670g_fail(SIM7670G_STAGE_TLS, deadline_ms);
+        }
+
+        sent += chunk;
     }
-    
-    // Enviar datos JSON
-    sim7670g_tx_string(json_data);
-    
-    // Ejecutar POST
-    sim7670g_rx_flush();
-    sim7670g_tx_string("AT+HTTPACTION=1\r\n");  // 1=POST 
-    
-    bool ok = false;
-    uint64_t start = time_us_64();
-    
-    while ((time_us_64() - start) < (SIM7670G_CMD_TIMEOUT * 1000ULL)) 
+
+    return true;
+}
+
+/**
+ * Leer datos recibidos por la sesión TLS
+ * Devuelve bytes leídos, 0 si no llegó nada a tiempo, -1 si la conexión se cerró
+ */
+int Sim7670G::sim7670g_ssl_recv(char *buffer, int max_len, uint32_t deadline_ms) 
+{
+    char response[64];
+    char cmd[32];
+
+    if (!ssl_open || !buffer || max_len <= 0) 
+        return -1;
+
+    // El long poll de getUpdates espera aquí a que el servidor conteste
+    Sim7670gLongWait long_wait;
+    timeout_stage = SIM7670G_STAGE_NONE;
+    uint64_t deadline = sim7670g_deadline_us(deadline_ms);
+
+    while (time_us_64() < deadline) 
     {
-        if (!sim7670g_read_line_skip_empty(response, sizeof(response), 5000))
+        // +CCHRECV: LEN,<cache sesión 0>,<cache sesión 1>
+        if (!sim7670g_send_query("AT+CCHRECV?", "+CCHRECV: LEN,", response, sizeof(response), deadline_ms)) 
+        {
+            printf("❌ Error consultando CCHRECV\n");
+            ssl_open = false;
+            sim7670g_fail(SIM7670G_STAGE_BODY_READ, deadline_ms);
+            return -1;
+        }
+
+        int cached = 0;
+        int cached_other = 0;
+        sscanf(response, "+CCHRECV: LEN,%d,%d", &cached, &cached_other);
+
+        if (cached <= 0) 
+        {
+            // Nada en camino: hay trabajo más urgente, dejar de esperar
+            if (recv_abort && recv_abort()) 
+            {
+                printf("⏸ Recepción TLS abandonada: hay trabajo más urgente\n");
+                recv_aborted = true;
+                return 0;
+            }
+            sleep_ms(20);
             continue;
-        
-        if (strstr(response, "+HTTPACTION:")) 
+        }
+
+        if (cached > max_len) 
+            cached = max_len;
+
+        snprintf(cmd, sizeof(cmd), "AT+CCHRECV=0,%d\r\n", cached);
+        sim7670g_rx_flush();
+        sim7670g_tx_string(cmd);
+
+        // +CCHRECV: DATA,0,<len>\r\n<datos>\r\n+CCHRECV: 0,0\r\nOK
+        int received = -1;
+        while (time_us_64() < deadline) 
         {
-            int method, status, length;
-            sscanf(response, "+HTTPACTION: %d,%d,%d", &method, &status, &length);
+            if (!sim7670g_read_line_skip_empty(response, sizeof(response), deadline)) 
+                continue;
 
-            printf("HTTP POST Status: %d, Length: %d, response: %s\n", status, length, response);
-            
-            if (status == 200) 
+            int len = 0;
+            if (received < 0 && sscanf(response, "+CCHRECV: DATA,0,%d", &len) == 1) 
             {
-                ok = true;
+                received = sim7670g_read_bytes(buffer, len, deadline);
+                ssl_rx_bytes += received;
+                continue;
             }
-            break;
+
+            if (strcmp(response, "OK") == 0 || strstr(response, "ERROR")) 
+                break;
+            sim7670g_dispatch_urc(response);
         }
+
+        if (received < 0) 
+            sim7670g_fail(SIM7670G_STAGE_BODY_READ, deadline_ms);
+        return received < 0 ? -1 : received;
     }
-    
-    return ok;
+
+    sim7670g_fail(SIM7670G_STAGE_BODY_READ, deadline_ms);
+    return 0;
+}
+
+void Sim7670G::sim7670g_set_recv_abort(const AbortCheck& check) 
+{
+    recv_abort = check;
+    recv_aborted = false;
+}
+
+/**
+ * Cerrar la sesión TLS
+ */
+void Sim7670G::sim7670g_ssl_close() 
+{
+    if (!ssl_open) 
+        return;
+
+    printf("Cerrando TLS...\n");
+    sim7670g_send_command("AT+CCHCLOSE=0", "+CCHCLOSE: 0", sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
+    ssl_open = false;
+}
+
+/**
+ * Parar el servicio SSL; el siguiente ssl_open lo vuelve a arrancar
+ */
+void Sim7670G::sim7670g_ssl_stop() 
+{
+    sim7670g_ssl_close();
+
+    if (!ssl_started) 
+        return;
+
+    sim7670g_send_command("AT+CCHSTOP", "+CCHSTOP: 0", sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
+    ssl_started = false;
+}
+
+/**
+ * Reiniciar el servicio HTTP (y los sockets SSL que dependen del PDP)
+ */
+bool Sim7670G::sim7670g_http_reinit(uint32_t deadline_ms) 
+{
+    printf("Reiniciando servicio HTTP...\n");
+
+    // HTTPTERM falla si el servicio no estaba iniciado (arranque): plazo
+    // propio para que no gaste el de HTTPINIT
+    sim7670g_ssl_stop();
+    sim7670g_send_command("AT+HTTPTERM", "OK", sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
+    http_target_id++;
+
+    if (!sim7670g_send_command("AT+HTTPINIT", "OK", deadline_ms)) 
+    {
+        printf("❌ Error al inicializar HTTP\n");
+        device_info.link.http_ready = false;
+        return false;
+    }
+    device_info.link.http_ready = true;
+    return true;
 }
 
 /**
@@ -709,8 +1926,34 @@ bool Sim7670G::sim7670g_https_post(const char* url, const char* json_data, char*
 void Sim7670G::sim7670g_reset() 
 {
     printf("Reiniciando SIM7670G...\n");
-    sim7670g_send_command("AT+CRESET", NULL, 5000);
+    Sim7670gLongWait long_wait;
+    sim7670g_send_command("AT+CRESET", NULL, sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
     sleep_ms(3000);
+
+    // Los servicios del módem se pierden con el reinicio
+    ssl_started = false;
+    ssl_open = false;
+    modem_asleep = false;
+    device_info.link.network_registered = false;
+    device_info.link.cs_registered = false;
+    device_info.link.eps_registered = false;
+    device_info.link.gprs_attached = false;
+    device_info.link.pdp_active = false;
+    device_info.link.http_ready = false;
+    link_down_ms = to_ms_since_boot(get_absolute_time());
+
+    // Esperar a que vuelva a responder
+    uint32_t start = to_ms_since_boot(get_absolute_time());
+    while (to_ms_since_boot(get_absolute_time()) - start < SIM7670G_RESET_TIMEOUT) 
+    {
+        if (sim7670g_send_command("AT", "OK", sim7670g_deadline(1000))) 
+        {
+            printf("✓ SIM7670G responde tras el reinicio\n");
+            return;
+        }
+        sleep_ms(1000);
+    }
+    printf("❌ SIM7670G no responde tras el reinicio\n");
 }
 
 /**
@@ -723,83 +1966,65 @@ bool Sim7670G::sim7670g_init()
     printf("====================================\n");
     
     device_info.state = SIM7670G_STATE_INITIALIZING;
+    Sim7670gLongWait long_wait;
     
     // 1. Esperar a que el módulo esté listo
     sleep_ms(2000);
     
     // 2. Desactivar echo
-    printf("[1/7] Desactivando echo...\n");
-    sim7670g_send_command("ATE0", "OK", SIM7670G_CMD_TIMEOUT);
-    sleep_ms(500);
+    printf("[1/6] Desactivando echo...\n");
+    sim7670g_send_command("ATE0", "OK", sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
     
     // 3. Verificar SIM
-    printf("[2/7] Verificando SIM...\n");
-    if (!sim7670g_check_sim()) 
+    printf("[2/6] Verificando SIM...\n");
+    if (!sim7670g_check_sim(sim7670g_deadline(SIM7670G_INIT_TIMEOUT))) 
     {
         device_info.state = SIM7670G_STATE_ERROR;
         return false;
     }
-    sleep_ms(1000);
     
-    // 5. Verificar señal
-    printf("[3/7] Verificando señal...\n");
-    if (!sim7670g_check_signal()) 
+    // 4. Verificar señal
+    printf("[3/6] Verificando señal...\n");
+    if (!sim7670g_check_signal(sim7670g_deadline(SIM7670G_INIT_TIMEOUT))) 
     {
         printf("⚠️  Señal débil, continuando...\n");
     }
-    sleep_ms(1000);
-    
-    // 6. Adjuntar GPRS
-    printf("[4/7] Adjuntando GPRS...\n");
-    if (!sim7670g_attach_gprs()) 
+
+    // 5. Avisos de red: a partir de aquí las caídas llegan como URC
+    printf("[4/6] Activando avisos de red...\n");
+    if (!sim7670g_enable_network_urcs(sim7670g_deadline(SIM7670G_CMD_TIMEOUT))) 
     {
-        device_info.state = SIM7670G_STATE_ERROR;
-        return false;
+        printf("⚠️  Avisos de red no disponibles\n");
     }
-    sleep_ms(2000);
+    // Hora de la red en el reloj del módem (NITZ)
+    sim7670g_send_command("AT+CTZU=1", "OK", sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
     
-    // 7. Activar PDP
-    printf("[5/7] Activando contexto PDP...\n");
-    if (!sim7670g_activate_pdp()) 
+    // 6. Registro, GPRS, PDP y HTTP (solo los pasos que falten)
+    printf("[5/6] Conectando enlace de datos...\n");
+    if (!sim7670g_connect(sim7670g_deadline(SIM7670G_REGISTER_TIMEOUT))) 
     {
         device_info.state = SIM7670G_STATE_ERROR;
         return false;
     }
-    sleep_ms(1000);
-
-    // Inicializar HTTP
-    printf("[6/7] Inicializando HTTP...\n");
-    if (!sim7670g_send_command("AT+HTTPINIT", "OK", SIM7670G_CMD_TIMEOUT))
-        return false;
+    sim7670g_sync_clock(sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
 
-    // 8. Encender GNSS y obtener posición
-    printf("[7/7] Encendiendo GNSS y obteniendo posición...\n");
-    double lat, lon;
-    if (sim7670g_gnss_power_on())
+    // 7. Encender GNSS; el fix llega en segundo plano
+    printf("[6/6] Encendiendo GNSS...\n");
+    sim7670g_batch_cmd_t gnss[] = 
     {
-        sleep_ms(2000);
-        sim7670g_gnss_check_power();
-        sleep_ms(3000);
-        // esperar a que consiga fix
-        for (int i = 0; i < 300; i++)  // ~30 s
-        {
-            sleep_ms(1000);
-            if (sim7670g_gnss_get_location(&lat, &lon))
-            {
-                printf("POSICIÓN: lat=%.6f, lon=%.6f\n", lat, lon);
-                break;
-            }
-            else
-            {
-                printf("Esperando fix GNSS... (%d/30)\n", i+1);
-            }
-        }
-    }
+        {"AT+CGNSSPWR=1", NULL},
+        {"AT+CGNSSPWR?", "+CGNSSPWR:"}
+    };
+    sim7670g_send_batch(gnss, 2, sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
+    if (strstr(gnss[1].response, "+CGNSSPWR: 1"))
+        printf("✓ GNSS está ENCENDIDO (ON)\n");
+    else
+        printf("⚠️  GNSS no confirmado: %s\n", gnss[1].response);
     
     // 8. Obtener información
     printf("[SUCCESS] Obteniendo información del dispositivo...\n");
     sim7670g_info_t info;
-    sim7670g_get_info(&info);
+    sim7670g_get_info(&info, sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
     
     device_info.state = SIM7670G_STATE_READY;
     
@@ -809,8 +2034,11 @@ bool Sim7670G::sim7670g_init()
     printf("IMEI: %s\n", device_info.imei);
     printf("Señal: %d/31\n", device_info.signal_quality);
     printf("SIM: %s\n", device_info.sim_ready ? "LISTA" : "ERROR");
-    printf("GPRS: %s\n", device_info.gprs_attached ? "ADJUNTADO" : "ERROR");
-    printf("Internet: %s\n", device_info.pdp_active ? "ACTIVO" : "INACTIVO");
+    printf("GPRS: %s\n", device_info.link.gprs_attached ? "ADJUNTADO" : "ERROR");
+    printf("Internet: %s\n", device_info.link.pdp_active ? "ACTIVO" : "INACTIVO");
+    printf("Lotes AT: %u comandos en %u líneas, %u idas y vueltas menos (~%u ms)\n", 
+           batch_stats.commands, batch_stats.lines, 
+           batch_stats.commands - batch_stats.lines, batch_stats.saved_ms);
     printf("====================================\n");
     
     return true;
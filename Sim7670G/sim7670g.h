@@ -3,9 +3,12 @@
 
 #include <stdint.h>
 #include <string>
+#include <vector>
+#include <functional>
 #include <stdbool.h>
 #include "pico/stdlib.h"
 #include "hardware/uart.h"
+#include "sim7670g_parse.h"
 
 // Configuración UART1
 #define SIM7670G_UART uart1
@@ -14,14 +17,59 @@
 #define SIM7670G_RX_PIN 5      // GPIO 5
 #define SIM7670G_BAUD 115200
 
-// Timeouts (ms)
+// Control de bajo consumo (ajustar al cableado)
+#define SIM7670G_DTR_PIN 6     // GPIO 6 -> DTR del módem
+#define SIM7670G_RI_PIN 7      // GPIO 7 <- RI del módem
+#define SIM7670G_WAKE_DELAY_MS 50
+
+// Tiempo máximo de arranque tras AT+CRESET (ms)
+#define SIM7670G_RESET_TIMEOUT 30000
+
+// Espera máxima de registro en la red al conectar (ms)
+#define SIM7670G_REGISTER_TIMEOUT 30000
+
+// Timeouts (ms): presupuestos habituales para sim7670g_deadline()
 #define SIM7670G_CMD_TIMEOUT 5000
 #define SIM7670G_INIT_TIMEOUT 10000
+#define SIM7670G_SSL_OPEN_TIMEOUT 20000
+#define SIM7670G_SMS_TIMEOUT 60000     // AT+CMGS espera a la red
+#define SIM7670G_GNSS_TIMEOUT 3000     // respuesta de AT+CGPSINFO
+#define SIM7670G_URC_LINE_TIMEOUT 100  // final de una URC que ya empezó a llegar
+
+// Máximo de bytes por AT+CCHSEND
+#define SIM7670G_SSL_MAX_SEND 1500
 
 // Buffer sizes
 #define RX_BUFFER_SIZE 4096
 #define TX_BUFFER_SIZE 2048
 
+// Tamaño de cada AT+HTTPREAD en lecturas por trozos
+#define SIM7670G_HTTP_CHUNK 512
+
+// Comandos concatenados (AT+A;+B;+C): longitud máxima de la línea
+// (la V.250 garantiza al menos 40; el SIM7670G acepta bastante más)
+#define SIM7670G_BATCH_MAX_LINE 256
+
+// Plazos: instante absoluto en ms desde el arranque (el mismo reloj que
+// ModemTransaction::deadline_ms). Cada operación recibe uno y lo pasa tal cual
+// a sus pasos, así una petición gasta lo que le queda y nunca más
+static inline uint32_t sim7670g_deadline(uint32_t timeout_ms)
+{
+    return to_ms_since_boot(get_absolute_time()) + timeout_ms;
+}
+
+// Etapa en la que venció el plazo de la última operación fallida
+enum sim7670g_stage_t 
+{
+    SIM7670G_STAGE_NONE,           // no venció (error del módem o del servidor)
+    SIM7670G_STAGE_COMMAND,        // comando AT o configuración
+    SIM7670G_STAGE_TLS,            // AT+CCHSTART/CCHOPEN/CCHSEND
+    SIM7670G_STAGE_HTTP_ACTION,    // AT+HTTPDATA y espera de +HTTPACTION
+    SIM7670G_STAGE_BODY_READ       // AT+HTTPREAD o AT+CCHRECV
+};
+
+const char* sim7670g_stage_name(sim7670g_stage_t stage);
+
 // Estados del módulo
 enum sim7670g_state_t 
 {
@@ -39,42 +87,183 @@ struct sim7670g_info_t
     char imsi[16];
     int signal_quality;  // 0-31
     bool sim_ready;
-    bool network_registered;
-    bool gprs_attached;
-    bool pdp_active;
+    sim7670g_link_t link;  // pasos del enlace de datos
+};
+
+// Resultado de un subcomando de un lote
+enum sim7670g_batch_result_t 
+{
+    SIM7670G_BATCH_PENDING,    // no llegó a ejecutarse
+    SIM7670G_BATCH_OK,
+    SIM7670G_BATCH_ERROR
+};
+
+// Subcomando de sim7670g_send_batch()
+struct sim7670g_batch_cmd_t
+{
+    const char *cmd;           // comando completo, "AT+CREG=1"
+    const char *prefix;        // línea de información a guardar ("+CSQ:"), NULL si no hay
+    sim7670g_batch_result_t result = SIM7670G_BATCH_PENDING;
+    char response[64] = "";    // línea que empieza por 'prefix'
+};
+
+// Ahorro de los lotes frente a un comando por línea
+struct sim7670g_batch_stats_t
+{
+    uint32_t commands;         // subcomandos enviados en lotes
+    uint32_t lines;            // líneas AT enviadas para ellos
+    uint32_t fallbacks;        // lotes repetidos comando a comando tras un ERROR
+    uint32_t saved_ms;         // (comandos × ida y vuelta media) - tiempo real de los lotes
+    uint32_t cmd_rtt_ms;       // ida y vuelta media de un comando suelto
 };
 
 class Sim7670G 
 {
 public:
+    // Manejador de líneas no solicitadas (+CMTI, +CGEV, +CMQTTRX...)
+    using UrcHandler = std::function<void(const char *line)>;
+
+    // Receptor de datos por trozos; devolver false para dejar de recibir
+    using ChunkConsumer = std::function<bool(const char *data, int len)>;
+
+    // Productor de un cuerpo de longitud conocida: lo escribe en 'out' por trozos
+    using BodyWriter = std::function<bool(const ChunkConsumer& out)>;
+
+    // Devuelve true cuando hay trabajo más urgente que la recepción en curso
+    using AbortCheck = std::function<bool()>;
 
     explicit Sim7670G(const std::string& sim_pin);
     ~Sim7670G();
 
-    // Funciones públicas
+    // Un único propietario del módem (ver ModemArbiter): una copia
+    // enviaría sus propios comandos AT y otro AT+HTTPTERM al destruirse
+    Sim7670G(const Sim7670G&) = delete;
+    Sim7670G& operator=(const Sim7670G&) = delete;
+
+    // Funciones públicas. Las que hablan con el módem reciben un plazo absoluto
+    // (sim7670g_deadline()); init, reset y el cierre de TLS usan el suyo propio,
+    // un cierre tiene que enviarse aunque la petición ya no tenga tiempo
     void sim7670g_uart_init();
     bool sim7670g_init();
-    bool sim7670g_send_command(const char *cmd, const char *expected_response, uint32_t timeout);
-    bool sim7670g_check_sim();
-    bool sim7670g_check_signal();
-    bool sim7670g_attach_gprs();
-    bool sim7670g_activate_pdp();
-    bool sim7670g_get_info(sim7670g_info_t *info);
+    bool sim7670g_send_command(const char *cmd, const char *expected_response, uint32_t deadline_ms);
+    bool sim7670g_send_query(const char *cmd, const char *prefix, char *out, int out_len, uint32_t deadline_ms);
+    bool sim7670g_send_with_prompt(const char *cmd, const char *data, int len, 
+                                   const char *expected_response, uint32_t deadline_ms);
+
+    // Enviar varios comandos en una línea (partiendo en varias si no caben).
+    // Tras un ERROR se repiten uno a uno para saber cuál falló: usar solo
+    // comandos idempotentes (configuración y consultas). Devuelve cuántos dieron OK.
+    int sim7670g_send_batch(sim7670g_batch_cmd_t *cmds, int count, uint32_t deadline_ms);
+    const sim7670g_batch_stats_t& sim7670g_batch_stats() const { return batch_stats; }
+    int sim7670g_read_raw(char *dst, int len, uint32_t deadline_ms);
+    void sim7670g_add_urc_handler(UrcHandler handler);
+    void sim7670g_poll_urc(uint32_t deadline_ms);
+    bool sim7670g_check_sim(uint32_t deadline_ms);
+    bool sim7670g_check_signal(uint32_t deadline_ms);
+    bool sim7670g_attach_gprs(uint32_t deadline_ms);
+    bool sim7670g_activate_pdp(uint32_t deadline_ms);
+    bool sim7670g_enable_network_urcs(uint32_t deadline_ms);
+    bool sim7670g_wait_registration(uint32_t deadline_ms);
+    bool sim7670g_connect(uint32_t deadline_ms);
+    bool sim7670g_link_up() const;
+    uint32_t sim7670g_link_down_since() const { return link_down_ms; }
+    bool sim7670g_get_info(sim7670g_info_t *info, uint32_t deadline_ms);
     void sim7670g_reset();
-    bool sim7670g_gnss_power_on();
-    bool sim7670g_gnss_power_off();
-    bool sim7670g_gnss_get_location(double *lat, double *lon);
-    void sim7670g_gnss_check_power();
-    bool sim7670g_https_get(const char* url, char* response_buffer, int buffer_len);
-    bool sim7670g_https_post(const char* url, const char* json_data, char* response_buffer, int buffer_len);
+    bool sim7670g_http_reinit(uint32_t deadline_ms);
+    bool sim7670g_gnss_power_on(uint32_t deadline_ms);
+    bool sim7670g_gnss_power_off(uint32_t deadline_ms);
+    bool sim7670g_gnss_get_location(double *lat, double *lon, uint32_t deadline_ms);
+    void sim7670g_gnss_check_power(uint32_t deadline_ms);
+
+    // Hora UTC (s Unix): de la red al arrancar y de cada fix GNSS; false si aún no hay
+    bool sim7670g_sync_clock(uint32_t deadline_ms);
+    bool sim7670g_get_utc(uint32_t *unix_s) const;
+
+    // Celda servidora (AT+CPSI?), para situar sin GNSS
+    bool sim7670g_get_cell(sim7670g_cell_t *cell, uint32_t deadline_ms);
+
+    // SMS en modo texto; los nuevos llegan como URC +CMTI: "SM",<index>
+    bool sim7670g_sms_init(uint32_t deadline_ms);
+    bool sim7670g_sms_read(int index, char *number, int number_len, char *text, int text_len, 
+                           uint32_t deadline_ms);
+    bool sim7670g_sms_send(const char *number, const char *text, uint32_t deadline_ms);
+    bool sim7670g_sms_delete(int index, uint32_t deadline_ms);
+    int sim7670g_sms_list(int *indexes, int max, uint32_t deadline_ms);
+    bool sim7670g_sleep_enable(uint32_t deadline_ms);
+    void sim7670g_allow_sleep();
+    void sim7670g_wake();
+    bool sim7670g_is_asleep() const { return modem_asleep; }
+    bool sim7670g_https_get(const char* url, char* response_buffer, int buffer_len, uint32_t deadline_ms);
+    bool sim7670g_https_post(const char* url, const char* json_data, char* response_buffer, int buffer_len, 
+                             uint32_t deadline_ms);
+    bool sim7670g_https_get_stream(const char* url, const ChunkConsumer& consumer, uint32_t deadline_ms);
+    int sim7670g_last_content_length() const { return last_content_length; }
+    bool sim7670g_https_post_data(const char* url, const char* content_type, const uint8_t* data, int len, 
+                                  char* response_buffer, int buffer_len, uint32_t deadline_ms);
+    bool sim7670g_https_post_stream(const char* url, const char* content_type, int len, 
+                                    const BodyWriter& writer, char* response_buffer, int buffer_len, 
+                                    uint32_t deadline_ms);
+
+    // POST en dos pasos: destino una vez, cuerpo por petición (mismo destino, varios envíos)
+    bool sim7670g_http_set_target(const char* url, const char* content_type, uint32_t deadline_ms);
+    bool sim7670g_http_post_body(int len, const BodyWriter& writer, char* response_buffer, int buffer_len, 
+                                 uint32_t deadline_ms);
+
+    // Cambia con cada URL fijada o reinicio HTTP: si no ha cambiado, el destino sigue puesto
+    uint32_t sim7670g_http_target_id() const { return http_target_id; }
+
+    // Sockets TLS persistentes (AT+CCH*), sesión 0
+    bool sim7670g_ssl_start(uint32_t deadline_ms);
+    bool sim7670g_ssl_open(const char *host, int port, uint32_t deadline_ms);
+    bool sim7670g_ssl_send(const char *data, int len, uint32_t deadline_ms);
+    int sim7670g_ssl_recv(char *buffer, int max_len, uint32_t deadline_ms);
+    void sim7670g_ssl_close();
+    void sim7670g_ssl_stop();
+    bool sim7670g_ssl_is_open() const { return ssl_open; }
+    uint32_t sim7670g_ssl_rx_bytes() const { return ssl_rx_bytes; }
+
+    // Mientras no llega nada, ssl_recv consulta 'check' y abandona (devuelve 0)
+    // si dice que sí; la respuesta sigue pendiente en el socket, hay que cerrarlo.
+    // Fijarlo borra el aviso de la recepción abandonada anterior
+    void sim7670g_set_recv_abort(const AbortCheck& check);
+    bool sim7670g_recv_aborted() const { return recv_aborted; }
+
+    // Dónde venció el plazo la última operación HTTP/TLS que falló
+    // (SIM7670G_STAGE_NONE si falló por otra causa)
+    sim7670g_stage_t sim7670g_timeout_stage() const { return timeout_stage; }
 
 private:
     // Funciones internas
     void sim7670g_tx_string(const char *str);
     void sim7670g_rx_flush();
+    void sim7670g_dispatch_urc(const char *line);
+    void sim7670g_handle_network_urc(const char *line);
+    void sim7670g_link_lost(const char *reason, bool was_up);
+    bool sim7670g_http_action(int method, int *status, int *length, uint32_t deadline_ms);
+    int sim7670g_http_read_chunk(int offset, int len, char *dst, uint32_t deadline_ms);
+    bool sim7670g_send_single(sim7670g_batch_cmd_t &cmd, uint32_t deadline_ms);
+    bool sim7670g_send_batch_line(const char *line, sim7670g_batch_cmd_t *cmds, int count, uint32_t deadline_ms);
+    void sim7670g_record_rtt(uint64_t start_us);
+    bool sim7670g_fail(sim7670g_stage_t stage, uint32_t deadline_ms);
+    void sim7670g_set_utc(uint32_t unix_s);
 
     sim7670g_info_t device_info;
     std::string pin_;
+    bool ssl_started;
+    bool ssl_open;
+    uint32_t ssl_rx_bytes;
+    std::vector<UrcHandler> urc_handlers;
+    int last_content_length;   // de la última URC +HTTPACTION
+    bool modem_asleep;         // DTR alto, reloj lento permitido
+    uint32_t link_down_ms;     // cuándo se perdió el enlace de datos
+    bool utc_valid;            // hay hora UTC de la red o del GNSS
+    uint32_t utc_base_s;       // hora UTC en utc_base_ms
+    uint32_t utc_base_ms;
+    uint32_t http_target_id;
+    sim7670g_batch_stats_t batch_stats;
+    sim7670g_stage_t timeout_stage;
+    AbortCheck recv_abort;
+    bool recv_aborted;         // la última ssl_recv se abandonó por recv_abort
 };
 
 #endif
\ No newline at end of file
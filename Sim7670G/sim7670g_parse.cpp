@@ -0,0 +1,324 @@
+#include "sim7670g_parse.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Clocks before this year were never set (the modem RTC starts in 1980)
+#define SIM7670G_MIN_CLOCK_YEAR 2024
+
+// Civil date (UTC) to Unix time; false if out of range
+static bool unix_time(int year, int month, int day, int hour, int minute, int second, uint32_t* unix_s)
+{
+    if (year < SIM7670G_MIN_CLOCK_YEAR || year > 2099 || month < 1 || month > 12 || day < 1 || day > 31 ||
+        hour > 23 || minute > 59 || second > 60 || hour < 0 || minute < 0 || second < 0)
+    {
+        return false;
+    }
+
+    // Days since 1970-01-01, counting the year from March so February is last
+    int y = month <= 2 ? year - 1 : year;
+    int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int doe = (y % 400) * 365 + (y % 400) / 4 - (y % 400) / 100 + doy;
+    int64_t days = (int64_t)(y / 400) * 146097 + doe - 719468;
+
+    *unix_s = (uint32_t)(days * 86400 + hour * 3600 + minute * 60 + second);
+    return true;
+}
+
+bool sim7670g_parse_cgpsinfo(const char* line, double* lat, double* lon)
+{
+    const char* info = strstr(line, "+CGPSINFO:");
+    if (!info)
+    {
+        return false;
+    }
+
+    double lat_raw = 0.0;
+    double lon_raw = 0.0;
+    char lat_dir = 'N';
+    char lon_dir = 'W';
+
+    // Parser simplificado (el módulo solo devuelve 4 campos útiles)
+    int parsed = sscanf(info, "+CGPSINFO: %lf,%c,%lf,%c",
+                        &lat_raw, &lat_dir, &lon_raw, &lon_dir);
+
+    if (parsed < 3 || lat_raw <= 0 || lon_raw <= 0)
+    {
+        return false;
+    }
+
+    // Convertir NMEA (ddmm.mmmm) a decimales
+    double lat_degrees = (int)(lat_raw / 100);
+    double lat_minutes = lat_raw - (lat_degrees * 100);
+    double flat = lat_degrees + (lat_minutes / 60.0);
+
+    double lon_degrees = (int)(lon_raw / 100);
+    double lon_minutes = lon_raw - (lon_degrees * 100);
+    double flon = lon_degrees + (lon_minutes / 60.0);
+
+    if (lat_dir == 'S') flat = -flat;
+    if (lon_dir == 'W') flon = -flon;
+
+    if (flat < -90 || flat > 90 || flon < -180 || flon > 180)
+    {
+        return false;
+    }
+
+    *lat = flat;
+    *lon = flon;
+    return true;
+}
+
+bool sim7670g_parse_cgpsinfo_utc(const char* line, uint32_t* unix_s)
+{
+    const char* info = strstr(line, "+CGPSINFO:");
+    if (!info)
+    {
+        return false;
+    }
+
+    // Skip lat, N/S, lon, E/W; empty fields (no fix) stop the scan
+    int day, month, year, hour, minute, second;
+    if (sscanf(info, "+CGPSINFO: %*[^,],%*[^,],%*[^,],%*[^,],%2d%2d%2d,%2d%2d%2d",
+               &day, &month, &year, &hour, &minute, &second) != 6)
+    {
+        return false;
+    }
+    return unix_time(2000 + year, month, day, hour, minute, second, unix_s);
+}
+
+bool sim7670g_parse_cclk(const char* line, uint32_t* unix_s)
+{
+    int year, month, day, hour, minute, second, quarters;
+    char sign;
+    if (sscanf(line, "+CCLK: \"%d/%d/%d,%d:%d:%d%c%d\"",
+               &year, &month, &day, &hour, &minute, &second, &sign, &quarters) != 8 ||
+        (sign != '+' && sign != '-'))
+    {
+        return false;
+    }
+
+    // An RTC never set from the network reads 80/01/06 (1980)
+    uint32_t local_s;
+    if (!unix_time(year >= 80 ? 1900 + year : 2000 + year, month, day, hour, minute, second, &local_s))
+    {
+        return false;
+    }
+    int32_t offset_s = quarters * 15 * 60;
+    *unix_s = sign == '+' ? local_s - offset_s : local_s + offset_s;
+    return true;
+}
+
+bool sim7670g_parse_link_urc(const char* line, sim7670g_link_t* link)
+{
+    // URC: +CEREG: <stat>; reply to the query: +CEREG: <n>,<stat>
+    bool eps = strncmp(line, "+CEREG:", 7) == 0;
+    if (eps || strncmp(line, "+CREG:", 6) == 0)
+    {
+        int a = 0, b = 0;
+        int n = sscanf(strchr(line, ':') + 1, "%d,%d", &a, &b);
+        int stat = (n == 2) ? b : a;
+
+        (eps ? link->eps_registered : link->cs_registered) = (stat == 1 || stat == 5);
+        bool registered = link->eps_registered || link->cs_registered;
+        bool dropped = !registered && link->network_registered;
+
+        link->network_registered = registered;
+        if (dropped)
+        {
+            link->http_ready = false;
+        }
+        return dropped;
+    }
+
+    if (strncmp(line, "+CGEV:", 6) != 0)
+    {
+        return false;
+    }
+
+    // +CGEV: NW|ME <event>; only the default bearer (PDN) of our context counts,
+    // dedicated bearers ("NW DEACT <p_cid>,<cid>,...") and other cids do not
+    const char* event = line + 6;
+    while (*event == ' ')
+    {
+        event++;
+    }
+    if (strncmp(event, "NW ", 3) == 0 || strncmp(event, "ME ", 3) == 0)
+    {
+        event += 3;
+    }
+
+    int cid = 0;
+    if (strncmp(event, "DETACH", 6) == 0)
+    {
+        // the whole packet domain is gone
+        link->gprs_attached = false;
+        link->pdp_active = false;
+        link->http_ready = false;
+        return true;
+    }
+    if (sscanf(event, "PDN DEACT %d", &cid) == 1 && cid == SIM7670G_PDP_CID)
+    {
+        link->pdp_active = false;
+        link->http_ready = false;
+        return true;
+    }
+    if (sscanf(event, "PDN ACT %d", &cid) == 1 && cid == SIM7670G_PDP_CID)
+    {
+        link->pdp_active = true;
+        link->gprs_attached = true;
+    }
+    return false;
+}
+
+int sim7670g_parse_httpread(const char* line)
+{
+    int n = 0;
+    if (sscanf(line, "+HTTPREAD: DATA,%d", &n) != 1 &&
+        sscanf(line, "+HTTPREAD: %d", &n) != 1)
+    {
+        return -1;
+    }
+    return n < 0 ? -1 : n;
+}
+
+int sim7670g_parse_cmti(const char* line)
+{
+    int index = -1;
+    if (sscanf(line, "+CMTI: \"%*[^\"]\",%d", &index) != 1)
+    {
+        return -1;
+    }
+    return index;
+}
+
+int sim7670g_parse_cmgl(const char* line)
+{
+    int index = -1;
+    if (sscanf(line, "+CMGL: %d,", &index) != 1)
+    {
+        return -1;
+    }
+    return index;
+}
+
+bool sim7670g_parse_cmgr(const char* line, char* number, int number_len)
+{
+    if (strncmp(line, "+CMGR:", 6) != 0 || number_len <= 0)
+    {
+        return false;
+    }
+
+    // Second quoted field
+    const char* p = strchr(line, '"');
+    for (int quote = 0; p && quote < 2; quote++)
+    {
+        p = strchr(p + 1, '"');
+    }
+    if (!p)
+    {
+        return false;
+    }
+
+    const char* end = strchr(++p, '"');
+    if (!end || end == p)
+    {
+        return false;
+    }
+
+    int len = (int)(end - p) < number_len - 1 ? (int)(end - p) : number_len - 1;
+    memcpy(number, p, len);
+    number[len] = '\0';
+    return true;
+}
+
+bool sim7670g_parse_cpsi(const char* line, sim7670g_cell_t* cell)
+{
+    if (strncmp(line, "+CPSI: ", 7) != 0)
+    {
+        return false;
+    }
+
+    // LTE: LTE,Online,214-07,0x5A1E,187214780,257,EUTRAN-BAND20,6300,5,5,-94,-850,-545,15
+    // GSM: GSM,Online,214-07,0x182d,12401,27 EGSM 900,-64,2110,42-42
+    char copy[160];
+    strncpy(copy, line + 7, sizeof(copy) - 1);
+    copy[sizeof(copy) - 1] = '\0';
+
+    const char* fields[14] = {};
+    int count = 0;
+    for (char* p = copy; p && count < 14; count++)
+    {
+        fields[count] = p;
+        p = strchr(p, ',');
+        if (p)
+        {
+            *p++ = '\0';
+        }
+    }
+    if (count < 5)
+    {
+        return false;
+    }
+
+    bool lte = strcmp(fields[0], "LTE") == 0;
+    if (!lte && strcmp(fields[0], "GSM") != 0)
+    {
+        return false;       // NO SERVICE, or a RAT this modem does not report
+    }
+
+    unsigned mcc, mnc;
+    char* end;
+    if (sscanf(fields[2], "%u-%u", &mcc, &mnc) != 2 || mcc > 999 || mnc > 999)
+    {
+        return false;
+    }
+    uint32_t area = strtoul(fields[3], &end, 16);
+    if (end == fields[3] || area > 0xFFFF)
+    {
+        return false;
+    }
+    uint32_t cell_id = strtoul(fields[4], &end, 10);
+    if (end == fields[4] || cell_id >= (1u << 28))
+    {
+        return false;
+    }
+
+    cell->lte = lte;
+    cell->mcc = mcc;
+    cell->mnc = mnc;
+    cell->area = area;
+    cell->cell_id = cell_id;
+
+    // RSRP comes in tenths of a dBm
+    cell->signal_dbm = 0;
+    if (lte && count > 11)
+    {
+        cell->signal_dbm = (int16_t)(atoi(fields[11]) / 10);
+    }
+    else if (!lte && count > 6)
+    {
+        cell->signal_dbm = (int16_t)atoi(fields[6]);
+    }
+    return true;
+}
+
+bool sim7670g_batch_append(char* line, int* len, int size, const char* cmd)
+{
+    // After the first command only the part behind "AT" is added
+    const char* body = *len ? cmd + 2 : cmd;
+    int body_len = (int)strlen(body);
+    int needed = *len ? *len + 1 + body_len : body_len;
+    if (needed > size - 3)
+    {
+        return false;
+    }
+
+    if (*len)
+    {
+        line[(*len)++] = ';';
+    }
+    memcpy(line + *len, body, body_len + 1);
+    *len += body_len;
+    return true;
+}
@@ -0,0 +1,71 @@
+#ifndef SIM7670G_PARSE_H
+#define SIM7670G_PARSE_H
+
+#include <stdint.h>
+
+/**
+ * Parsers for SIM7670G responses that run on every poll or fix.
+ *
+ * Pure logic with no SDK dependency, so the host tools can time them
+ * against recorded modem output (tools/hotpath_bench).
+ */
+
+// +CGPSINFO: <lat>,<N/S>,<lon>,<E/W>,... -> decimal degrees; false without a fix
+bool sim7670g_parse_cgpsinfo(const char* line, double* lat, double* lon);
+
+// +CGPSINFO: ...,<ddmmyy>,<hhmmss.s>,... -> Unix time (UTC); false without a fix
+bool sim7670g_parse_cgpsinfo_utc(const char* line, uint32_t* unix_s);
+
+// +CCLK: "yy/MM/dd,hh:mm:ss±zz" (local time, zz in quarter hours) -> Unix time
+// (UTC); false if the modem clock was never set from the network
+bool sim7670g_parse_cclk(const char* line, uint32_t* unix_s);
+
+// PDP context the driver activates (AT+CGDCONT=1, AT+CGACT=1,1)
+#define SIM7670G_PDP_CID 1
+
+// Data link steps; sim7670g_connect() repeats the ones that are false
+struct sim7670g_link_t
+{
+    bool cs_registered;        // last +CREG
+    bool eps_registered;       // last +CEREG
+    bool network_registered;   // either of the two: in LTE +CREG may stay unregistered
+    bool gprs_attached;
+    bool pdp_active;
+    bool http_ready;
+};
+
+// Apply +CREG/+CEREG/+CGEV to 'link'. True if the URC took the data path
+// down (the HTTP/TLS service does not survive it); other lines are ignored
+bool sim7670g_parse_link_urc(const char* line, sim7670g_link_t* link);
+
+// +HTTPREAD: <n> or +HTTPREAD: DATA,<n> -> n (0 closes the read); -1 for any other line
+int sim7670g_parse_httpread(const char* line);
+
+// +CMTI: "<mem>",<index> (new SMS stored) -> index; -1 for any other line
+int sim7670g_parse_cmti(const char* line);
+
+// +CMGL: <index>,... (one line per stored SMS) -> index; -1 for any other line
+int sim7670g_parse_cmgl(const char* line);
+
+// +CMGR: "<stat>","<number>",... -> sender number; false for any other line
+bool sim7670g_parse_cmgr(const char* line, char* number, int number_len);
+
+// Serving cell reported by AT+CPSI?
+struct sim7670g_cell_t
+{
+    bool lte;                  // LTE (TAC, E-UTRAN cell id) or GSM (LAC, CI)
+    uint16_t mcc;
+    uint16_t mnc;
+    uint32_t area;             // TAC or LAC
+    uint32_t cell_id;
+    int16_t signal_dbm;        // RSRP (LTE) or RxLev (GSM), 0 if not reported
+};
+
+// +CPSI: <mode>,<op>,<mcc>-<mnc>,0x<area>,<cell id>,... -> serving cell; false without service
+bool sim7670g_parse_cpsi(const char* line, sim7670g_cell_t* cell);
+
+// Append "AT+X" to a batch line: whole if the line is empty, as ";+X" after it.
+// false (line unchanged) if it would not fit in 'size' with the CRLF
+bool sim7670g_batch_append(char* line, int* len, int size, const char* cmd);
+
+#endif // SIM7670G_PARSE_H
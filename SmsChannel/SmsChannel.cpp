@@ -0,0 +1,160 @@
+#include "SmsChannel.h"
+#include <cstdio>
+#include "pico/stdlib.h"
+
+static uint32_t now_ms()
+{
+    return to_ms_since_boot(get_absolute_time());
+}
+
+SmsChannel::SmsChannel(ModemArbiter & arbiter, const char* authorized_numbers)
+    : arbiter(arbiter),
+      inbox(),
+      ready(false),
+      last_sweep_ms(0)
+{
+    inbox.authorize(authorized_numbers);
+
+    // Se ejecuta dentro de cualquier intercambio AT: solo encolar
+    arbiter.modem().sim7670g_add_urc_handler([this](const char* line)
+    {
+        if (ready && inbox.onUrc(line, now_ms()))
+        {
+            printf("[SmsChannel] New SMS announced (%d pending)\n", inbox.pending());
+            // A long poll in progress stops waiting, the command runs next pass
+            this->arbiter.requestYield();
+        }
+    });
+}
+
+SmsChannel::~SmsChannel()
+{
+}
+
+bool SmsChannel::begin()
+{
+    ready = arbiter.execute("smsInit", MODEM_PRIORITY_NORMAL, [this](Sim7670G & sim7670g)
+    {
+        uint32_t deadline = sim7670g_deadline(2 * SIM7670G_CMD_TIMEOUT);
+        if (!sim7670g.sim7670g_sms_init(deadline))
+        {
+            return false;
+        }
+
+        // Llegados con el Pico apagado o antes de activar +CMTI
+        queueStored(sim7670g, deadline);
+        return true;
+    });
+    last_sweep_ms = now_ms();
+
+    printf("[SmsChannel] %s, %d authorized numbers\n",
+           ready ? "Ready" : "❌ Init failed", inbox.authorizedCount());
+    return ready;
+}
+
+void SmsChannel::onCommand(CommandCallback callback)
+{
+    command_callback = callback;
+}
+
+int SmsChannel::queueStored(Sim7670G & sim7670g, uint32_t deadline)
+{
+    int indexes[SMS_MAX_PENDING];
+    int stored = sim7670g.sim7670g_sms_list(indexes, SMS_MAX_PENDING, deadline);
+    uint32_t now = now_ms();
+    for (int i = 0; i < stored; i++)
+    {
+        inbox.queue(indexes[i], now);
+    }
+    if (stored > 0)
+    {
+        printf("[SmsChannel] %d SMS stored on the SIM\n", stored);
+    }
+    return stored;
+}
+
+void SmsChannel::loop()
+{
+    // +CMTI perdido, lectura fallida o cola llena: siguen en la SIM
+    if (ready && now_ms() - last_sweep_ms >= SMS_SWEEP_INTERVAL_MS)
+    {
+        last_sweep_ms = now_ms();
+        arbiter.execute("smsList", MODEM_PRIORITY_NORMAL, [this](Sim7670G & sim7670g)
+        {
+            return queueStored(sim7670g, sim7670g_deadline(SIM7670G_CMD_TIMEOUT)) >= 0;
+        });
+    }
+
+    while (inbox.pending() > 0)
+    {
+        int index = inbox.peek();
+        char number[SMS_NUMBER_MAX];
+        char text[SMS_TEXT_MAX * SMS_MAX_PARTS + 1];
+
+        // Leer y borrar en la misma transacción: la SIM solo guarda unos pocos.
+        // Si la lectura falla el SMS se queda en la SIM para el barrido AT+CMGL
+        bool read = arbiter.execute("smsRead", MODEM_PRIORITY_URGENT,
+            [index, &number, &text](Sim7670G & sim7670g)
+            {
+                if (!sim7670g.sim7670g_sms_read(index, number, sizeof(number), text, sizeof(text),
+                                                sim7670g_deadline(SIM7670G_CMD_TIMEOUT)))
+                {
+                    return false;
+                }
+                sim7670g.sim7670g_sms_delete(index, sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
+                return true;
+            });
+
+        if (!read)
+        {
+            printf("[SmsChannel] ❌ SMS %d not read, left on the SIM\n", index);
+            inbox.drop();
+            continue;
+        }
+
+        // El handler puede responder con send(): fuera de la transacción
+        if (!inbox.take(number, now_ms()))
+        {
+            printf("[Warning] SMS from unauthorized number: %s\n", number);
+            continue;
+        }
+
+        printf("[SmsChannel] Command from %s after %u ms: %s\n",
+               number, inbox.stats().last_latency_ms, text);
+        if (command_callback)
+        {
+            command_callback(number, text);
+        }
+    }
+}
+
+bool SmsChannel::send(const char* number, const char* text)
+{
+    char parts[SMS_MAX_PARTS][SMS_TEXT_MAX + 1];
+    int count = SmsInbox::split(text, parts, SMS_MAX_PARTS);
+
+    bool ok = true;
+    for (int i = 0; i < count && ok; i++)
+    {
+        const char* part = parts[i];
+        ok = arbiter.execute("smsSend", MODEM_PRIORITY_URGENT,
+            [number, part](Sim7670G & sim7670g)
+            {
+                return sim7670g.sim7670g_sms_send(number, part, sim7670g_deadline(SIM7670G_SMS_TIMEOUT));
+            });
+        if (ok)
+        {
+            inbox.recordReply();
+        }
+    }
+    return ok;
+}
+
+int SmsChannel::format(char* buffer, size_t len) const
+{
+    const SmsStats& sms = inbox.stats();
+    return snprintf(buffer, len, "SMS: %u comandos, %u rechazados, %u respuestas, %u ms medio / %u ms máx\n",
+                    sms.commands, sms.rejected, sms.replies,
+                    sms.commands ? (uint32_t)(sms.total_latency_ms / sms.commands) : 0,
+                    sms.max_latency_ms);
+}
@@ -0,0 +1,65 @@
+#ifndef SMS_CHANNEL_H
+#define SMS_CHANNEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include "ModemArbiter.h"
+#include "SmsInbox.h"
+
+// AT+CMGL sweep for messages left on the SIM
+#define SMS_SWEEP_INTERVAL_MS (5u * 60u * 1000u)
+
+/**
+ * Command channel over SMS.
+ *
+ * The modem announces every new SMS with a +CMTI URC as soon as it is
+ * stored, so a command does not wait for the next Telegram poll. The URC
+ * handler only queues the index; loop() reads (AT+CMGR) and deletes
+ * (AT+CMGD) each message in one urgent transaction and hands authorized
+ * ones to the command handler, which replies with send().
+ *
+ * A +CMTI that arrives while no AT exchange is listening, a read that
+ * fails and a full queue all leave the message on the SIM; loop() lists
+ * the SIM (AT+CMGL) every SMS_SWEEP_INTERVAL_MS and queues what it finds.
+ */
+class SmsChannel
+{
+public:
+    using CommandCallback = std::function<void(const char* number, const char* text)>;
+
+    // Comma-separated list of numbers allowed to send commands
+    SmsChannel(ModemArbiter & arbiter, const char* authorized_numbers);
+    ~SmsChannel();
+
+    // Modo texto, avisos +CMTI y mensajes ya guardados en la SIM
+    bool begin();
+
+    // Registrar callback para comandos recibidos
+    void onCommand(CommandCallback callback);
+
+    // Leer y procesar los SMS avisados (llamar en bucle principal)
+    void loop();
+
+    // Responder por SMS; textos largos van en varios mensajes
+    bool send(const char* number, const char* text);
+
+    bool hasPending() const { return inbox.pending() > 0; }
+
+    const SmsStats& stats() const { return inbox.stats(); }
+
+    // Human-readable summary
+    int format(char* buffer, size_t len) const;
+
+private:
+    ModemArbiter & arbiter;
+    SmsInbox inbox;
+    CommandCallback command_callback;
+    bool ready;
+    uint32_t last_sweep_ms;
+
+    // AT+CMGL -> inbox; number of messages on the SIM or -1
+    int queueStored(Sim7670G & sim7670g, uint32_t deadline);
+};
+
+#endif // SMS_CHANNEL_H
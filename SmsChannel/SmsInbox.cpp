@@ -0,0 +1,250 @@
+#include "SmsInbox.h"
+#include <cstring>
+#include "sim7670g_parse.h"
+
+// Latin-1 supplement (U+00C0..U+00FF, UTF-8 C3 80..C3 BF) without accents
+static const char latin1_ascii[] =
+    "AAAAAAACEEEEIIII" "DNOOOOOxOUUUUYTs"
+    "aaaaaaaceeeeiiii" "dnooooo/ouuuuyty";
+
+SmsInbox::SmsInbox()
+    : head(0),
+      count(0),
+      number_count(0),
+      sms_stats()
+{
+}
+
+void SmsInbox::normalize(const char* number, char* out, int out_len)
+{
+    // Digits only; 00 prefix = +
+    int pos = 0;
+    if (number[0] == '0' && number[1] == '0')
+    {
+        number += 2;
+    }
+    for (; *number && pos < out_len - 1; number++)
+    {
+        if (*number >= '0' && *number <= '9')
+        {
+            out[pos++] = *number;
+        }
+    }
+    out[pos] = '\0';
+}
+
+void SmsInbox::authorize(const char* list)
+{
+    number_count = 0;
+    while (list && *list && number_count < SMS_MAX_NUMBERS)
+    {
+        const char* end = strchr(list, ',');
+        int len = end ? (int)(end - list) : (int)strlen(list);
+
+        char number[SMS_NUMBER_MAX];
+        if (len >= (int)sizeof(number))
+        {
+            len = sizeof(number) - 1;
+        }
+        memcpy(number, list, len);
+        number[len] = '\0';
+
+        normalize(number, numbers[number_count], SMS_NUMBER_MAX);
+        if (numbers[number_count][0] != '\0')
+        {
+            number_count++;
+        }
+        list = end ? end + 1 : nullptr;
+    }
+}
+
+bool SmsInbox::isAuthorized(const char* number) const
+{
+    char sender[SMS_NUMBER_MAX];
+    normalize(number, sender, sizeof(sender));
+    size_t sender_len = strlen(sender);
+    if (sender_len == 0)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < number_count; i++)
+    {
+        // Same number with or without the country code: the shorter one is
+        // a national number (at least 9 digits) at the end of the longer one
+        const char* allowed = numbers[i];
+        size_t allowed_len = strlen(allowed);
+        size_t shorter = sender_len < allowed_len ? sender_len : allowed_len;
+        if (shorter != sender_len && shorter != allowed_len)
+        {
+            continue;
+        }
+        if ((sender_len == allowed_len || shorter >= 9) &&
+            strcmp(sender + sender_len - shorter, allowed + allowed_len - shorter) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SmsInbox::onUrc(const char* line, uint32_t now_ms)
+{
+    int index = sim7670g_parse_cmti(line);
+    return index >= 0 && queue(index, now_ms);
+}
+
+bool SmsInbox::queue(int index, uint32_t now_ms)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (entries[(head + i) % SMS_MAX_PENDING].index == index)
+        {
+            return true;
+        }
+    }
+
+    if (count == SMS_MAX_PENDING)
+    {
+        sms_stats.dropped++;
+        return false;
+    }
+
+    entries[(head + count) % SMS_MAX_PENDING] = {index, now_ms};
+    count++;
+    return true;
+}
+
+int SmsInbox::peek() const
+{
+    return count > 0 ? entries[head].index : -1;
+}
+
+bool SmsInbox::take(const char* number, uint32_t now_ms)
+{
+    if (count == 0)
+    {
+        return false;
+    }
+
+    uint32_t arrival = entries[head].arrival_ms;
+    drop();
+    sms_stats.received++;
+
+    if (!isAuthorized(number))
+    {
+        sms_stats.rejected++;
+        return false;
+    }
+
+    uint32_t latency = now_ms - arrival;
+    sms_stats.commands++;
+    sms_stats.last_latency_ms = latency;
+    sms_stats.total_latency_ms += latency;
+    if (latency > sms_stats.max_latency_ms)
+    {
+        sms_stats.max_latency_ms = latency;
+    }
+    return true;
+}
+
+void SmsInbox::drop()
+{
+    if (count > 0)
+    {
+        head = (head + 1) % SMS_MAX_PENDING;
+        count--;
+    }
+}
+
+int SmsInbox::split(const char* text, char parts[][SMS_TEXT_MAX + 1], int max_parts)
+{
+    if (max_parts > SMS_MAX_PARTS)
+    {
+        max_parts = SMS_MAX_PARTS;
+    }
+
+    // UTF-8 -> ASCII, the modem is in IRA mode
+    char ascii[SMS_TEXT_MAX * SMS_MAX_PARTS + 1];
+    int len = 0;
+    const int room = SMS_TEXT_MAX * max_parts;
+    for (const uint8_t* p = (const uint8_t*)text; *p && len < room; )
+    {
+        const char* out = "?";
+        int in = 1;
+
+        if (*p < 0x80)
+        {
+            ascii[len++] = *p++;
+            continue;
+        }
+        if (p[0] == 0xC3 && p[1] >= 0x80 && p[1] <= 0xBF)
+        {
+            ascii[len++] = latin1_ascii[p[1] - 0x80];
+            p += 2;
+            continue;
+        }
+        if (p[0] == 0xC2 && p[1] >= 0x80 && p[1] <= 0xBF)
+        {
+            in = 2;
+            out = p[1] == 0xA1 ? "!" : p[1] == 0xBF ? "?" : p[1] == 0xB1 ? "+/-" :
+                  (p[1] == 0xB0 || p[1] == 0xBA) ? "o" : p[1] == 0xAA ? "a" : "";
+        }
+        else
+        {
+            // Symbols and emoji have no ASCII form: skip the whole sequence
+            in = *p >= 0xF0 ? 4 : *p >= 0xE0 ? 3 : 2;
+            out = "";
+        }
+
+        for (; *out && len < room; out++)
+        {
+            ascii[len++] = *out;
+        }
+        for (int i = 0; i < in && *p; i++)
+        {
+            p++;
+        }
+    }
+
+    // Cut at the last line end that fits
+    int count = 0;
+    int pos = 0;
+    while (pos < len && count < max_parts)
+    {
+        while (pos < len && (ascii[pos] == '\n' || ascii[pos] == ' '))
+        {
+            pos++;
+        }
+        if (pos == len)
+        {
+            break;
+        }
+
+        int take = len - pos;
+        int next = len;
+        if (take > SMS_TEXT_MAX)
+        {
+            take = SMS_TEXT_MAX;
+            for (int i = SMS_TEXT_MAX; i > 0; i--)
+            {
+                if (ascii[pos + i] == '\n')
+                {
+                    take = i;
+                    break;
+                }
+            }
+            next = pos + take;
+        }
+
+        while (take > 0 && ascii[pos + take - 1] == '\n')
+        {
+            take--;
+        }
+        memcpy(parts[count], ascii + pos, take);
+        parts[count][take] = '\0';
+        count++;
+        pos = next;
+    }
+    return count;
+}
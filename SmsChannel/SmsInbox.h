@@ -0,0 +1,90 @@
+#ifndef SMS_INBOX_H
+#define SMS_INBOX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Messages announced by +CMTI and not read yet
+#define SMS_MAX_PENDING 8
+
+// Authorized sender numbers
+#define SMS_MAX_NUMBERS 4
+#define SMS_NUMBER_MAX 24
+
+// One GSM 7-bit SMS; longer replies are cut into SMS_MAX_PARTS messages
+#define SMS_TEXT_MAX 160
+#define SMS_MAX_PARTS 3
+
+struct SmsStats
+{
+    uint32_t received;          // read from the SIM
+    uint32_t rejected;          // sender not authorized
+    uint32_t dropped;           // queue full, left on the SIM for the sweep
+    uint32_t commands;          // handed to the command handler
+    uint32_t replies;           // SMS sent
+    uint32_t last_latency_ms;   // +CMTI -> handler
+    uint32_t max_latency_ms;
+    uint64_t total_latency_ms;
+};
+
+/**
+ * Queue of incoming SMS and sender authorization.
+ *
+ * +CMTI URCs arrive in the middle of other AT exchanges, so onUrc() only
+ * records the storage index and the time; the message is read later from
+ * SmsChannel::loop(). Pure logic with no SDK dependency: every call takes
+ * the current time, so modem transcripts can be replayed on the host
+ * (tools/sms_replay).
+ */
+class SmsInbox
+{
+public:
+    SmsInbox();
+
+    // Comma-separated numbers, e.g. "+34600111222,600333444"
+    void authorize(const char* numbers);
+    bool isAuthorized(const char* number) const;
+    int authorizedCount() const { return number_count; }
+
+    // +CMTI line -> queued; any other line is ignored
+    bool onUrc(const char* line, uint32_t now_ms);
+
+    // Messages already on the SIM (AT+CMGL at startup)
+    bool queue(int index, uint32_t now_ms);
+
+    int pending() const { return count; }
+
+    // Oldest queued index, -1 if none
+    int peek() const;
+
+    // Oldest message was read: drop it from the queue, count it and check the sender
+    bool take(const char* number, uint32_t now_ms);
+
+    // Oldest message could not be read
+    void drop();
+
+    void recordReply() { sms_stats.replies++; }
+
+    const SmsStats& stats() const { return sms_stats; }
+
+    // Reply text -> ASCII parts of at most SMS_TEXT_MAX chars, cut at line ends
+    static int split(const char* text, char parts[][SMS_TEXT_MAX + 1], int max_parts);
+
+private:
+    struct Entry
+    {
+        int index;
+        uint32_t arrival_ms;
+    };
+
+    Entry entries[SMS_MAX_PENDING];
+    int head;
+    int count;
+    char numbers[SMS_MAX_NUMBERS][SMS_NUMBER_MAX];
+    int number_count;
+    SmsStats sms_stats;
+
+    static void normalize(const char* number, char* out, int out_len);
+};
+
+#endif // SMS_INBOX_H
@@ -0,0 +1,140 @@
+#include "TelegramAdmission.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static uint32_t hash_chat(int64_t chat_id)
+{
+    // Fibonacci hashing; group ids are negative, only the bits matter
+    uint64_t h = (uint64_t)chat_id * 0x9E3779B97F4A7C15ULL;
+    return (uint32_t)(h >> 32);
+}
+
+TelegramAdmission::TelegramAdmission()
+    : chats(),
+      chat_buckets(),
+      chat_count(0),
+      restricted(false),
+      global_bucket(),
+      admission_stats()
+{
+    global_bucket.credit_ms = TELEGRAM_GLOBAL_BURST * TELEGRAM_GLOBAL_REFILL_MS;
+}
+
+void TelegramAdmission::allow(const char* list)
+{
+    memset(chats, 0, sizeof(chats));
+    chat_count = 0;
+    restricted = true;
+
+    while (list && *list)
+    {
+        char* end;
+        int64_t chat_id = strtoll(list, &end, 10);
+        if (chat_id != 0 && find_slot(chat_id) < 0 && chat_count == TELEGRAM_MAX_ALLOWED_CHATS)
+        {
+            // Full table: this chat would be silently locked out otherwise
+            printf("[TelegramAdmission] ❌ More than %d allowed chats, %lld ignored\n", 
+                   TELEGRAM_MAX_ALLOWED_CHATS, (long long)chat_id);
+        }
+        else if (chat_id != 0 && find_slot(chat_id) < 0)
+        {
+            // Linear probing; half the slots stay free, so the probe always ends
+            uint32_t slot = hash_chat(chat_id) % SLOTS;
+            while (chats[slot] != 0)
+            {
+                slot = (slot + 1) % SLOTS;
+            }
+            chats[slot] = chat_id;
+            chat_buckets[slot].credit_ms = TELEGRAM_CHAT_BURST * TELEGRAM_CHAT_REFILL_MS;
+            chat_buckets[slot].last_ms = 0;
+            chat_count++;
+        }
+
+        const char* comma = strchr(end, ',');
+        list = comma ? comma + 1 : nullptr;
+    }
+}
+
+int TelegramAdmission::find_slot(int64_t chat_id) const
+{
+    uint32_t slot = hash_chat(chat_id) % SLOTS;
+    for (int probe = 0; probe < SLOTS && chats[slot] != 0; probe++)
+    {
+        if (chats[slot] == chat_id)
+        {
+            return (int)slot;
+        }
+        slot = (slot + 1) % SLOTS;
+    }
+    return -1;
+}
+
+bool TelegramAdmission::isAllowed(int64_t chat_id) const
+{
+    return !restricted || find_slot(chat_id) >= 0;
+}
+
+void TelegramAdmission::fill(Bucket& bucket, uint32_t burst, uint32_t refill_ms, uint32_t now_ms)
+{
+    uint32_t full = burst * refill_ms;
+    uint32_t elapsed = now_ms - bucket.last_ms;
+    bucket.last_ms = now_ms;
+    bucket.credit_ms = (full - bucket.credit_ms <= elapsed) ? full : bucket.credit_ms + elapsed;
+}
+
+bool TelegramAdmission::take(Bucket& bucket, uint32_t burst, uint32_t refill_ms, uint32_t now_ms)
+{
+    fill(bucket, burst, refill_ms, now_ms);
+    if (bucket.credit_ms < refill_ms)
+    {
+        return false;
+    }
+    bucket.credit_ms -= refill_ms;
+    return true;
+}
+
+TelegramVerdict TelegramAdmission::admit(int64_t chat_id, uint32_t now_ms)
+{
+    if (chat_id == 0)
+    {
+        return TELEGRAM_ADMIT;
+    }
+
+    // Without an allow-list there are no chat buckets, only the global one
+    Bucket* chat_bucket = nullptr;
+    if (restricted)
+    {
+        int slot = find_slot(chat_id);
+        if (slot < 0)
+        {
+            admission_stats.unknown++;
+            return TELEGRAM_DROP_UNKNOWN;
+        }
+        chat_bucket = &chat_buckets[slot];
+    }
+
+    // Both buckets must have a token; refill first so neither is charged alone
+    fill(global_bucket, TELEGRAM_GLOBAL_BURST, TELEGRAM_GLOBAL_REFILL_MS, now_ms);
+    if (chat_bucket)
+    {
+        fill(*chat_bucket, TELEGRAM_CHAT_BURST, TELEGRAM_CHAT_REFILL_MS, now_ms);
+        if (chat_bucket->credit_ms < TELEGRAM_CHAT_REFILL_MS)
+        {
+            admission_stats.chat_rate++;
+            return TELEGRAM_DROP_CHAT_RATE;
+        }
+    }
+    if (!take(global_bucket, TELEGRAM_GLOBAL_BURST, TELEGRAM_GLOBAL_REFILL_MS, now_ms))
+    {
+        admission_stats.global_rate++;
+        return TELEGRAM_DROP_GLOBAL_RATE;
+    }
+    if (chat_bucket)
+    {
+        chat_bucket->credit_ms -= TELEGRAM_CHAT_REFILL_MS;
+    }
+
+    admission_stats.admitted++;
+    return TELEGRAM_ADMIT;
+}
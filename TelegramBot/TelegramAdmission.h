@@ -0,0 +1,80 @@
+#ifndef TELEGRAM_ADMISSION_H
+#define TELEGRAM_ADMISSION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Chats in the allow-list (TELEGRAM_AUTORIZED_USERS); the table has twice the slots
+#define TELEGRAM_MAX_ALLOWED_CHATS 8
+
+// Per chat: a burst of 5 updates, then one every 6 s
+#define TELEGRAM_CHAT_BURST 5
+#define TELEGRAM_CHAT_REFILL_MS 6000
+
+// All chats together: a burst of 10 updates, then one every 2 s
+#define TELEGRAM_GLOBAL_BURST 10
+#define TELEGRAM_GLOBAL_REFILL_MS 2000
+
+enum TelegramVerdict
+{
+    TELEGRAM_ADMIT,
+    TELEGRAM_DROP_UNKNOWN,       // chat not in the allow-list
+    TELEGRAM_DROP_CHAT_RATE,     // chat over its own rate
+    TELEGRAM_DROP_GLOBAL_RATE,   // every chat together over the global rate
+};
+
+struct TelegramAdmissionStats
+{
+    uint32_t admitted;
+    uint32_t unknown;
+    uint32_t chat_rate;
+    uint32_t global_rate;
+};
+
+/**
+ * Decides which updates reach the message handler, before they are copied
+ * or parsed. Chats are looked up in a small open-addressed hash set, then
+ * pay one token from their own bucket and one from the global bucket.
+ * Updates without a message (chat_id 0) are admitted: they carry nothing to
+ * handle and only move the offset. Without an allow-list only the global
+ * rate applies. Pure logic with no SDK dependency: every
+ * call takes the current time, so it can be flooded on the host
+ * (tools/admission_bench).
+ */
+class TelegramAdmission
+{
+public:
+    TelegramAdmission();
+
+    // Comma-separated chat ids; until called every chat is allowed
+    void allow(const char* chat_ids);
+    bool isAllowed(int64_t chat_id) const;
+    int allowedCount() const { return chat_count; }
+
+    TelegramVerdict admit(int64_t chat_id, uint32_t now_ms);
+
+    const TelegramAdmissionStats& stats() const { return admission_stats; }
+
+private:
+    static const int SLOTS = 2 * TELEGRAM_MAX_ALLOWED_CHATS;
+
+    // Credit in ms of refill time: one token is worth refill_ms
+    struct Bucket
+    {
+        uint32_t credit_ms;
+        uint32_t last_ms;
+    };
+
+    int64_t chats[SLOTS];            // 0 = free slot
+    Bucket chat_buckets[SLOTS];
+    int chat_count;
+    bool restricted;
+    Bucket global_bucket;
+    TelegramAdmissionStats admission_stats;
+
+    int find_slot(int64_t chat_id) const;
+    static bool take(Bucket& bucket, uint32_t burst, uint32_t refill_ms, uint32_t now_ms);
+    static void fill(Bucket& bucket, uint32_t burst, uint32_t refill_ms, uint32_t now_ms);
+};
+
+#endif // TELEGRAM_ADMISSION_H
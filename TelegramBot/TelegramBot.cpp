@@ -1,14 +1,33 @@
 #include "TelegramBot.h"
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include "pico/stdlib.h"
+#include "TextScan.h"
 
-TelegramBot::TelegramBot(const char* bot_token, Sim7670G & sim7670g) 
+// Deadline of one API request; a new TLS session adds its handshake to the budget
+static uint32_t request_deadline(Sim7670G & sim7670g, uint32_t timeout_ms)
+{
+    return sim7670g_deadline(timeout_ms + (sim7670g.sim7670g_ssl_is_open() ? 0 : SIM7670G_SSL_OPEN_TIMEOUT));
+}
+
+TelegramBot::TelegramBot(const char* bot_token, ModemArbiter & arbiter) 
     : bot_token(bot_token), 
-      sim7670g(sim7670g),
+      arbiter(arbiter),
+      telegram_api(TELEGRAM_API_HOST),
+      persistent_connection(false),
+      last_via_socket(false),
+      data_budget(nullptr),
       last_update_id(0),
       last_poll_time(0),
-      waiting_response(false)
+      poll_interval(0),
+      waiting_response(false),
+      poll_transaction(0),
+      retry_transaction(0),
+      next_retry_time(0),
+      retry_delay(TELEGRAM_RETRY_MIN_MS),
+      telegram_stats(),
+      update_stream(RX_BUFFER_SIZE, TELEGRAM_MAX_PENDING_UPDATES)
 {
 }
 
@@ -24,35 +43,274 @@ bool TelegramBot::sendMessage(const char* chat_id, const char* text)
         return false;
     }
 
+    if (post_message(chat_id, text))
+    {
+        return true;
+    }
+
+    queue_retry(chat_id, text);
+    return false;
+}
+
+void TelegramBot::queue_retry(const char* chat_id, const char* text) 
+{
+    // add to message queue for retry later
+    if (message_queue.empty())
+    {
+        next_retry_time = to_ms_since_boot(get_absolute_time()) + retry_delay;
+    }
+    message_queue.push({chat_id, text});
+}
+
+// One broadcast, shared by the transactions of its recipients
+struct TelegramBot::Broadcast
+{
+    std::string text;                          // original text, for the retry queue
+    std::string text_json;                     // "text" escaped once
+    char path[256];
+    std::vector<TelegramDelivery> deliveries;
+    size_t next;                               // recipient of the next transaction
+    int delivered;
+    uint32_t start_ms;
+    uint32_t target_id;                        // modem HTTP target this broadcast set, 0 = none
+    std::unique_ptr<char[]> response_buffer;
+};
+
+int TelegramBot::broadcast(const std::vector<std::string>& chat_ids, const char* text) 
+{
+    if (!text || chat_ids.empty()) 
+    {
+        printf("[TelegramBot::broadcast] Invalid parameters\n");
+        return 0;
+    }
+
+    std::shared_ptr<Broadcast> state = std::make_shared<Broadcast>();
+    state->text = text;
+    state->next = 0;
+    state->delivered = 0;
+    state->start_ms = to_ms_since_boot(get_absolute_time());
+    state->target_id = 0;
+    state->response_buffer.reset(new char[TX_BUFFER_SIZE]());
+
+    // "text" escapado una sola vez; cada destinatario solo añade su chat_id
+    state->text_json.reserve(JsonWriter::escapedLength(text, strlen(text)));
+    {
+        std::string& text_json = state->text_json;
+        JsonWriter::Sink append = [&text_json](const char* data, int len)
+        {
+            text_json.append(data, len);
+            return true;
+        };
+        char chunk[JSON_WRITER_CHUNK];
+        JsonWriter json(chunk, sizeof(chunk), append);
+        json.value(text);
+        json.finish();
+    }
+
+    snprintf(state->path, sizeof(state->path), "/bot%s/sendMessage", bot_token.c_str());
+
+    for (const std::string& chat_id : chat_ids) 
+    {
+        state->deliveries.push_back({chat_id, false, 0, 0});
+    }
+
+    broadcast_next(state);
+    return state->next < state->deliveries.size() ? (int)state->deliveries.size() : 0;
+}
+
+// Queue the next recipient; it runs after whatever urgent work arrived meanwhile
+void TelegramBot::broadcast_next(const std::shared_ptr<Broadcast>& state) 
+{
+    if (state->next >= state->deliveries.size()) 
+    {
+        broadcast_finish(*state);
+        return;
+    }
+
+    ModemTransaction send = {};
+    send.name = "broadcast";
+    send.priority = MODEM_PRIORITY_URGENT;
+    send.network = true;
+    send.run = [this, state](Sim7670G & sim7670g) { return broadcast_send(sim7670g, *state); };
+    send.done = [this, state](bool)
+    {
+        state->next++;
+        broadcast_next(state);
+    };
+
+    if (arbiter.submit(send) == 0) 
+    {
+        // the rest go to the retry queue
+        state->next = state->deliveries.size();
+        broadcast_finish(*state);
+    }
+}
+
+bool TelegramBot::broadcast_send(Sim7670G & sim7670g, Broadcast& state) 
+{
+    TelegramDelivery& delivery = state.deliveries[state.next];
+    uint32_t sent_at = to_ms_since_boot(get_absolute_time());
+    const char* chat_id = delivery.chat_id.c_str();
+    const std::string& text_json = state.text_json;
+
+    JsonWriter::Render render = [chat_id, &text_json](JsonWriter& json)
+    {
+        json.beginObject()
+            .field("chat_id", chat_id)
+            .key("text").raw(text_json.data(), text_json.size())
+            .endObject();
+    };
+    int json_len = (int)JsonWriter::measure(render);
+
+    // Another transaction may have moved the HTTP target since the previous recipient
+    bool target_ready = state.target_id != 0 && state.target_id == sim7670g.sim7670g_http_target_id();
+
+    while (!delivery.delivered && delivery.attempts < TELEGRAM_BROADCAST_ATTEMPTS) 
+    {
+        delivery.attempts++;
+        delivery.delivered = api_post(sim7670g, state.path, render, json_len, 
+                                      state.response_buffer.get(), TX_BUFFER_SIZE, &target_ready);
+        uint32_t bytes = account(sim7670g, DATA_CLASS_MESSAGE, strlen(state.path) + json_len);
+        telegram_stats.messages.requests++;
+        telegram_stats.messages.bytes += bytes;
+    }
+    state.target_id = target_ready ? sim7670g.sim7670g_http_target_id() : 0;
+
+    delivery.elapsed_ms = to_ms_since_boot(get_absolute_time()) - sent_at;
+    if (delivery.delivered) 
+    {
+        state.delivered++;
+    }
+    return delivery.delivered;
+}
+
+void TelegramBot::broadcast_finish(Broadcast& state) 
+{
+    for (const TelegramDelivery& delivery : state.deliveries) 
+    {
+        printf("[TelegramBot] Broadcast -> %s: %s (%u attempts, %u ms)\n", 
+               delivery.chat_id.c_str(), delivery.delivered ? "ok" : "failed", 
+               delivery.attempts, delivery.elapsed_ms);
+
+        if (!delivery.delivered) 
+        {
+            queue_retry(delivery.chat_id.c_str(), state.text.c_str());
+        }
+    }
+
+    printf("[TelegramBot] Broadcast: %d/%u delivered in %u ms\n", state.delivered, 
+           (unsigned)state.deliveries.size(), to_ms_since_boot(get_absolute_time()) - state.start_ms);
+    deliveries = state.deliveries;
+    state.response_buffer.reset();
+}
+
+bool TelegramBot::post_message(const char* chat_id, const char* text) 
+{
     printf("[TelegramBot] Sending message to chat %s: %s\n", chat_id, text);
 
-    char json_buffer[512];
-    snprintf(json_buffer, sizeof(json_buffer),
-             "{\"chat_id\":\"%s\",\"text\":\"%s\"}",
-             chat_id, text);
+    // El texto se escapa al escribir; el cuerpo nunca existe entero en RAM
+    JsonWriter::Render render = [chat_id, text](JsonWriter& json)
+    {
+        json.beginObject()
+            .field("chat_id", chat_id)
+            .field("text", text)
+            .endObject();
+    };
+    return call_method("sendMessage", render, telegram_stats.messages);
+}
 
-    char url[512];
-    snprintf(url, sizeof(url),
-             "https://api.telegram.org/bot%s/sendMessage",
-             bot_token.c_str());
+bool TelegramBot::sendLocation(const char* chat_id, double lat, double lon, uint32_t live_period_s, 
+                               uint32_t accuracy_m, int32_t* message_id) 
+{
+    JsonWriter::Render render = [=](JsonWriter& json)
+    {
+        json.beginObject()
+            .field("chat_id", chat_id)
+            .key("latitude").value(lat, 6)
+            .key("longitude").value(lon, 6);
+        if (live_period_s > 0) 
+        {
+            json.field("live_period", (int64_t)live_period_s);
+        }
+        if (accuracy_m > 0) 
+        {
+            json.field("horizontal_accuracy", (int64_t)(accuracy_m < 1500 ? accuracy_m : 1500));
+        }
+        json.endObject();
+    };
+    return call_method("sendLocation", render, telegram_stats.locations, message_id);
+}
 
-    printf("[TelegramBot] POST URL: %s\n", url);
-    printf("[TelegramBot] JSON: %s\n", json_buffer);
+bool TelegramBot::editLiveLocation(const char* chat_id, int32_t message_id, double lat, double lon, 
+                                   uint32_t accuracy_m) 
+{
+    JsonWriter::Render render = [=](JsonWriter& json)
+    {
+        json.beginObject()
+            .field("chat_id", chat_id)
+            .field("message_id", (int64_t)message_id)
+            .key("latitude").value(lat, 6)
+            .key("longitude").value(lon, 6);
+        if (accuracy_m > 0) 
+        {
+            json.field("horizontal_accuracy", (int64_t)(accuracy_m < 1500 ? accuracy_m : 1500));
+        }
+        json.endObject();
+    };
+    return call_method("editMessageLiveLocation", render, telegram_stats.edits);
+}
+
+bool TelegramBot::stopLiveLocation(const char* chat_id, int32_t message_id) 
+{
+    JsonWriter::Render render = [=](JsonWriter& json)
+    {
+        json.beginObject()
+            .field("chat_id", chat_id)
+            .field("message_id", (int64_t)message_id)
+            .endObject();
+    };
+    return call_method("stopMessageLiveLocation", render, telegram_stats.edits);
+}
+
+bool TelegramBot::call_method(const char* method, const JsonWriter::Render& render, 
+                              TelegramTraffic& traffic, int32_t* message_id) 
+{
+    int json_len = (int)JsonWriter::measure(render);
+
+    char path[256];
+    snprintf(path, sizeof(path), "/bot%s/%s", bot_token.c_str(), method);
+
+    printf("[TelegramBot] POST %s (%d bytes JSON)\n", method, json_len);
 
     // Llamada síncrona bloqueante con POST
-    char * response_buffer = new char[TX_BUFFER_SIZE];
-    bool ok = false;
-    if (sim7670g.sim7670g_https_post(url, json_buffer, response_buffer, TX_BUFFER_SIZE)) 
+    // Vacío si ninguna ruta llega a leer el cuerpo: message_id no sale de basura
+    char * response_buffer = new char[TX_BUFFER_SIZE]();
+    uint32_t bytes = 0;
+    bool ok = arbiter.execute(method, MODEM_PRIORITY_URGENT, 
+        [&](Sim7670G & sim7670g) 
+        {
+            bool sent = api_post(sim7670g, path, render, json_len, response_buffer, TX_BUFFER_SIZE);
+            bytes = account(sim7670g, DATA_CLASS_MESSAGE, strlen(path) + json_len);
+            return sent;
+        });
+
+    traffic.requests++;
+    traffic.bytes += bytes;
+
+    // {"ok":true,"result":{"message_id":123,...}}
+    if (ok && message_id) 
     {
-        printf("[TelegramBot] ✓ HTTP 200\n");
-        ok = true;
+        *message_id = atoi(telegram_json_field(response_buffer, "\"message_id\"").c_str());
+        ok = *message_id != 0;
+    }
+
+    if (ok) 
+    {
+        printf("[TelegramBot] ✓ HTTP 200, ~%u bytes\n", bytes);
     } 
     else 
     {
         printf("[TelegramBot] ❌ HTTP POST failed\n");
-        
-        // add to message queue for retry later
-        message_queue.push({chat_id, text});
     }
 
     delete [] response_buffer;
@@ -66,7 +324,7 @@ bool TelegramBot::send_queued_messages()
     {
         TelegramMessage msg = message_queue.front();
         
-        if (sendMessage(msg.chat_id.c_str(), msg.text.c_str())) 
+        if (post_message(msg.chat_id.c_str(), msg.text.c_str())) 
         {
             message_queue.pop();
             sleep_ms(500);
@@ -82,7 +340,11 @@ bool TelegramBot::send_queued_messages()
 
 bool TelegramBot::getLocation(double *lat, double *lon) 
 {
-    return sim7670g.sim7670g_gnss_get_location(lat, lon);
+    return arbiter.execute("getLocation", MODEM_PRIORITY_URGENT, 
+        [&](Sim7670G & sim7670g) 
+        {
+            return sim7670g.sim7670g_gnss_get_location(lat, lon, sim7670g_deadline(SIM7670G_GNSS_TIMEOUT));
+        });
 }
 
 bool TelegramBot::enableActiveMode(bool enable) 
@@ -93,89 +355,301 @@ bool TelegramBot::enableActiveMode(bool enable)
     return true;
 }
 
+void TelegramBot::setPersistentConnection(bool enable) 
+{
+    persistent_connection = enable;
+    printf("[TelegramBot] Persistent TLS connection %s\n", enable ? "enabled" : "disabled");
+}
+
+/**
+ * Socket first, then modem HTTP; both share one deadline, so a failed socket
+ * attempt leaves the fallback only what is left of the budget
+ */
+bool TelegramBot::api_get_stream(Sim7670G & sim7670g, const char* path, 
+                                 const Sim7670G::ChunkConsumer& consumer, uint32_t deadline_ms) 
+{
+    last_via_socket = persistent_connection;
+    if (persistent_connection) 
+    {
+        if (telegram_api.getStream(sim7670g, path, consumer, deadline_ms)) 
+        {
+            return true;
+        }
+
+        // Got an HTTP answer: the body may be partly consumed, do not repeat it.
+        // Cut short by the arbiter: the modem is wanted for something else
+        if (telegram_api.lastStatus() != 0 || sim7670g.sim7670g_recv_aborted()) 
+        {
+            return false;
+        }
+        printf("[TelegramBot] Persistent connection failed, using modem HTTP\n");
+        last_via_socket = false;
+    }
+
+    char url[512];
+    snprintf(url, sizeof(url), "https://%s%s", TELEGRAM_API_HOST, path);
+    if (sim7670g.sim7670g_https_get_stream(url, consumer, deadline_ms)) 
+    {
+        return true;
+    }
+    log_timeout(sim7670g);
+    return false;
+}
+
+bool TelegramBot::api_post(Sim7670G & sim7670g, const char* path, const JsonWriter::Render& render, 
+                           int json_len, char* response_buffer, int buffer_len, bool* target_ready) 
+{
+    // Segunda pasada del render: mismos bytes que midió measure()
+    Sim7670G::BodyWriter writer = [&render](const Sim7670G::ChunkConsumer& out)
+    {
+        char chunk[JSON_WRITER_CHUNK];
+        JsonWriter json(chunk, sizeof(chunk), out);
+        render(json);
+        return json.finish();
+    };
+
+    uint32_t deadline = request_deadline(sim7670g, TELEGRAM_POST_TIMEOUT_MS);
+
+    last_via_socket = persistent_connection;
+    if (persistent_connection) 
+    {
+        if (telegram_api.postStream(sim7670g, path, "application/json", json_len, writer, 
+                                    response_buffer, buffer_len, deadline)) 
+        {
+            return true;
+        }
+
+        if (telegram_api.lastStatus() != 0) 
+        {
+            return false;
+        }
+        printf("[TelegramBot] Persistent connection failed, using modem HTTP\n");
+        last_via_socket = false;
+    }
+
+    bool ok;
+    char url[512];
+    snprintf(url, sizeof(url), "https://%s%s", TELEGRAM_API_HOST, path);
+
+    // Mismo destino que la petición anterior del broadcast: solo HTTPDATA + HTTPACTION
+    if (target_ready && *target_ready) 
+    {
+        ok = sim7670g.sim7670g_http_post_body(json_len, writer, response_buffer, buffer_len, deadline);
+    }
+    else if (!target_ready) 
+    {
+        ok = sim7670g.sim7670g_https_post_stream(url, "application/json", json_len, writer, 
+                                                 response_buffer, buffer_len, deadline);
+    }
+    else 
+    {
+        *target_ready = sim7670g.sim7670g_http_set_target(url, "application/json", deadline);
+        ok = *target_ready && 
+             sim7670g.sim7670g_http_post_body(json_len, writer, response_buffer, buffer_len, deadline);
+    }
+
+    if (!ok) 
+    {
+        log_timeout(sim7670g);
+    }
+    return ok;
+}
+
+void TelegramBot::log_timeout(Sim7670G & sim7670g) 
+{
+    sim7670g_stage_t stage = sim7670g.sim7670g_timeout_stage();
+    if (stage != SIM7670G_STAGE_NONE) 
+    {
+        printf("[TelegramBot] ⏱ Request out of time in %s\n", sim7670g_stage_name(stage));
+    }
+}
+
+void TelegramBot::setDataBudget(DataBudget* budget) 
+{
+    data_budget = budget;
+}
+
+uint32_t TelegramBot::account(Sim7670G & sim7670g, DataClass data_class, uint32_t request_bytes) 
+{
+    uint32_t tx_bytes = request_bytes;
+    uint32_t rx_bytes;
+    bool new_tls;
+
+    if (last_via_socket) 
+    {
+        const HttpStats& stats = telegram_api.stats();
+        tx_bytes = stats.last_tx_bytes;
+        rx_bytes = stats.last_rx_bytes;
+        new_tls = stats.last_new_tls;
+    }
+    else 
+    {
+        // The modem HTTP service negotiates TLS on most requests
+        int content_length = sim7670g.sim7670g_last_content_length();
+        rx_bytes = content_length > 0 ? content_length : 0;
+        new_tls = true;
+    }
+
+    if (data_budget) 
+    {
+        data_budget->record(data_class, tx_bytes, rx_bytes, new_tls);
+    }
+    return DataBudget::estimate(tx_bytes, rx_bytes, new_tls);
+}
+
 void TelegramBot::getUpdates() 
 {
     uint32_t current_time = to_ms_since_boot(get_absolute_time());
+    poll_interval = telegramPollInterval;
+
+    if (data_budget) 
+    {
+        uint32_t utc = 0;
+        arbiter.modem().sim7670g_get_utc(&utc);
+        data_budget->tick(current_time, utc);
+        poll_interval = data_budget->pollInterval(telegramPollInterval);
+    }
     
     // Check polling interval
-    if (current_time - last_poll_time < telegramPollInterval) {
+    if (current_time - last_poll_time < poll_interval) {
+        return;
+    }
+
+    // Previous poll still waiting for the modem
+    if (poll_transaction != 0) {
         return;
     }
 
     last_poll_time = current_time;
 
+    if (poll_interval != telegramPollInterval) 
+    {
+        printf("[TelegramBot] Data budget: poll interval stretched to %u ms\n", poll_interval);
+    }
+
+    ModemTransaction poll = {};
+    poll.name = "getUpdates";
+    poll.priority = MODEM_PRIORITY_LOW;
+    poll.deadline_ms = 0;
+    poll.preemptible = true;
+    poll.network = true;
+    poll.run = [this](Sim7670G & sim7670g) { return poll_updates(sim7670g); };
+    poll.done = [this](bool) { poll_transaction = 0; };
+
+    poll_transaction = arbiter.submit(poll);
+}
+
+bool TelegramBot::poll_updates(Sim7670G & sim7670g) 
+{
+    // Long poll only when nobody else is waiting for the modem
+    int poll_timeout = (arbiter.shouldYield() || !message_queue.empty()) ? 0 : 10;
+
     // Construir URL con offset
-    char url[512];
-    snprintf(url, sizeof(url),
-             "https://api.telegram.org/bot%s/getUpdates?offset=%d&timeout=10",
-             bot_token.c_str(), last_update_id + 1);
+    char path[256];
+    snprintf(path, sizeof(path),
+             "/bot%s/getUpdates?offset=%d&timeout=%d&limit=%d",
+             bot_token.c_str(), last_update_id + 1, poll_timeout, TELEGRAM_UPDATES_PER_POLL);
 
-    printf("[TelegramBot] Polling for updates (offset=%d)...\n", last_update_id + 1);
+    printf("[TelegramBot] Polling for updates (offset=%d, timeout=%d)...\n", 
+           last_update_id + 1, poll_timeout);
 
-    // Llamada síncrona bloqueante
-    char * response_buffer = new char[RX_BUFFER_SIZE];
-    if (sim7670g.sim7670g_https_get(url, response_buffer, RX_BUFFER_SIZE)) 
+    // Llamada síncrona bloqueante; cada update se separa en cuanto llega
+    // completa, así un backlog mayor que RX_BUFFER_SIZE no se pierde
+    update_stream.begin([this](int32_t update_id, int64_t chat_id) 
+    {
+        return admit_update(update_id, chat_id);
+    });
+
+    bool ok = api_get_stream(sim7670g, path, 
+        [this](const char* data, int len) 
+        {
+            update_stream.feed(data, len);
+            return true;
+        }, 
+        request_deadline(sim7670g, (poll_timeout + 10) * 1000));
+    account(sim7670g, DATA_CLASS_POLL, strlen(path));
+
+    if (ok) 
     {
         printf("[TelegramBot] ✓ getUpdates HTTP 200\n");
-        std::string data(response_buffer);
-        parse_updates(data);
+        telegram_stats.polls_ok++;
     } 
+    else if (sim7670g.sim7670g_recv_aborted()) 
+    {
+        // Not a network failure: the next poll asks again from the same offset
+        printf("[TelegramBot] getUpdates cut short for more urgent work\n");
+        ok = true;
+    }
     else 
     {
         printf("[TelegramBot] ❌ getUpdates HTTP failed\n");
     }
 
-    delete[] response_buffer;
+    update_stream.end();
+
+    // Dropped updates are never parsed, they only move the offset
+    if (update_stream.dropped() > 0) 
+    {
+        const TelegramAdmissionStats& stats = update_admission.stats();
+        printf("[TelegramBot] Dropped %u updates (total: %u unknown, %u chat rate, %u global rate)\n",
+               update_stream.dropped(), stats.unknown, stats.chat_rate, stats.global_rate);
+    }
+    if (update_stream.droppedUpdateId() > last_update_id) 
+    {
+        last_update_id = update_stream.droppedUpdateId();
+    }
+
+    // Handlers reply through the modem: only once the body has been read
+    for (const std::string& update : update_stream.kept()) 
+    {
+        parse_updates(update);
+    }
+    update_stream.kept().clear();
+    return ok;
 }
 
-void TelegramBot::parse_updates(const std::string& json_response) 
+bool TelegramBot::admit_update(int32_t update_id, int64_t chat_id) 
 {
-    // simple parsing of JSON response to extract updates
-    size_t pos = 0;
-    int32_t max_update_id = last_update_id;
+    TelegramVerdict verdict = update_admission.admit(chat_id, to_ms_since_boot(get_absolute_time()));
+    if (verdict == TELEGRAM_ADMIT) 
+    {
+        return true;
+    }
 
-    printf("[TelegramBot] Parsing updates json=%s\n", json_response.c_str());
-    
-    while ((pos = json_response.find("\"update_id\":", pos)) != std::string::npos) 
+    // Only the first drop of a kind is worth a line; a flood would fill the log
+    const TelegramAdmissionStats& stats = update_admission.stats();
+    uint32_t count = verdict == TELEGRAM_DROP_UNKNOWN ? stats.unknown :
+                     verdict == TELEGRAM_DROP_CHAT_RATE ? stats.chat_rate : stats.global_rate;
+    if (count == 1) 
     {
-        pos += 12; // update_id length
-        int update_id = atoi(json_response.c_str() + pos);
-        
-        if (update_id > max_update_id) 
-        {
-            max_update_id = update_id;
-        }
+        printf("[TelegramBot] ⚠️  Update %d from chat %lld dropped (%s)\n", update_id, (long long)chat_id,
+               verdict == TELEGRAM_DROP_UNKNOWN ? "not allowed" :
+               verdict == TELEGRAM_DROP_CHAT_RATE ? "chat rate" : "global rate");
+    }
+    return false;
+}
 
-        // search for message
-        size_t msg_start = json_response.find("\"message\":", pos);
-        if (msg_start == std::string::npos || msg_start > json_response.find("\"update_id\":", pos + 1)) 
-        {
-            // No message found for this update_id
-            continue;
-        }
+void TelegramBot::allowChats(const char* chat_ids) 
+{
+    update_admission.allow(chat_ids);
+    printf("[TelegramBot] %d chats allowed\n", update_admission.allowedCount());
+}
 
-        // get chat id
-        std::string chat_id = extract_json_field(json_response.substr(msg_start, 500), "\"id\"");
-        
-        // get text
-        std::string text = extract_json_field(json_response.substr(msg_start, 1000), "\"text\"");
-        
-        // get username
-        std::string username = extract_json_field(json_response.substr(msg_start, 500), "\"username\"");
+void TelegramBot::parse_updates(const std::string& json_response) 
+{
+    printf("[TelegramBot] Parsing updates json=%s\n", json_response.c_str());
 
-        if (!chat_id.empty() && !text.empty()) 
+    int32_t max_update_id = telegram_parse_updates(json_response, last_update_id,
+        [this](const std::string& chat_id, const std::string& text, const std::string& username)
         {
             printf("[TelegramBot] New message from @%s (chat_id=%s): %s\n", 
                    username.c_str(), chat_id.c_str(), text.c_str());
-            
+
             if (message_callback) 
             {
                 message_callback(chat_id, text, username);
             }
-        }
-
-        pos++;
-    }
+        });
 
     // update last_update_id
     if (max_update_id > last_update_id) 
@@ -185,85 +659,23 @@ void TelegramBot::parse_updates(const std::string& json_response)
     }
 }
 
-std::string TelegramBot::extract_json_field(const std::string& json, const char* field) 
+void TelegramBot::onMessage(MessageCallback callback) 
 {
-    size_t field_pos = json.find(field);
-    if (field_pos == std::string::npos) 
-    {
-        return "";
-    }
-
-    // find the value start
-    size_t value_start = json.find(':', field_pos);
-    if (value_start == std::string::npos) 
-    {
-        return "";
-    }
-    value_start++;
-
-    // skip spaces
-    while (value_start < json.length() && (json[value_start] == ' ' || json[value_start] == '\t')) 
-    {
-        value_start++;
-    }
+    message_callback = callback;
+}
 
-    // The strings are enclosed in quotes
-    // Handle string values enclosed in quotes
-    if (json[value_start] == '"') 
-    {
-        value_start++; // Skip the opening quote
-        std::string value;
-        bool escape = false;
+uint32_t TelegramBot::nextWakeTime() const
+{
+    uint32_t next_poll = last_poll_time + poll_interval;
 
-        for (size_t i = value_start; i < json.length(); i++) 
-        {
-            char c = json[i];
-            if (escape) 
-            {
-                // Handle escaped characters
-                value += c;
-                escape = false;
-            } 
-            else if (c == '\\') 
-            {
-                // Escape the next character
-                escape = true;
-            } 
-            else if (c == '"') 
-            {
-                // End of the string
-                printf("[TelegramBot] Extracted field %s: %s\n", field, value.c_str());
-                return value;
-            } 
-            else 
-            {
-                value += c;
-            }
-        }
-        printf("[TelegramBot] unexpected end!\n");
-        return ""; // Unterminated string
-    }
-    
-    // For numeric values
-    size_t value_end = json.find_first_of(",}", value_start);
-    if (value_end == std::string::npos) 
+    // Queued messages waiting for their next retry
+    if (!message_queue.empty() && retry_transaction == 0 &&
+        (int32_t)(next_retry_time - next_poll) < 0)
     {
-        return "";
+        return next_retry_time;
     }
-    
-    std::string value = json.substr(value_start, value_end - value_start);
-    // remove trailing spaces
-    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) 
-    {
-        value.pop_back();
-    }
-    
-    return value;
-}
 
-void TelegramBot::onMessage(MessageCallback callback) 
-{
-    message_callback = callback;
+    return next_poll;
 }
 
 void TelegramBot::loop() 
@@ -271,6 +683,33 @@ void TelegramBot::loop()
     //get telegram updates
     getUpdates();
     
-    // try to send queued messages
-    send_queued_messages();
+    // try to send queued messages, backing off while they keep failing
+    uint32_t current_time = to_ms_since_boot(get_absolute_time());
+    if (!message_queue.empty() && retry_transaction == 0 &&
+        (int32_t)(current_time - next_retry_time) >= 0)
+    {
+        ModemTransaction retry = {};
+        retry.name = "sendQueued";
+        retry.priority = MODEM_PRIORITY_HIGH;
+        retry.deadline_ms = 0;
+        retry.preemptible = false;
+        retry.network = true;
+        retry.run = [this](Sim7670G &) { return send_queued_messages(); };
+        retry.done = [this](bool ok) 
+        {
+            retry_transaction = 0;
+            if (ok)
+            {
+                retry_delay = TELEGRAM_RETRY_MIN_MS;
+                return;
+            }
+
+            next_retry_time = to_ms_since_boot(get_absolute_time()) + retry_delay;
+            printf("[TelegramBot] %u queued messages, next retry in %u ms\n", 
+                   (unsigned)message_queue.size(), retry_delay);
+            retry_delay = retry_delay * 2 > TELEGRAM_RETRY_MAX_MS ? TELEGRAM_RETRY_MAX_MS : retry_delay * 2;
+        };
+
+        retry_transaction = arbiter.submit(retry);
+    }
 }
\ No newline at end of file
@@ -3,8 +3,32 @@
 
 #include <string>
 #include <functional>
-#include "sim7670g.h"
+#include <memory>
+#include "ModemArbiter.h"
+#include "HttpClient.h"
+#include "DataBudget.h"
+#include "JsonWriter.h"
+#include "TelegramParser.h"
+#include "TelegramAdmission.h"
 #include <queue>
+#include <vector>
+
+#define TELEGRAM_API_HOST "api.telegram.org"
+#define TELEGRAM_POST_TIMEOUT_MS 10000
+
+// Updates pedidos por getUpdates (limit=). Los descartados por TelegramAdmission
+// no se copian, así que un flood se vacía en pocas peticiones
+#define TELEGRAM_UPDATES_PER_POLL 100
+
+// Updates admitidos por respuesta; se procesan al cerrar la respuesta
+#define TELEGRAM_MAX_PENDING_UPDATES 8
+
+// Reintento de la cola de mensajes: espera inicial y máxima (ms)
+#define TELEGRAM_RETRY_MIN_MS 2000
+#define TELEGRAM_RETRY_MAX_MS 300000
+
+// Intentos por destinatario dentro de un broadcast; los fallidos van a la cola
+#define TELEGRAM_BROADCAST_ATTEMPTS 2
 
 struct TelegramMessage 
 {
@@ -12,6 +36,30 @@ struct TelegramMessage
     std::string text;
 };
 
+// Requests of one kind and their estimated bytes on air (DataBudget::estimate)
+struct TelegramTraffic 
+{
+    uint32_t requests;
+    uint64_t bytes;
+};
+
+struct TelegramStats 
+{
+    TelegramTraffic messages;    // sendMessage (text replies)
+    TelegramTraffic locations;   // sendLocation
+    TelegramTraffic edits;       // editMessageLiveLocation / stopMessageLiveLocation
+    uint32_t polls_ok;           // getUpdates answered with HTTP 200
+};
+
+// Resultado de un broadcast para un destinatario
+struct TelegramDelivery 
+{
+    std::string chat_id;
+    bool delivered;
+    uint8_t attempts;
+    uint32_t elapsed_ms;     // time spent on this recipient, retries included
+};
+
 class TelegramBot 
 {
 public:
@@ -19,18 +67,43 @@ public:
                                                const std::string& text, 
                                                const std::string& from_username)>;
 
-    TelegramBot(const char* bot_token, Sim7670G & sim7670g);
+    TelegramBot(const char* bot_token, ModemArbiter & arbiter);
     ~TelegramBot();
 
     // Enviar mensaje de texto
     bool sendMessage(const char* chat_id, const char* text);
 
+    // Enviar el mismo texto a varios chats. El texto se escapa una vez y el destino
+    // HTTP se fija una vez; solo cambia chat_id. Cada destinatario es una transacción
+    // urgente aparte, así que otras respuestas urgentes pasan entre dos envíos.
+    // Devuelve cuántos destinatarios se encolaron; los fallidos pasan a la cola.
+    int broadcast(const std::vector<std::string>& chat_ids, const char* text);
+
+    // Resultado por destinatario del último broadcast terminado
+    const std::vector<TelegramDelivery>& lastBroadcast() const { return deliveries; }
+
+    // Enviar ubicación nativa; live_period_s > 0 la deja en directo (message_id para editarla)
+    bool sendLocation(const char* chat_id, double lat, double lon, uint32_t live_period_s, 
+                      uint32_t accuracy_m, int32_t* message_id);
+
+    // Mover una ubicación en directo enviada con sendLocation
+    bool editLiveLocation(const char* chat_id, int32_t message_id, double lat, double lon, uint32_t accuracy_m);
+
+    // Terminar la ubicación en directo antes de que acabe su live_period
+    bool stopLiveLocation(const char* chat_id, int32_t message_id);
+
     // Obtener actualizaciones (polling)
     void getUpdates();
 
     // Registrar callback para mensajes recibidos
     void onMessage(MessageCallback callback);
 
+    // Solo estos chats (ids separados por comas) llegan al callback; el resto
+    // se descarta al separar la respuesta y solo avanza el offset
+    void allowChats(const char* chat_ids);
+
+    const TelegramAdmission& admission() const { return update_admission; }
+
     // Procesar eventos (llamar en bucle principal)
     void loop();
 
@@ -40,17 +113,62 @@ public:
     // Habilitar o deshabilitar modo activo
     bool enableActiveMode(bool enable);
 
+    // Usar una conexión TLS persistente en lugar del servicio HTTP del módem
+    void setPersistentConnection(bool enable);
+
+    // Contabilizar tráfico y ajustar el polling a un presupuesto de datos
+    void setDataBudget(DataBudget* budget);
+
+    // Instante (ms desde el arranque) en que loop() tiene trabajo pendiente
+    uint32_t nextWakeTime() const;
+
+    const TelegramStats& stats() const { return telegram_stats; }
+
+    // Intervalo de polling actual (ms), ya ajustado al presupuesto de datos
+    uint32_t pollInterval() const { return poll_interval ? poll_interval : telegramPollInterval; }
+
 private:
     std::string bot_token;
-    Sim7670G sim7670g;
+    ModemArbiter & arbiter;
+    HttpClient telegram_api;
+    bool persistent_connection;
+    bool last_via_socket;        // last API call went through telegram_api
+    DataBudget* data_budget;
     MessageCallback message_callback;
     int32_t last_update_id;
     uint32_t last_poll_time;
+    uint32_t poll_interval;      // current interval, stretched by the data budget
     bool waiting_response;
     std::queue<TelegramMessage> message_queue;
+    uint32_t poll_transaction;   // queued getUpdates transaction, 0 if none
+    uint32_t retry_transaction;  // queued retry transaction, 0 if none
+    uint32_t next_retry_time;
+    uint32_t retry_delay;        // doubles on every failed retry
+    std::vector<TelegramDelivery> deliveries;
+    TelegramStats telegram_stats;
+
+    // Streaming getUpdates parser; kept updates are handled after the body
+    TelegramUpdateStream update_stream;
+    TelegramAdmission update_admission;
+
+    struct Broadcast;
 
+    bool post_message(const char* chat_id, const char* text);
+    void broadcast_next(const std::shared_ptr<Broadcast>& state);
+    bool broadcast_send(Sim7670G & sim7670g, Broadcast& state);
+    void broadcast_finish(Broadcast& state);
+    void queue_retry(const char* chat_id, const char* text);
+    bool api_get_stream(Sim7670G & sim7670g, const char* path, 
+                        const Sim7670G::ChunkConsumer& consumer, uint32_t deadline_ms);
+    bool admit_update(int32_t update_id, int64_t chat_id);
+    void log_timeout(Sim7670G & sim7670g);
+    uint32_t account(Sim7670G & sim7670g, DataClass data_class, uint32_t request_bytes);
+    bool call_method(const char* method, const JsonWriter::Render& render, 
+                     TelegramTraffic& traffic, int32_t* message_id = nullptr);
+    bool api_post(Sim7670G & sim7670g, const char* path, const JsonWriter::Render& render, 
+                  int json_len, char* response_buffer, int buffer_len, bool* target_ready = nullptr);
+    bool poll_updates(Sim7670G & sim7670g);
     void parse_updates(const std::string& json_response);
-    std::string extract_json_field(const std::string& json, const char* field);
     bool send_queued_messages();
 
     uint32_t telegramPollInterval = 45000; // Intervalo de polling en ms
@@ -0,0 +1,351 @@
+#include "TelegramParser.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "TextScan.h"
+
+int32_t telegram_parse_updates(const std::string& json_response, int32_t last_update_id,
+                               const TelegramMessageHandler& on_message)
+{
+    // simple parsing of JSON response to extract updates
+    size_t pos = 0;
+    int32_t max_update_id = last_update_id;
+
+    while ((pos = json_response.find("\"update_id\":", pos)) != std::string::npos) 
+    {
+        pos += 12; // update_id length
+        int update_id = atoi(json_response.c_str() + pos);
+        
+        if (update_id > max_update_id) 
+        {
+            max_update_id = update_id;
+        }
+
+        // search for message
+        size_t msg_start = json_response.find("\"message\":", pos);
+        if (msg_start == std::string::npos || msg_start > json_response.find("\"update_id\":", pos + 1)) 
+        {
+            // No message found for this update_id
+            continue;
+        }
+
+        // get chat id
+        std::string chat_id = telegram_json_field(json_response.substr(msg_start, 500), "\"id\"");
+        
+        // get text
+        std::string text = telegram_json_field(json_response.substr(msg_start, 1000), "\"text\"");
+        
+        // get username
+        std::string username = telegram_json_field(json_response.substr(msg_start, 500), "\"username\"");
+
+        if (!chat_id.empty() && !text.empty()) 
+        {
+            on_message(chat_id, text, username);
+        }
+
+        pos++;
+    }
+
+    return max_update_id;
+}
+
+std::string telegram_json_field(const std::string& json, const char* field)
+{
+    size_t field_pos = json.find(field);
+    if (field_pos == std::string::npos) 
+    {
+        return "";
+    }
+
+    // find the value start
+    size_t value_start = json.find(':', field_pos);
+    if (value_start == std::string::npos) 
+    {
+        return "";
+    }
+    value_start++;
+
+    // skip spaces
+    while (value_start < json.length() && (json[value_start] == ' ' || json[value_start] == '\t')) 
+    {
+        value_start++;
+    }
+
+    // The strings are enclosed in quotes
+    // Handle string values enclosed in quotes
+    if (json[value_start] == '"') 
+    {
+        value_start++; // Skip the opening quote
+        std::string value;
+        const char* data = json.data();
+        size_t i = value_start;
+
+        while (true) 
+        {
+            // Plain run up to the next quote or backslash, copied in one go
+            size_t end = i + text_find_quote_or_backslash(data + i, json.length() - i);
+            value.append(data + i, end - i);
+
+            if (end < json.length() && data[end] == '"') 
+            {
+                // End of the string
+                return value;
+            }
+            if (end + 1 >= json.length()) 
+            {
+                return ""; // Unterminated string
+            }
+
+            // Escaped character, kept as is
+            value += data[end + 1];
+            i = end + 2;
+        }
+    }
+    
+    // For numeric values
+    size_t value_end = json.find_first_of(",}", value_start);
+    if (value_end == std::string::npos) 
+    {
+        return "";
+    }
+    
+    std::string value = json.substr(value_start, value_end - value_start);
+    // remove trailing spaces
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) 
+    {
+        value.pop_back();
+    }
+    
+    return value;
+}
+
+std::string escape_special_characters(const std::string& input) 
+{
+    std::string escaped;
+    escaped.reserve(input.size() + 8);
+
+    const char* data = input.data();
+    size_t len = input.size();
+    size_t start = 0;
+
+    while (true) 
+    {
+        // Plain run in one go; other control characters are kept as they are
+        size_t i = start + text_find_json_escape(data + start, len - start);
+        escaped.append(data + start, i - start);
+        if (i == len) 
+        {
+            return escaped;
+        }
+        start = i + 1;
+
+        switch (data[i]) 
+        {
+            case '\n': escaped += "\\n"; break;
+            case '\t': escaped += "\\t"; break;
+            case '\r': escaped += "\\r"; break;
+            case '\"': escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            default: escaped += data[i]; break;
+        }
+    }
+}
+
+int32_t telegram_peek_update(const std::string& update, int64_t* chat_id)
+{
+    *chat_id = 0;
+
+    size_t pos = update.find("\"update_id\":");
+    if (pos == std::string::npos) 
+    {
+        return -1;
+    }
+    int32_t update_id = atoi(update.c_str() + pos + 12);
+
+    pos = update.find("\"message\":", pos);
+    if (pos != std::string::npos) 
+    {
+        pos = update.find("\"id\":", pos);
+        if (pos != std::string::npos) 
+        {
+            *chat_id = strtoll(update.c_str() + pos + 5, nullptr, 10);
+        }
+    }
+    return update_id;
+}
+
+TelegramUpdateStream::TelegramUpdateStream(size_t max_update_bytes, size_t max_kept)
+    : max_update_bytes(max_update_bytes),
+      max_kept(max_kept),
+      depth(0),
+      in_string(false),
+      escape(false),
+      truncated(false),
+      overflow(false),
+      decided(false),
+      skipping(false),
+      dropped_update_id(-1),
+      dropped_count(0)
+{
+}
+
+void TelegramUpdateStream::begin(const Filter& update_filter)
+{
+    filter = update_filter;
+    depth = 0;
+    in_string = false;
+    escape = false;
+    overflow = false;
+    decided = false;
+    skipping = false;
+    update.clear();
+    kept_updates.clear();
+    dropped_update_id = -1;
+    dropped_count = 0;
+}
+
+void TelegramUpdateStream::end()
+{
+    update.clear();
+    update.shrink_to_fit();
+}
+
+void TelegramUpdateStream::feed(const char* data, size_t len)
+{
+    size_t i = 0;
+    while (i < len) 
+    {
+        // Bytes that cannot change the state are kept as one run
+        if (!escape) 
+        {
+            size_t run = in_string ? text_find_quote_or_backslash(data + i, len - i)
+                                   : text_find_json_structural(data + i, len - i);
+            if (depth >= 2) 
+            {
+                keep_bytes(data + i, run);
+            }
+            i += run;
+            if (i == len) 
+            {
+                break;
+            }
+        }
+
+        char c = data[i++];
+        if (depth >= 2) 
+        {
+            keep_bytes(&c, 1);
+        }
+
+        if (in_string) 
+        {
+            if (escape) 
+            {
+                escape = false;
+            }
+            else if (c == '\\') 
+            {
+                escape = true;
+            }
+            else if (c == '"') 
+            {
+                in_string = false;
+            }
+            continue;
+        }
+
+        if (c == '"') 
+        {
+            in_string = true;
+        }
+        else if (c == '{') 
+        {
+            depth++;
+            if (depth == 2) 
+            {
+                update = "{";
+                truncated = false;
+                decided = false;
+                skipping = false;
+            }
+        }
+        else if (c == '}') 
+        {
+            depth--;
+            if (depth == 3 && !decided) 
+            {
+                // "from" closed: the sender is known, a dropped update is not copied further
+                decide(false);
+            }
+            else if (depth == 1) 
+            {
+                update_done();
+            }
+        }
+    }
+}
+
+void TelegramUpdateStream::decide(bool complete)
+{
+    int64_t chat_id;
+    int32_t update_id = telegram_peek_update(update, &chat_id);
+    if (chat_id == 0 && !complete) 
+    {
+        return;
+    }
+
+    decided = true;
+    if (filter && !filter(update_id, chat_id)) 
+    {
+        // Only the offset moves, and only while nothing was left behind
+        skipping = true;
+        dropped_count++;
+        if (!overflow && update_id > dropped_update_id) 
+        {
+            dropped_update_id = update_id;
+        }
+    }
+}
+
+void TelegramUpdateStream::update_done()
+{
+    if (!decided) 
+    {
+        decide(true);
+    }
+
+    if (skipping) 
+    {
+        // Already counted by decide()
+    }
+    else if (kept_updates.size() < max_kept) 
+    {
+        kept_updates.push_back(std::move(update));
+    }
+    else 
+    {
+        // Beyond the cap the offset does not advance: fetched again next poll
+        overflow = true;
+    }
+    update.clear();
+}
+
+void TelegramUpdateStream::keep_bytes(const char* data, size_t len)
+{
+    if (skipping) 
+    {
+        return;
+    }
+
+    size_t room = update.size() < max_update_bytes ? max_update_bytes - update.size() : 0;
+    if (room > 0) 
+    {
+        update.append(data, len < room ? len : room);
+    }
+    if (len > room && !truncated) 
+    {
+        // update_id comes first, so the offset still advances
+        printf("[TelegramBot] ⚠️  Update larger than %u bytes, truncated\n", (unsigned)max_update_bytes);
+        truncated = true;
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef TELEGRAM_PARSER_H
+#define TELEGRAM_PARSER_H
+
+#include <stdint.h>
+#include <string>
+#include <functional>
+#include <vector>
+
+/**
+ * Parsing of getUpdates responses and message text, the work done on every poll.
+ *
+ * Pure logic with no SDK dependency, so the host tools can time it against
+ * recorded responses (tools/hotpath_bench).
+ */
+
+using TelegramMessageHandler = std::function<void(const std::string& chat_id,
+                                                  const std::string& text,
+                                                  const std::string& username)>;
+
+// Calls on_message for every text message in a getUpdates body (or a single
+// update) and returns the highest update_id seen, at least last_update_id
+int32_t telegram_parse_updates(const std::string& json, int32_t last_update_id,
+                               const TelegramMessageHandler& on_message);
+
+// Value of the first "field" (quoted, e.g. "\"text\"") in json, unescaped; "" if absent
+std::string telegram_json_field(const std::string& json, const char* field);
+
+// Newlines, tabs, quotes and backslashes written as JSON escapes
+std::string escape_special_characters(const std::string& input);
+
+// update_id of one update and its sender: the first "id" after "message",
+// the same one telegram_parse_updates reports; chat_id 0 without a message
+int32_t telegram_peek_update(const std::string& update, int64_t* chat_id);
+
+/**
+ * Splits a getUpdates body into its updates while it streams in:
+ * {"ok":true,"result":[{update},{update}...]}, every object that opens at
+ * depth 2 is one update. The filter runs as soon as the sender is known
+ * (the "from" object has closed) or at the end of the update, so a dropped
+ * update is neither copied further nor handed to the message parser.
+ */
+class TelegramUpdateStream
+{
+public:
+    // false drops the update; its update_id still moves the offset
+    using Filter = std::function<bool(int32_t update_id, int64_t chat_id)>;
+
+    TelegramUpdateStream(size_t max_update_bytes, size_t max_kept);
+
+    // Before each response
+    void begin(const Filter& filter);
+
+    void feed(const char* data, size_t len);
+
+    // Kept updates in arrival order, for the caller to handle and clear
+    std::vector<std::string>& kept() { return kept_updates; }
+
+    // Highest update_id dropped before any update was left out for lack of
+    // room (those are fetched again, so the offset must not pass them); -1 if none
+    int32_t droppedUpdateId() const { return dropped_update_id; }
+    uint32_t dropped() const { return dropped_count; }
+
+    // After each response: release the update buffer
+    void end();
+
+private:
+    size_t max_update_bytes;
+    size_t max_kept;
+    Filter filter;
+    int depth;
+    bool in_string;
+    bool escape;
+    bool truncated;
+    bool overflow;
+    bool decided;            // filter already ran for the current update
+    bool skipping;           // current update dropped: its bytes are not kept
+    std::string update;
+    std::vector<std::string> kept_updates;
+    int32_t dropped_update_id;
+    uint32_t dropped_count;
+
+    void keep_bytes(const char* data, size_t len);
+    void decide(bool complete);
+    void update_done();
+};
+
+#endif // TELEGRAM_PARSER_H
@@ -0,0 +1,218 @@
+#include "TelemetryBatch.h"
+#include <cmath>
+
+static void put_u16(uint8_t* p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t* p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        p[i] = (v >> (8 * i)) & 0xFF;
+    }
+}
+
+static uint16_t get_u16(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static size_t put_varint(uint8_t* p, uint32_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80)
+    {
+        p[n++] = (v & 0x7F) | 0x80;
+        v >>= 7;
+    }
+    p[n++] = v;
+    return n;
+}
+
+static bool get_varint(const uint8_t* p, size_t len, size_t* pos, uint32_t* v)
+{
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (*pos >= len)
+        {
+            return false;
+        }
+        uint8_t b = p[(*pos)++];
+        result |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80))
+        {
+            *v = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+int32_t telemetry_to_e6(double degrees)
+{
+    return (int32_t)lround(degrees * 1e6);
+}
+
+uint16_t telemetry_crc16(const uint8_t* data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+TelemetryBatch::TelemetryBatch(const TelemetryFlushPolicy& policy)
+    : policy(policy)
+{
+    clear();
+}
+
+void TelemetryBatch::clear()
+{
+    length = TELEMETRY_HEADER_SIZE;
+    fix_count = 0;
+    first_add_ms = 0;
+    last = {0, 0, 0};
+}
+
+bool TelemetryBatch::add(const TelemetryFix& fix, uint32_t now_ms)
+{
+    if (fix_count == UINT16_MAX)
+    {
+        return false;
+    }
+
+    if (fix_count == 0)
+    {
+        // First fix goes in the header
+        put_u32(&data[6], fix.timestamp);
+        put_u32(&data[10], (uint32_t)fix.lat_e6);
+        put_u32(&data[14], (uint32_t)fix.lon_e6);
+        first_add_ms = now_ms;
+    }
+    else
+    {
+        if (length + TELEMETRY_MAX_FIX_SIZE + TELEMETRY_CRC_SIZE > sizeof(data))
+        {
+            return false;
+        }
+
+        length += put_varint(&data[length], zigzag((int32_t)(fix.timestamp - last.timestamp)));
+        length += put_varint(&data[length], zigzag(fix.lat_e6 - last.lat_e6));
+        length += put_varint(&data[length], zigzag(fix.lon_e6 - last.lon_e6));
+    }
+
+    last = fix;
+    fix_count++;
+    return true;
+}
+
+bool TelemetryBatch::shouldFlush(uint32_t now_ms) const
+{
+    if (fix_count == 0)
+    {
+        return false;
+    }
+
+    if (policy.max_fixes && fix_count >= policy.max_fixes)
+    {
+        return true;
+    }
+
+    if (policy.max_age_ms && now_ms - first_add_ms >= policy.max_age_ms)
+    {
+        return true;
+    }
+
+    // Room for one more worst-case fix?
+    size_t limit = policy.max_bytes ? policy.max_bytes : sizeof(data);
+    return size() + TELEMETRY_MAX_FIX_SIZE > limit;
+}
+
+const uint8_t* TelemetryBatch::finish(size_t* len)
+{
+    data[0] = 'T';
+    data[1] = 'K';
+    data[2] = TELEMETRY_FORMAT_VERSION;
+    data[3] = 0;
+    put_u16(&data[4], fix_count);
+    put_u16(&data[length], telemetry_crc16(data, length));
+
+    *len = length + TELEMETRY_CRC_SIZE;
+    return data;
+}
+
+int telemetry_decode(const uint8_t* data, size_t len, TelemetryFix* fixes, int max_fixes)
+{
+    if (len < TELEMETRY_HEADER_SIZE + TELEMETRY_CRC_SIZE ||
+        data[0] != 'T' || data[1] != 'K' || data[2] != TELEMETRY_FORMAT_VERSION)
+    {
+        return -1;
+    }
+
+    size_t body_len = len - TELEMETRY_CRC_SIZE;
+    if (telemetry_crc16(data, body_len) != get_u16(&data[body_len]))
+    {
+        return -1;
+    }
+
+    int count = get_u16(&data[4]);
+    if (count == 0)
+    {
+        return 0;
+    }
+    if (count > max_fixes)
+    {
+        return -1;
+    }
+
+    TelemetryFix fix;
+    fix.timestamp = get_u32(&data[6]);
+    fix.lat_e6 = (int32_t)get_u32(&data[10]);
+    fix.lon_e6 = (int32_t)get_u32(&data[14]);
+    fixes[0] = fix;
+
+    size_t pos = TELEMETRY_HEADER_SIZE;
+    for (int i = 1; i < count; i++)
+    {
+        uint32_t dt, dlat, dlon;
+        if (!get_varint(data, body_len, &pos, &dt) ||
+            !get_varint(data, body_len, &pos, &dlat) ||
+            !get_varint(data, body_len, &pos, &dlon))
+        {
+            return -1;
+        }
+
+        fix.timestamp += unzigzag(dt);
+        fix.lat_e6 += unzigzag(dlat);
+        fix.lon_e6 += unzigzag(dlon);
+        fixes[i] = fix;
+    }
+
+    return pos == body_len ? count : -1;
+}
@@ -0,0 +1,85 @@
+#ifndef TELEMETRY_BATCH_H
+#define TELEMETRY_BATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Formato binario de lote (little endian):
+//   0  'T' 'K'          magic
+//   2  version          TELEMETRY_FORMAT_VERSION
+//   3  flags            reserved, 0
+//   4  count   u16      number of fixes
+//   6  time    u32      timestamp of the first fix (Unix time, s UTC)
+//  10  lat     i32      latitude of the first fix (1e-6 deg)
+//  14  lon     i32      longitude of the first fix (1e-6 deg)
+//  18  fixes 2..count:  zigzag varint deltas (time, lat, lon) from the previous fix
+//   n  crc     u16      CRC-16/CCITT-FALSE over bytes 0..n-1
+#define TELEMETRY_FORMAT_VERSION 1
+#define TELEMETRY_HEADER_SIZE 18
+#define TELEMETRY_CRC_SIZE 2
+
+// Worst case per fix: three 5-byte varints
+#define TELEMETRY_MAX_FIX_SIZE 15
+
+// Tamaño máximo de un lote (cuerpo de un único AT+HTTPDATA)
+#define TELEMETRY_MAX_BATCH_BYTES 1024
+
+struct TelemetryFix
+{
+    uint32_t timestamp;  // Unix time (s, UTC)
+    int32_t lat_e6;      // latitude * 1e6
+    int32_t lon_e6;      // longitude * 1e6
+};
+
+// A batch is flushed as soon as any limit is reached (0 = limit unused)
+struct TelemetryFlushPolicy
+{
+    uint16_t max_fixes;
+    uint32_t max_age_ms;
+    uint16_t max_bytes;
+};
+
+/**
+ * Packs position fixes into one compact binary body for a single POST.
+ * Fixes are delta encoded as they are added, so size() is always exact.
+ */
+class TelemetryBatch
+{
+public:
+    explicit TelemetryBatch(const TelemetryFlushPolicy& policy);
+
+    // Añadir posición; false si el lote está lleno (vaciar antes)
+    bool add(const TelemetryFix& fix, uint32_t now_ms);
+
+    // ¿Se alcanzó algún límite de la política?
+    bool shouldFlush(uint32_t now_ms) const;
+
+    // No cabe otra posición en el peor caso
+    bool full() const { return size() + TELEMETRY_MAX_FIX_SIZE > TELEMETRY_MAX_BATCH_BYTES; }
+
+    // Cerrar el lote (cabecera + CRC) y devolver el cuerpo a enviar
+    const uint8_t* finish(size_t* len);
+
+    void clear();
+
+    uint16_t count() const { return fix_count; }
+    size_t size() const { return length + TELEMETRY_CRC_SIZE; }
+
+private:
+    TelemetryFlushPolicy policy;
+    uint8_t data[TELEMETRY_MAX_BATCH_BYTES];
+    size_t length;
+    uint16_t fix_count;
+    uint32_t first_add_ms;
+    TelemetryFix last;
+};
+
+// Conversión de grados a punto fijo 1e-6
+int32_t telemetry_to_e6(double degrees);
+
+uint16_t telemetry_crc16(const uint8_t* data, size_t len);
+
+// Decodificar un lote; devuelve el número de posiciones o -1 si es inválido
+int telemetry_decode(const uint8_t* data, size_t len, TelemetryFix* fixes, int max_fixes);
+
+#endif // TELEMETRY_BATCH_H
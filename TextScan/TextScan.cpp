@@ -0,0 +1,94 @@
+#include "TextScan.h"
+#include <stdint.h>
+
+// Word loads from char buffers: may_alias keeps them legal for the compiler
+typedef uint32_t __attribute__((__may_alias__)) text_word_t;
+
+#define TEXT_ONES  0x01010101u
+#define TEXT_HIGHS 0x80808080u
+
+// Non-zero iff some byte of w is zero (exact; only the first hit bit is reliable)
+static inline uint32_t has_zero(uint32_t w)
+{
+    return (w - TEXT_ONES) & ~w & TEXT_HIGHS;
+}
+
+static inline uint32_t has_byte(uint32_t w, uint8_t b)
+{
+    return has_zero(w ^ (TEXT_ONES * b));
+}
+
+// Non-zero iff some byte of w is below n (exact for n <= 128)
+static inline uint32_t has_less(uint32_t w, uint8_t n)
+{
+    return (w - TEXT_ONES * n) & ~w & TEXT_HIGHS;
+}
+
+// Unaligned head byte by byte, then whole aligned words until one has a
+// hit, then byte by byte from that word on
+template <typename WordHit, typename ByteHit>
+static inline size_t find_first(const char* text, size_t len, WordHit word_hit, ByteHit byte_hit)
+{
+    size_t i = 0;
+
+    while (i < len && ((uintptr_t)(text + i) & 3))
+    {
+        if (byte_hit((uint8_t)text[i]))
+        {
+            return i;
+        }
+        i++;
+    }
+
+    while (i + 4 <= len && !word_hit(*(const text_word_t*)(text + i)))
+    {
+        i += 4;
+    }
+
+    for (; i < len; i++)
+    {
+        if (byte_hit((uint8_t)text[i]))
+        {
+            return i;
+        }
+    }
+    return len;
+}
+
+size_t text_find_newline(const char* text, size_t len)
+{
+    return find_first(text, len,
+        [](uint32_t w) { return has_byte(w, '\n'); },
+        [](uint8_t c) { return c == '\n'; });
+}
+
+size_t text_find_quote_or_backslash(const char* text, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (text[i] == '"' || text[i] == '\\')
+        {
+            return i;
+        }
+    }
+    return len;
+}
+
+size_t text_find_json_structural(const char* text, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (text[i] == '"' || text[i] == '{' || text[i] == '}')
+        {
+            return i;
+        }
+    }
+    return len;
+}
+
+size_t text_find_json_escape(const char* text, size_t len)
+{
+    return find_first(text, len,
+        [](uint32_t w) { return has_byte(w, '"') | has_byte(w, '\\') | has_less(w, 0x20); },
+        [](uint8_t c) { return c == '"' || c == '\\' || c < 0x20; });
+}
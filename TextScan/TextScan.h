@@ -0,0 +1,33 @@
+#ifndef TEXT_SCAN_H
+#define TEXT_SCAN_H
+
+#include <stddef.h>
+
+/**
+ * Byte scanners for the buffered text paths (HTTP lines, JSON strings,
+ * getUpdates streams). The newline and JSON escape scanners test four bytes
+ * per 32-bit word (SWAR) and only fall back to single bytes around the hit
+ * and at the unaligned ends. Inside JSON a quote or brace comes every few
+ * bytes, so the quote/backslash and structural scanners are byte loops:
+ * words timed no faster there.
+ *
+ * Each returns the index of the first matching byte in text[0, len), or len
+ * when there is none.
+ *
+ * Pure logic with no SDK dependency: tools/hotpath_bench checks them against
+ * byte loops and times both.
+ */
+
+// '\n'
+size_t text_find_newline(const char* text, size_t len);
+
+// '"' or '\\': the end of a run inside a JSON string
+size_t text_find_quote_or_backslash(const char* text, size_t len);
+
+// '"', '{' or '}': the next byte that changes nesting outside JSON strings
+size_t text_find_json_structural(const char* text, size_t len);
+
+// '"', '\\' or a control character (< 0x20): the bytes JSON must escape
+size_t text_find_json_escape(const char* text, size_t len);
+
+#endif // TEXT_SCAN_H
@@ -0,0 +1,362 @@
+#include "TimerWheel.h"
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+
+// Ticks covered by levels 0..level
+static uint32_t level_span(int level)
+{
+    return 1u << (TIMER_WHEEL_LEVEL_BITS * (level + 1));
+}
+
+// First set bit at or after 'from', wrapping around; -1 if none
+static int next_slot(uint64_t bits, int from)
+{
+    if (bits == 0)
+    {
+        return -1;
+    }
+    uint64_t rotated = (bits >> from) | (from ? bits << (TIMER_WHEEL_SLOTS - from) : 0);
+    return (from + __builtin_ctzll(rotated)) & SLOT_MASK;
+}
+
+TimerWheel::TimerWheel(uint32_t now_ms, size_t capacity)
+    : timers(capacity < NONE ? capacity : NONE - 1),
+      free_head(NONE),
+      firing(NONE),
+      firing_cancelled(false),
+      occupied(),
+      current(now_ms),
+      active(0),
+      timer_stats()
+{
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++)
+    {
+        for (int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++)
+        {
+            wheel[level][slot] = NONE;
+        }
+    }
+
+    // Free list threaded through 'next'
+    for (size_t i = timers.size(); i-- > 0;)
+    {
+        timers[i].next = free_head;
+        timers[i].generation = 1;
+        timers[i].linked = false;
+        free_head = (uint16_t)i;
+    }
+}
+
+uint16_t TimerWheel::index_of(TimerId id) const
+{
+    uint16_t index = (uint16_t)(id & 0xFFFF);
+    if (id == 0 || index == 0 || index > timers.size())
+    {
+        return NONE;
+    }
+    index--;
+    return timers[index].generation == (id >> 16) ? index : NONE;
+}
+
+void TimerWheel::link(uint16_t index, bool cascading)
+{
+    Timer& t = timers[index];
+    int32_t delta = (int32_t)(t.expires - current);
+    uint32_t when = t.expires;
+
+    // The current tick is still to be fired while cascading, done otherwise
+    int32_t first = cascading ? 0 : 1;
+    if (delta < first)
+    {
+        delta = first;
+        when = current + first;
+    }
+
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && (uint32_t)delta >= level_span(level))
+    {
+        level++;
+    }
+    if ((uint32_t)delta >= level_span(TIMER_WHEEL_LEVELS - 1))
+    {
+        // Beyond the top level: park in the farthest slot, re-cascaded from there
+        when = current + level_span(TIMER_WHEEL_LEVELS - 1) - 1;
+    }
+
+    int slot = (when >> (TIMER_WHEEL_LEVEL_BITS * level)) & SLOT_MASK;
+
+    t.level = level;
+    t.slot = slot;
+    t.prev = NONE;
+    t.next = wheel[level][slot];
+    if (t.next != NONE)
+    {
+        timers[t.next].prev = index;
+    }
+    wheel[level][slot] = index;
+    occupied[level] |= 1ull << slot;
+    t.linked = true;
+}
+
+void TimerWheel::unlink(uint16_t index)
+{
+    Timer& t = timers[index];
+
+    if (t.prev != NONE)
+    {
+        timers[t.prev].next = t.next;
+    }
+    else
+    {
+        wheel[t.level][t.slot] = t.next;
+        if (t.next == NONE)
+        {
+            occupied[t.level] &= ~(1ull << t.slot);
+        }
+    }
+    if (t.next != NONE)
+    {
+        timers[t.next].prev = t.prev;
+    }
+    t.linked = false;
+}
+
+TimerId TimerWheel::scheduleAt(uint32_t when_ms, Callback callback)
+{
+    if (free_head == NONE)
+    {
+        return 0;
+    }
+
+    uint16_t index = free_head;
+    Timer& t = timers[index];
+    free_head = t.next;
+
+    t.expires = when_ms;
+    t.period = 0;
+    t.callback = std::move(callback);
+    link(index, false);
+    active++;
+
+    return ((TimerId)t.generation << 16) | (index + 1);
+}
+
+TimerId TimerWheel::schedule(uint32_t delay_ms, Callback callback)
+{
+    return scheduleAt(current + delay_ms, std::move(callback));
+}
+
+TimerId TimerWheel::scheduleEvery(uint32_t period_ms, Callback callback)
+{
+    if (period_ms == 0)
+    {
+        return 0;
+    }
+
+    TimerId id = schedule(period_ms, std::move(callback));
+    if (id != 0)
+    {
+        timers[index_of(id)].period = period_ms;
+    }
+    return id;
+}
+
+bool TimerWheel::reschedule(TimerId id, uint32_t when_ms)
+{
+    uint16_t index = index_of(id);
+    if (index == NONE || !timers[index].callback)
+    {
+        return false;
+    }
+
+    Timer& t = timers[index];
+    if (t.linked)
+    {
+        unlink(index);
+    }
+    else
+    {
+        active++;
+    }
+    t.expires = when_ms;
+    link(index, false);
+    return true;
+}
+
+bool TimerWheel::cancel(TimerId id)
+{
+    uint16_t index = index_of(id);
+    if (index != NONE && index == firing && !timers[index].linked)
+    {
+        // Its callback is running: advance() frees it afterwards
+        firing_cancelled = true;
+        timer_stats.cancelled++;
+        return true;
+    }
+    if (index == NONE || !timers[index].linked)
+    {
+        return false;
+    }
+
+    unlink(index);
+    Timer& t = timers[index];
+    t.callback = nullptr;
+    t.generation = t.generation == 0xFFFF ? 1 : t.generation + 1;
+    t.next = free_head;
+    free_head = index;
+    active--;
+    timer_stats.cancelled++;
+    return true;
+}
+
+bool TimerWheel::isPending(TimerId id) const
+{
+    uint16_t index = index_of(id);
+    return index != NONE && timers[index].linked;
+}
+
+void TimerWheel::cascade(int level)
+{
+    int slot = (current >> (TIMER_WHEEL_LEVEL_BITS * level)) & SLOT_MASK;
+
+    uint16_t index = wheel[level][slot];
+    wheel[level][slot] = NONE;
+    occupied[level] &= ~(1ull << slot);
+
+    while (index != NONE)
+    {
+        uint16_t next = timers[index].next;
+        link(index, true);
+        timer_stats.cascaded++;
+        index = next;
+    }
+}
+
+int TimerWheel::advance(uint32_t now_ms)
+{
+    int fired = 0;
+
+    while ((int32_t)(now_ms - current) > 0)
+    {
+        if (active == 0)
+        {
+            current = now_ms;
+            break;
+        }
+
+        // Nothing on level 0: jump to the tick before the next level-0 wrap
+        if (occupied[0] == 0)
+        {
+            uint32_t wrap = (current | SLOT_MASK);
+            if ((int32_t)(now_ms - wrap) <= 0)
+            {
+                current = now_ms;
+                break;
+            }
+            current = wrap;
+        }
+
+        current++;
+
+        // Entering a new block on level n pulls its slot down a level
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; level++)
+        {
+            if (current & ((1u << (TIMER_WHEEL_LEVEL_BITS * level)) - 1))
+            {
+                break;
+            }
+            cascade(level);
+        }
+
+        int slot = current & SLOT_MASK;
+        uint16_t index;
+        while ((index = wheel[0][slot]) != NONE)
+        {
+            Timer& t = timers[index];
+            unlink(index);
+            active--;
+
+            uint32_t late = now_ms - t.expires;
+            timer_stats.fired++;
+            timer_stats.total_late_ms += late;
+            if (late > timer_stats.max_late_ms)
+            {
+                timer_stats.max_late_ms = late;
+            }
+
+            // Called in place: the pool never reallocates, and the callback
+            // may reschedule() or cancel() its own handle
+            firing = index;
+            firing_cancelled = false;
+            t.callback();
+            firing = NONE;
+            fired++;
+
+            if (!t.linked && t.period && !firing_cancelled)
+            {
+                // Next point on the grid that is still ahead of us
+                uint32_t behind = now_ms - t.expires;
+                t.expires += (behind / t.period + 1) * t.period;
+                link(index, false);
+                active++;
+            }
+            else if (!t.linked)
+            {
+                t.callback = nullptr;
+                t.generation = t.generation == 0xFFFF ? 1 : t.generation + 1;
+                t.next = free_head;
+                free_head = index;
+            }
+        }
+    }
+
+    return fired;
+}
+
+uint32_t TimerWheel::slot_deadline(int level, int slot, uint32_t best) const
+{
+    for (uint16_t index = wheel[level][slot]; index != NONE; index = timers[index].next)
+    {
+        uint32_t when = timers[index].expires;
+        if ((int32_t)(when - current) <= 0)
+        {
+            when = current + 1;
+        }
+        if ((int32_t)(when - best) < 0)
+        {
+            best = when;
+        }
+    }
+    return best;
+}
+
+uint32_t TimerWheel::nextDeadline(uint32_t limit_ms) const
+{
+    uint32_t best = limit_ms;
+
+    // Below the top level slots are in block order from the current position,
+    // so the first occupied one holds the earliest timer of that level. The
+    // slot of the current block was already cascaded: anything in it is a
+    // full lap ahead, hence the scan starts after it
+    for (int level = 0; level < TIMER_WHEEL_LEVELS - 1; level++)
+    {
+        int start = ((current >> (TIMER_WHEEL_LEVEL_BITS * level)) + 1) & SLOT_MASK;
+        int slot = next_slot(occupied[level], start);
+        if (slot >= 0)
+        {
+            best = slot_deadline(level, slot, best);
+        }
+    }
+
+    // Parked long timers break that order on the top level: check every slot
+    const int top = TIMER_WHEEL_LEVELS - 1;
+    for (int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++)
+    {
+        if (occupied[top] & (1ull << slot))
+        {
+            best = slot_deadline(top, slot, best);
+        }
+    }
+
+    return best;
+}
@@ -0,0 +1,104 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <vector>
+
+// 4 levels of 64 slots at 1 ms per tick: exact up to 2^24 ms (~4.6 h),
+// longer timers are re-cascaded from the top level until due
+#define TIMER_WHEEL_LEVEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_LEVEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+
+// Handle returned by schedule(); 0 is never a valid timer
+using TimerId = uint32_t;
+
+struct TimerStats
+{
+    uint32_t fired;
+    uint32_t cancelled;
+    uint32_t cascaded;         // entries moved down a level
+    uint32_t max_late_ms;      // worst firing delay past the deadline
+    uint64_t total_late_ms;    // for the mean delay (jitter)
+};
+
+/**
+ * Hierarchical timer wheel with O(1) schedule and cancel.
+ *
+ * Pure logic with no SDK dependency: time only enters through the now_ms
+ * arguments, so the same code runs on the host against a simulated clock.
+ * Timers live in a fixed pool sized at construction; callbacks run from
+ * advance() and may schedule or cancel other timers.
+ */
+class TimerWheel
+{
+public:
+    using Callback = std::function<void()>;
+
+    TimerWheel(uint32_t now_ms, size_t capacity = 32);
+
+    // Run callback at when_ms (at least one tick from now). 0 if the pool is full
+    TimerId scheduleAt(uint32_t when_ms, Callback callback);
+
+    // Run callback delay_ms from the last advance()
+    TimerId schedule(uint32_t delay_ms, Callback callback);
+
+    // Run callback every period_ms, first time period_ms from the last advance().
+    // Deadlines stay on the period grid; missed periods are skipped, not queued
+    TimerId scheduleEvery(uint32_t period_ms, Callback callback);
+
+    // Move a pending timer keeping its callback; called from inside its own
+    // callback it re-arms the timer
+    bool reschedule(TimerId id, uint32_t when_ms);
+
+    // false if the timer already fired or was cancelled
+    bool cancel(TimerId id);
+
+    bool isPending(TimerId id) const;
+
+    // Fire every timer due up to now_ms; returns how many fired
+    int advance(uint32_t now_ms);
+
+    // Earliest pending deadline, or limit_ms if nothing is due before it
+    uint32_t nextDeadline(uint32_t limit_ms) const;
+
+    size_t size() const { return active; }
+
+    const TimerStats& stats() const { return timer_stats; }
+
+private:
+    static const uint16_t NONE = 0xFFFF;
+
+    struct Timer
+    {
+        uint32_t expires;
+        uint32_t period;       // 0 = one-shot
+        Callback callback;
+        uint16_t prev;
+        uint16_t next;
+        uint16_t generation;
+        uint8_t level;
+        uint8_t slot;
+        bool linked;
+    };
+
+    std::vector<Timer> timers;
+    uint16_t free_head;
+    uint16_t firing;                         // timer whose callback is running
+    bool firing_cancelled;
+    uint16_t wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    uint64_t occupied[TIMER_WHEEL_LEVELS];   // one bit per non-empty slot
+    uint32_t current;                        // last tick processed
+    size_t active;
+    TimerStats timer_stats;
+
+    void link(uint16_t index, bool cascading);
+    void unlink(uint16_t index);
+    void cascade(int level);
+    uint32_t slot_deadline(int level, int slot, uint32_t best) const;
+    uint16_t index_of(TimerId id) const;
+};
+
+#endif // TIMER_WHEEL_H
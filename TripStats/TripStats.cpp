@@ -0,0 +1,227 @@
+#include "TripStats.h"
+#include <cstdio>
+
+// Millimetres per micro-degree, Q8 (111.195 mm)
+#define TRIP_MM_PER_E6_Q8 28466u
+
+// cos(0..90 degrees) in Q15, linearly interpolated (error < 4e-5)
+static const uint16_t cos_table[91] =
+{
+    32768, 32763, 32748, 32723, 32688, 32643, 32588, 32524, 32449, 32365,
+    32270, 32166, 32052, 31928, 31795, 31651, 31499, 31336, 31164, 30983,
+    30792, 30592, 30382, 30163, 29935, 29698, 29452, 29197, 28932, 28660,
+    28378, 28088, 27789, 27482, 27166, 26842, 26510, 26170, 25822, 25466,
+    25102, 24730, 24351, 23965, 23571, 23170, 22763, 22348, 21926, 21498,
+    21063, 20622, 20174, 19720, 19261, 18795, 18324, 17847, 17364, 16877,
+    16384, 15886, 15384, 14876, 14365, 13848, 13328, 12803, 12275, 11743,
+    11207, 10668, 10126, 9580, 9032, 8481, 7927, 7371, 6813, 6252,
+    5690, 5126, 4560, 3993, 3425, 2856, 2286, 1715, 1144, 572,
+    0
+};
+
+static int32_t cos_q15(int32_t lat_e6)
+{
+    uint32_t lat = lat_e6 < 0 ? -lat_e6 : lat_e6;
+    if (lat >= 90000000)
+    {
+        return 0;
+    }
+    uint32_t degree = lat / 1000000;
+    int32_t frac = lat - degree * 1000000;
+    int32_t a = cos_table[degree];
+    int32_t b = cos_table[degree + 1];
+    return a + (b - a) * frac / 1000000;
+}
+
+static uint32_t isqrt32(uint32_t v)
+{
+    uint32_t result = 0;
+    uint32_t bit = 1u << 30;
+
+    while (bit > v)
+    {
+        bit >>= 2;
+    }
+    while (bit)
+    {
+        if (v >= result + bit)
+        {
+            v -= result + bit;
+            result = (result >> 1) + bit;
+        }
+        else
+        {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return result;
+}
+
+static uint64_t isqrt64(uint64_t v)
+{
+    uint64_t result = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > v)
+    {
+        bit >>= 2;
+    }
+    while (bit)
+    {
+        if (v >= result + bit)
+        {
+            v -= result + bit;
+            result = (result >> 1) + bit;
+        }
+        else
+        {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return result;
+}
+
+uint32_t TripStats::distanceMm(int32_t lat1_e6, int32_t lon1_e6, int32_t lat2_e6, int32_t lon2_e6)
+{
+    int32_t dlat = lat2_e6 - lat1_e6;
+    int32_t dlon = lon2_e6 - lon1_e6;
+    int32_t cos_lat = cos_q15(lat1_e6 + dlat / 2);
+
+    if (dlat > -2048 && dlat < 2048 && dlon > -2048 && dlon < 2048)
+    {
+        // Under ~200 m, the usual step: 4 fractional bits, 32-bit only
+        int32_t x = (dlon * cos_lat) >> 11;
+        int32_t y = dlat * 16;
+        uint32_t d_q4 = isqrt32((uint32_t)(x * x) + (uint32_t)(y * y));
+        return (d_q4 * TRIP_MM_PER_E6_Q8) >> 12;
+    }
+
+    // Longitude shrunk to latitude units at the mean latitude
+    int32_t x = (int32_t)(((int64_t)dlon * cos_lat) >> 15);
+    int32_t y = dlat;
+
+    if (x > -46341 && x < 46341 && y > -46341 && y < 46341)
+    {
+        // Under ~5 km: still 32-bit, whole micro-degrees are enough
+        uint32_t d = isqrt32((uint32_t)(x * x) + (uint32_t)(y * y));
+        return (d * TRIP_MM_PER_E6_Q8) >> 8;
+    }
+
+    uint64_t d = isqrt64((uint64_t)((int64_t)x * x) + (uint64_t)((int64_t)y * y));
+    uint64_t mm = (d * TRIP_MM_PER_E6_Q8) >> 8;
+    return mm > UINT32_MAX ? UINT32_MAX : (uint32_t)mm;
+}
+
+TripStats::TripStats()
+{
+    reset(0);
+}
+
+void TripStats::reset(uint32_t now_ms)
+{
+    start_ms = now_ms;
+    has_last = false;
+    last_ms = 0;
+    distance_mm = 0;
+    moving_ms = 0;
+    max_speed_mm_s = 0;
+    in_stop = false;
+    anchor_ms = 0;
+    anchor_lat_e6 = 0;
+    anchor_lon_e6 = 0;
+    stops_total = 0;
+}
+
+void TripStats::add(uint32_t now_ms, int32_t lat_e6, int32_t lon_e6)
+{
+    if (has_last && now_ms == last_ms)
+    {
+        return;
+    }
+
+    if (has_last)
+    {
+        uint32_t dt = now_ms - anchor_ms;
+        uint32_t chord_mm = distanceMm(anchor_lat_e6, anchor_lon_e6, lat_e6, lon_e6);
+
+        if (chord_mm < TRIP_STOP_RADIUS_MM)
+        {
+            // Still near the anchor: GNSS wander is not distance
+            if (!in_stop && dt >= TRIP_STOP_MIN_MS)
+            {
+                in_stop = true;
+                stops[stops_total % TRIP_MAX_STOPS] = {anchor_ms, 0, anchor_lat_e6, anchor_lon_e6};
+                stops_total++;
+            }
+            if (in_stop)
+            {
+                stops[(stops_total - 1) % TRIP_MAX_STOPS].duration_ms = dt;
+            }
+            last_ms = now_ms;
+            return;
+        }
+
+        // Left the anchor; after a stop only the last interval was travel
+        uint32_t travel_ms = in_stop ? now_ms - last_ms : dt;
+        uint32_t speed = chord_mm < 4000000 ? chord_mm * 1000 / travel_ms
+                                            : (uint32_t)((uint64_t)chord_mm * 1000 / travel_ms);
+
+        if (speed > TRIP_MAX_SPEED_MM_S)
+        {
+            // A jump, not travel: start again from here
+            printf("[TripStats] Ignoring %u m jump\n", chord_mm / 1000);
+        }
+        else
+        {
+            distance_mm += chord_mm;
+            moving_ms += travel_ms;
+
+            // A chord out of a stop started some time in the stop, too fast to trust
+            if (!in_stop && speed > max_speed_mm_s)
+            {
+                max_speed_mm_s = speed;
+            }
+        }
+        in_stop = false;
+    }
+
+    has_last = true;
+    last_ms = now_ms;
+    anchor_ms = now_ms;
+    anchor_lat_e6 = lat_e6;
+    anchor_lon_e6 = lon_e6;
+}
+
+uint32_t TripStats::averageSpeed() const
+{
+    if (moving_ms == 0)
+    {
+        return 0;
+    }
+    return (uint32_t)(distance_mm * 1000 / moving_ms);
+}
+
+const TripStop& TripStats::stop(int i) const
+{
+    // Oldest kept stop first
+    uint32_t first = stops_total > TRIP_MAX_STOPS ? stops_total - TRIP_MAX_STOPS : 0;
+    return stops[(first + i) % TRIP_MAX_STOPS];
+}
+
+int TripStats::format(char* buffer, size_t len, uint32_t now_ms) const
+{
+    uint32_t moving_s = moving_ms / 1000;
+    uint32_t elapsed_s = (now_ms - start_ms) / 1000;
+
+    return snprintf(buffer, len,
+                    "Distancia: %.2f km\n"
+                    "En movimiento: %uh %02um de %uh %02um\n"
+                    "Velocidad media: %.1f km/h, máxima: %.1f km/h\n"
+                    "Paradas: %u\n",
+                    distance_mm / 1e6,
+                    moving_s / 3600, (moving_s / 60) % 60, elapsed_s / 3600, (elapsed_s / 60) % 60,
+                    averageSpeed() * 0.0036, max_speed_mm_s * 0.0036,
+                    stops_total);
+}
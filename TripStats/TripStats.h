@@ -0,0 +1,84 @@
+#ifndef TRIP_STATS_H
+#define TRIP_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Fixes within this distance of the last counted one are standing still (mm)
+#define TRIP_STOP_RADIUS_MM 25000
+
+// Standing still at least this long is a stop (ms)
+#define TRIP_STOP_MIN_MS 120000
+
+// Faster than this between fixes is a glitch, not travel (mm/s, 250 km/h)
+#define TRIP_MAX_SPEED_MM_S 70000
+
+// Most recent stops kept
+#define TRIP_MAX_STOPS 16
+
+struct TripStop
+{
+    uint32_t start_ms;
+    uint32_t duration_ms;      // grows while the stop is still going on
+    int32_t lat_e6;
+    int32_t lon_e6;
+};
+
+/**
+ * Trip statistics updated once per fix: distance, moving time, maximum and
+ * average speed, and the stops made since reset(). Nothing is recomputed
+ * from history; the stops list is a ring of the last TRIP_MAX_STOPS.
+ *
+ * Distance is counted in chords: a fix only counts once it is more than
+ * TRIP_STOP_RADIUS_MM away from the last counted one, so GNSS wander while
+ * parked adds nothing and time spent inside the radius is standing still.
+ *
+ * Distances use a fixed-point equirectangular approximation with a cosine
+ * table (distanceMm), in 32-bit arithmetic for steps under ~200 m so it stays
+ * cheap on a core without FPU or 64-bit multiply.
+ *
+ * Pure logic with no SDK dependency: time only enters through now_ms.
+ */
+class TripStats
+{
+public:
+    TripStats();
+
+    void reset(uint32_t now_ms);
+
+    // Feed a position fix (degrees * 1e6)
+    void add(uint32_t now_ms, int32_t lat_e6, int32_t lon_e6);
+
+    uint32_t distance() const { return (uint32_t)(distance_mm / 1000); }    // m
+    uint32_t movingTime() const { return moving_ms; }
+    uint32_t maxSpeed() const { return max_speed_mm_s; }
+    uint32_t averageSpeed() const;                                          // mm/s while moving
+
+    // Stops, oldest first; stopCount() counts all of them, stop(i) only the kept ones
+    uint32_t stopCount() const { return stops_total; }
+    int keptStops() const { return stops_total < TRIP_MAX_STOPS ? (int)stops_total : TRIP_MAX_STOPS; }
+    const TripStop& stop(int i) const;
+
+    // Summary lines (Spanish) without the stops
+    int format(char* buffer, size_t len, uint32_t now_ms) const;
+
+    // Ground distance between two fixes (mm)
+    static uint32_t distanceMm(int32_t lat1_e6, int32_t lon1_e6, int32_t lat2_e6, int32_t lon2_e6);
+
+private:
+    uint32_t start_ms;
+    bool has_last;
+    uint32_t last_ms;          // newest fix
+    uint64_t distance_mm;
+    uint32_t moving_ms;
+    uint32_t max_speed_mm_s;
+
+    bool in_stop;              // near the anchor long enough to be the newest stop
+    uint32_t anchor_ms;        // last counted fix
+    int32_t anchor_lat_e6;
+    int32_t anchor_lon_e6;
+    TripStop stops[TRIP_MAX_STOPS];
+    uint32_t stops_total;
+};
+
+#endif // TRIP_STATS_H
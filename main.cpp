@@ -2,101 +2,647 @@
 #include "pico/stdlib.h"
 #include "TelegramBot.h"
 #include "sim7670g.h"
+#include "ModemArbiter.h"
+#include "MqttClient.h"
+#include "TelemetryBatch.h"
+#include "DataBudget.h"
+#include "PowerManager.h"
+#include "TimerWheel.h"
+#include "ModemHealth.h"
+#include "ConnectionManager.h"
+#include "ReverseGeocoder.h"
+#include "PositionFilter.h"
+#include "TripStats.h"
+#include "SmsChannel.h"
+#include "LiveLocation.h"
+#include "CellLocator.h"
+#include "OtaUpdater.h"
+#include "hardware/regs/addressmap.h"
+#include "hardware/watchdog.h"
 
 #include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <functional>
 
 TelegramBot* bot = nullptr;
+MqttClient* mqtt = nullptr;
+ModemArbiter* modem = nullptr;
+SmsChannel* sms = nullptr;
+OtaUpdater* ota = nullptr;
 std::vector<std::string> authorized_users;
 
-std::string escape_special_characters(const std::string& input) 
+// MQTT topics, built from the IMEI at startup
+std::string mqtt_fix_topic;
+std::string mqtt_cmd_topic;
+
+// interval between pushed position fixes (ms)
+#define MQTT_FIX_INTERVAL_MS 60000
+
+// one GNSS sample every 30 s for the trip stats and telemetry, one POST per batch
+#define TELEMETRY_SAMPLE_INTERVAL_MS 30000
+TelemetryBatch telemetry_batch({20, 10 * 60 * 1000, 512});
+
+// whole batch upload: target, HTTPDATA and +HTTPACTION (ms)
+#define TELEMETRY_UPLOAD_TIMEOUT_MS 15000
+
+// interval between stats log lines (ms)
+#define STATS_FLUSH_INTERVAL_MS (10u * 60u * 1000u)
+
+// monthly cellular data budget (-DDATA_BUDGET_MB, empty = no limit)
+#define DATA_BUDGET_PERIOD_S (30u * 24u * 3600u)
+DataBudget* data_budget = nullptr;
+
+// hardware watchdog period (ms; the RP2040 allows up to ~8.3 s). Fed by the
+// main loop, by PowerManager while asleep and by the known long operations:
+// modem init and reset, link bring-up, HTTPACTION, the long poll, results
+// the network sends after OK, and the OTA download and erase
+#define MAIN_WATCHDOG_MS 8000
+
+// data path watchdog and recovery
+ModemHealth* health = nullptr;
+ConnectionManager* connection = nullptr;
+
+// offline place names, index read in place from flash
+ReverseGeocoder geocoder;
+
+// coarse position from the serving cell while GNSS has no fix
+CellLocator cell_locator;
+
+// GNSS smoothing, outlier rejection and dead reckoning between fixes
+PositionFilter position_filter;
+
+// distance, speeds and stops since the last /trip reset
+TripStats trip;
+
+// a /location answered from the cell gets the GNSS position once there is a fix
+#define CELL_FOLLOWUP_MS (10u * 60u * 1000u)
+
+// reply on the channel the command came from (Telegram chat or SMS sender)
+using CommandReply = std::function<void(const char* text)>;
+CommandReply precise_fix_reply;
+uint32_t precise_fix_until = 0;
+
+// /live: one Telegram location message moved in place
+LiveLocation live;
+uint32_t live_transaction = 0;
+
+// firmware download in progress (queued modem transaction), 0 if none
+uint32_t ota_transaction = 0;
+
+// earlier of two wrapping ms timestamps
+static uint32_t earliest(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) < 0 ? a : b;
+}
+
+// network traffic only flows with the link up and the breaker closed
+static bool traffic_allowed()
+{
+    return connection->isUp() && health->allowTraffic();
+}
+
+// next live location sample; idle, just a far deadline the main loop keeps moving
+static uint32_t live_wake_time()
+{
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    return live.active() ? live.nextSampleTime() : now + LIVE_MAX_INTERVAL_MS;
+}
+
+// next time the bot needs the loop; while traffic is held, the main loop re-arms it
+static uint32_t bot_wake_time()
+{
+    return traffic_allowed() ? bot->nextWakeTime() : health->nextWakeTime();
+}
+
+// GNSS fix through the position filter; without a usable fix the estimate is
+// dead-reckoned for a few seconds and then held, with a growing sigma.
+// fresh: a fix was accepted in this call (and fed to the trip)
+bool read_position(Sim7670G & sim7670g, double* lat, double* lon, 
+                   bool* fresh = nullptr, uint32_t* sigma_m = nullptr)
 {
-    std::ostringstream escaped;
-    for (char c : input) 
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    double raw_lat = 0.0, raw_lon = 0.0;
+    FilterResult result = FILTER_REJECTED;
+
+    if (sim7670g.sim7670g_gnss_get_location(&raw_lat, &raw_lon, sim7670g_deadline(SIM7670G_GNSS_TIMEOUT)))
     {
-        switch (c) 
+        result = position_filter.update(now, telemetry_to_e6(raw_lat), telemetry_to_e6(raw_lon));
+        if (result == FILTER_REJECTED)
         {
-            case '\n': escaped << "\\n"; break;
-            case '\t': escaped << "\\t"; break;
-            case '\r': escaped << "\\r"; break;
-            case '\"': escaped << "\\\""; break;
-            case '\\': escaped << "\\\\"; break;
-            default: escaped << c; break;
+            printf("[Main] GNSS outlier rejected: %.6f,%.6f\n", raw_lat, raw_lon);
         }
     }
-    return escaped.str();
+    if (fresh)
+    {
+        *fresh = result != FILTER_REJECTED;
+    }
+
+    int32_t lat_e6, lon_e6;
+    if (!position_filter.estimate(now, &lat_e6, &lon_e6, sigma_m))
+    {
+        return false;
+    }
+    if (result != FILTER_REJECTED)
+    {
+        trip.add(now, lat_e6, lon_e6);
+    }
+    *lat = lat_e6 / 1e6;
+    *lon = lon_e6 / 1e6;
+    return true;
 }
 
-//callback to handle received messages
-void on_telegram_message(const std::string& chat_id, 
-                        const std::string& text, 
-                        const std::string& username) 
+// "<title>:\nLatitud...\nLongitud...\nPrecisión..." plus the nearest town and
+// road from the offline index, no network involved
+static int format_location(char* buffer, size_t len, const char* title,
+                           int32_t lat_e6, int32_t lon_e6, uint32_t accuracy_m)
+{
+    int pos = snprintf(buffer, len, "%s:\nLatitud: %.6f\nLongitud: %.6f\nPrecisión: ±%u m",
+                       title, lat_e6 / 1e6, lon_e6 / 1e6, accuracy_m);
+
+    char place[160];
+    uint64_t start = time_us_64();
+    if (pos > 0 && pos < (int)len && geocoder.describe(lat_e6, lon_e6, place, sizeof(place)) > 0)
+    {
+        printf("[Main] Geocoded in %llu us\n", (unsigned long long)(time_us_64() - start));
+        pos += snprintf(buffer + pos, len - pos, "\n%s", place);
+    }
+    return pos;
+}
+
+// commands shared by Telegram and SMS; the caller has checked the sender
+void handle_command(const std::string& text, const CommandReply& reply, bool via_sms)
 {
-    printf("\n=== New message received ===\n");
-    printf("From: @%s\n", username.c_str());
-    printf("Chat ID: %s\n", chat_id.c_str());
     std::string escaped_text = escape_special_characters(text);
-    printf("Text: %s\n", escaped_text.c_str());
-    printf("===========================\n\n");
 
-    if(std::find(authorized_users.begin(), authorized_users.end(), chat_id) == authorized_users.end())
+    // an SMS sender can be spoofed: nothing that changes the device from SMS
+    if (via_sms && (escaped_text == "/activo" || escaped_text == "/ota" || escaped_text.rfind("/fallo ", 0) == 0))
     {
-        printf("[Warning] Message from unauthorized chat_id: %s\n", chat_id.c_str());
+        reply("Comando solo disponible por Telegram.");
         return;
     }
 
     // ask message
     if (escaped_text == "/start") 
     {
-        bot->sendMessage(chat_id.c_str(), 
+        reply(
             "¡Hola! Soy tu bot en Raspberry Pi Pico W.\n"
             "Comandos disponibles:\n"
             "/start - Este mensaje\n"
             "/location - Obtener ubicación actual\n"
             "/activo - Estado activo del bot\n"
-            "/lowEnergy - Modo de bajo consumo\n");
+            "/lowEnergy - Modo de bajo consumo\n"
+            "/trip - Resumen del viaje (/trip reset para empezar otro)\n"
+            "/live [min] - Ubicación en directo (/live stop para terminar)\n"
+            "/datos - Consumo de datos del mes\n"
+            "/salud - Estado del módem y recuperaciones\n"
+            "/ota - Actualizar el firmware desde OTA_FIRMWARE_URL\n");
     }
     else if( escaped_text == "/location") 
     {
         double lat = 0.0, lon = 0.0;
-        if (bot->getLocation(&lat, &lon)) 
+        uint32_t sigma_m = 0;
+        bool gnss = false;
+        CellFix cell_fix = {};
+        bool coarse = modem->execute("getLocation", MODEM_PRIORITY_URGENT, 
+            [&](Sim7670G & sim7670g) 
+            {
+                gnss = read_position(sim7670g, &lat, &lon, nullptr, &sigma_m);
+                if (gnss || !cell_locator.isOpen())
+                {
+                    return gnss;
+                }
+
+                // no fix yet: the serving cell answers at once
+                sim7670g_cell_t cell;
+                uint64_t start = time_us_64();
+                if (!sim7670g.sim7670g_get_cell(&cell, sim7670g_deadline(SIM7670G_CMD_TIMEOUT)) ||
+                    !cell_locator.locate(&cell, 1, &cell_fix))
+                {
+                    return false;
+                }
+                printf("[Main] Cell located in %llu us\n", (unsigned long long)(time_us_64() - start));
+                return true;
+            }) && !gnss;
+
+        char location_msg[320];
+        if (gnss) 
+        {
+            format_location(location_msg, sizeof(location_msg), "Ubicación actual",
+                            telemetry_to_e6(lat), telemetry_to_e6(lon), sigma_m);
+            reply(location_msg);
+        } 
+        else if (coarse) 
         {
-            char location_msg[256];
-            snprintf(location_msg, sizeof(location_msg), 
-                     "Ubicación actual:\nLatitud: %.6f\nLongitud: %.6f", 
-                     lat, lon);
-            bot->sendMessage(chat_id.c_str(), location_msg);
+            format_location(location_msg, sizeof(location_msg), "Ubicación aproximada (antena, sin GNSS)",
+                            cell_fix.lat_e6, cell_fix.lon_e6, cell_fix.accuracy_m);
+            reply(location_msg);
+
+            // GNSS keeps sampling in the background; the first fix goes to this chat
+            precise_fix_reply = reply;
+            precise_fix_until = to_ms_since_boot(get_absolute_time()) + CELL_FOLLOWUP_MS;
         } 
         else 
         {
-            bot->sendMessage(chat_id.c_str(), "No se pudo obtener la ubicación GNSS en este momento.");
+            reply("No se pudo obtener la ubicación GNSS en este momento.");
         }
     }
+    else if( escaped_text == "/trip") 
+    {
+        char report[640];
+        uint32_t now = to_ms_since_boot(get_absolute_time());
+        int len = trip.format(report, sizeof(report), now);
+
+        // last stops, by place name when the geocoder has one
+        for (int i = 0; i < trip.keptStops() && len > 0 && len < (int)sizeof(report); i++)
+        {
+            const TripStop& stop = trip.stop(i);
+            char place[160];
+            if (geocoder.describe(stop.lat_e6, stop.lon_e6, place, sizeof(place)) <= 0)
+            {
+                snprintf(place, sizeof(place), "%.6f,%.6f", stop.lat_e6 / 1e6, stop.lon_e6 / 1e6);
+            }
+            len += snprintf(report + len, sizeof(report) - len, "- %u min: %s\n",
+                            stop.duration_ms / 60000, place);
+        }
+        reply(report);
+    }
+    else if( escaped_text == "/trip reset") 
+    {
+        trip.reset(to_ms_since_boot(get_absolute_time()));
+        reply("Viaje reiniciado.");
+    }
     else if( escaped_text == "/activo") 
     {
         bot->enableActiveMode(true);
-        bot->sendMessage(chat_id.c_str(), "Modo activo activado. El bot responderá rápidamente a los comandos.");
+        reply("Modo activo activado. El bot responderá rápidamente a los comandos.");
     }
     else if( escaped_text == "/lowEnergy") 
     {
         bot->enableActiveMode(false);
-        bot->sendMessage(chat_id.c_str(), "Modo de bajo consumo activado. Tiempos de respuesta más lentos.");
+        reply("Modo de bajo consumo activado. Tiempos de respuesta más lentos.");
+    }
+    else if( escaped_text == "/datos") 
+    {
+        if (data_budget)
+        {
+            char report[384];
+            data_budget->format(report, sizeof(report));
+            reply(report);
+        }
+        else
+        {
+            reply("Sin presupuesto de datos configurado.");
+        }
+    }
+    else if( escaped_text == "/salud") 
+    {
+        char report[512];
+        int len = health->recovery().format(report, sizeof(report));
+        if (len > 0 && len < (int)sizeof(report))
+        {
+            len += connection->format(report + len, sizeof(report) - len);
+        }
+        if (sms && len > 0 && len < (int)sizeof(report))
+        {
+            sms->format(report + len, sizeof(report) - len);
+        }
+        reply(report);
+    }
+    else if( escaped_text.rfind("/fallo ", 0) == 0) 
+    {
+        // fault injection to measure recovery time: /fallo http|pdp|red
+        std::string layer = escaped_text.substr(7);
+        RecoveryStep step = layer == "http" ? RECOVERY_HTTP :
+                            layer == "pdp" ? RECOVERY_PDP :
+                            layer == "red" ? RECOVERY_ATTACH : RECOVERY_NONE;
+        if (step == RECOVERY_NONE)
+        {
+            reply("Uso: /fallo http|pdp|red");
+        }
+        else
+        {
+            reply("Inyectando fallo, consulta /salud para ver el MTTR.");
+            health->injectFault(step);
+        }
     }
     else 
     {
         char response[256];
         snprintf(response, sizeof(response), 
                  "Recibí tu mensaje: %s\nEnvía /start para ver los comandos.", 
-                 escaped_text.c_str());
-        bot->sendMessage(chat_id.c_str(), response);
+                 text.c_str());
+        reply(response);
+    }
+}
+
+// bytes per live location update against a text reply (estimated on air)
+static int format_live_traffic(char* buffer, size_t len)
+{
+    const TelegramStats& stats = bot->stats();
+    const LiveStats& updates = live.stats();
+    return snprintf(buffer, len, "Ubicación en directo: %u ediciones, %u omitidas, %u B/edición; %u B por mensaje de texto\n",
+                    updates.edits, updates.skipped,
+                    stats.edits.requests ? (unsigned)(stats.edits.bytes / stats.edits.requests) : 0u,
+                    stats.messages.requests ? (unsigned)(stats.messages.bytes / stats.messages.requests) : 0u);
+}
+
+// Download the new firmware into the other slot, then reboot into it on trial
+void start_ota(const std::string& chat_id)
+{
+    if (!ota->supported())
+    {
+        bot->sendMessage(chat_id.c_str(), "Actualización no disponible (sin particiones A/B, OTA_FIRMWARE_URL u OTA_HMAC_KEY).");
+        return;
+    }
+    if (ota_transaction != 0)
+    {
+        bot->sendMessage(chat_id.c_str(), "Ya hay una actualización en curso.");
+        return;
+    }
+
+    bot->sendMessage(chat_id.c_str(), "Descargando firmware...");
+
+    // Holds the modem for the whole download: queued behind everything else
+    ModemTransaction update = {};
+    update.name = "ota";
+    update.priority = MODEM_PRIORITY_LOW;
+    update.network = true;
+    update.run = [](Sim7670G & sim7670g) { return ota->download(sim7670g); };
+    update.done = [chat_id](bool ok)
+    {
+        ota_transaction = 0;
+
+        char report[256];
+        int len = snprintf(report, sizeof(report), ok ? "Firmware verificado, reiniciando.\n" : "Actualización fallida, sigue el firmware actual.\n");
+        ota->format(report + len, sizeof(report) - len);
+        bot->sendMessage(chat_id.c_str(), report);
+
+        if (ok)
+        {
+            ota->reboot();
+        }
+    };
+    ota_transaction = modem->submit(update);
+}
+
+//callback to handle received messages
+void on_telegram_message(const std::string& chat_id, 
+                        const std::string& text, 
+                        const std::string& username) 
+{
+    printf("\n=== New message received ===\n");
+    printf("From: @%s\n", username.c_str());
+    printf("Chat ID: %s\n", chat_id.c_str());
+    printf("Text: %s\n", escape_special_characters(text).c_str());
+    printf("===========================\n\n");
+
+
+    // live location needs a chat to show the message in: Telegram only
+    if (text == "/live stop")
+    {
+        if (live.active() && live.messageId() != 0)
+        {
+            bot->stopLiveLocation(live.chatId(), live.messageId());
+        }
+        live.stop();
+
+        char report[160];
+        format_live_traffic(report, sizeof(report));
+        bot->sendMessage(chat_id.c_str(), report);
+        return;
+    }
+    if (text == "/live" || text.rfind("/live ", 0) == 0)
+    {
+        uint32_t minutes = text.size() > 6 ? (uint32_t)atoi(text.c_str() + 6) : 0;
+        live.start(chat_id.c_str(), to_ms_since_boot(get_absolute_time()),
+                   minutes > 0 ? minutes * 60 : LIVE_DEFAULT_PERIOD_S);
+
+        char reply[128];
+        snprintf(reply, sizeof(reply), "Ubicación en directo durante %u min. /live stop para terminar.",
+                 live.period() / 60);
+        bot->sendMessage(chat_id.c_str(), reply);
+        return;
+    }
+
+    // firmware update: Telegram only, an SMS sender can be spoofed
+    if (text == "/ota")
+    {
+        start_ota(chat_id);
+        return;
+    }
+
+    handle_command(text, [chat_id](const char* reply) { bot->sendMessage(chat_id.c_str(), reply); }, false);
+}
+
+// callback for SMS from an authorized number (SmsChannel checks the sender)
+void on_sms_command(const char* number, const char* text)
+{
+    // phones add trailing spaces or line breaks
+    std::string command = text;
+    while (!command.empty() && (command.back() == ' ' || command.back() == '\n' || command.back() == '\r'))
+    {
+        command.pop_back();
+    }
+
+    std::string sender = number;
+    handle_command(command, [sender](const char* reply) { sms->send(sender.c_str(), reply); }, true);
+}
+
+// one live location step: the first fix sends the message, later ones move it
+bool update_live_location(Sim7670G & sim7670g)
+{
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    double lat = 0.0, lon = 0.0;
+    uint32_t sigma_m = 0;
+
+    if (!read_position(sim7670g, &lat, &lon, nullptr, &sigma_m))
+    {
+        live.retry(now);
+        return true;
+    }
+
+    bool ok = true;
+    int32_t message_id = 0;
+    switch (live.onFix(now, telemetry_to_e6(lat), telemetry_to_e6(lon), sigma_m, position_filter.speed()))
+    {
+        case LIVE_SEND:
+            ok = bot->sendLocation(live.chatId(), lat, lon, live.period(), sigma_m, &message_id);
+            if (ok)
+            {
+                live.sent(message_id);
+            }
+            break;
+        case LIVE_EDIT:
+            ok = bot->editLiveLocation(live.chatId(), live.messageId(), lat, lon, sigma_m);
+            if (ok)
+            {
+                live.edited();
+            }
+            break;
+        case LIVE_END:
+            printf("[Main] Live location period over\n");
+            break;
+        default:
+            break;
+    }
+
+    if (!ok)
+    {
+        live.retry(now);
+    }
+    return ok;
+}
+
+// publish the current GNSS position as "lat,lon" (compact text payload)
+bool publish_fix(Sim7670G & sim7670g, int qos)
+{
+    double lat = 0.0, lon = 0.0;
+    if (!read_position(sim7670g, &lat, &lon))
+    {
+        return false;
+    }
+
+    char payload[48];
+    int len = snprintf(payload, sizeof(payload), "%.6f,%.6f", lat, lon);
+    if (!mqtt->publish(mqtt_fix_topic.c_str(), payload, len, qos))
+    {
+        return false;
+    }
+
+    if (data_budget)
+    {
+        // MQTT fixed header + topic + packet id, no TLS
+        data_budget->record(DATA_CLASS_MQTT, len + mqtt_fix_topic.size() + 6, 0, false);
+    }
+
+    const MqttStats& stats = mqtt->stats();
+    printf("[Main] Fix published (%d bytes, %u fixes, %u payload bytes total)\n",
+           len, stats.published, stats.payload_bytes);
+    return true;
+}
+
+// sample GNSS for the trip stats and, when uploads are configured, the telemetry batch
+bool sample_position(Sim7670G & sim7670g)
+{
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    double lat = 0.0, lon = 0.0;
+    bool fresh = false;
+
+    uint32_t sigma_m = 0;
+    bool located = read_position(sim7670g, &lat, &lon, &fresh, &sigma_m);
+
+    // follow-up to a /location that was answered from the cell
+    if (precise_fix_reply && (int32_t)(now - precise_fix_until) >= 0)
+    {
+        precise_fix_reply = nullptr;
+    }
+    if (precise_fix_reply && located && fresh)
+    {
+        char location_msg[320];
+        format_location(location_msg, sizeof(location_msg), "Ubicación GNSS",
+                        telemetry_to_e6(lat), telemetry_to_e6(lon), sigma_m);
+        CommandReply reply = precise_fix_reply;
+        precise_fix_reply = nullptr;
+        reply(location_msg);
+    }
+
+    // only measured positions are uploaded, never dead-reckoned ones
+    uint32_t utc = 0;
+    if (located && fresh && strlen(TELEMETRY_UPLOAD_URL) > 0 && !sim7670g.sim7670g_get_utc(&utc))
+    {
+        printf("[Main] No UTC time yet, fix not uploaded\n");
+    }
+    else if (located && fresh && strlen(TELEMETRY_UPLOAD_URL) > 0)
+    {
+        TelemetryFix fix = {utc, telemetry_to_e6(lat), telemetry_to_e6(lon)};
+        if (!telemetry_batch.add(fix, now))
+        {
+            printf("[Main] Telemetry batch full, fix dropped\n");
+        }
+    }
+    return true;
+}
+
+// upload the telemetry batch when the flush policy says so
+bool upload_telemetry(Sim7670G & sim7670g)
+{
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+
+    // over budget pace: keep batching until the buffer is full
+    bool flush = telemetry_batch.shouldFlush(now);
+    if (flush && data_budget && data_budget->overPace() && !telemetry_batch.full())
+    {
+        printf("[Main] Over data budget pace, deferring telemetry upload\n");
+        flush = false;
+    }
+
+    if (!flush)
+    {
+        return true;
+    }
+
+    size_t len = 0;
+    uint16_t count = telemetry_batch.count();
+    const uint8_t* body = telemetry_batch.finish(&len);
+
+    char response[256];
+    bool uploaded = sim7670g.sim7670g_https_post_data(TELEMETRY_UPLOAD_URL, "application/octet-stream",
+                                                      body, len, response, sizeof(response),
+                                                      sim7670g_deadline(TELEMETRY_UPLOAD_TIMEOUT_MS));
+    if (data_budget)
+    {
+        data_budget->record(DATA_CLASS_TELEMETRY, strlen(TELEMETRY_UPLOAD_URL) + len,
+                            sim7670g.sim7670g_last_content_length(), true);
+    }
+
+    if (!uploaded)
+    {
+        // keep the batch, the next upload round retries
+        printf("[Main] Telemetry upload failed, %u fixes kept\n", count);
+        return false;
+    }
+
+    printf("[Main] Telemetry uploaded: %u fixes in %u bytes (%.1f B/fix)\n",
+           count, (unsigned)len, (double)len / count);
+    telemetry_batch.clear();
+    return true;
+}
+
+//callback to handle commands pushed on the MQTT command topic
+void on_mqtt_message(const std::string& topic, const std::string& payload)
+{
+    printf("[Main] MQTT command: %s\n", payload.c_str());
+
+    if (payload == "/location")
+    {
+        modem->execute("mqttLocation", MODEM_PRIORITY_URGENT,
+            [](Sim7670G & sim7670g) { return publish_fix(sim7670g, 1); });
+    }
+    else if (payload == "/activo")
+    {
+        bot->enableActiveMode(true);
+    }
+    else if (payload == "/lowEnergy")
+    {
+        bot->enableActiveMode(false);
     }
 }
 
 int main() 
 {
     stdio_init_all();
+
+    // after an OTA update this firmware runs on trial; the main loop keeps it
+    // once a Telegram poll succeeds
+    ota = new OtaUpdater(OTA_FIRMWARE_URL, OTA_HMAC_KEY, (uint32_t)atoi(FIRMWARE_VERSION));
     
     // wait for USB serial to be ready
     sleep_ms(5000);
+
+    // reboot if the firmware hangs from here on; on a trial boot this re-arms
+    // the bootrom's watchdog, so a hang still goes back to the old slot
+    watchdog_enable(MAIN_WATCHDOG_MS, true);
     
     printf("\n");
     printf("======================================\n");
@@ -128,21 +674,298 @@ int main()
         }
     }
 
+    // reverse geocoding index, flashed separately (tools/geocode_build)
+    if (geocoder.open((const uint8_t*)(OTA_FLASH_DATA_BASE + GEOCODER_FLASH_OFFSET),
+                      PICO_FLASH_SIZE_BYTES - GEOCODER_FLASH_OFFSET))
+    {
+        printf("[Main] Geocoder: %u places, %u bytes in flash\n",
+               (unsigned)geocoder.size(), (unsigned)geocoder.imageSize());
+    }
+    else
+    {
+        printf("[Main] No geocoding index in flash, /location sends coordinates only\n");
+    }
+
+    // cell-ID table, flashed separately (tools/cell_build)
+    if (cell_locator.open((const uint8_t*)(OTA_FLASH_DATA_BASE + CELL_FLASH_OFFSET), CELL_FLASH_SIZE))
+    {
+        printf("[Main] Cell table: %u cells, %u bytes in flash\n",
+               (unsigned)cell_locator.size(), (unsigned)cell_locator.imageSize());
+    }
+    else
+    {
+        printf("[Main] No cell table in flash, /location waits for GNSS\n");
+    }
+
+    // single owner of the modem, shared by every service
+    ModemArbiter arbiter(sim7670g);
+    modem = &arbiter;
+
+    // sleep between deadlines, modem in slow-clock mode during long gaps
+    PowerManager power(sim7670g);
+    power.begin();
+
+    // recover the data path step by step when transactions keep failing
+    ModemHealth modem_health(arbiter);
+    health = &modem_health;
+
+    // reconnect only the missing steps when +CGEV/+CEREG report a drop;
+    // network transactions wait in the queue until the link is back
+    ConnectionManager link(arbiter);
+    connection = &link;
+    link.onGiveUp([]() { health->reportFault(RECOVERY_ATTACH); });
+    arbiter.setNetworkGate(traffic_allowed);
+
+    // optional MQTT push channel
+    static std::string mqtt_client_id;
+    if (strlen(MQTT_BROKER_URI) > 0)
+    {
+        sim7670g_info_t info;
+        sim7670g.sim7670g_get_info(&info, sim7670g_deadline(SIM7670G_CMD_TIMEOUT));
+
+        mqtt_client_id = std::string("tracker-") + info.imei;
+        mqtt_fix_topic = "tracker/" + std::string(info.imei) + "/fix";
+        mqtt_cmd_topic = "tracker/" + std::string(info.imei) + "/cmd";
+
+        MqttConfig mqtt_config = {};
+        mqtt_config.broker_uri = MQTT_BROKER_URI;
+        mqtt_config.client_id = mqtt_client_id.c_str();
+        mqtt_config.keepalive_s = 120;
+        mqtt_config.use_tls = false;
+
+        mqtt = new MqttClient(sim7670g, mqtt_config);
+        mqtt->onMessage(on_mqtt_message);
+        mqtt->subscribe(mqtt_cmd_topic.c_str(), 1);
+        mqtt->connect();
+    }
     printf("\n[Main] Creating Telegram bot instance...\n");
-    bot = new TelegramBot(TELEGRAM_BOT_TOKEN, sim7670g);
+    bot = new TelegramBot(TELEGRAM_BOT_TOKEN, arbiter);
+
+    // keep one TLS connection to api.telegram.org open between requests
+    bot->setPersistentConnection(true);
+
+    // account traffic and stretch polling to the monthly data budget
+    if (atoi(DATA_BUDGET_MB) > 0)
+    {
+        data_budget = new DataBudget((uint64_t)atoi(DATA_BUDGET_MB) * 1024 * 1024, DATA_BUDGET_PERIOD_S);
+        bot->setDataBudget(data_budget);
+    }
 
-    // Register method to handle incoming messages
+    // Register method to handle incoming messages; other chats and floods are
+    // dropped while the response is split, before any of this runs
+    bot->allowChats(TELEGRAM_AUTORIZED_USERS);
     bot->onMessage(on_telegram_message);
 
+    // startup alert to every authorized chat, saying so when the watchdog rebooted us
+    if (!authorized_users.empty())
+    {
+        bot->broadcast(authorized_users, watchdog_enable_caused_reboot() ? "Localizador en marcha (reinicio por watchdog)."
+                                                                         : "Localizador en marcha.");
+    }
+
+    // SMS commands from the numbers in -DSMS_AUTHORIZED_NUMBERS, delivered by
+    // +CMTI as they arrive instead of at the next Telegram poll
+    if (strlen(SMS_AUTHORIZED_NUMBERS) > 0)
+    {
+        sms = new SmsChannel(arbiter, SMS_AUTHORIZED_NUMBERS);
+        sms->onCommand(on_sms_command);
+        sms->begin();
+    }
+
     printf("\n✅ Bot running! Waiting for messages...\n\n");
 
+    // every periodic job is an event on the timer wheel
+    TimerWheel timers(to_ms_since_boot(get_absolute_time()));
+
+    // Telegram polling and outbox retries; re-armed from bot->nextWakeTime()
+    // and held back while the modem recovers
+    static TimerId bot_timer = 0;
+    bot_timer = timers.schedule(0, [&timers]()
+    {
+        if (traffic_allowed())
+        {
+            bot->loop();
+        }
+        timers.reschedule(bot_timer, bot_wake_time());
+    });
+
+    // Live location: sampled faster while moving, queued like any network job
+    static TimerId live_timer = 0;
+    live_timer = timers.schedule(LIVE_MAX_INTERVAL_MS, [&timers, &arbiter]()
+    {
+        if (live.active() && live_transaction == 0)
+        {
+            ModemTransaction update = {};
+            update.name = "liveLocation";
+            update.priority = MODEM_PRIORITY_NORMAL;
+            update.deadline_ms = to_ms_since_boot(get_absolute_time()) + LIVE_MIN_INTERVAL_MS;
+            update.network = true;
+            update.run = update_live_location;
+            update.done = [](bool) { live_transaction = 0; };
+            live_transaction = arbiter.submit(update);
+        }
+        timers.reschedule(live_timer, live_wake_time());
+    });
+
+    // Health checks and recovery steps
+    static TimerId health_timer = 0;
+    health_timer = timers.schedule(0, [&timers]()
+    {
+        health->loop();
+        timers.reschedule(health_timer, health->nextWakeTime());
+    });
+
+    // Push a position fix over MQTT
+    if (mqtt)
+    {
+        timers.scheduleEvery(MQTT_FIX_INTERVAL_MS, [&arbiter]()
+        {
+            if (!mqtt->isConnected())
+            {
+                return;
+            }
+
+            ModemTransaction fix = {};
+            fix.name = "mqttFix";
+            fix.priority = MODEM_PRIORITY_LOW;
+            fix.deadline_ms = to_ms_since_boot(get_absolute_time()) + MQTT_FIX_INTERVAL_MS;
+            fix.run = [](Sim7670G & sim7670g) { return publish_fix(sim7670g, 0); };
+            arbiter.submit(fix);
+        });
+    }
+
+    // GNSS refresh: trip stats and telemetry batch, no network needed
+    timers.scheduleEvery(TELEMETRY_SAMPLE_INTERVAL_MS, [&arbiter]()
+    {
+        ModemTransaction sample = {};
+        sample.name = "gnssSample";
+        sample.priority = MODEM_PRIORITY_LOW;
+        sample.deadline_ms = to_ms_since_boot(get_absolute_time()) + TELEMETRY_SAMPLE_INTERVAL_MS;
+        sample.run = sample_position;
+        arbiter.submit(sample);
+    });
+
+    // Telemetry upload, once the batch is due
+    if (strlen(TELEMETRY_UPLOAD_URL) > 0)
+    {
+        timers.scheduleEvery(TELEMETRY_SAMPLE_INTERVAL_MS, [&arbiter]()
+        {
+            if (!telemetry_batch.shouldFlush(to_ms_since_boot(get_absolute_time())))
+            {
+                return;
+            }
+
+            ModemTransaction upload = {};
+            upload.name = "telemetry";
+            upload.priority = MODEM_PRIORITY_LOW;
+            upload.deadline_ms = to_ms_since_boot(get_absolute_time()) + TELEMETRY_SAMPLE_INTERVAL_MS;
+            upload.network = true;
+            upload.run = upload_telemetry;
+            arbiter.submit(upload);
+        });
+    }
+
+    // Duty cycle, timer jitter and data usage
+    timers.scheduleEvery(STATS_FLUSH_INTERVAL_MS, [&timers, &power]()
+    {
+        char report[160];
+        power.schedule().format(report, sizeof(report));
+        printf("[Main] %s", report);
+
+        const TimerStats& stats = timers.stats();
+        printf("[Main] Timers: %u fired, %.1f ms mean / %u ms max late, %u pending\n",
+               stats.fired, stats.fired ? (double)stats.total_late_ms / stats.fired : 0.0,
+               stats.max_late_ms, (unsigned)timers.size());
+
+        if (data_budget)
+        {
+            printf("[Main] Data used: %llu KB\n", (unsigned long long)(data_budget->used() / 1024));
+        }
+
+        const FilterStats& fixes = position_filter.stats();
+        printf("[Main] GNSS filter: %u accepted, %u rejected, %u resets\n",
+               fixes.accepted, fixes.rejected, fixes.resets);
+        printf("[Main] Trip: %u m, %u stops\n", trip.distance(), trip.stopCount());
+
+        if (live.stats().sessions > 0)
+        {
+            format_live_traffic(report, sizeof(report));
+            printf("[Main] %s", report);
+        }
+
+        // command latency: SMS measured from +CMTI, Telegram waits half a poll on average
+        if (sms)
+        {
+            const SmsStats& sms_stats = sms->stats();
+            printf("[Main] SMS: %u commands, %u ms mean / %u ms max; Telegram poll every %u ms (~%u ms mean wait)\n",
+                   sms_stats.commands,
+                   sms_stats.commands ? (unsigned)(sms_stats.total_latency_ms / sms_stats.commands) : 0u,
+                   sms_stats.max_latency_ms, bot->pollInterval(), bot->pollInterval() / 2);
+        }
+    });
+
     while (true) 
     {
-        // Process bot events
-        bot->loop();
-        
-        // light sleep to reduce CPU usage
-        sleep_ms(20);
+        watchdog_update();
+
+        // Fire the events that are due
+        timers.advance(to_ms_since_boot(get_absolute_time()));
+
+        // Network URCs; reconnect when the link dropped
+        link.loop();
+
+        // Commands announced by +CMTI since the last pass
+        if (sms)
+        {
+            sms->loop();
+        }
+
+        // Run the next modem transaction
+        arbiter.loop();
+
+        // A trial firmware has proved itself once it reaches Telegram
+        if (ota->onTrial())
+        {
+            if (bot->stats().polls_ok > 0)
+            {
+                ota->confirm();
+            }
+            else if (to_ms_since_boot(get_absolute_time()) > OTA_TRIAL_TIMEOUT_MS)
+            {
+                ota->rollback();
+            }
+        }
+
+        // Incoming MQTT commands and reconnection
+        if (mqtt)
+        {
+            arbiter.execute("mqttLoop", MODEM_PRIORITY_NORMAL,
+                [](Sim7670G &) { mqtt->loop(); return true; });
+        }
+
+        // Sends, the data budget, /activo and failures move these deadlines
+        timers.reschedule(bot_timer, bot_wake_time());
+        timers.reschedule(health_timer, health->nextWakeTime());
+        if (live.active())
+        {
+            timers.reschedule(live_timer, live_wake_time());
+        }
+
+        // Sleep until the next event; RI / UART activity (URCs) wakes us early
+        if (arbiter.runnable() == 0)
+        {
+            uint32_t now = to_ms_since_boot(get_absolute_time());
+            uint32_t next = timers.nextDeadline(now + POWER_MAX_SLEEP_MS);
+            if (mqtt && !mqtt->isConnected())
+            {
+                next = earliest(next, mqtt->nextReconnectTime());
+            }
+            if (link.isDown())
+            {
+                next = earliest(next, link.nextRetryTime());
+            }
+            power.sleepUntil(next);
+        }
     }
 
     delete bot;
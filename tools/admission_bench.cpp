@@ -0,0 +1,255 @@
+// Flood the getUpdates path with spam and time it
+//   admission_bench [spam_updates]
+//
+// Builds one getUpdates response with spam_updates (default 1000) messages
+// from chats outside the allow-list, a burst from one allowed chat and two
+// ordinary messages from another, then feeds it in HTTP-sized chunks through
+// TelegramUpdateStream + TelegramAdmission as TelegramBot::poll_updates does.
+// Checks which updates are kept and where the offset ends, then times the
+// response against the old path, where every update was copied, parsed,
+// printed with escape_special_characters and only then looked up in the
+// authorized list, and counts what that path printed. Any failed check
+// exits with 1.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "TelegramParser.h"
+#include "TelegramAdmission.h"
+
+// Bytes handed to the stream per call (one HTTPREAD / CCHRECV chunk)
+#define FEED_CHUNK 512
+
+// Same caps as the firmware (RX_BUFFER_SIZE, TELEGRAM_MAX_PENDING_UPDATES)
+#define MAX_UPDATE_BYTES 4096
+#define MAX_KEPT 8
+
+#define ALLOWED "123456789,-1001234567890"
+#define FLOOD_CHAT 123456789LL
+#define FRIEND_CHAT -1001234567890LL
+
+static std::string make_update(int32_t update_id, int64_t chat_id, const char* text)
+{
+    char update[768];
+    snprintf(update, sizeof(update),
+             "{\"update_id\":%d,\"message\":{\"message_id\":%d,\"from\":{\"id\":%lld,\"is_bot\":false,"
+             "\"first_name\":\"Spam \\\"bot\\\"\",\"username\":\"user%lld\",\"language_code\":\"es\"},"
+             "\"chat\":{\"id\":%lld,\"first_name\":\"Spam\",\"username\":\"user%lld\",\"type\":\"private\"},"
+             "\"date\":1760790000,\"text\":\"%s\",\"entities\":[{\"offset\":0,\"length\":9,\"type\":\"bot_command\"}]}}",
+             update_id, update_id % 10000, (long long)chat_id, (long long)chat_id,
+             (long long)chat_id, (long long)chat_id, text);
+    return update;
+}
+
+struct Flood
+{
+    std::string response;
+    std::vector<int32_t> expected;     // update_ids that must be kept, in order
+    int32_t last_update_id;
+};
+
+static Flood make_flood(int spam)
+{
+    Flood flood;
+    flood.response = "{\"ok\":true,\"result\":[";
+    int32_t update_id = 900000000;
+
+    auto add = [&](const std::string& update)
+    {
+        if (flood.response.back() != '[')
+        {
+            flood.response += ',';
+        }
+        flood.response += update;
+    };
+
+    for (int i = 0; i < spam; i++)
+    {
+        // 50 spam chats; every 40th update the allowed chat floods as well
+        add(make_update(++update_id, 5550000000LL + i % 50, "/location \\u00a1hola\\u00a1\\n\\n\\ud83d\\ude00"));
+        if (i % 40 == 0)
+        {
+            add(make_update(++update_id, FLOOD_CHAT, "/salud"));
+            if (i / 40 < TELEGRAM_CHAT_BURST)
+            {
+                flood.expected.push_back(update_id);
+            }
+        }
+        if (i == spam / 3 || i == 2 * spam / 3)
+        {
+            add(make_update(++update_id, FRIEND_CHAT, "/location"));
+            flood.expected.push_back(update_id);
+        }
+    }
+    flood.response += "]}";
+    flood.last_update_id = update_id;
+    std::sort(flood.expected.begin(), flood.expected.end());
+    return flood;
+}
+
+static void feed(TelegramUpdateStream& stream, const std::string& response)
+{
+    for (size_t pos = 0; pos < response.size(); pos += FEED_CHUNK)
+    {
+        size_t n = response.size() - pos < FEED_CHUNK ? response.size() - pos : FEED_CHUNK;
+        stream.feed(response.data() + pos, n);
+    }
+}
+
+// One response through the new path; returns the offset it leaves
+static int32_t admit_response(const std::string& response, TelegramAdmission admission, 
+                              TelegramUpdateStream& stream, uint32_t* messages)
+{
+    stream.begin([&admission](int32_t, int64_t chat_id)
+    {
+        return admission.admit(chat_id, 1000) == TELEGRAM_ADMIT;
+    });
+    feed(stream, response);
+    stream.end();
+
+    int32_t last_update_id = stream.droppedUpdateId();
+    for (const std::string& update : stream.kept())
+    {
+        int32_t max_id = telegram_parse_updates(update, last_update_id,
+            [messages](const std::string&, const std::string& text, const std::string&)
+            {
+                *messages += escape_special_characters(text).size() > 0;
+            });
+        last_update_id = max_id > last_update_id ? max_id : last_update_id;
+    }
+    return last_update_id;
+}
+
+// The same response through the old path, without its cap of MAX_KEPT updates
+static uint32_t old_response(const std::string& response, const std::vector<std::string>& authorized,
+                             uint64_t* console_bytes = nullptr)
+{
+    TelegramUpdateStream stream(MAX_UPDATE_BYTES, (size_t)-1);
+    stream.begin(nullptr);
+    feed(stream, response);
+    stream.end();
+
+    uint32_t accepted = 0;
+    static char console[8192];
+    for (const std::string& update : stream.kept())
+    {
+        // parse_updates printed the whole update, on_telegram_message the escaped text
+        int printed = snprintf(console, sizeof(console), "[TelegramBot] Parsing updates json=%s\n", update.c_str());
+        telegram_parse_updates(update, 0,
+            [&](const std::string& chat_id, const std::string& text, const std::string&)
+            {
+                printed += snprintf(console, sizeof(console), "Text: %s\n", escape_special_characters(text).c_str());
+                accepted += std::find(authorized.begin(), authorized.end(), chat_id) != authorized.end();
+            });
+        if (console_bytes)
+        {
+            *console_bytes += printed;
+        }
+    }
+    return accepted;
+}
+
+static bool check(bool ok, const char* what)
+{
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    return ok;
+}
+
+static volatile uint32_t sink;
+
+template <typename Op>
+static double time_ns(Op op)
+{
+    using clock = std::chrono::steady_clock;
+    double best = 1e30;
+    for (int round = 0; round < 5; round++)
+    {
+        const int iterations = 20;
+        auto start = clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            sink = sink + op();
+        }
+        double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / iterations;
+        best = ns < best ? ns : best;
+    }
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    int spam = argc > 1 ? atoi(argv[1]) : 1000;
+    Flood flood = make_flood(spam);
+    int total = spam + (spam + 39) / 40 + 2;
+
+    TelegramAdmission admission;
+    admission.allow(ALLOWED);
+    TelegramUpdateStream stream(MAX_UPDATE_BYTES, MAX_KEPT);
+
+    bool ok = true;
+    ok &= check(admission.allowedCount() == 2 && admission.isAllowed(FRIEND_CHAT) &&
+                !admission.isAllowed(5550000000LL), "allow-list parsed");
+
+    // Flood: only the allowed chats' first updates are kept, the offset passes all of it
+    uint32_t messages = 0;
+    int32_t offset = admit_response(flood.response, admission, stream, &messages);
+    std::vector<int32_t> kept;
+    for (const std::string& update : stream.kept())
+    {
+        int64_t chat_id;
+        kept.push_back(telegram_peek_update(update, &chat_id));
+    }
+    ok &= check(kept == flood.expected, "kept the allowed burst and both ordinary messages");
+    ok &= check(messages == flood.expected.size(), "kept updates reach the message handler");
+    ok &= check(offset == flood.last_update_id, "offset moves past every dropped update");
+    ok &= check(stream.dropped() == (uint32_t)(total - flood.expected.size()), "every other update dropped");
+
+    // Without an allow-list: the global bucket still limits, and an update left
+    // out by the cap stops the offset before it so it is fetched again
+    std::string burst = "{\"ok\":true,\"result\":[";
+    for (int i = 1; i <= 12; i++)
+    {
+        burst += (i > 1 ? "," : "") + make_update(i, 1000 + i, "/salud");
+    }
+    burst += "]}";
+    messages = 0;
+    offset = admit_response(burst, TelegramAdmission(), stream, &messages);
+    ok &= check(stream.kept().size() == MAX_KEPT && offset == MAX_KEPT, "cap keeps the offset before the first left out");
+    ok &= check(stream.dropped() == 12 - TELEGRAM_GLOBAL_BURST, "global rate drops the rest");
+
+    // A chat over its rate recovers after one refill period
+    TelegramAdmission bucket;
+    bucket.allow(ALLOWED);
+    int admitted = 0;
+    for (int i = 0; i < 20; i++)
+    {
+        admitted += bucket.admit(FLOOD_CHAT, 5000) == TELEGRAM_ADMIT;
+    }
+    ok &= check(admitted == TELEGRAM_CHAT_BURST, "chat burst");
+    ok &= check(bucket.admit(FLOOD_CHAT, 5000 + TELEGRAM_CHAT_REFILL_MS) == TELEGRAM_ADMIT &&
+                bucket.admit(FLOOD_CHAT, 5000 + TELEGRAM_CHAT_REFILL_MS) == TELEGRAM_DROP_CHAT_RATE,
+                "one token per refill period");
+
+    if (!ok)
+    {
+        return 1;
+    }
+
+    std::vector<std::string> authorized = {"123456789", "-1001234567890"};
+    double new_ns = time_ns([&]() { uint32_t n = 0; return (uint32_t)admit_response(flood.response, admission, stream, &n); });
+    double old_ns = time_ns([&]() { return old_response(flood.response, authorized); });
+
+    printf("\n%d updates, %zu bytes in one response\n", total, flood.response.size());
+    printf("%-28s %10.1f us  %7.0f ns/update\n", "admission + split", new_ns / 1e3, new_ns / total);
+    printf("%-28s %10.1f us  %7.0f ns/update\n", "old: parse, print, find", old_ns / 1e3, old_ns / total);
+    printf("speedup %.1fx\n", old_ns / new_ns);
+
+    // On the device stdout is the UART at 115200 baud: the old path printed every update
+    uint64_t old_console = 0;
+    old_response(flood.response, authorized, &old_console);
+    printf("console: old %llu bytes (%.1f s at 115200 baud), now one summary line per poll\n",
+           (unsigned long long)old_console, old_console * 10.0 / 115200);
+    return 0;
+}
@@ -0,0 +1,203 @@
+// Count what AT command batching saves on the UART, before and after
+//   at_batch_count [cmd_rtt_ms]
+//
+// Every batch the driver sends (the sim7670g_send_batch() call sites, with
+// their real commands and a typical Telegram URL) is packed with
+// sim7670g_batch_append(), the function the driver uses, and compared with
+// one command per line as before: AT lines (round trips) and bytes each way
+// with echo off (ATE0), "\r\nOK\r\n" per line and the information lines.
+//
+// Lines and bytes are exact counts. The ms column is a modelled host
+// figure: saved round trips times cmd_rtt_ms, plus the fixed sleep the PDP
+// step no longer does; on the device sim7670g_batch_stats() keeps its own
+// estimate from measured round trips. Any failed check exits with 1.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "sim7670g_parse.h"
+
+// Same as Sim7670G
+#define BATCH_MAX_LINE 256
+#define DEFAULT_CMD_RTT_MS 50
+
+#define OK_BYTES 6             // "\r\nOK\r\n"
+
+#define TELEGRAM_URL "https://api.telegram.org/bot1234567890:AAHdqTcvCH1vGWJxfSeofSAs0K5PALDsaw/getUpdates?offset=123456789&limit=100&timeout=0"
+
+struct Site
+{
+    const char* name;
+    bool at_init;              // sent on every cold init
+    std::vector<std::string> cmds;
+    std::vector<std::string> info;     // information lines in the reply
+    uint32_t sleep_removed_ms;
+};
+
+struct Count
+{
+    int lines;
+    int tx;
+    int rx;
+};
+
+static std::string url_cmd(const std::string& url)
+{
+    return "AT+HTTPPARA=\"URL\",\"" + url + "\"";
+}
+
+static int info_bytes(const Site& site)
+{
+    int bytes = 0;
+    for (const std::string& line : site.info)
+    {
+        bytes += 2 + (int)line.size() + 2;
+    }
+    return bytes;
+}
+
+static Count one_per_line(const Site& site)
+{
+    Count count = {0, 0, info_bytes(site)};
+    for (const std::string& cmd : site.cmds)
+    {
+        count.lines++;
+        count.tx += (int)cmd.size() + 2;
+        count.rx += OK_BYTES;
+    }
+    return count;
+}
+
+// Packs as sim7670g_send_batch() does; returns the lines in 'lines'
+static Count batched(const Site& site, std::vector<std::string>& lines)
+{
+    Count count = {0, 0, info_bytes(site)};
+    char line[BATCH_MAX_LINE];
+    size_t first = 0;
+    while (first < site.cmds.size())
+    {
+        int len = 0;
+        size_t last = first;
+        if (!sim7670g_batch_append(line, &len, sizeof(line), site.cmds[first].c_str()))
+        {
+            // Too long on its own: sent alone, as is
+            lines.push_back(site.cmds[first]);
+            last = first + 1;
+        }
+        else
+        {
+            last = first + 1;
+            while (last < site.cmds.size() && sim7670g_batch_append(line, &len, sizeof(line), site.cmds[last].c_str()))
+            {
+                last++;
+            }
+            lines.push_back(std::string(line, len));
+        }
+        count.lines++;
+        count.tx += (int)lines.back().size() + 2;
+        count.rx += OK_BYTES;
+        first = last;
+    }
+    return count;
+}
+
+int main(int argc, char** argv)
+{
+    double rtt_ms = argc > 1 ? atof(argv[1]) : DEFAULT_CMD_RTT_MS;
+    if (rtt_ms <= 0)
+    {
+        fprintf(stderr, "usage: %s [cmd_rtt_ms]\n", argv[0]);
+        return 1;
+    }
+
+    const std::string long_url = "https://example.com/track?" + std::string(260, 'x');
+    const std::vector<Site> sites =
+    {
+        {"network URCs", true, {"AT+CREG=1", "AT+CEREG=1", "AT+CGEREP=2,1"}, {}, 0},
+        {"PDP context", true, {"AT+CGDCONT=1,\"IP\",\"internet\"", "AT+CGACT=1,1"}, {}, 1000},
+        {"GNSS power", true, {"AT+CGNSSPWR=1", "AT+CGNSSPWR?"}, {"+CGNSSPWR: 1"}, 0},
+        {"SMS setup", false,
+         {"AT+CMGF=1", "AT+CSCS=\"IRA\"", "AT+CPMS=\"SM\",\"SM\",\"SM\"", "AT+CNMI=2,1,0,0,0"},
+         {"+CPMS: 0,10,0,10,0,10"}, 0},
+        {"HTTP GET", false,
+         {url_cmd(TELEGRAM_URL), "AT+HTTPPARA=\"USERDATA\",\"Accept-Encoding: identity\""}, {}, 0},
+        {"HTTP POST target", false,
+         {url_cmd("https://api.telegram.org/bot1234567890:AAHdqTcvCH1vGWJxfSeofSAs0K5PALDsaw/sendMessage"),
+          "AT+HTTPPARA=\"CONTENT\",\"application/json\""}, {}, 0},
+        {"long URL", false,
+         {url_cmd(long_url), "AT+HTTPPARA=\"CONTENT\",\"application/json\""}, {}, 0},
+    };
+
+    int failures = 0;
+    Count init_before = {0, 0, 0}, init_after = {0, 0, 0};
+    double init_ms = 0;
+
+    printf("Lines and bytes exact; ms modelled on the host at %.0f ms per AT round trip\n", rtt_ms);
+    printf("%-17s %11s %13s %13s %9s\n", "batch", "lines", "tx bytes", "rx bytes", "ms saved");
+    for (const Site& site : sites)
+    {
+        std::vector<std::string> lines;
+        Count before = one_per_line(site);
+        Count after = batched(site, lines);
+        double saved_ms = (before.lines - after.lines) * rtt_ms + site.sleep_removed_ms;
+
+        // Every line fits, and splitting them again gives the commands back in order
+        std::vector<std::string> unpacked;
+        for (const std::string& line : lines)
+        {
+            if (line.size() > BATCH_MAX_LINE - 3 && line.find(';') != std::string::npos)
+            {
+                fprintf(stderr, "%s: batch line of %zu bytes\n", site.name, line.size());
+                failures++;
+            }
+            size_t start = 0;
+            bool first = true;
+            while (true)
+            {
+                size_t end = line.find(";+", start);
+                std::string part = line.substr(start, end == std::string::npos ? std::string::npos : end - start);
+                unpacked.push_back(first ? part : "AT" + part);
+                first = false;
+                if (end == std::string::npos)
+                {
+                    break;
+                }
+                start = end + 1;
+            }
+        }
+        if (unpacked != site.cmds)
+        {
+            fprintf(stderr, "%s: batch lines do not split back into the commands\n", site.name);
+            failures++;
+        }
+
+        printf("%-17s %4d -> %-4d %5d -> %-5d %5d -> %-5d %9.0f\n", site.name,
+               before.lines, after.lines, before.tx, after.tx, before.rx, after.rx, saved_ms);
+
+        if (site.at_init)
+        {
+            init_before.lines += before.lines;
+            init_before.tx += before.tx;
+            init_before.rx += before.rx;
+            init_after.lines += after.lines;
+            init_after.tx += after.tx;
+            init_after.rx += after.rx;
+            init_ms += saved_ms;
+        }
+    }
+
+    printf("%-17s %4d -> %-4d %5d -> %-5d %5d -> %-5d %9.0f\n", "cold init",
+           init_before.lines, init_after.lines, init_before.tx, init_after.tx,
+           init_before.rx, init_after.rx, init_ms);
+
+    // The long URL must go alone, the short ones must share a line
+    std::vector<std::string> lines;
+    batched(sites.back(), lines);
+    if (lines.size() != 2 || lines[0] != sites.back().cmds[0])
+    {
+        fprintf(stderr, "long URL not sent on its own line\n");
+        failures++;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,96 @@
+// Modelled send time of one alert to 1..20 chats over the modem HTTP service
+//   broadcast_timing [cmd_rtt_ms] [http_action_ms]
+//
+// Host timing from a model, not a measurement on the device. Request bodies
+// are rendered with the firmware JsonWriter exactly as TelegramBot renders
+// them. The AT exchanges per request follow Sim7670G:
+//   set target   AT+HTTPPARA URL + CONTENT, one batched line
+//   body         AT+HTTPDATA, DOWNLOAD prompt, body bytes
+//   action       AT+HTTPACTION=1 until +HTTPACTION (server + network time)
+//   response     AT+HTTPREAD of the sendMessage reply
+// Each exchange costs cmd_rtt_ms plus its bytes at SIM7670G_BAUD. "separate"
+// is one sendMessage per chat, which sets the target every time. "broadcast"
+// sets it once while no other transaction moves it. "urgent wait" is the
+// longest an urgent reply queued during the broadcast waits for the modem.
+// Now one recipient holds the modem ("urgent_wait_ms"); before, the whole
+// broadcast did ("old_wait_ms"). Over the persistent TLS connection there is
+// no target to reuse, only the single escape of the text.
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "JsonWriter.h"
+
+// Defaults: AT round trip on a 115200 baud link, sendMessage over LTE
+#define DEFAULT_CMD_RTT_MS 40
+#define DEFAULT_HTTP_ACTION_MS 700
+
+#define UART_BYTES_PER_MS (115200.0 / 10.0 / 1000.0)
+#define MAX_RECIPIENTS 20
+
+static const char* ALERT = "Localizador en marcha.";
+static const char* URL = "https://api.telegram.org/bot123456789:AAHdqTcvCH1vGWJxfSeofSAs0K5PALDsaw/sendMessage";
+
+// Typical sendMessage reply for the alert above
+static const char* REPLY =
+    "{\"ok\":true,\"result\":{\"message_id\":2048,\"from\":{\"id\":7000000001,\"is_bot\":true,"
+    "\"first_name\":\"Tracker\",\"username\":\"tracker_bot\"},\"chat\":{\"id\":123456789,"
+    "\"first_name\":\"Ana\",\"username\":\"ana_gps\",\"type\":\"private\"},\"date\":1760790000,"
+    "\"text\":\"Localizador en marcha.\"}}";
+
+static double exchange_ms(double rtt_ms, size_t bytes)
+{
+    return rtt_ms + bytes / UART_BYTES_PER_MS;
+}
+
+int main(int argc, char** argv)
+{
+    double rtt_ms = argc > 1 ? atof(argv[1]) : DEFAULT_CMD_RTT_MS;
+    double action_ms = argc > 2 ? atof(argv[2]) : DEFAULT_HTTP_ACTION_MS;
+    if (rtt_ms <= 0 || action_ms <= 0)
+    {
+        fprintf(stderr, "usage: %s [cmd_rtt_ms] [http_action_ms]\n", argv[0]);
+        return 1;
+    }
+
+    std::string target_line = std::string("AT+HTTPPARA=\"URL\",\"") + URL + "\";+HTTPPARA=\"CONTENT\",\"application/json\"\r\n";
+    double target_ms = exchange_ms(rtt_ms, target_line.size());
+    double read_ms = exchange_ms(rtt_ms, strlen(REPLY) + 32);
+
+    printf("Modelled host timing: AT round trip %.0f ms, HTTPACTION %.0f ms, %.1f B/ms UART\n",
+           rtt_ms, action_ms, UART_BYTES_PER_MS);
+    printf("%10s %12s %12s %8s %14s %14s\n", "recipients", "separate_ms", "broadcast_ms", "saved",
+           "urgent_wait_ms", "old_wait_ms");
+
+    double separate_ms = 0.0;
+    double broadcast_ms = target_ms;
+    double longest_ms = 0.0;
+    for (int n = 1; n <= MAX_RECIPIENTS; n++)
+    {
+        // Supergroup-sized ids: the longest chat_id the allow-list takes
+        char chat_id[24];
+        snprintf(chat_id, sizeof(chat_id), "-100%010d", 1234567890 - n);
+
+        JsonWriter::Render render = [chat_id](JsonWriter& json)
+        {
+            json.beginObject()
+                .field("chat_id", chat_id)
+                .field("text", ALERT)
+                .endObject();
+        };
+        size_t body = JsonWriter::measure(render);
+        char data_cmd[48];
+        int data_len = snprintf(data_cmd, sizeof(data_cmd), "AT+HTTPDATA=%u,10000\r\n", (unsigned)body);
+
+        double send_ms = exchange_ms(rtt_ms, data_len + body) + action_ms + read_ms;
+        separate_ms += target_ms + send_ms;
+        broadcast_ms += send_ms;
+        // the first recipient also sets the target
+        longest_ms = std::max(longest_ms, send_ms + (n == 1 ? target_ms : 0.0));
+
+        printf("%10d %12.0f %12.0f %7.1f%% %14.0f %14.0f\n", n, separate_ms, broadcast_ms,
+               100.0 * (separate_ms - broadcast_ms) / separate_ms, longest_ms, broadcast_ms);
+    }
+    return 0;
+}
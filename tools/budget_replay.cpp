@@ -0,0 +1,177 @@
+// Replay DataBudget through month ends, reboots and the millisecond wrap
+//   budget_replay [budget_mb] [poll_ms]
+//
+// Drives tick() as TelegramBot does, with the ms-since-boot clock and the
+// modem's UTC time (0 until the network gives it), and checks:
+//  - calendar months in UTC, including February of a leap year
+//  - counters reset when the month ends, not when the ms clock wraps
+//  - the fallback period from boot when there is no network time
+//  - a reboot in mid-month carries the part before boot at budget pace
+//  - the first request of a period is not already over pace
+//  - polling at pollInterval() keeps a month of polls within its share
+// Any failed check exits with 1.
+#include <cstdio>
+#include <cstdlib>
+#include "DataBudget.h"
+
+#define FALLBACK_PERIOD_S (30u * 24u * 3600u)
+#define POLL_BYTES 900
+
+// 2026-01-31 23:59:00 UTC and 2028-02-10 12:00:00 UTC
+#define JAN_END_2026 1769903940u
+#define FEB_2028 1833796800u
+
+static int failures = 0;
+
+static void check(bool ok, const char* what)
+{
+    if (!ok)
+    {
+        fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static void day_of(const DataBudget& budget, unsigned* day, unsigned* days)
+{
+    char report[384];
+    budget.format(report, sizeof(report));
+    *day = *days = 0;
+    sscanf(report, "Datos: %*u/%*u KB (día %u de %u", day, days);
+}
+
+static void poll(DataBudget& budget)
+{
+    budget.record(DATA_CLASS_POLL, POLL_BYTES / 2, POLL_BYTES / 2, false);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t budget_mb = argc > 1 ? (uint32_t)atoi(argv[1]) : 50;
+    uint32_t poll_ms = argc > 2 ? (uint32_t)atoi(argv[2]) : 5000;
+    if (budget_mb == 0 || poll_ms == 0)
+    {
+        fprintf(stderr, "usage: %s [budget_mb] [poll_ms]\n", argv[0]);
+        return 1;
+    }
+    const uint64_t budget_bytes = (uint64_t)budget_mb * 1024 * 1024;
+    unsigned day, days;
+
+    // First request of a period
+    {
+        DataBudget budget(budget_bytes, FALLBACK_PERIOD_S);
+        budget.tick(1000, 0);
+        poll(budget);
+        check(!budget.overPace(), "first request of the period over pace");
+        budget.record(DATA_CLASS_TELEMETRY, 0, (uint32_t)(budget_bytes / 10), false);
+        check(budget.overPace(), "a tenth of the month in the first minute not over pace");
+    }
+
+    // Across the 32-bit ms wrap without network time
+    {
+        DataBudget budget(budget_bytes, FALLBACK_PERIOD_S);
+        uint32_t now = 0xFFFFFFFFu - 30u * 60u * 1000u;
+        budget.tick(now, 0);
+        poll(budget);
+        for (int i = 0; i < 720; i++)
+        {
+            now += 5000;
+            budget.tick(now, 0);
+        }
+        day_of(budget, &day, &days);
+        check(budget.used() > 0, "counters reset at the ms wrap");
+        check(day == 1 && days == 30, "fallback period miscounted across the wrap");
+    }
+
+    // Fallback period ends after 30 days from boot
+    {
+        DataBudget budget(budget_bytes, FALLBACK_PERIOD_S);
+        uint32_t now = 0;
+        int resets = 0;
+        budget.tick(now, 0);
+        poll(budget);
+        for (uint32_t minute = 0; minute < 31u * 24u * 60u; minute++)
+        {
+            now += 60000;
+            budget.tick(now, 0);
+            if (budget.used() == 0)
+            {
+                resets++;
+                poll(budget);
+            }
+        }
+        check(resets == 1, "fallback period did not end once in 31 days");
+    }
+
+    // Calendar months in UTC
+    {
+        DataBudget budget(budget_bytes, FALLBACK_PERIOD_S);
+        budget.tick(0, FEB_2028);
+        day_of(budget, &day, &days);
+        check(day == 10 && days == 29, "February 2028 is not day 10 of 29");
+
+        DataBudget month_end(budget_bytes, FALLBACK_PERIOD_S);
+        month_end.tick(0, JAN_END_2026);
+        day_of(month_end, &day, &days);
+        check(day == 31 && days == 31, "31 January 2026 is not day 31 of 31");
+        poll(month_end);
+        uint64_t before = month_end.used();
+        month_end.tick(50000, JAN_END_2026 + 50);
+        check(month_end.used() == before, "counters reset before the month ended");
+        month_end.tick(70000, JAN_END_2026 + 70);
+        day_of(month_end, &day, &days);
+        check(month_end.used() == 0 && day == 1 && days == 28, "February 2026 did not start a new period");
+    }
+
+    // Reboot in mid-month: network time arrives after 10 min of uptime
+    {
+        DataBudget budget(budget_bytes, FALLBACK_PERIOD_S);
+        const uint32_t uptime_s = 600;
+        budget.tick(0, 0);
+        poll(budget);
+        budget.tick(uptime_s * 1000, 0);
+        budget.tick(uptime_s * 1000, FEB_2028);
+        uint32_t boot_in_month_s = 9u * 86400u + 12u * 3600u - uptime_s;
+        uint64_t carried = budget_bytes * boot_in_month_s / (29u * 86400u);
+        check(budget.used() == carried + DataBudget::estimate(POLL_BYTES / 2, POLL_BYTES / 2, false),
+              "month before boot not carried at budget pace");
+        check(!budget.overPace(), "a reboot on pace is reported over pace");
+    }
+
+    // A month of polls at the stretched interval, starting on the 1st
+    {
+        DataBudget budget(budget_bytes, FALLBACK_PERIOD_S);
+        uint32_t utc = JAN_END_2026 + 60;
+        uint32_t now = 0xFFFFFFFFu - 3600u * 1000u;
+        uint32_t polls = 0, longest = 0;
+        budget.tick(now, utc);
+        const uint32_t march = JAN_END_2026 + 60 + 28u * 86400u;
+        while (true)
+        {
+            uint32_t interval = budget.pollInterval(poll_ms);
+            if (utc + interval / 1000 >= march)
+            {
+                break;
+            }
+            longest = interval > longest ? interval : longest;
+            now += interval;
+            utc += interval / 1000;
+            budget.tick(now, utc);
+            poll(budget);
+            polls++;
+        }
+        uint64_t poll_bytes = budget.usage(DATA_CLASS_POLL).bytes;
+        printf("February 2026, %u MB: %u polls, %llu KB (share %.0f %%), interval up to %u ms\n",
+               budget_mb, polls, (unsigned long long)(poll_bytes / 1024),
+               DATA_BUDGET_POLL_SHARE * 100.0, longest);
+        // Polling never slows below one poll per DATA_BUDGET_MAX_POLL_INTERVAL_MS
+        uint64_t floor_bytes = (uint64_t)(28u * 86400u / (DATA_BUDGET_MAX_POLL_INTERVAL_MS / 1000) + 1) *
+                               DataBudget::estimate(POLL_BYTES / 2, POLL_BYTES / 2, false);
+        uint64_t share_bytes = (uint64_t)(budget_bytes * DATA_BUDGET_POLL_SHARE * 1.01);
+        check(poll_bytes <= (share_bytes > floor_bytes ? share_bytes : floor_bytes),
+              "polls overran their share of the month");
+    }
+
+    printf("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,252 @@
+// Build the on-flash cell table from an OpenCellID-style CSV extract
+//   cell_build cells.csv cells.bin [--mcc 214,208] [--bench]
+//   picotool load -o 0x10200000 cells.bin
+//
+// CSV columns: radio,mcc,net,area,cell,unit,lon,lat,range,samples,...
+// (the OpenCellID export). GSM, UMTS and LTE rows are kept; NR cell ids do
+// not fit the key and the SIM7670G does not report them anyway. A first
+// line whose mcc is not a number is taken as a header. When a cell appears
+// twice the row with more samples wins.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include "CellLocator.h"
+
+struct Row
+{
+    uint64_t key;
+    uint32_t samples;
+    CellRecord record;
+};
+
+static void split_csv(const char* line, std::vector<std::string>& fields)
+{
+    fields.clear();
+    std::string field;
+    for (const char* p = line; *p && *p != '\n' && *p != '\r'; p++)
+    {
+        if (*p == ',')
+        {
+            fields.push_back(field);
+            field.clear();
+        }
+        else
+        {
+            field += *p;
+        }
+    }
+    fields.push_back(field);
+}
+
+static bool parse_uint(const std::string& text, unsigned long long* value)
+{
+    char* end = nullptr;
+    *value = strtoull(text.c_str(), &end, 10);
+    return !text.empty() && *end == '\0';
+}
+
+static double now_ms()
+{
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+static void bench(const std::vector<uint8_t>& image, const std::vector<Row>& rows)
+{
+    CellLocator locator;
+    if (!locator.open(image.data(), image.size()))
+    {
+        fprintf(stderr, "Table does not open\n");
+        return;
+    }
+
+    // Half known cells, half unknown ids in the same areas
+    std::mt19937 rng(42);
+    const int queries = 200000;
+    std::vector<sim7670g_cell_t> probes(queries);
+    for (sim7670g_cell_t& probe : probes)
+    {
+        uint64_t key = rows[rng() % rows.size()].key;
+        probe.lte = true;
+        probe.mcc = key >> 54;
+        probe.mnc = (key >> 44) & 0x3FF;
+        probe.area = (key >> 28) & 0xFFFF;
+        probe.cell_id = (rng() & 1) ? key & 0xFFFFFFF : rng() & 0xFFFFFFF;
+        probe.signal_dbm = -90;
+    }
+
+    uint32_t hits = 0;
+    double start = now_ms();
+    for (const sim7670g_cell_t& probe : probes)
+    {
+        CellFix fix;
+        hits += locator.locate(&probe, 1, &fix);
+    }
+    double elapsed = now_ms() - start;
+
+    // Every row must be found with its own position
+    int missing = 0;
+    for (const Row& row : rows)
+    {
+        sim7670g_cell_t cell = {true, (uint16_t)(row.key >> 54), (uint16_t)((row.key >> 44) & 0x3FF),
+                                (uint32_t)((row.key >> 28) & 0xFFFF), (uint32_t)(row.key & 0xFFFFFFF), 0};
+        const CellRecord* record = locator.find(cell);
+        if (!record || record->lat_e6 != row.record.lat_e6 || record->lon_e6 != row.record.lon_e6)
+        {
+            missing++;
+        }
+    }
+
+    fprintf(stderr, "Lookup: %.0f ns mean over %d queries (host, %u hits), %d/%zu cells not found\n",
+            elapsed * 1e6 / queries, queries, hits, missing, rows.size());
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s cells.csv cells.bin [--mcc 214,208] [--bench]\n", argv[0]);
+        return 1;
+    }
+
+    std::set<unsigned> mccs;
+    bool run_bench = false;
+    for (int i = 3; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--bench") == 0)
+        {
+            run_bench = true;
+        }
+        else if (strcmp(argv[i], "--mcc") == 0 && i + 1 < argc)
+        {
+            for (char* token = strtok(argv[++i], ","); token; token = strtok(nullptr, ","))
+            {
+                mccs.insert(atoi(token));
+            }
+        }
+    }
+
+    FILE* in = fopen(argv[1], "r");
+    if (!in)
+    {
+        fprintf(stderr, "Cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<Row> rows;
+    std::vector<std::string> fields;
+    char buffer[512];
+    int line_no = 0, skipped = 0;
+
+    while (fgets(buffer, sizeof(buffer), in))
+    {
+        line_no++;
+        split_csv(buffer, fields);
+
+        unsigned long long mcc, mnc, area, cell, range = 0, samples = 0;
+        if (fields.size() < 8 || !parse_uint(fields[1], &mcc))
+        {
+            if (line_no > 1 && buffer[0] != '\n' && buffer[0] != '\r')
+            {
+                skipped++;
+            }
+            continue;
+        }
+
+        const std::string& radio = fields[0];
+        char* end = nullptr;
+        double lon = strtod(fields[6].c_str(), &end);
+        bool numeric = end != fields[6].c_str();
+        double lat = strtod(fields[7].c_str(), &end);
+        numeric = numeric && end != fields[7].c_str();
+        if (fields.size() > 8)
+        {
+            parse_uint(fields[8], &range);
+        }
+        if (fields.size() > 9)
+        {
+            parse_uint(fields[9], &samples);
+        }
+
+        if ((radio != "GSM" && radio != "UMTS" && radio != "LTE") ||
+            !parse_uint(fields[2], &mnc) || !parse_uint(fields[3], &area) || !parse_uint(fields[4], &cell) ||
+            mcc > 999 || mnc > 999 || area > 0xFFFF || cell > 0xFFFFFFF ||
+            !numeric || lat < -90 || lat > 90 || lon < -180 || lon > 180)
+        {
+            skipped++;
+            continue;
+        }
+        if (!mccs.empty() && !mccs.count((unsigned)mcc))
+        {
+            continue;
+        }
+
+        Row row;
+        row.key = CellLocator::key(mcc, mnc, area, cell);
+        row.samples = (uint32_t)samples;
+        row.record = {(uint32_t)(row.key >> 32), (uint32_t)row.key,
+                      (int32_t)lround(lat * 1e6), (int32_t)lround(lon * 1e6),
+                      (uint32_t)std::min<unsigned long long>(range, UINT32_MAX)};
+        rows.push_back(row);
+    }
+    fclose(in);
+
+    double start = now_ms();
+    std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b)
+    {
+        return a.key != b.key ? a.key < b.key : a.samples > b.samples;
+    });
+    rows.erase(std::unique(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.key == b.key; }),
+               rows.end());
+    double build_ms = now_ms() - start;
+
+    if (rows.empty())
+    {
+        fprintf(stderr, "No cells\n");
+        return 1;
+    }
+
+    CellTableHeader header = {};
+    header.magic = CELL_MAGIC;
+    header.version = CELL_VERSION;
+    header.header_size = sizeof(CellTableHeader);
+    header.count = rows.size();
+    header.cells_offset = sizeof(CellTableHeader);
+
+    std::vector<uint8_t> image(header.cells_offset + rows.size() * sizeof(CellRecord));
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        memcpy(image.data() + header.cells_offset + i * sizeof(CellRecord), &rows[i].record, sizeof(CellRecord));
+    }
+    header.checksum = CellLocator::checksum(image.data() + header.cells_offset,
+                                            image.size() - header.cells_offset);
+    memcpy(image.data(), &header, sizeof(header));
+
+    FILE* out = fopen(argv[2], "wb");
+    if (!out || fwrite(image.data(), 1, image.size(), out) != image.size())
+    {
+        fprintf(stderr, "Cannot write %s\n", argv[2]);
+        return 1;
+    }
+    fclose(out);
+
+    fprintf(stderr, "%zu cells, %d lines skipped, %zu bytes (%zu B/cell), sorted in %.1f ms\n",
+            rows.size(), skipped, image.size(), sizeof(CellRecord), build_ms);
+    if (image.size() > CELL_FLASH_SIZE)
+    {
+        fprintf(stderr, "Warning: table larger than the %u byte flash region, filter with --mcc\n",
+                CELL_FLASH_SIZE);
+    }
+
+    if (run_bench)
+    {
+        bench(image, rows);
+    }
+    return 0;
+}
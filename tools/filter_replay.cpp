@@ -0,0 +1,141 @@
+// Replay a recorded GNSS track through PositionFilter and compare with ground truth
+//   filter_replay track.csv [every_n] > filtered.csv
+//
+// CSV columns: time_ms,lat,lon[,true_lat,true_lon]. Without ground truth the
+// errors are measured against the raw fixes. every_n feeds only one fix in n
+// (a lower GNSS sample rate); the others are dead-reckoned and still scored.
+//
+// Exits 2 when the filtered error is clearly worse than holding the last raw
+// fix, which is what the firmware did before the filter. corpus/drive_track.csv
+// is a synthetic 1 h drive with ground truth (4 m noise, 2% jumps of 150-800 m).
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "PositionFilter.h"
+
+// Filtered RMS allowed over the held-last-fix RMS at any sample rate
+#define FILTER_REPLAY_MAX_RATIO 1.25
+
+struct TrackPoint
+{
+    uint32_t time_ms;
+    double lat, lon;
+    double true_lat, true_lon;
+};
+
+struct ErrorStats
+{
+    double sum_sq = 0;
+    double max = 0;
+    int count = 0;
+
+    void add(double error)
+    {
+        sum_sq += error * error;
+        max = error > max ? error : max;
+        count++;
+    }
+
+    double rms() const { return count ? sqrt(sum_sq / count) : 0; }
+};
+
+static double distance_m(double lat1, double lon1, double lat2, double lon2)
+{
+    double dlat = (lat2 - lat1) * 111195.0;
+    double dlon = (lon2 - lon1) * 111195.0 * cos(lat1 * M_PI / 180.0);
+    return sqrt(dlat * dlat + dlon * dlon);
+}
+
+int main(int argc, char** argv)
+{
+    FILE* in = argc > 1 ? fopen(argv[1], "r") : stdin;
+    if (!in)
+    {
+        fprintf(stderr, "Cannot open %s\n", argv[1]);
+        return 1;
+    }
+    int every_n = argc > 2 ? atoi(argv[2]) : 1;
+    if (every_n < 1)
+    {
+        every_n = 1;
+    }
+
+    std::vector<TrackPoint> track;
+    char line[256];
+    while (fgets(line, sizeof(line), in))
+    {
+        TrackPoint p;
+        int n = sscanf(line, "%u,%lf,%lf,%lf,%lf", &p.time_ms, &p.lat, &p.lon, &p.true_lat, &p.true_lon);
+        if (n < 3)
+        {
+            continue;
+        }
+        if (n < 5)
+        {
+            p.true_lat = p.lat;
+            p.true_lon = p.lon;
+        }
+        track.push_back(p);
+    }
+    if (in != stdin)
+    {
+        fclose(in);
+    }
+
+    PositionFilter filter;
+    ErrorStats raw, held, filtered;
+    double held_lat = 0, held_lon = 0;
+    double update_ns = 0;
+    int updates = 0;
+
+    printf("time_ms,lat,lon,result\n");
+    for (size_t i = 0; i < track.size(); i++)
+    {
+        const TrackPoint& p = track[i];
+        const char* result = "predicted";
+
+        if (i % every_n == 0)
+        {
+            int32_t lat_e6 = (int32_t)lround(p.lat * 1e6);
+            int32_t lon_e6 = (int32_t)lround(p.lon * 1e6);
+
+            auto start = std::chrono::steady_clock::now();
+            FilterResult r = filter.update(p.time_ms, lat_e6, lon_e6);
+            update_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            updates++;
+
+            result = r == FILTER_ACCEPTED ? "accepted" : r == FILTER_REJECTED ? "rejected" : "reset";
+            raw.add(distance_m(p.true_lat, p.true_lon, p.lat, p.lon));
+            held_lat = p.lat;
+            held_lon = p.lon;
+        }
+
+        // What the firmware did without the filter: last raw fix until the next one
+        held.add(distance_m(p.true_lat, p.true_lon, held_lat, held_lon));
+
+        int32_t lat_e6, lon_e6;
+        if (filter.estimate(p.time_ms, &lat_e6, &lon_e6))
+        {
+            filtered.add(distance_m(p.true_lat, p.true_lon, lat_e6 / 1e6, lon_e6 / 1e6));
+            printf("%u,%.6f,%.6f,%s\n", p.time_ms, lat_e6 / 1e6, lon_e6 / 1e6, result);
+        }
+    }
+
+    const FilterStats& stats = filter.stats();
+    fprintf(stderr, "%zu points, 1 fix in %d: %u accepted, %u rejected, %u resets\n",
+            track.size(), every_n, stats.accepted, stats.rejected, stats.resets);
+    fprintf(stderr, "Raw fixes: %.1f m RMS, %.1f m max\n", raw.rms(), raw.max);
+    fprintf(stderr, "Last fix:  %.1f m RMS, %.1f m max (every point, raw fix held)\n", held.rms(), held.max);
+    fprintf(stderr, "Filtered:  %.1f m RMS, %.1f m max (every point, dead reckoning included)\n",
+            filtered.rms(), filtered.max);
+    fprintf(stderr, "Update: %.0f ns mean (host)\n", updates ? update_ns / updates : 0.0);
+
+    if (filtered.rms() > held.rms() * FILTER_REPLAY_MAX_RATIO)
+    {
+        fprintf(stderr, "FAIL: filtered RMS is over %.2fx the last-fix RMS\n", FILTER_REPLAY_MAX_RATIO);
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,313 @@
+// Build the on-flash reverse geocoding index from a CSV of named points
+//   geocode_build places.csv places.bin [--bench]
+//   picotool load -o 0x10300000 places.bin
+//
+// CSV columns: name,lat,lon[,kind] with kind town (default), road or poi.
+// Roads are given as points along them (e.g. their vertices every ~100 m).
+// A first line whose lat is not a number is taken as a header.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ReverseGeocoder.h"
+
+// Flash left for the index after GEOCODER_FLASH_OFFSET on a 4 MB part
+#define GEOCODER_FLASH_REGION (0x400000 - GEOCODER_FLASH_OFFSET)
+
+static bool split_csv(const std::string& line, std::vector<std::string>& fields)
+{
+    fields.clear();
+    std::string field;
+    bool quoted = false;
+
+    for (size_t i = 0; i < line.size(); i++)
+    {
+        char c = line[i];
+        if (quoted)
+        {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"')
+            {
+                field += '"';
+                i++;
+            }
+            else if (c == '"')
+            {
+                quoted = false;
+            }
+            else
+            {
+                field += c;
+            }
+        }
+        else if (c == '"')
+        {
+            quoted = true;
+        }
+        else if (c == ',')
+        {
+            fields.push_back(field);
+            field.clear();
+        }
+        else if (c != '\r' && c != '\n')
+        {
+            field += c;
+        }
+    }
+    fields.push_back(field);
+    return !quoted;
+}
+
+static bool parse_kind(const std::string& text, GeoKind* kind)
+{
+    if (text.empty() || text == "town")
+    {
+        *kind = GEO_KIND_TOWN;
+    }
+    else if (text == "road")
+    {
+        *kind = GEO_KIND_ROAD;
+    }
+    else if (text == "poi")
+    {
+        *kind = GEO_KIND_POI;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+// Median split on lat at even depths, lon at odd ones; node at lo + (hi - lo) / 2
+static void build_tree(std::vector<GeoNode>& nodes, size_t lo, size_t hi, int depth)
+{
+    if (hi - lo <= 1)
+    {
+        return;
+    }
+
+    size_t mid = lo + (hi - lo) / 2;
+    bool by_lon = depth & 1;
+    std::nth_element(nodes.begin() + lo, nodes.begin() + mid, nodes.begin() + hi,
+                     [by_lon](const GeoNode& a, const GeoNode& b)
+                     {
+                         return by_lon ? a.lon_e6 < b.lon_e6 : a.lat_e6 < b.lat_e6;
+                     });
+
+    build_tree(nodes, lo, mid, depth + 1);
+    build_tree(nodes, mid + 1, hi, depth + 1);
+}
+
+static double now_ms()
+{
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Same metric as ReverseGeocoder, by brute force
+static const GeoNode* brute_force(const std::vector<GeoNode>& nodes, int32_t lat, int32_t lon, uint32_t kinds)
+{
+    int32_t cos_q16 = (int32_t)(cosf(lat * 1.7453293e-8f) * 65536.0f);
+    const GeoNode* best = nullptr;
+    uint64_t best_d2 = UINT64_MAX;
+
+    for (const GeoNode& node : nodes)
+    {
+        if (!(kinds & (1u << (node.name >> 24))))
+        {
+            continue;
+        }
+        int64_t dlat = (int64_t)lat - node.lat_e6;
+        int64_t dlon = (((int64_t)lon - node.lon_e6) * cos_q16) >> 16;
+        uint64_t d2 = (uint64_t)(dlat * dlat) + (uint64_t)(dlon * dlon);
+        if (d2 < best_d2)
+        {
+            best_d2 = d2;
+            best = &node;
+        }
+    }
+    return best;
+}
+
+static void bench(const std::vector<uint8_t>& image, const std::vector<GeoNode>& nodes)
+{
+    ReverseGeocoder geocoder;
+    if (!geocoder.open(image.data(), image.size()))
+    {
+        fprintf(stderr, "Index does not open\n");
+        return;
+    }
+
+    int32_t min_lat = INT32_MAX, max_lat = INT32_MIN, min_lon = INT32_MAX, max_lon = INT32_MIN;
+    for (const GeoNode& node : nodes)
+    {
+        min_lat = std::min(min_lat, node.lat_e6);
+        max_lat = std::max(max_lat, node.lat_e6);
+        min_lon = std::min(min_lon, node.lon_e6);
+        max_lon = std::max(max_lon, node.lon_e6);
+    }
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int32_t> lat_dist(min_lat, max_lat);
+    std::uniform_int_distribution<int32_t> lon_dist(min_lon, max_lon);
+
+    const int queries = 100000;
+    std::vector<std::pair<int32_t, int32_t>> points(queries);
+    for (auto& point : points)
+    {
+        point = {lat_dist(rng), lon_dist(rng)};
+    }
+
+    GeoPlace place;
+    uint64_t checksum = 0;
+    double start = now_ms();
+    for (const auto& point : points)
+    {
+        if (geocoder.nearest(point.first, point.second, GEO_KINDS_ANY, &place))
+        {
+            checksum += place.distance_m;
+        }
+    }
+    double elapsed = now_ms() - start;
+
+    int mismatches = 0;
+    for (int i = 0; i < 1000; i++)
+    {
+        const GeoNode* expected = brute_force(nodes, points[i].first, points[i].second, GEO_KINDS_ANY);
+        geocoder.nearest(points[i].first, points[i].second, GEO_KINDS_ANY, &place);
+        if (!expected || expected->lat_e6 != place.lat_e6 || expected->lon_e6 != place.lon_e6)
+        {
+            mismatches++;
+        }
+    }
+
+    fprintf(stderr, "Lookup: %.0f ns mean over %d queries (host), %d/1000 differ from brute force [%llu]\n",
+            elapsed * 1e6 / queries, queries, mismatches, (unsigned long long)(checksum & 1));
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s places.csv places.bin [--bench]\n", argv[0]);
+        return 1;
+    }
+
+    FILE* in = fopen(argv[1], "r");
+    if (!in)
+    {
+        fprintf(stderr, "Cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<GeoNode> nodes;
+    std::string names(1, '\0');     // offset 0 = empty name
+    std::unordered_map<std::string, uint32_t> name_offsets;
+    std::vector<std::string> fields;
+    char buffer[1024];
+    int line_no = 0;
+
+    while (fgets(buffer, sizeof(buffer), in))
+    {
+        line_no++;
+        if (!split_csv(buffer, fields) || fields.size() < 3)
+        {
+            if (buffer[0] != '\n' && buffer[0] != '\r')
+            {
+                fprintf(stderr, "Line %d skipped\n", line_no);
+            }
+            continue;
+        }
+
+        char* end = nullptr;
+        double lat = strtod(fields[1].c_str(), &end);
+        bool numeric = end != fields[1].c_str();
+        double lon = strtod(fields[2].c_str(), &end);
+        numeric = numeric && end != fields[2].c_str();
+
+        GeoKind kind;
+        if (!numeric || lat < -90 || lat > 90 || lon < -180 || lon > 180 ||
+            !parse_kind(fields.size() > 3 ? fields[3] : "", &kind))
+        {
+            if (line_no > 1)
+            {
+                fprintf(stderr, "Line %d skipped\n", line_no);
+            }
+            continue;
+        }
+
+        auto found = name_offsets.find(fields[0]);
+        uint32_t offset;
+        if (found != name_offsets.end())
+        {
+            offset = found->second;
+        }
+        else
+        {
+            offset = names.size();
+            names += fields[0];
+            names += '\0';
+            name_offsets[fields[0]] = offset;
+        }
+
+        nodes.push_back({(int32_t)lround(lat * 1e6), (int32_t)lround(lon * 1e6),
+                         (uint32_t)kind << 24 | offset});
+    }
+    fclose(in);
+
+    if (nodes.empty() || names.size() >= (1u << 24))
+    {
+        fprintf(stderr, "%s\n", nodes.empty() ? "No places" : "Name table over 16 MB");
+        return 1;
+    }
+
+    double start = now_ms();
+    build_tree(nodes, 0, nodes.size(), 0);
+    double build_ms = now_ms() - start;
+
+    GeoIndexHeader header = {};
+    header.magic = GEOCODER_MAGIC;
+    header.version = GEOCODER_VERSION;
+    header.header_size = sizeof(GeoIndexHeader);
+    header.count = nodes.size();
+    header.nodes_offset = sizeof(GeoIndexHeader);
+    header.names_offset = header.nodes_offset + nodes.size() * sizeof(GeoNode);
+    header.names_size = names.size();
+
+    std::vector<uint8_t> image(header.names_offset + header.names_size);
+    memcpy(image.data() + header.nodes_offset, nodes.data(), nodes.size() * sizeof(GeoNode));
+    memcpy(image.data() + header.names_offset, names.data(), names.size());
+    header.checksum = ReverseGeocoder::checksum(image.data() + header.nodes_offset,
+                                                image.size() - header.nodes_offset);
+    memcpy(image.data(), &header, sizeof(header));
+
+    // The firmware would read past its region: never write such an image
+    if (image.size() > GEOCODER_FLASH_REGION)
+    {
+        fprintf(stderr, "Index of %zu bytes does not fit the %u byte flash region\n",
+                image.size(), GEOCODER_FLASH_REGION);
+        return 1;
+    }
+
+    FILE* out = fopen(argv[2], "wb");
+    if (!out || fwrite(image.data(), 1, image.size(), out) != image.size())
+    {
+        fprintf(stderr, "Cannot write %s\n", argv[2]);
+        return 1;
+    }
+    fclose(out);
+
+    fprintf(stderr, "%zu places, %zu names, %zu bytes (%.1f B/place), built in %.1f ms\n",
+            nodes.size(), name_offsets.size(), image.size(),
+            (double)image.size() / nodes.size(), build_ms);
+    if (argc > 3 && strcmp(argv[3], "--bench") == 0)
+    {
+        bench(image, nodes);
+    }
+    return 0;
+}
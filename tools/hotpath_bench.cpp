@@ -0,0 +1,504 @@
+// Time the parsers that run on every poll and fix against a recorded corpus
+//   hotpath_bench <corpus_dir> [-o results.json] [--compare baseline.json]
+//
+// The TextScan scanners are first checked against byte loops: every byte
+// value at every position and alignment of short buffers, every pair of
+// positions, then random buffers. Any mismatch exits with 1. Only the
+// word-at-a-time ones are timed against the byte loop.
+//
+// Results are one JSON object per line so two runs (e.g. before and after a
+// commit) can be compared with --compare, which prints the change per case.
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include "TelegramParser.h"
+#include "sim7670g_parse.h"
+#include "TextScan.h"
+
+struct BenchResult
+{
+    std::string name;
+    double ns_per_op;
+    size_t bytes;          // input bytes per op
+};
+
+static bool read_file(const std::string& path, std::string* out)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f)
+    {
+        fprintf(stderr, "Cannot open %s\n", path.c_str());
+        return false;
+    }
+    char chunk[4096];
+    size_t n;
+    out->clear();
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+    {
+        out->append(chunk, n);
+    }
+    fclose(f);
+    return true;
+}
+
+struct Scanner
+{
+    const char* name;
+    size_t (*find)(const char*, size_t);
+    bool (*hit)(uint8_t);
+    bool swar;             // word at a time; the others are byte loops already
+};
+
+static const Scanner scanners[] =
+{
+    {"newline", text_find_newline, [](uint8_t c) { return c == '\n'; }, true},
+    {"quote_or_backslash", text_find_quote_or_backslash, [](uint8_t c) { return c == '"' || c == '\\'; }, false},
+    {"json_structural", text_find_json_structural, [](uint8_t c) { return c == '"' || c == '{' || c == '}'; }, false},
+    {"json_escape", text_find_json_escape, [](uint8_t c) { return c == '"' || c == '\\' || c < 0x20; }, true},
+};
+
+static size_t find_bytewise(const Scanner& scanner, const char* text, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (scanner.hit((uint8_t)text[i]))
+        {
+            return i;
+        }
+    }
+    return len;
+}
+
+// Known positions for corpus/cgpsinfo.txt, in file order: W and E longitudes,
+// S latitude and a line without a fix; utc is the fix time as Unix time
+struct GpsExpect
+{
+    bool fix;
+    double lat;
+    double lon;
+    uint32_t utc;
+};
+
+static const GpsExpect gps_expected[] =
+{
+    {true, 40.416775, -3.703790, 1792318512},
+    {true, 40.416872, -3.703331, 1792318542},
+    {true, -33.859200, 151.209783, 1792318572},
+    {false, 0.0, 0.0, 0},
+    {true, 51.507481, -0.127354, 1792318632},
+};
+
+static bool check_cgpsinfo(const std::vector<std::string>& lines)
+{
+    size_t count = sizeof(gps_expected) / sizeof(gps_expected[0]);
+    if (lines.size() != count)
+    {
+        fprintf(stderr, "cgpsinfo: %zu corpus lines, %zu expected\n", lines.size(), count);
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const GpsExpect& want = gps_expected[i];
+        double lat = 0.0, lon = 0.0;
+        bool fix = sim7670g_parse_cgpsinfo(lines[i].c_str(), &lat, &lon);
+        if (fix != want.fix ||
+            (fix && (fabs(lat - want.lat) > 1e-6 || fabs(lon - want.lon) > 1e-6)))
+        {
+            fprintf(stderr, "cgpsinfo line %zu: expected %s %.6f,%.6f, got %s %.6f,%.6f\n", i + 1,
+                    want.fix ? "fix" : "no fix", want.lat, want.lon, fix ? "fix" : "no fix", lat, lon);
+            return false;
+        }
+
+        uint32_t utc = 0;
+        if (sim7670g_parse_cgpsinfo_utc(lines[i].c_str(), &utc) != want.fix || utc != want.utc)
+        {
+            fprintf(stderr, "cgpsinfo line %zu: expected UTC %u, got %u\n", i + 1, want.utc, utc);
+            return false;
+        }
+    }
+    return true;
+}
+
+// +CCLK is local time with the zone in quarter hours; the 1980 RTC default means "not set"
+static bool check_cclk()
+{
+    struct
+    {
+        const char* line;
+        bool valid;
+        uint32_t utc;
+    } cases[] =
+    {
+        {"+CCLK: \"26/10/18,12:15:12+08\"", true, 1792318512},
+        {"+CCLK: \"26/10/18,06:15:12-16\"", true, 1792318512},
+        {"+CCLK: \"26/10/18,10:15:12+00\"", true, 1792318512},
+        {"+CCLK: \"80/01/06,00:01:02+00\"", false, 0},
+        {"+CCLK: \"26/13/18,10:15:12+00\"", false, 0},
+    };
+
+    for (const auto& c : cases)
+    {
+        uint32_t utc = 0;
+        if (sim7670g_parse_cclk(c.line, &utc) != c.valid || utc != c.utc)
+        {
+            fprintf(stderr, "cclk %s: expected %s %u, got %u\n", c.line, c.valid ? "valid" : "invalid", c.utc, utc);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool check_scanner(const Scanner& scanner)
+{
+    alignas(4) char buffer[80];
+    uint64_t cases = 0;
+
+    auto expect = [&](const char* text, size_t len)
+    {
+        cases++;
+        size_t want = find_bytewise(scanner, text, len);
+        size_t got = scanner.find(text, len);
+        if (got != want)
+        {
+            fprintf(stderr, "%s: mismatch, len %zu, expected %zu, got %zu\n", scanner.name, len, want, got);
+            return false;
+        }
+        return true;
+    };
+
+    // Short buffers at every alignment: any byte at any position, then any byte
+    // before a hit (borrows in the word test must not move the answer)
+    for (size_t align = 0; align < 4; align++)
+    {
+        char* text = buffer + align;
+        for (size_t len = 0; len <= 16; len++)
+        {
+            for (size_t first = 0; first < len; first++)
+            {
+                for (int b = 0; b < 256; b++)
+                {
+                    memset(text, 'a', len);
+                    text[first] = (char)b;
+                    if (!expect(text, len))
+                    {
+                        return false;
+                    }
+
+                    for (size_t second = first + 1; second < len; second++)
+                    {
+                        for (int h = 0; h < 256; h++)
+                        {
+                            if (!scanner.hit((uint8_t)h))
+                            {
+                                continue;
+                            }
+                            memset(text, 'a', len);
+                            text[first] = (char)b;
+                            text[second] = (char)h;
+                            if (!expect(text, len))
+                            {
+                                return false;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Random buffers, mostly plain text with a few hits
+    std::mt19937 rng(42);
+    for (int round = 0; round < 200000; round++)
+    {
+        size_t align = rng() % 4;
+        size_t len = rng() % 64;
+        for (size_t i = 0; i < len; i++)
+        {
+            buffer[align + i] = (rng() % 16) ? (char)(' ' + rng() % 95) : (char)(rng() % 256);
+        }
+        if (!expect(buffer + align, len))
+        {
+            return false;
+        }
+    }
+
+    printf("%s: %llu cases match the byte loop\n", scanner.name, (unsigned long long)cases);
+    return true;
+}
+
+static volatile uint32_t sink;
+
+// Best of 5 rounds, each long enough (~50 ms) to hide the clock resolution
+static BenchResult run(const char* name, size_t bytes, const std::function<uint32_t()>& op)
+{
+    using clock = std::chrono::steady_clock;
+
+    uint64_t iterations = 1;
+    while (true)
+    {
+        auto start = clock::now();
+        for (uint64_t i = 0; i < iterations; i++)
+        {
+            sink = sink + op();
+        }
+        if (clock::now() - start > std::chrono::milliseconds(50))
+        {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    double best = 1e30;
+    for (int round = 0; round < 5; round++)
+    {
+        auto start = clock::now();
+        for (uint64_t i = 0; i < iterations; i++)
+        {
+            sink = sink + op();
+        }
+        double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / iterations;
+        best = ns < best ? ns : best;
+    }
+    return {name, best, bytes};
+}
+
+static std::string to_json(const BenchResult& r)
+{
+    char line[192];
+    snprintf(line, sizeof(line), "{\"name\": \"%s\", \"ns_per_op\": %.1f, \"bytes\": %zu, \"mb_per_s\": %.1f}",
+             r.name.c_str(), r.ns_per_op, r.bytes, r.bytes ? r.bytes * 1e3 / r.ns_per_op : 0.0);
+    return line;
+}
+
+static bool find_baseline(const std::string& json, const std::string& name, double* ns)
+{
+    size_t at = json.find("\"name\": \"" + name + "\"");
+    if (at == std::string::npos)
+    {
+        return false;
+    }
+    size_t value = json.find("\"ns_per_op\":", at);
+    return value != std::string::npos && sscanf(json.c_str() + value + 12, "%lf", ns) == 1;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <corpus_dir> [-o results.json] [--compare baseline.json]\n", argv[0]);
+        return 1;
+    }
+
+    std::string dir = argv[1];
+    const char* out_path = nullptr;
+    const char* baseline_path = nullptr;
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "-o") == 0)
+        {
+            out_path = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "--compare") == 0)
+        {
+            baseline_path = argv[i + 1];
+        }
+    }
+
+    for (const Scanner& scanner : scanners)
+    {
+        if (!check_scanner(scanner))
+        {
+            return 1;
+        }
+    }
+
+    std::string single, backlog, empty, httpread, gps;
+    if (!read_file(dir + "/getupdates_single.json", &single) ||
+        !read_file(dir + "/getupdates_backlog.json", &backlog) ||
+        !read_file(dir + "/getupdates_empty.json", &empty) ||
+        !read_file(dir + "/httpread_backlog.txt", &httpread) ||
+        !read_file(dir + "/cgpsinfo.txt", &gps))
+    {
+        return 1;
+    }
+
+    // Message texts from the corpus, for the escaping case
+    std::vector<std::string> texts;
+    size_t text_bytes = 0;
+    telegram_parse_updates(backlog, 0, [&](const std::string&, const std::string& text, const std::string&)
+    {
+        texts.push_back(text);
+        text_bytes += text.size();
+    });
+
+    std::vector<std::string> gps_lines;
+    size_t gps_bytes = 0;
+    for (size_t start = 0, end; (end = gps.find('\n', start)) != std::string::npos; start = end + 1)
+    {
+        gps_lines.push_back(gps.substr(start, end - start));
+        gps_bytes += end - start;
+    }
+
+    if (!check_cgpsinfo(gps_lines) || !check_cclk())
+    {
+        return 1;
+    }
+
+    auto count_messages = [](const std::string& json)
+    {
+        uint32_t n = 0;
+        telegram_parse_updates(json, 0, [&n](const std::string&, const std::string&, const std::string&) { n++; });
+        return n;
+    };
+
+    std::vector<BenchResult> results;
+    results.push_back(run("parse_updates/empty", empty.size(), [&]() { return count_messages(empty); }));
+    results.push_back(run("parse_updates/single", single.size(), [&]() { return count_messages(single); }));
+    results.push_back(run("parse_updates/backlog8", backlog.size(), [&]() { return count_messages(backlog); }));
+
+    results.push_back(run("json_field/text", single.size(), [&]()
+    {
+        return (uint32_t)telegram_json_field(single, "\"text\"").size();
+    }));
+    results.push_back(run("json_field/missing", backlog.size(), [&]()
+    {
+        return (uint32_t)telegram_json_field(backlog, "\"caption\"").size();
+    }));
+
+    results.push_back(run("escape/messages", text_bytes, [&]()
+    {
+        uint32_t n = 0;
+        for (const std::string& text : texts)
+        {
+            n += escape_special_characters(text).size();
+        }
+        return n;
+    }));
+
+    // Framed read as sim7670g_http_read_chunk does it: header lines, then exactly n body bytes
+    std::vector<char> body(httpread.size());
+    results.push_back(run("httpread/frames", httpread.size(), [&]()
+    {
+        char line[64];
+        int line_len = 0;
+        uint32_t copied = 0;
+        for (size_t i = 0; i < httpread.size(); i++)
+        {
+            char c = httpread[i];
+            if (c == '\r')
+            {
+                continue;
+            }
+            if (c != '\n')
+            {
+                if (line_len < (int)sizeof(line) - 1)
+                {
+                    line[line_len++] = c;
+                }
+                continue;
+            }
+            line[line_len] = '\0';
+            int n = line_len ? sim7670g_parse_httpread(line) : -1;
+            line_len = 0;
+            if (n == 0)
+            {
+                break;
+            }
+            if (n > 0 && i + 1 + n <= httpread.size())
+            {
+                memcpy(&body[copied], &httpread[i + 1], n);
+                copied += n;
+                i += n;
+            }
+        }
+        return copied;
+    }));
+
+    results.push_back(run("cgpsinfo/lines", gps_bytes, [&]()
+    {
+        uint32_t fixes = 0;
+        for (const std::string& line : gps_lines)
+        {
+            double lat, lon;
+            fixes += sim7670g_parse_cgpsinfo(line.c_str(), &lat, &lon);
+        }
+        return fixes;
+    }));
+
+    // Every hit in the backlog, word at a time and byte by byte
+    for (const Scanner& scanner : scanners)
+    {
+        if (!scanner.swar)
+        {
+            continue;
+        }
+        std::string name = std::string("scan/") + scanner.name;
+        auto count_hits = [&](bool words)
+        {
+            uint32_t hits = 0;
+            const char* text = backlog.data();
+            size_t len = backlog.size();
+            for (size_t i = 0; i < len; i++)
+            {
+                i += words ? scanner.find(text + i, len - i) : find_bytewise(scanner, text + i, len - i);
+                hits += i < len;
+            }
+            return hits;
+        };
+        results.push_back(run((name + "/bytes").c_str(), backlog.size(), [&]() { return count_hits(false); }));
+        results.push_back(run((name + "/swar").c_str(), backlog.size(), [&]() { return count_hits(true); }));
+    }
+
+    std::string report = "[\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        report += "  " + to_json(results[i]) + (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    report += "]\n";
+
+    if (out_path)
+    {
+        FILE* out = fopen(out_path, "w");
+        if (!out)
+        {
+            fprintf(stderr, "Cannot write %s\n", out_path);
+            return 1;
+        }
+        fputs(report.c_str(), out);
+        fclose(out);
+    }
+    else if (!baseline_path)
+    {
+        fputs(report.c_str(), stdout);
+    }
+
+    if (baseline_path)
+    {
+        std::string baseline;
+        if (!read_file(baseline_path, &baseline))
+        {
+            return 1;
+        }
+        printf("%-34s %12s %12s %8s\n", "case", "baseline ns", "now ns", "change");
+        for (const BenchResult& r : results)
+        {
+            double before;
+            if (find_baseline(baseline, r.name, &before))
+            {
+                printf("%-34s %12.1f %12.1f %+7.1f%%\n", r.name.c_str(), before, r.ns_per_op,
+                       (r.ns_per_op - before) * 100.0 / before);
+            }
+            else
+            {
+                printf("%-34s %12s %12.1f %8s\n", r.name.c_str(), "-", r.ns_per_op, "new");
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,198 @@
+// Feed recorded HTTP/1.1 responses through HttpResponse in every split
+//   http_replay <corpus_dir>
+//
+// The getUpdates bodies in corpus_dir are framed the ways api.telegram.org
+// and proxies answer: Content-Length, chunked, until the connection closes,
+// HTTP/1.0, errors and two responses back to back on one keep-alive socket.
+// Each response is fed whole, one byte at a time and in HTTP_CLIENT_RX_CHUNK
+// pieces (one AT+CCHRECV), as HttpClient::read_response does, and every
+// split must give the same status, keep-alive, body and bytes used. Broken
+// responses (bad status line or chunk size, connection closed mid-body)
+// must fail. Any failed check exits with 1.
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "HttpResponse.h"
+
+// HTTP_CLIENT_RX_CHUNK, HttpClient's socket buffer
+#define RX_CHUNK 512
+
+struct Case
+{
+    std::string name;
+    std::string wire;      // bytes on the socket; may hold the next response too
+    bool closes;           // the server closes after 'wire'
+    bool ok;
+    int status;
+    bool keep_alive;
+    std::string body;
+    size_t used;           // bytes of 'wire' that belong to this response
+    size_t refuse_after;   // consumer refuses data past this many bytes (0 = never)
+};
+
+struct Result
+{
+    bool done = false;
+    bool failed = false;
+    int status = 0;
+    bool keep_alive = false;
+    std::string body;
+    size_t used = 0;
+};
+
+static std::string read_file(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream data;
+    data << in.rdbuf();
+    return data.str();
+}
+
+static std::string chunked(const std::string& body, size_t chunk)
+{
+    std::string out;
+    char size[32];
+    for (size_t pos = 0; pos < body.size(); pos += chunk)
+    {
+        std::string piece = body.substr(pos, chunk);
+        snprintf(size, sizeof(size), pos == 0 ? "%zx;ext=1\r\n" : "%zX\r\n", piece.size());
+        out += size + piece + "\r\n";
+    }
+    return out + "0\r\nX-Trailer: 1\r\n\r\n";
+}
+
+static Result replay(const Case& c, size_t split)
+{
+    Result result;
+    HttpResponse response;
+    response.begin([&](const char* data, int len)
+    {
+        if (c.refuse_after && result.body.size() >= c.refuse_after)
+        {
+            return false;
+        }
+        result.body.append(data, len);
+        return true;
+    });
+
+    size_t pos = 0;
+    while (!response.done() && !response.failed())
+    {
+        if (pos >= c.wire.size())
+        {
+            if (!c.closes)
+            {
+                break;
+            }
+            response.closed();
+            break;
+        }
+        size_t n = c.wire.size() - pos < split ? c.wire.size() - pos : split;
+        int used = response.feed(c.wire.data() + pos, (int)n);
+        pos += used;
+        if ((size_t)used < n && !response.done())
+        {
+            fprintf(stderr, "%s: feed stopped at %zu before the end\n", c.name.c_str(), pos);
+            break;
+        }
+    }
+
+    result.done = response.done();
+    result.failed = response.failed();
+    result.status = response.status();
+    result.keep_alive = response.keepAlive();
+    result.used = pos;
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <corpus_dir>\n", argv[0]);
+        return 1;
+    }
+
+    std::string dir = argv[1];
+    std::string backlog = read_file(dir + "/getupdates_backlog.json");
+    std::string single = read_file(dir + "/getupdates_single.json");
+    std::string empty = read_file(dir + "/getupdates_empty.json");
+    if (backlog.empty() || single.empty() || empty.empty())
+    {
+        fprintf(stderr, "cannot read the getupdates_*.json corpus in %s\n", dir.c_str());
+        return 1;
+    }
+
+    const std::string ok_head = "HTTP/1.1 200 OK\r\nServer: nginx/1.18.0\r\nContent-Type: application/json\r\n";
+    std::string long_header = "X-Long: " + std::string(600, 'a') + "\r\n";
+    std::string first = ok_head + "Content-Length: " + std::to_string(single.size()) + "\r\n\r\n" + single;
+    std::string second = ok_head + "Content-Length: " + std::to_string(empty.size()) + "\r\n\r\n" + empty;
+    std::string refused = ok_head + "Transfer-Encoding: chunked\r\n\r\n" + chunked(backlog, 300);
+
+    std::vector<Case> cases =
+    {
+        {"content-length", ok_head + "Content-Length: " + std::to_string(backlog.size()) + "\r\n\r\n" + backlog,
+         false, true, 200, true, backlog, 0, 0},
+        {"chunked", ok_head + "Transfer-Encoding: chunked\r\n\r\n" + chunked(backlog, 700),
+         false, true, 200, true, backlog, 0, 0},
+        {"until close", ok_head + "Connection: close\r\n\r\n" + backlog, true, true, 200, false, backlog, 0, 0},
+        {"http/1.0", "HTTP/1.0 200 OK\r\nContent-Length: " + std::to_string(empty.size()) + "\r\n\r\n" + empty,
+         false, true, 200, false, empty, 0, 0},
+        {"lowercase headers, LF only", "HTTP/1.1 200 OK\ncontent-length: " + std::to_string(single.size()) + "\n\n" + single,
+         false, true, 200, true, single, 0, 0},
+        {"long header line", ok_head + long_header + "Content-Length: " + std::to_string(empty.size()) + "\r\n\r\n" + empty,
+         false, true, 200, true, empty, 0, 0},
+        {"error with body", "HTTP/1.1 409 Conflict\r\nContent-Length: 21\r\n\r\n{\"ok\":false,\"x\":409}\n",
+         false, true, 409, true, "{\"ok\":false,\"x\":409}\n", 0, 0},
+        {"empty body", "HTTP/1.1 204 No Content\r\nContent-Length: 0\r\n\r\n", false, true, 204, true, "", 0, 0},
+        {"keep-alive, next response queued", first + second, false, true, 200, true, single, first.size(), 0},
+        {"consumer refuses, rest drained", refused + second, false, true, 200, true, "", refused.size(), 600},
+        {"bad status line", "<html>gateway</html>\r\n", false, false, 0, false, "", 0, 0},
+        {"bad chunk size", ok_head + "Transfer-Encoding: chunked\r\n\r\nzz\r\n", false, false, 200, false, "", 0, 0},
+        {"closed mid-body", ok_head + "Content-Length: 5000\r\n\r\n" + backlog, true, false, 200, false, backlog, 0, 0},
+    };
+
+    int failures = 0;
+    for (Case& c : cases)
+    {
+        if (c.used == 0)
+        {
+            c.used = c.wire.size();
+        }
+        if (c.refuse_after)
+        {
+            // whole chunks are delivered until the consumer says no
+            c.body.clear();
+        }
+
+        int case_failures = 0;
+        const size_t splits[] = {c.wire.size(), 1, RX_CHUNK};
+        for (size_t split : splits)
+        {
+            Result r = replay(c, split);
+            bool body_ok = c.refuse_after ? r.body.size() >= c.refuse_after && r.body.size() < backlog.size() &&
+                                            backlog.compare(0, r.body.size(), r.body) == 0
+                                          : r.body == c.body;
+            bool ok = r.done == c.ok && r.failed == !c.ok && r.status == c.status &&
+                      r.keep_alive == c.keep_alive && body_ok && (!c.ok || r.used == c.used);
+            if (!ok)
+            {
+                fprintf(stderr, "%s (split %zu): %s status %d keep-alive %d, %zu body bytes, %zu used; "
+                        "expected %s status %d keep-alive %d, %zu body bytes, %zu used\n",
+                        c.name.c_str(), split, r.done ? "done" : r.failed ? "failed" : "incomplete",
+                        r.status, r.keep_alive, r.body.size(), r.used, c.ok ? "done" : "failed",
+                        c.status, c.keep_alive, c.body.size(), c.used);
+                case_failures++;
+            }
+        }
+        printf("%-34s %-6s %5zu bytes%s\n", c.name.c_str(), c.ok ? "done" : "failed", c.wire.size(),
+               case_failures ? "  FAIL" : "");
+        failures += case_failures;
+    }
+
+    printf("%zu responses x 3 splits, %d failures\n", cases.size(), failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,175 @@
+// Time and check JsonWriter on sendMessage bodies
+//   json_bench [iterations]
+//
+// Each text is rendered as TelegramBot renders {"chat_id","text"}: a
+// counting pass for the AT+HTTPDATA size, then a pass through the 256-byte
+// chunk buffer into a sink that stands in for the UART. The output must match
+// a reference escaper byte for byte and the counted size, and a sink that
+// refuses data must make finish() fail (Sim7670G then drops the POST). It is
+// timed against the old body, snprintf into a 512-byte buffer without
+// escaping, and the old body is checked for what it got wrong. Host timing
+// only. Any failed check exits with 1.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "JsonWriter.h"
+
+#define CHAT_ID "-1001234567890"
+
+// Old TelegramBot::sendMessage buffer
+#define OLD_BODY_SIZE 512
+
+struct Sample
+{
+    const char* name;
+    std::string text;
+};
+
+// Reference: quotes, backslash and control characters escaped, UTF-8 as is
+static std::string escape_reference(const std::string& text)
+{
+    std::string out = "\"";
+    for (unsigned char c : text)
+    {
+        switch (c)
+        {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            default:
+                if (c < 0x20)
+                {
+                    char hex[8];
+                    snprintf(hex, sizeof(hex), "\\u%04x", c);
+                    out += hex;
+                }
+                else
+                {
+                    out += (char)c;
+                }
+        }
+    }
+    return out + "\"";
+}
+
+static JsonWriter::Render message(const char* text)
+{
+    return [text](JsonWriter& json)
+    {
+        json.beginObject()
+            .field("chat_id", CHAT_ID)
+            .field("text", text)
+            .endObject();
+    };
+}
+
+// Counted size, then the chunked write; returns false with 'out' as written
+static bool render(const JsonWriter::Render& body, std::string& out, size_t* counted, size_t refuse_after = 0)
+{
+    *counted = JsonWriter::measure(body);
+    out.clear();
+    JsonWriter::Sink sink = [&out, refuse_after](const char* data, int len)
+    {
+        if (refuse_after && out.size() + len > refuse_after)
+        {
+            return false;
+        }
+        out.append(data, len);
+        return true;
+    };
+    char chunk[JSON_WRITER_CHUNK];
+    JsonWriter json(chunk, sizeof(chunk), sink);
+    body(json);
+    return json.finish();
+}
+
+template <typename F>
+static double time_ns(uint32_t iterations, F&& f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        f();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t iterations = argc > 1 ? (uint32_t)atoi(argv[1]) : 100000;
+    if (iterations == 0)
+    {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    std::string trip;
+    for (int i = 0; i < 24; i++)
+    {
+        trip += "Tramo " + std::to_string(i + 1) + ": 12.4 km, 00:18:32, \"Calle Mayor\"\n";
+    }
+
+    Sample samples[] =
+    {
+        {"alert", "Localizador en marcha."},
+        {"location", "Ubicación actual:\nLatitud: 40.416775\nLongitud: -3.703790\nhttps://maps.google.com/?q=40.416775,-3.703790"},
+        {"escapes", "Ruta: C:\\datos\\ruta.gpx\tok {\"a\":1} \x01\x1f ¿Dónde? 🚗"},
+        {"trip", trip},
+    };
+
+    printf("Host timing, %u iterations\n", iterations);
+    printf("%-10s %6s %6s %12s %12s  %s\n", "body", "bytes", "old_B", "writer_ns", "old_ns", "old body");
+
+    int failures = 0;
+    for (const Sample& sample : samples)
+    {
+        const char* text = sample.text.c_str();
+        JsonWriter::Render body = message(text);
+        std::string expected = "{\"chat_id\":" + escape_reference(CHAT_ID) + ",\"text\":" + escape_reference(sample.text) + "}";
+
+        std::string out;
+        size_t counted = 0;
+        if (!render(body, out, &counted) || out != expected || counted != expected.size())
+        {
+            fprintf(stderr, "%s: expected %zu bytes %s\n  got %zu (counted %zu) %s\n", sample.name,
+                    expected.size(), expected.c_str(), out.size(), counted, out.c_str());
+            failures++;
+            continue;
+        }
+
+        // A refused chunk must fail the body, never look complete
+        if (counted > JSON_WRITER_CHUNK && render(body, out, &counted, JSON_WRITER_CHUNK))
+        {
+            fprintf(stderr, "%s: sink refused data but finish() succeeded\n", sample.name);
+            failures++;
+        }
+
+        char old_body[OLD_BODY_SIZE];
+        int old_len = snprintf(old_body, sizeof(old_body), "{\"chat_id\":\"%s\",\"text\":\"%s\"}", CHAT_ID, text);
+        const char* old_verdict = old_len >= OLD_BODY_SIZE ? "truncated"
+                                  : strcmp(old_body, expected.c_str()) != 0 ? "invalid JSON" : "ok";
+
+        std::string sink_copy;
+        sink_copy.reserve(expected.size());
+        double writer_ns = time_ns(iterations, [&]()
+        {
+            render(body, sink_copy, &counted);
+        });
+        volatile int keep = 0;
+        double old_ns = time_ns(iterations, [&]()
+        {
+            keep += snprintf(old_body, sizeof(old_body), "{\"chat_id\":\"%s\",\"text\":\"%s\"}", CHAT_ID, text);
+        });
+
+        printf("%-10s %6zu %6d %12.0f %12.0f  %s\n", sample.name, counted,
+               old_len < OLD_BODY_SIZE ? old_len : OLD_BODY_SIZE - 1, writer_ns, old_ns, old_verdict);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,76 @@
+// Sign a firmware image for OtaUpdater
+//   ota_pack <firmware.bin> <firmware.ota> <version> <hmac_key>
+//   ota_pack --device-key <master_key> <device_id>
+//
+// Writes the OtaHeader (version, length, SHA-256, HMAC-SHA256 keyed with the
+// OTA_HMAC_KEY the tracker was built with) followed by the .bin untouched.
+// Serve the result at OTA_FIRMWARE_URL; the version must be higher than the
+// FIRMWARE_VERSION running on the tracker.
+//
+// --device-key prints HMAC-SHA256(master_key, device_id) in hex: one key per
+// tracker (build it with that OTA_HMAC_KEY, sign its images with it) while
+// only the master key, which never goes into a firmware, has to be kept.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "OtaImage.h"
+
+int main(int argc, char** argv)
+{
+    if (argc == 4 && strcmp(argv[1], "--device-key") == 0)
+    {
+        uint8_t key[SHA256_DIGEST_SIZE];
+        Sha256::hmac((const uint8_t*)argv[2], strlen(argv[2]), (const uint8_t*)argv[3], strlen(argv[3]), key);
+        for (int i = 0; i < SHA256_DIGEST_SIZE; i++)
+        {
+            printf("%02x", key[i]);
+        }
+        printf("\n");
+        return 0;
+    }
+
+    if (argc < 5)
+    {
+        fprintf(stderr, "usage: %s <firmware.bin> <firmware.ota> <version> <hmac_key>\n"
+                        "       %s --device-key <master_key> <device_id>\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    FILE* in = fopen(argv[1], "rb");
+    if (!in)
+    {
+        fprintf(stderr, "Cannot open %s\n", argv[1]);
+        return 1;
+    }
+    std::vector<uint8_t> image;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0)
+    {
+        image.insert(image.end(), chunk, chunk + n);
+    }
+    fclose(in);
+
+    uint32_t version = (uint32_t)strtoul(argv[3], nullptr, 10);
+    const char* key = argv[4];
+    OtaHeader header = OtaImage::sign((const uint8_t*)key, strlen(key), version, image.data(), image.size());
+
+    FILE* out = fopen(argv[2], "wb");
+    if (!out)
+    {
+        fprintf(stderr, "Cannot write %s\n", argv[2]);
+        return 1;
+    }
+    fwrite(&header, sizeof(header), 1, out);
+    fwrite(image.data(), 1, image.size(), out);
+    fclose(out);
+
+    printf("%s: version %u, %zu bytes, sha256 ", argv[2], version, image.size());
+    for (int i = 0; i < SHA256_DIGEST_SIZE; i++)
+    {
+        printf("%02x", header.sha256[i]);
+    }
+    printf("\n");
+    return 0;
+}
@@ -0,0 +1,415 @@
+// Replay OTA downloads against a flash simulator and a local HTTP server
+//   ota_sim [firmware.ota hmac_key]
+//
+// A loopback HTTP server stands in for OTA_FIRMWARE_URL. The client reads
+// the body in SIM7670G_HTTP_CHUNK pieces, like the AT+HTTPREAD loop, and
+// hands each one to OtaImage. The flash simulator behaves like NOR: erase
+// sets sectors to 0xFF, program can only clear bits, and each operation is
+// counted with typical QSPI timings.
+//
+// Without arguments a random 900 KB image is signed and the failure paths
+// are checked first: wrong key, old version, truncated body, a corrupted
+// byte, and a bit that does not program. Each must stop with the running
+// slot untouched. Any failed check exits with 1. Then the real download is
+// timed on the host, and the tracker's time is modelled: the body comes
+// over the 115200 baud modem UART, with the flash work added on top.
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "OtaImage.h"
+
+// Same as OtaUpdater.h / sim7670g.h
+#define SLOT_A_OFFSET 0x002000
+#define SLOT_B_OFFSET 0x100000
+#define SLOT_SIZE 0x0FE000
+#define ERASE_STEP 0x10000
+#define HTTP_CHUNK 512
+#define FLASH_SIZE 0x400000
+
+// Typical QSPI NOR timings (W25Q-class) and the modem UART
+#define BLOCK_ERASE_MS 150.0        // 64 KB
+#define SECTOR_ERASE_MS 45.0        // 4 KB
+#define PAGE_PROGRAM_MS 0.4
+#define UART_BYTES_PER_S 11520.0    // 115200 baud, 8N1
+#define HTTPREAD_OVERHEAD 48        // AT+HTTPREAD=<o>,<n> out, +HTTPREAD: DATA/0 and OK in
+
+struct FlashSim
+{
+    std::vector<uint8_t> flash;
+    uint32_t base;                 // slot offset being written
+    uint32_t erases;
+    uint32_t programs;
+    double busy_ms;
+    int32_t stuck_bit_at;          // byte whose bit 0 never programs, -1 = none
+
+    FlashSim() : flash(FLASH_SIZE, 0xFF), base(SLOT_B_OFFSET), erases(0), programs(0), busy_ms(0), stuck_bit_at(-1) {}
+
+    OtaFlash ops()
+    {
+        return OtaFlash{
+            [this](uint32_t offset, uint32_t len)
+            {
+                // OtaUpdater erases in ERASE_STEP blocks, the tail by sectors
+                if ((offset | len) % OTA_FLASH_SECTOR || base + offset + len > FLASH_SIZE)
+                {
+                    return false;
+                }
+                memset(&flash[base + offset], 0xFF, len);
+                for (uint32_t done = 0; done < len; done += ERASE_STEP)
+                {
+                    uint32_t n = len - done < ERASE_STEP ? len - done : ERASE_STEP;
+                    busy_ms += n == ERASE_STEP ? BLOCK_ERASE_MS : SECTOR_ERASE_MS * (n / OTA_FLASH_SECTOR);
+                    erases++;
+                }
+                return true;
+            },
+            [this](uint32_t offset, const uint8_t* data, uint32_t len)
+            {
+                if (offset % OTA_FLASH_PAGE || len != OTA_FLASH_PAGE || base + offset + len > FLASH_SIZE)
+                {
+                    return false;
+                }
+                for (uint32_t i = 0; i < len; i++)
+                {
+                    uint8_t bits = data[i];
+                    if ((int32_t)(offset + i) == stuck_bit_at)
+                    {
+                        bits |= 1;
+                    }
+                    flash[base + offset + i] &= bits;
+                }
+                busy_ms += PAGE_PROGRAM_MS;
+                programs++;
+                return true;
+            },
+            [this](uint32_t offset, uint8_t* data, uint32_t len)
+            {
+                memcpy(data, &flash[base + offset], len);
+                return true;
+            }
+        };
+    }
+};
+
+enum ServeMode
+{
+    SERVE_FULL,
+    SERVE_TRUNCATED,     // Content-Length says all of it, half is sent
+    SERVE_CORRUPT,       // one byte of the image flipped
+};
+
+// One request on a loopback socket, then the server thread ends
+class LocalServer
+{
+public:
+    LocalServer(const std::vector<uint8_t>& body, ServeMode mode) : body(body), mode(mode), port(0)
+    {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(listener, (sockaddr*)&addr, sizeof(addr));
+        socklen_t len = sizeof(addr);
+        getsockname(listener, (sockaddr*)&addr, &len);
+        port = ntohs(addr.sin_port);
+        listen(listener, 1);
+        thread = std::thread([this]() { serve(); });
+    }
+
+    ~LocalServer()
+    {
+        thread.join();
+        close(listener);
+    }
+
+    uint16_t getPort() const { return port; }
+
+private:
+    std::vector<uint8_t> body;
+    ServeMode mode;
+    int listener;
+    uint16_t port;
+    std::thread thread;
+
+    void serve()
+    {
+        int client = accept(listener, nullptr, nullptr);
+        char request[1024];
+        if (recv(client, request, sizeof(request), 0) <= 0)
+        {
+            close(client);
+            return;
+        }
+
+        std::vector<uint8_t> sent = body;
+        if (mode == SERVE_CORRUPT)
+        {
+            sent[sizeof(OtaHeader) + sent.size() / 2] ^= 0x40;
+        }
+        size_t send_len = mode == SERVE_TRUNCATED ? sent.size() / 2 : sent.size();
+
+        char header[128];
+        int header_len = snprintf(header, sizeof(header),
+                                  "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n", sent.size());
+        send(client, header, header_len, 0);
+        for (size_t pos = 0; pos < send_len; )
+        {
+            ssize_t n = send(client, sent.data() + pos, send_len - pos, 0);
+            if (n <= 0)
+            {
+                break;
+            }
+            pos += n;
+        }
+        close(client);
+    }
+};
+
+// GET through the local server, body handed over HTTP_CHUNK bytes at a time
+static bool http_get_chunked(uint16_t port, const std::function<bool(const uint8_t*, size_t)>& consumer)
+{
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, (sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        close(sock);
+        return false;
+    }
+
+    const char request[] = "GET /firmware.ota HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    send(sock, request, sizeof(request) - 1, 0);
+
+    // Headers up to the blank line; what follows is body
+    std::string head;
+    char buffer[HTTP_CHUNK];
+    size_t header_end;
+    while ((header_end = head.find("\r\n\r\n")) == std::string::npos)
+    {
+        ssize_t n = recv(sock, buffer, sizeof(buffer), 0);
+        if (n <= 0)
+        {
+            close(sock);
+            return false;
+        }
+        head.append(buffer, n);
+    }
+    size_t content_length = strtoul(strstr(head.c_str(), "Content-Length:") + 15, nullptr, 10);
+    std::string pending = head.substr(header_end + 4);
+
+    size_t delivered = 0;
+    bool ok = true;
+    while (ok && delivered < content_length)
+    {
+        // Fill one HTTPREAD-sized chunk
+        while (pending.size() < HTTP_CHUNK && delivered + pending.size() < content_length)
+        {
+            ssize_t n = recv(sock, buffer, sizeof(buffer), 0);
+            if (n <= 0)
+            {
+                break;
+            }
+            pending.append(buffer, n);
+        }
+        if (pending.empty())
+        {
+            break;
+        }
+        size_t n = pending.size() < HTTP_CHUNK ? pending.size() : HTTP_CHUNK;
+        ok = consumer((const uint8_t*)pending.data(), n);
+        pending.erase(0, n);
+        delivered += n;
+    }
+    close(sock);
+    return ok && delivered == content_length;
+}
+
+struct Attempt
+{
+    OtaStatus status;
+    double host_ms;
+};
+
+static Attempt attempt(const std::vector<uint8_t>& body, ServeMode mode, const char* key,
+                       uint32_t running_version, FlashSim& sim)
+{
+    OtaImage image((const uint8_t*)key, strlen(key), SLOT_SIZE, sim.ops());
+    LocalServer server(body, mode);
+
+    auto start = std::chrono::steady_clock::now();
+    image.begin(running_version);
+    bool ok = http_get_chunked(server.getPort(), [&image](const uint8_t* data, size_t len)
+    {
+        return image.feed(data, len);
+    });
+    if (ok)
+    {
+        image.finish();
+    }
+    else if (image.status() == OTA_WRITING)
+    {
+        // Connection ended early: what finish() reports on the device
+        image.finish();
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return {image.status(), ms};
+}
+
+static bool check(bool ok, const char* what)
+{
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    return ok;
+}
+
+static std::string hex(const uint8_t* digest)
+{
+    std::string out;
+    char byte[3];
+    for (int i = 0; i < SHA256_DIGEST_SIZE; i++)
+    {
+        snprintf(byte, sizeof(byte), "%02x", digest[i]);
+        out += byte;
+    }
+    return out;
+}
+
+int main(int argc, char** argv)
+{
+    bool ok = true;
+
+    // Known answers: FIPS 180-2 "abc", a two-block message, RFC 4231 case 2
+    Sha256 sha;
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    sha.update((const uint8_t*)"abc", 3);
+    sha.finish(digest);
+    ok &= check(hex(digest) == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", "sha256 abc");
+    const char* two_blocks = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    sha.reset();
+    for (const char* p = two_blocks; *p; p++)
+    {
+        sha.update((const uint8_t*)p, 1);
+    }
+    sha.finish(digest);
+    ok &= check(hex(digest) == "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1", "sha256 fed a byte at a time");
+    const char* data = "what do ya want for nothing?";
+    Sha256::hmac((const uint8_t*)"Jefe", 4, (const uint8_t*)data, strlen(data), digest);
+    ok &= check(hex(digest) == "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843", "hmac-sha256 rfc 4231");
+
+    // Image: a real one, or 900 KB of random bytes signed here
+    std::vector<uint8_t> body;
+    std::string key = "test-key";
+    uint32_t version = 2;
+    if (argc > 2)
+    {
+        FILE* in = fopen(argv[1], "rb");
+        if (!in)
+        {
+            fprintf(stderr, "Cannot open %s\n", argv[1]);
+            return 1;
+        }
+        uint8_t chunk[4096];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0)
+        {
+            body.insert(body.end(), chunk, chunk + n);
+        }
+        fclose(in);
+        key = argv[2];
+        if (body.size() < sizeof(OtaHeader))
+        {
+            fprintf(stderr, "%s: no OTA header\n", argv[1]);
+            return 1;
+        }
+        version = ((const OtaHeader*)body.data())->firmware_version;
+    }
+    else
+    {
+        std::mt19937 rng(7);
+        std::vector<uint8_t> image(900 * 1024);
+        for (uint8_t& b : image)
+        {
+            b = (uint8_t)rng();
+        }
+        OtaHeader header = OtaImage::sign((const uint8_t*)key.c_str(), key.size(), version, image.data(), image.size());
+        body.assign((const uint8_t*)&header, (const uint8_t*)&header + sizeof(header));
+        body.insert(body.end(), image.begin(), image.end());
+    }
+    uint32_t image_len = body.size() - sizeof(OtaHeader);
+
+    // The running slot, which no attempt may touch
+    FlashSim sim;
+    std::mt19937 rng(11);
+    for (uint32_t i = 0; i < SLOT_SIZE; i++)
+    {
+        sim.flash[SLOT_A_OFFSET + i] = (uint8_t)rng();
+    }
+    std::vector<uint8_t> running(sim.flash.begin() + SLOT_A_OFFSET, sim.flash.begin() + SLOT_A_OFFSET + SLOT_SIZE);
+    auto running_intact = [&]()
+    {
+        return std::equal(running.begin(), running.end(), sim.flash.begin() + SLOT_A_OFFSET);
+    };
+
+    if (argc <= 2)
+    {
+        Attempt a = attempt(body, SERVE_FULL, "other-key", version - 1, sim);
+        ok &= check(a.status == OTA_BAD_SIGNATURE && sim.erases == 0, "wrong key: rejected before erasing");
+
+        a = attempt(body, SERVE_FULL, key.c_str(), version, sim);
+        ok &= check(a.status == OTA_OLD_VERSION && sim.erases == 0, "same version: rejected before erasing");
+
+        a = attempt(body, SERVE_TRUNCATED, key.c_str(), version - 1, sim);
+        ok &= check(a.status == OTA_TRUNCATED && running_intact(), "truncated body: running slot intact");
+
+        a = attempt(body, SERVE_CORRUPT, key.c_str(), version - 1, sim);
+        ok &= check(a.status == OTA_BAD_HASH && running_intact(), "corrupted byte: hash mismatch");
+
+        // A byte whose bit 0 should be programmed to 0
+        uint32_t stuck = image_len / 3;
+        while (body[sizeof(OtaHeader) + stuck] & 1)
+        {
+            stuck++;
+        }
+        sim.stuck_bit_at = stuck;
+        a = attempt(body, SERVE_FULL, key.c_str(), version - 1, sim);
+        ok &= check(a.status == OTA_BAD_HASH, "bit that does not program: caught on read-back");
+        sim.stuck_bit_at = -1;
+    }
+
+    sim.erases = 0;
+    sim.programs = 0;
+    sim.busy_ms = 0;
+    Attempt good = attempt(body, SERVE_FULL, key.c_str(), version - 1, sim);
+    ok &= check(good.status == OTA_VERIFIED, "download verified");
+    ok &= check(std::equal(body.begin() + sizeof(OtaHeader), body.end(), sim.flash.begin() + SLOT_B_OFFSET),
+                "slot B holds the image");
+    ok &= check(running_intact(), "slot A untouched");
+
+    if (!ok)
+    {
+        return 1;
+    }
+
+    // Tracker: the body crosses the UART once per HTTPREAD chunk, flash work on top
+    uint32_t chunks = (body.size() + HTTP_CHUNK - 1) / HTTP_CHUNK;
+    double uart_ms = (body.size() + (double)chunks * HTTPREAD_OVERHEAD) * 1000.0 / UART_BYTES_PER_S;
+    double device_ms = uart_ms + sim.busy_ms;
+
+    printf("\n%u bytes, %u HTTPREAD chunks of %d, %u erases, %u page programs\n",
+           image_len, chunks, HTTP_CHUNK, sim.erases, sim.programs);
+    printf("host:    %8.1f ms  %8.1f MB/s (loopback HTTP + SHA-256 + flash simulator + read-back)\n",
+           good.host_ms, image_len / good.host_ms / 1e3);
+    printf("tracker: %8.1f s   %8.0f B/s  (UART %.1f s, flash %.1f s, modelled)\n",
+           device_ms / 1e3, image_len * 1000.0 / device_ms, uart_ms / 1e3, sim.busy_ms / 1e3);
+    return 0;
+}
@@ -0,0 +1,219 @@
+// Drive PowerSchedule through a simulated day of the main loop
+//   power_sim [hours] [poll_ms]
+//
+// The loop runs the firmware's periodic work (Telegram poll, GNSS telemetry
+// sample and upload, MQTT fix, stats flush) on a millisecond clock that
+// starts 10 minutes before the 32-bit wrap of to_ms_since_boot(). Between
+// passes it sleeps as PowerManager::sleepUntil() does: plan() up to the
+// earliest deadline, cut short by modem URCs at random times, then record().
+//
+// Checks: no sleep runs past its deadline or POWER_MAX_SLEEP_MS, short gaps
+// stay awake, the modem is released only for long sleeps, every deadline is
+// served within the work queued ahead of it, and awake + asleep adds up to
+// the simulated time across the wrap. The duty cycle is a modelled host
+// figure from the work costs below, not a device measurement; the old loop
+// polled every 20 ms and never slept. Any failed check exits with 1.
+#include <cstdio>
+#include <cstdlib>
+#include "PowerSchedule.h"
+
+#define DEFAULT_POLL_MS 5000
+
+// Same periods as main.cpp
+#define TELEMETRY_SAMPLE_INTERVAL_MS 30000
+#define MQTT_FIX_INTERVAL_MS 60000
+#define STATS_FLUSH_INTERVAL_MS (10u * 60u * 1000u)
+
+// Modelled time awake per piece of work (ms)
+#define LOOP_PASS_MS 2
+#define URC_MS 40
+#define MEAN_URC_GAP_MS 300000
+
+// Old main loop delay
+#define OLD_LOOP_MS 20
+
+struct Job
+{
+    const char* name;
+    uint32_t period_ms;
+    uint32_t work_ms;
+    uint32_t due;
+    uint32_t runs;
+    uint32_t max_late_ms;
+};
+
+// Deterministic, so a failure can be reproduced
+static uint32_t rng_state = 0x2545F491;
+
+static uint32_t next_random()
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, uint32_t now)
+{
+    if (!ok)
+    {
+        if (failures < 10)
+        {
+            fprintf(stderr, "at %u ms: %s\n", now, what);
+        }
+        failures++;
+    }
+}
+
+static void check_plan_edges()
+{
+    PowerSchedule schedule;
+    PowerPlan plan = schedule.plan(5, 0xFFFFFFF0u);
+    check(plan.sleep_ms == 0, "deadline just before the wrap seen as ahead", 5);
+    plan = schedule.plan(0xFFFFFFF0u, 100);
+    check(plan.sleep_ms == 116 && !plan.modem_sleep, "gap across the wrap", 0xFFFFFFF0u);
+    plan = schedule.plan(1000, 1000 + POWER_MIN_SLEEP_MS - 1);
+    check(plan.sleep_ms == 0, "sleeping a gap below POWER_MIN_SLEEP_MS", 1000);
+    plan = schedule.plan(1000, 1000 + POWER_MODEM_SLEEP_MIN_MS);
+    check(plan.sleep_ms == POWER_MODEM_SLEEP_MIN_MS && plan.modem_sleep, "modem kept awake for a long gap", 1000);
+    plan = schedule.plan(1000, 1000 + 10 * POWER_MAX_SLEEP_MS);
+    check(plan.sleep_ms == POWER_MAX_SLEEP_MS, "sleep not capped", 1000);
+}
+
+int main(int argc, char** argv)
+{
+    double hours = argc > 1 ? atof(argv[1]) : 24.0;
+    uint32_t poll_ms = argc > 2 ? (uint32_t)atoi(argv[2]) : DEFAULT_POLL_MS;
+    if (hours <= 0 || hours > 500 || poll_ms == 0)
+    {
+        fprintf(stderr, "usage: %s [hours] [poll_ms]\n", argv[0]);
+        return 1;
+    }
+
+    check_plan_edges();
+
+    Job jobs[] =
+    {
+        {"telegram poll", poll_ms, 900, 0, 0, 0},
+        {"telemetry sample", TELEMETRY_SAMPLE_INTERVAL_MS, 150, 0, 0, 0},
+        {"telemetry upload", TELEMETRY_SAMPLE_INTERVAL_MS, 1200, 0, 0, 0},
+        {"mqtt fix", MQTT_FIX_INTERVAL_MS, 400, 0, 0, 0},
+        {"stats flush", STATS_FLUSH_INTERVAL_MS, 5, 0, 0, 0},
+    };
+    uint32_t queued_work = LOOP_PASS_MS + URC_MS;
+    for (Job& job : jobs)
+    {
+        queued_work += job.work_ms;
+    }
+
+    const uint32_t start = 0xFFFFFFFFu - 10u * 60u * 1000u;
+    const uint64_t duration = (uint64_t)(hours * 3600.0 * 1000.0);
+    uint32_t now = start;
+    uint64_t elapsed = 0;
+
+    for (Job& job : jobs)
+    {
+        job.due = start + job.period_ms;
+    }
+    uint32_t next_urc = start + next_random() % (2 * MEAN_URC_GAP_MS);
+
+    PowerSchedule schedule;
+    schedule.record(now, 0, false, false);
+    uint32_t records = 0;
+    uint32_t urc_wakes = 0;
+    uint32_t record_now = now;
+
+    auto run = [&](uint32_t ms)
+    {
+        now += ms;
+        elapsed += ms;
+    };
+
+    while (elapsed < duration)
+    {
+        for (Job& job : jobs)
+        {
+            if ((int32_t)(now - job.due) >= 0)
+            {
+                uint32_t late = now - job.due;
+                if (late > job.max_late_ms)
+                {
+                    job.max_late_ms = late;
+                }
+                check(late <= queued_work, "deadline served late", now);
+                run(job.work_ms);
+                job.runs++;
+
+                // On the period grid, missed periods skipped (TimerWheel::scheduleEvery)
+                uint32_t behind = now - job.due;
+                job.due += (behind / job.period_ms + 1) * job.period_ms;
+            }
+        }
+        if ((int32_t)(now - next_urc) >= 0)
+        {
+            run(URC_MS);
+            next_urc = now + 1 + next_random() % (2 * MEAN_URC_GAP_MS);
+        }
+        run(LOOP_PASS_MS);
+
+        uint32_t next = now + POWER_MAX_SLEEP_MS;
+        for (const Job& job : jobs)
+        {
+            if ((int32_t)(job.due - next) < 0)
+            {
+                next = job.due;
+            }
+        }
+
+        PowerPlan plan = schedule.plan(now, next);
+        int32_t gap = (int32_t)(next - now);
+        check(plan.sleep_ms <= POWER_MAX_SLEEP_MS, "sleep above POWER_MAX_SLEEP_MS", now);
+        check(gap < 0 || plan.sleep_ms <= (uint32_t)gap, "sleep past the deadline", now);
+        check((gap >= POWER_MIN_SLEEP_MS) == (plan.sleep_ms > 0), "short gap slept or long gap awake", now);
+        check(plan.modem_sleep == (plan.sleep_ms >= POWER_MODEM_SLEEP_MIN_MS), "modem released for a short sleep", now);
+        // A URC already waiting is handled instead of sleeping (uart_is_readable)
+        if (plan.sleep_ms == 0 || (int32_t)(now - next_urc) >= 0)
+        {
+            continue;
+        }
+
+        // A URC during the sleep ends it early
+        uint32_t slept = plan.sleep_ms;
+        bool woke = false;
+        if ((int32_t)(next_urc - now) < (int32_t)slept)
+        {
+            slept = next_urc - now;
+            woke = true;
+            urc_wakes++;
+        }
+        run(slept);
+        schedule.record(now, slept, plan.modem_sleep, woke);
+        records++;
+        record_now = now;
+    }
+
+    const PowerStats& stats = schedule.stats();
+    uint32_t recorded_span = record_now - start;
+    check(stats.awake_ms + stats.asleep_ms == recorded_span, "awake + asleep differs from the time simulated", now);
+    check(stats.modem_sleep_ms <= stats.asleep_ms, "modem asleep longer than the MCU", now);
+    check(stats.sleeps == records && stats.modem_wakes == urc_wakes, "sleeps or wakes miscounted", now);
+    check(duration <= 10u * 60u * 1000u || now < start, "clock did not cross the 32-bit wrap", now);
+
+    printf("Modelled host timing: %.1f h from %u ms (32-bit wrap after 10 min), poll every %u ms\n",
+           hours, start, poll_ms);
+    printf("%-18s %8s %12s\n", "job", "runs", "max_late_ms");
+    for (const Job& job : jobs)
+    {
+        printf("%-18s %8u %12u\n", job.name, job.runs, job.max_late_ms);
+    }
+
+    char report[160];
+    schedule.format(report, sizeof(report));
+    printf("%s", report);
+    printf("old 20 ms loop: MCU activo 100.0%%, módem activo 100.0%% (%llu pasadas)\n",
+           (unsigned long long)(duration / OLD_LOOP_MS));
+    printf("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
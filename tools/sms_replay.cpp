@@ -0,0 +1,224 @@
+// Replay a scripted modem through the SMS inbox and compare command latency
+// with Telegram polling
+//   sms_replay <script> [authorized_numbers] [poll_interval_ms]
+//
+// The script stands in for the SIM7670G, one event per line:
+//   <ms> sms <index> <number> <text>   SMS stored, the modem sends +CMTI
+//   <ms> urc <line>                    any other unsolicited line
+//   <ms> busy <duration_ms> <name>     a transaction holds the modem
+//
+// Each SMS is read back through the +CMGR parser and the sender check used
+// on the device. SMS latency is +CMTI -> handler: the modem must be free and
+// the read + delete takes SMS_READ_MS. Telegram latency is modelled: a poll
+// starts every poll_interval_ms and long-polls for TELEGRAM_LONG_POLL_MS, so
+// a message sent inside that window comes back with the response, any other
+// waits for the next poll. Script "busy" lines should match those polls.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include "SmsInbox.h"
+#include "sim7670g_parse.h"
+
+// AT+CMGR + AT+CMGD round trips (modelled)
+#define SMS_READ_MS 150
+
+// getUpdates?timeout=10 (TelegramBot::poll_updates)
+#define TELEGRAM_LONG_POLL_MS 10000
+
+// getUpdates over the persistent TLS connection (modelled)
+#define POLL_REQUEST_MS 1200
+
+struct Stored
+{
+    std::string number;
+    std::string text;
+};
+
+struct Latency
+{
+    uint32_t count = 0;
+    uint64_t total = 0;
+    uint32_t max = 0;
+
+    void add(uint32_t ms)
+    {
+        count++;
+        total += ms;
+        max = ms > max ? ms : max;
+    }
+};
+
+static void check_split()
+{
+    const char* reply =
+        "¡Hola! Soy tu bot en Raspberry Pi Pico W.\n"
+        "Comandos disponibles:\n"
+        "/start - Este mensaje\n"
+        "/location - Obtener ubicación actual\n"
+        "/activo - Estado activo del bot\n"
+        "/lowEnergy - Modo de bajo consumo\n"
+        "/trip - Resumen del viaje (/trip reset para empezar otro)\n"
+        "/datos - Consumo de datos del mes\n"
+        "/salud - Estado del módem y recuperaciones\n"
+        "Precisión: ±12 m ✓\n";
+
+    char parts[SMS_MAX_PARTS][SMS_TEXT_MAX + 1];
+    int count = SmsInbox::split(reply, parts, SMS_MAX_PARTS);
+    printf("/start reply: %d SMS\n", count);
+    for (int i = 0; i < count; i++)
+    {
+        size_t len = strlen(parts[i]);
+        for (size_t j = 0; j < len; j++)
+        {
+            if ((uint8_t)parts[i][j] >= 0x80)
+            {
+                fprintf(stderr, "part %d: non-ASCII byte at %zu\n", i, j);
+                exit(1);
+            }
+        }
+        printf("  [%d] %zu chars\n", i, len);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <script> [authorized_numbers] [poll_interval_ms]\n", argv[0]);
+        return 1;
+    }
+
+    FILE* f = fopen(argv[1], "r");
+    if (!f)
+    {
+        fprintf(stderr, "Cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    SmsInbox inbox;
+    inbox.authorize(argc > 2 ? argv[2] : "+34600111222");
+    uint32_t poll_interval = argc > 3 ? (uint32_t)atoi(argv[3]) : 45000;
+
+    std::map<int, Stored> sim;
+    uint32_t modem_free = 0;
+    Latency sms_latency, telegram_latency;
+
+    // Reads run as soon as the modem is free, in queue order
+    auto drain = [&](uint32_t until)
+    {
+        while (inbox.pending() > 0 && modem_free <= until)
+        {
+            int index = inbox.peek();
+            uint32_t done = modem_free + SMS_READ_MS;
+            modem_free = done;
+
+            auto stored = sim.find(index);
+            if (stored == sim.end())
+            {
+                inbox.drop();
+                continue;
+            }
+
+            char header[128], number[SMS_NUMBER_MAX];
+            snprintf(header, sizeof(header), "+CMGR: \"REC UNREAD\",\"%s\",\"\",\"24/05/01,10:00:00+08\"",
+                     stored->second.number.c_str());
+            if (!sim7670g_parse_cmgr(header, number, sizeof(number)))
+            {
+                fprintf(stderr, "+CMGR header not parsed: %s\n", header);
+                exit(1);
+            }
+
+            if (inbox.take(number, done))
+            {
+                uint32_t sms_ms = inbox.stats().last_latency_ms;
+                uint32_t arrival = done - sms_ms;
+                uint32_t poll = arrival / poll_interval * poll_interval;
+                uint32_t telegram_ms = arrival < poll + TELEGRAM_LONG_POLL_MS ? POLL_REQUEST_MS / 2
+                                     : poll + poll_interval + POLL_REQUEST_MS - arrival;
+                sms_latency.add(sms_ms);
+                telegram_latency.add(telegram_ms);
+                printf("%8u  %-14s %-14s sms %6u ms   telegram %6u ms\n",
+                       arrival, number, stored->second.text.c_str(), sms_ms, telegram_ms);
+            }
+            else
+            {
+                printf("%8u  %-14s rejected\n", done, number);
+            }
+            sim.erase(stored);
+        }
+    };
+
+    char line[512];
+    while (fgets(line, sizeof(line), f))
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '#' || line[0] == '\0')
+        {
+            continue;
+        }
+
+        uint32_t t;
+        char kind[8];
+        int used = 0;
+        if (sscanf(line, "%u %7s %n", &t, kind, &used) < 2)
+        {
+            fprintf(stderr, "Bad line: %s\n", line);
+            return 1;
+        }
+        const char* rest = line + used;
+
+        drain(t);
+        if (modem_free < t)
+        {
+            modem_free = t;
+        }
+
+        if (strcmp(kind, "sms") == 0)
+        {
+            int index;
+            char number[SMS_NUMBER_MAX];
+            int text_at = 0;
+            if (sscanf(rest, "%d %23s %n", &index, number, &text_at) < 2)
+            {
+                fprintf(stderr, "Bad sms line: %s\n", line);
+                return 1;
+            }
+            sim[index] = {number, rest + text_at};
+
+            char urc[32];
+            snprintf(urc, sizeof(urc), "+CMTI: \"SM\",%d", index);
+            inbox.onUrc(urc, t);
+        }
+        else if (strcmp(kind, "urc") == 0)
+        {
+            if (inbox.onUrc(rest, t))
+            {
+                fprintf(stderr, "Unexpected SMS from: %s\n", rest);
+                return 1;
+            }
+        }
+        else if (strcmp(kind, "busy") == 0)
+        {
+            modem_free += (uint32_t)atoi(rest);
+        }
+    }
+    fclose(f);
+    drain(UINT32_MAX);
+
+    const SmsStats& stats = inbox.stats();
+    printf("\n%u received, %u commands, %u rejected, %u dropped (queue full)\n",
+           stats.received, stats.commands, stats.rejected, stats.dropped);
+    if (sms_latency.count)
+    {
+        printf("SMS:      %6.0f ms mean, %6u ms max\n",
+               (double)sms_latency.total / sms_latency.count, sms_latency.max);
+        printf("Telegram: %6.0f ms mean, %6u ms max (poll every %u ms, modelled)\n",
+               (double)telegram_latency.total / telegram_latency.count, telegram_latency.max, poll_interval);
+    }
+
+    printf("\n");
+    check_split();
+    return 0;
+}
@@ -0,0 +1,45 @@
+// Decode a binary telemetry batch (as received by the upload endpoint) to CSV
+//   telemetry_decode batch.bin > fixes.csv
+#include <cstdio>
+#include <vector>
+#include "TelemetryBatch.h"
+
+int main(int argc, char** argv)
+{
+    FILE* in = argc > 1 ? fopen(argv[1], "rb") : stdin;
+    if (!in)
+    {
+        fprintf(stderr, "Cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+    {
+        data.insert(data.end(), buffer, buffer + n);
+    }
+    if (in != stdin)
+    {
+        fclose(in);
+    }
+
+    std::vector<TelemetryFix> fixes(UINT16_MAX);
+    int count = telemetry_decode(data.data(), data.size(), fixes.data(), fixes.size());
+    if (count < 0)
+    {
+        fprintf(stderr, "Invalid batch (%zu bytes)\n", data.size());
+        return 1;
+    }
+
+    printf("timestamp,lat,lon\n");
+    for (int i = 0; i < count; i++)
+    {
+        printf("%u,%.6f,%.6f\n", fixes[i].timestamp, fixes[i].lat_e6 / 1e6, fixes[i].lon_e6 / 1e6);
+    }
+
+    fprintf(stderr, "%d fixes, %zu bytes (%.1f B/fix)\n",
+            count, data.size(), count ? (double)data.size() / count : 0.0);
+    return 0;
+}
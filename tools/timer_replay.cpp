@@ -0,0 +1,311 @@
+// Check TimerWheel against a reference list of deadlines and time it
+//   timer_replay [timers] [hours]
+//
+// Keeps 'timers' random timers alive on a millisecond clock that starts an
+// hour before the 32-bit wrap: one-shots from 1 ms to past the 2^24 ms top
+// level, periodic timers, cancels, reschedules, and callbacks that re-arm or
+// cancel timers from inside advance(). The clock moves in random steps with
+// the occasional long jump, as the main loop does after a sleep.
+//
+// Every firing is checked against the reference: never early, never in a
+// later advance() than the one that reached its deadline, in deadline order
+// within one advance(), periodic timers on their grid. nextDeadline() must
+// match the reference's earliest deadline. Insert, cancel and advance costs
+// are host timing only. Any failed check exits with 1.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+#include "TimerWheel.h"
+
+// Beyond the top level: 2^24 ms is about 4.6 h
+#define LONGEST_DELAY_MS (8u * 3600u * 1000u)
+#define NEXT_DEADLINE_LIMIT_MS (1u << 30)
+
+struct Expected
+{
+    uint32_t expires;          // as the wheel sees it: at least one tick after scheduling
+    uint32_t period;
+};
+
+static uint32_t rng_state = 0x9E3779B9;
+
+static uint32_t next_random()
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static uint32_t random_delay()
+{
+    uint32_t pick = next_random() % 100;
+    if (pick < 50)
+    {
+        return 1 + next_random() % 1000;
+    }
+    if (pick < 80)
+    {
+        return 1 + next_random() % (10u * 60u * 1000u);
+    }
+    if (pick < 95)
+    {
+        return 1 + next_random() % (4u * 3600u * 1000u);
+    }
+    return (1u << 24) + next_random() % (LONGEST_DELAY_MS - (1u << 24));
+}
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, uint32_t now, TimerId id)
+{
+    if (!ok)
+    {
+        if (failures < 10)
+        {
+            fprintf(stderr, "at %u ms, timer %08x: %s\n", now, id, what);
+        }
+        failures++;
+    }
+}
+
+// Clock and reference shared with the callbacks
+struct Replay
+{
+    TimerWheel wheel;
+    std::unordered_map<TimerId, Expected> expected;
+    std::vector<TimerId> ids;
+    uint32_t now;
+    uint32_t previous;         // clock of the previous advance()
+    uint32_t last_fired;       // deadline of the previous firing in this advance()
+    uint32_t fired;
+
+    Replay(uint32_t start, size_t capacity)
+        : wheel(start, capacity), now(start), previous(start), last_fired(0), fired(0)
+    {
+    }
+
+    TimerId add(uint32_t delay, uint32_t period)
+    {
+        // The callback finds its handle by position; it only runs from advance()
+        size_t slot = ids.size();
+        TimerWheel::Callback callback = [this, slot]() { on_fire(slot); };
+        TimerId id = period ? wheel.scheduleEvery(period, callback) : wheel.schedule(delay, callback);
+        if (id == 0)
+        {
+            return 0;
+        }
+        expected[id] = {previous + (period ? period : delay), period};
+        ids.push_back(id);
+        return id;
+    }
+
+    void on_fire(size_t slot)
+    {
+        TimerId id = ids[slot];
+        auto it = expected.find(id);
+        check(it != expected.end(), "fired after it was cancelled", now, id);
+        if (it == expected.end())
+        {
+            return;
+        }
+
+        Expected& e = it->second;
+        check((int32_t)(now - e.expires) >= 0, "fired early", now, id);
+        check((int32_t)(previous - e.expires) < 0, "fired an advance() late", now, id);
+        check(last_fired == 0 || (int32_t)(e.expires - last_fired) >= 0, "fired out of order", now, id);
+        last_fired = e.expires;
+        fired++;
+
+        uint32_t action = next_random() % 10;
+        if (e.period)
+        {
+            uint32_t behind = now - e.expires;
+            e.expires += (behind / e.period + 1) * e.period;
+            if (action == 0)
+            {
+                // A periodic timer that stops itself
+                wheel.cancel(id);
+                expected.erase(it);
+            }
+        }
+        else if (action == 0)
+        {
+            // Re-armed from its own callback
+            uint32_t delay = random_delay();
+            check(wheel.reschedule(id, now + delay), "self reschedule refused", now, id);
+            e.expires = now + delay;
+        }
+        else
+        {
+            expected.erase(it);
+            TimerId other = ids[next_random() % ids.size()];
+            if (action == 1 && other != id)
+            {
+                // Cancel another timer, possibly one due in this same advance()
+                bool pending = expected.count(other) != 0;
+                check(wheel.cancel(other) == pending, "cancel from a callback disagrees", now, other);
+                expected.erase(other);
+            }
+        }
+    }
+
+    uint32_t earliest() const
+    {
+        uint32_t best = now + NEXT_DEADLINE_LIMIT_MS;
+        for (const auto& entry : expected)
+        {
+            uint32_t when = entry.second.expires;
+            if ((int32_t)(when - now) <= 0)
+            {
+                when = now + 1;
+            }
+            if ((int32_t)(when - best) < 0)
+            {
+                best = when;
+            }
+        }
+        return best;
+    }
+};
+
+template <typename F>
+static double time_ns(uint32_t count, F&& f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / count;
+}
+
+static void time_wheel(uint32_t count)
+{
+    std::vector<uint32_t> delays(count);
+    for (uint32_t& delay : delays)
+    {
+        delay = random_delay();
+    }
+
+    std::vector<TimerId> ids(count);
+    uint32_t fired = 0;
+    TimerWheel wheel(0, count);
+    double insert_ns = time_ns(count, [&]()
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            ids[i] = wheel.schedule(delays[i], [&fired]() { fired++; });
+        }
+    });
+    double cancel_ns = time_ns(count / 2, [&]()
+    {
+        for (uint32_t i = 0; i < count; i += 2)
+        {
+            wheel.cancel(ids[i]);
+        }
+    });
+    double advance_ns = time_ns(count - count / 2, [&]()
+    {
+        for (uint32_t now = 0; wheel.size() > 0;)
+        {
+            now = wheel.nextDeadline(now + NEXT_DEADLINE_LIMIT_MS);
+            wheel.advance(now);
+        }
+    });
+
+    printf("Host timing, %u timers: schedule %.0f ns, cancel %.0f ns, fire %.0f ns each "
+           "(nextDeadline() + advance()), %u cascades\n",
+           count, insert_ns, cancel_ns, advance_ns, wheel.stats().cascaded);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t count = argc > 1 ? (uint32_t)atoi(argv[1]) : 10000;
+    double hours = argc > 2 ? atof(argv[2]) : 12.0;
+    if (count < 2 || count >= 0xFFFF || hours <= 0 || hours > 500)
+    {
+        fprintf(stderr, "usage: %s [timers < 65535] [hours]\n", argv[0]);
+        return 1;
+    }
+
+    const uint32_t start = 0xFFFFFFFFu - 3600u * 1000u;
+    Replay replay(start, count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        replay.add(random_delay(), i % 10 == 0 ? 1 + next_random() % 60000 : 0);
+    }
+
+    const uint64_t duration = (uint64_t)(hours * 3600.0 * 1000.0);
+    uint64_t elapsed = 0;
+    uint32_t steps = 0;
+    while (elapsed < duration)
+    {
+        uint32_t step = next_random() % 100 == 0 ? 1 + next_random() % (30u * 60u * 1000u)
+                                                 : 1 + next_random() % 5000;
+        replay.now += step;
+        elapsed += step;
+        replay.last_fired = 0;
+
+        int fired_before = replay.fired;
+        int fired = replay.wheel.advance(replay.now);
+        check(fired == (int)(replay.fired - fired_before), "advance() count differs from callbacks run",
+              replay.now, 0);
+        replay.previous = replay.now;
+
+        // Nothing left overdue
+        if (steps % 16 == 0)
+        {
+            for (const auto& entry : replay.expected)
+            {
+                check((int32_t)(entry.second.expires - replay.now) > 0, "missed", replay.now, entry.first);
+            }
+            check(replay.wheel.nextDeadline(replay.now + NEXT_DEADLINE_LIMIT_MS) == replay.earliest(),
+                  "nextDeadline() differs from the earliest deadline", replay.now, 0);
+        }
+        check(replay.wheel.size() == replay.expected.size(), "size() differs from the reference",
+              replay.now, 0);
+
+        // Keep the population up and stir it
+        while (replay.expected.size() < count && replay.wheel.size() < count)
+        {
+            if (replay.add(random_delay(), next_random() % 10 == 0 ? 1 + next_random() % 60000 : 0) == 0)
+            {
+                break;
+            }
+        }
+        for (int i = 0; i < 4; i++)
+        {
+            TimerId id = replay.ids[next_random() % replay.ids.size()];
+            bool pending = replay.expected.count(id) != 0;
+            if (next_random() % 2)
+            {
+                check(replay.wheel.cancel(id) == pending, "cancel disagrees", replay.now, id);
+                replay.expected.erase(id);
+            }
+            else if (pending)
+            {
+                uint32_t delay = random_delay();
+                check(replay.wheel.reschedule(id, replay.now + delay), "reschedule refused", replay.now, id);
+                replay.expected[id].expires = replay.now + delay;
+            }
+            else
+            {
+                check(!replay.wheel.reschedule(id, replay.now + 1), "stale handle rescheduled", replay.now, id);
+            }
+        }
+        steps++;
+    }
+    check(duration <= 3600u * 1000u || replay.now < start, "clock did not cross the 32-bit wrap", replay.now, 0);
+
+    const TimerStats& stats = replay.wheel.stats();
+    printf("%u timers, %.1f h in %u steps from %u ms: %u fired, %u cancelled, %u cascaded, "
+           "late %u ms max / %.1f ms mean\n",
+           count, hours, steps, start, stats.fired, stats.cancelled, stats.cascaded,
+           stats.max_late_ms, stats.fired ? (double)stats.total_late_ms / stats.fired : 0.0);
+
+    time_wheel(count);
+
+    printf("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,148 @@
+// Check TripStats against a double-precision haversine and time it per fix
+//   trip_replay [track.csv]
+//
+// Without arguments only the distance kernel is checked. With a track
+// (time_ms,lat,lon per line) the trip summary is printed as /trip shows it.
+//
+// The ns figures are host timing on the build machine's CPU, with its FPU
+// and 64-bit multiplier; they are not RP2040 (Cortex-M0+) figures. A kernel
+// error above MAX_ERROR_PCT exits with 1.
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "TripStats.h"
+
+// Worst relative error accepted at any step length; 2 m steps are bounded
+// by the 1e-6 degree quantisation of the fixes
+#define MAX_ERROR_PCT 1.0
+
+static double haversine_mm(double lat1, double lon1, double lat2, double lon2)
+{
+    const double r = 6371008.8e3;
+    double p1 = lat1 * M_PI / 180.0, p2 = lat2 * M_PI / 180.0;
+    double dp = p2 - p1, dl = (lon2 - lon1) * M_PI / 180.0;
+    double a = sin(dp / 2) * sin(dp / 2) + cos(p1) * cos(p2) * sin(dl / 2) * sin(dl / 2);
+    return 2 * r * asin(sqrt(a));
+}
+
+static double elapsed_ns(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool check_kernel()
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> lat_dist(-70, 70), lon_dist(-179, 179), angle(0, 2 * M_PI);
+    const double steps_m[] = {2, 10, 100, 1000, 5000, 50000};
+
+    bool ok = true;
+    printf("step        max error   mean error (vs haversine, |lat| <= 70)\n");
+    for (double step : steps_m)
+    {
+        double max_rel = 0, sum_rel = 0;
+        const int n = 20000;
+        for (int i = 0; i < n; i++)
+        {
+            double lat = lat_dist(rng), lon = lon_dist(rng), a = angle(rng);
+            double lat2 = lat + step * cos(a) / 111195.0;
+            double lon2 = lon + step * sin(a) / (111195.0 * cos(lat * M_PI / 180.0));
+
+            int32_t a1 = (int32_t)lround(lat * 1e6), o1 = (int32_t)lround(lon * 1e6);
+            int32_t a2 = (int32_t)lround(lat2 * 1e6), o2 = (int32_t)lround(lon2 * 1e6);
+            double reference = haversine_mm(a1 / 1e6, o1 / 1e6, a2 / 1e6, o2 / 1e6);
+            double rel = fabs(TripStats::distanceMm(a1, o1, a2, o2) - reference) / reference;
+            max_rel = rel > max_rel ? rel : max_rel;
+            sum_rel += rel;
+        }
+        printf("%7.0f m   %8.4f %%   %8.4f %%\n", step, max_rel * 100, sum_rel / n * 100);
+        if (max_rel * 100 > MAX_ERROR_PCT)
+        {
+            fprintf(stderr, "%.0f m steps: error above %.1f %%\n", step, MAX_ERROR_PCT);
+            ok = false;
+        }
+    }
+
+    // Cost of the kernel on typical 30 s steps
+    std::vector<int32_t> coords(4 * 100000);
+    for (size_t i = 0; i < coords.size(); i += 4)
+    {
+        coords[i] = (int32_t)(lat_dist(rng) * 1e6);
+        coords[i + 1] = (int32_t)(lon_dist(rng) * 1e6);
+        coords[i + 2] = coords[i] + (int32_t)(rng() % 8000) - 4000;
+        coords[i + 3] = coords[i + 1] + (int32_t)(rng() % 8000) - 4000;
+    }
+    uint64_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < coords.size(); i += 4)
+    {
+        sink += TripStats::distanceMm(coords[i], coords[i + 1], coords[i + 2], coords[i + 3]);
+    }
+    printf("distanceMm: %.1f ns per call (host timing, not RP2040) [%llu]\n",
+           elapsed_ns(start) / (coords.size() / 4), (unsigned long long)(sink & 1));
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    bool kernel_ok = check_kernel();
+
+    if (argc < 2)
+    {
+        return kernel_ok ? 0 : 1;
+    }
+
+    FILE* in = fopen(argv[1], "r");
+    if (!in)
+    {
+        fprintf(stderr, "Cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    TripStats trip;
+    char line[256];
+    uint32_t t = 0;
+    double reference_mm = 0, prev_lat = NAN, prev_lon = NAN;
+    double add_ns = 0;
+    int fixes = 0;
+
+    while (fgets(line, sizeof(line), in))
+    {
+        double lat, lon;
+        if (sscanf(line, "%u,%lf,%lf", &t, &lat, &lon) != 3)
+        {
+            continue;
+        }
+        if (fixes == 0)
+        {
+            trip.reset(t);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        trip.add(t, (int32_t)lround(lat * 1e6), (int32_t)lround(lon * 1e6));
+        add_ns += elapsed_ns(start);
+        fixes++;
+
+        if (!std::isnan(prev_lat))
+        {
+            reference_mm += haversine_mm(prev_lat, prev_lon, lat, lon);
+        }
+        prev_lat = lat;
+        prev_lon = lon;
+    }
+    fclose(in);
+
+    char report[256];
+    trip.format(report, sizeof(report), t);
+    printf("\n%s", report);
+    for (int i = 0; i < trip.keptStops(); i++)
+    {
+        const TripStop& stop = trip.stop(i);
+        printf("  stop at %.6f,%.6f for %u s\n", stop.lat_e6 / 1e6, stop.lon_e6 / 1e6, stop.duration_ms / 1000);
+    }
+    printf("Haversine sum of every step: %.2f km (stops and glitches included)\n", reference_mm / 1e6);
+    printf("add(): %.1f ns per fix over %d fixes (host timing, not RP2040)\n", fixes ? add_ns / fixes : 0.0, fixes);
+    return kernel_ok ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+// Replay network URCs through the driver's link tracker and model reconnect time
+//   urc_replay [cmd_rtt_ms]
+//
+// Every scenario starts from a link that is up and feeds its URCs to
+// sim7670g_parse_link_urc(), the function Sim7670G runs on each +CREG,
+// +CEREG and +CGEV. The tool checks whether the link dropped and which steps
+// sim7670g_connect() would repeat: R registration, A attach (AT+CGATT), P PDP
+// (AT+CGACT), H HTTP service (AT+HTTPTERM/INIT). "old" is what the previous
+// +CGEV matcher did ("DEACT" plus any " 1" in the line); registration is
+// handled as before.
+//
+// Reconnect times are modelled host figures, not device measurements: each
+// missing step costs the constant below. The old path ran the whole of
+// sim7670g_init(), with its fixed sleeps and a GNSS wait of 1 to 300 tries.
+// Any failed check exits with 1.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "sim7670g_parse.h"
+
+// Modelled cost of each step once the network is back (ms)
+#define REGISTER_MS 3000
+#define ATTACH_MS 1500
+#define PDP_MS 1000
+
+// Old sim7670g_init(): sleep_ms() calls between its steps, and each GNSS try
+#define OLD_INIT_SLEEPS_MS (2000 + 500 + 1000 + 1000 + 2000 + 1000 + 2000 + 3000)
+#define OLD_GNSS_TRY_MS 1000
+#define OLD_GNSS_TRIES 300
+
+#define DEFAULT_CMD_RTT_MS 50
+
+struct Scenario
+{
+    const char* name;
+    const char* urcs[4];
+    bool dropped;
+    const char* missing;
+};
+
+static const Scenario scenarios[] =
+{
+    {"network detach", {"+CGEV: NW DETACH"}, true, "APH"},
+    {"our PDN deactivated", {"+CGEV: NW PDN DEACT 1"}, true, "PH"},
+    {"our PDN deactivated (ME)", {"+CGEV: ME PDN DEACT 1"}, true, "PH"},
+    {"other PDN deactivated", {"+CGEV: NW PDN DEACT 11"}, false, ""},
+    {"dedicated bearer down", {"+CGEV: NW DEACT 1,2,0"}, false, ""},
+    {"LTE lost, CS kept", {"+CEREG: 0"}, false, ""},
+    {"LTE and CS lost", {"+CEREG: 0", "+CREG: 2"}, true, "RH"},
+    {"roaming (query reply)", {"+CEREG: 0", "+CREG: 0", "+CEREG: 1,5"}, true, "H"},
+    {"detach, network reactivates", {"+CGEV: NW DETACH", "+CGEV: NW PDN ACT 1"}, true, "H"},
+    {"other PDN activated", {"+CGEV: NW DETACH", "+CGEV: NW PDN ACT 12"}, true, "APH"},
+    {"unrelated lines", {"+CMTI: \"SM\",3", "+CGEV: NW MODIFY 1,0,0"}, false, ""},
+};
+
+static std::string missing_steps(const sim7670g_link_t& link)
+{
+    std::string steps;
+    if (!link.network_registered) steps += 'R';
+    if (!link.gprs_attached) steps += 'A';
+    if (!link.pdp_active) steps += 'P';
+    if (!link.http_ready) steps += 'H';
+    return steps;
+}
+
+static double reconnect_ms(const std::string& steps, double rtt_ms)
+{
+    double ms = 0.0;
+    for (char step : steps)
+    {
+        ms += step == 'R' ? REGISTER_MS : step == 'A' ? ATTACH_MS : step == 'P' ? PDP_MS : 2 * rtt_ms;
+    }
+    return ms;
+}
+
+static bool old_cgev_drop(const char* line)
+{
+    return strstr(line, "DETACH") || (strstr(line, "DEACT") && strstr(line, " 1"));
+}
+
+int main(int argc, char** argv)
+{
+    double rtt_ms = argc > 1 ? atof(argv[1]) : DEFAULT_CMD_RTT_MS;
+    if (rtt_ms <= 0)
+    {
+        fprintf(stderr, "usage: %s [cmd_rtt_ms]\n", argv[0]);
+        return 1;
+    }
+
+    // ATE0, CPIN, CSQ, then every step, then GNSS tries of one query each
+    double old_base = OLD_INIT_SLEEPS_MS + 3 * rtt_ms + reconnect_ms("APH", rtt_ms);
+    double old_min = old_base + OLD_GNSS_TRY_MS + rtt_ms;
+    double old_max = old_base + OLD_GNSS_TRIES * (OLD_GNSS_TRY_MS + rtt_ms);
+
+    printf("Modelled host timing: AT round trip %.0f ms, old full init %.1f-%.1f s\n",
+           rtt_ms, old_min / 1000.0, old_max / 1000.0);
+    printf("%-28s %-7s %-7s %-8s %12s\n", "scenario", "dropped", "old", "redo", "reconnect_ms");
+
+    int failures = 0;
+    for (const Scenario& scenario : scenarios)
+    {
+        sim7670g_link_t link = {true, true, true, true, true, true};
+        sim7670g_link_t old_link = link;
+        bool dropped = false;
+        bool old_dropped = false;
+        for (const char* urc : scenario.urcs)
+        {
+            if (!urc)
+            {
+                break;
+            }
+            dropped |= sim7670g_parse_link_urc(urc, &link);
+            old_dropped |= strncmp(urc, "+CGEV:", 6) == 0 ? old_cgev_drop(urc)
+                                                           : sim7670g_parse_link_urc(urc, &old_link);
+        }
+
+        std::string steps = missing_steps(link);
+        bool ok = dropped == scenario.dropped && steps == scenario.missing;
+        printf("%-28s %-7s %-7s %-8s %12.0f%s\n", scenario.name, dropped ? "yes" : "no",
+               old_dropped ? "yes" : "no", steps.empty() ? "-" : steps.c_str(),
+               reconnect_ms(steps, rtt_ms), ok ? "" : "  FAIL");
+        if (!ok)
+        {
+            fprintf(stderr, "%s: expected %s, redo %s\n", scenario.name,
+                    scenario.dropped ? "drop" : "no drop", scenario.missing);
+            failures++;
+        }
+    }
+    return failures ? 1 : 0;
+}